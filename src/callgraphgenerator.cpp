@@ -8,85 +8,140 @@
 #include "callgraphgenerator.h"
 
 #include <QTextStream>
-#include <QUuid>
 
-QHash<Data::Symbol, QString> writeGraph(QTextStream& stream, const Data::Symbol& symbol,
-                                        Data::CallerCalleeResults& results, float thresholdPercent,
-                                        const QString& fontColor)
+#include <algorithm>
+
+#include "settings.h"
+
+CallGraph::CallGraph(const Data::Symbol& symbol, double thresholdPercent)
+    : m_thresholdPercent(thresholdPercent)
 {
-    auto settings = Settings::instance();
-    const auto parentId = QUuid::createUuid().toString(QUuid::Id128);
+    addNode(symbol);
+    m_nodes[0].distance[static_cast<int>(Direction::Caller)] = 0;
+    m_nodes[0].distance[static_cast<int>(Direction::Callee)] = 0;
+    m_frontier[static_cast<int>(Direction::Caller)] = {0};
+    m_frontier[static_cast<int>(Direction::Callee)] = {0};
+}
 
-    stream << "digraph callgraph {\n";
-    stream << "node [shape=box, fontname=\"monospace\", fontcolor=\"" << fontColor << "\", style=filled, color=\""
-           << settings->callgraphColor().name() << "\"]\n";
+int CallGraph::addNode(const Data::Symbol& symbol)
+{
+    auto it = m_nodeIndices.find(symbol);
+    if (it == m_nodeIndices.end()) {
+        it = m_nodeIndices.insert(symbol, m_nodes.size());
+        m_nodes.push_back({symbol, {-1, -1}});
+    }
+    return it.value();
+}
 
-    stream << "node" << parentId << " [label=\"";
-    if (symbol.prettySymbol.isEmpty()) {
-        stream << "??";
-    } else {
-        stream << symbol.prettySymbol;
+void CallGraph::expand(const Data::CallerCalleeResults& results, Direction direction, int depth)
+{
+    const auto dir = static_cast<int>(direction);
+    if (results.selfCosts.numTypes() == 0) {
+        m_frontier[dir].clear();
+    }
+    const auto totalCost = m_frontier[dir].isEmpty() ? 0 : results.selfCosts.totalCost(0);
+
+    while (m_depth[dir] < depth && !m_frontier[dir].isEmpty()) {
+        const auto distance = m_depth[dir];
+        QVector<int> frontier;
+        for (const auto node : qAsConst(m_frontier[dir])) {
+            const auto symbol = m_nodes[node].symbol;
+            if (symbol.prettySymbol.isEmpty()) {
+                continue;
+            }
+
+            const auto entry = results.entries.constFind(symbol);
+            if (entry == results.entries.constEnd()) {
+                continue;
+            }
+
+            const auto& map = direction == Direction::Callee ? entry->callees : entry->callers;
+            for (auto it = map.cbegin(), end = map.cend(); it != end; ++it) {
+                const auto cost = it.value()[0];
+                if (static_cast<double>(cost) / totalCost < m_thresholdPercent) {
+                    continue;
+                }
+
+                const auto other = addNode(it.key());
+                auto& otherDistance = m_nodes[other].distance[dir];
+                if (otherDistance == -1) {
+                    otherDistance = distance + 1;
+                    frontier.push_back(other);
+                }
+
+                if (direction == Direction::Callee) {
+                    m_edges.push_back({node, other, direction, distance});
+                } else {
+                    m_edges.push_back({other, node, direction, distance});
+                }
+            }
+        }
+        m_frontier[dir] = frontier;
+        ++m_depth[dir];
     }
-    stream << "\", color=\"" << settings->callgraphActiveColor().name() << "\"]\n";
 
-    QHash<Data::Symbol, QString> symbolToIdLookup;
-    symbolToIdLookup.insert(symbol, parentId);;
+    // nothing left to expand, so the graph is complete for any depth
+    if (m_frontier[dir].isEmpty()) {
+        m_depth[dir] = std::max(m_depth[dir], depth);
+    }
+}
 
-    resultsToDot(settings->callgraphParentDepth(), Direction::Caller, symbol, results, parentId, stream,
-                 symbolToIdLookup, thresholdPercent);
-    resultsToDot(settings->callgraphChildDepth(), Direction::Callee, symbol, results, parentId, stream,
-                 symbolToIdLookup, thresholdPercent);
+int CallGraph::depth(Direction direction) const
+{
+    return m_depth[static_cast<int>(direction)];
+}
 
-    stream << "}\n";
-    return symbolToIdLookup;
+const QVector<CallGraph::Node>& CallGraph::nodes() const
+{
+    return m_nodes;
 }
 
-void resultsToDot(int height, Direction direction, const Data::Symbol& symbol, Data::CallerCalleeResults& results,
-                  const QString& parent, QTextStream& stream, QHash<Data::Symbol, QString>& nodeIdLookup,
-                  float thresholdPercent)
+const QVector<CallGraph::Edge>& CallGraph::edges() const
 {
-    if (height == 0) {
-        return;
-    }
+    return m_edges;
+}
 
-    if (symbol.prettySymbol.isEmpty())
-        return;
+void CallGraph::writeDot(QTextStream& stream, int callerDepth, int calleeDepth, const QString& fontColor) const
+{
+    Q_ASSERT(callerDepth <= depth(Direction::Caller));
+    Q_ASSERT(calleeDepth <= depth(Direction::Callee));
 
-    if (results.selfCosts.numTypes() == 0) {
-        return;
-    }
+    auto settings = Settings::instance();
+    const int depths[2] = {callerDepth, calleeDepth};
 
-    const auto entry = results.entry(symbol);
+    stream << "digraph callgraph {\n";
+    stream << "node [shape=box, fontname=\"monospace\", fontcolor=\"" << fontColor << "\", style=filled, color=\""
+           << settings->callgraphColor().name() << "\"]\n";
 
-    auto addNode = [&stream](const QString& id, const QString& label) {
-        stream << "node" << id << " [label=\"" << label << "\"]\n";
-    };
-    auto connectNodes = [&stream, direction](const QString& parent, const QString& child) {
-        if (direction == Direction::Callee) {
-            stream << "node" << parent << " -> node" << child << "\n";
-        } else {
-            stream << "node" << child << " -> node" << parent << "\n";
-        }
+    auto label = [](const Data::Symbol& symbol) {
+        return symbol.prettySymbol.isEmpty() ? QStringLiteral("??") : symbol.prettySymbol;
     };
 
-    const auto totalCost = results.selfCosts.totalCost(0);
-    auto map = direction == Direction::Callee ? entry.callees : entry.callers;
+    stream << "node0 [label=\"" << label(m_nodes[0].symbol) << "\", color=\""
+           << settings->callgraphActiveColor().name() << "\"]\n";
+    for (int i = 1, c = m_nodes.size(); i < c; ++i) {
+        const auto& node = m_nodes[i];
+        auto isShown = [&node, &depths](int dir) {
+            return node.distance[dir] != -1 && node.distance[dir] <= depths[dir];
+        };
+        if (isShown(0) || isShown(1)) {
+            stream << "node" << i << " [label=\"" << label(node.symbol) << "\"]\n";
+        }
+    }
 
-    for (auto it = map.begin(); it != map.end(); it++) {
-        const auto cost = it.value()[0];
-        if (static_cast<double>(cost) / totalCost < thresholdPercent) {
+    // the same call can be found in both directions
+    QSet<QPair<int, int>> writtenEdges;
+    for (const auto& edge : m_edges) {
+        if (edge.distance >= depths[static_cast<int>(edge.direction)]) {
             continue;
         }
-
-        auto& key = it.key();
-        auto idIt = nodeIdLookup.find(key);
-        if (idIt == nodeIdLookup.end()) {
-            idIt = nodeIdLookup.insert(key, QUuid::createUuid().toString(QUuid::Id128));
-            addNode(idIt.value(), key.prettySymbol.isEmpty() ? QStringLiteral("??") : key.prettySymbol);
+        const auto call = qMakePair(edge.caller, edge.callee);
+        if (writtenEdges.contains(call)) {
+            continue;
         }
-        const auto nodeId = idIt.value();
-
-        connectNodes(parent, nodeId);
-        resultsToDot(height - 1, direction, key, results, nodeId, stream, nodeIdLookup, thresholdPercent);
+        writtenEdges.insert(call);
+        stream << "node" << edge.caller << " -> node" << edge.callee << "\n";
     }
+
+    stream << "}\n";
 }
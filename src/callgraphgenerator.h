@@ -7,11 +7,12 @@
 
 #pragma once
 
+#include <QSet>
+#include <QVector>
+
 #include "data.h"
-#include "models/callercalleemodel.h"
 
 class QTextStream;
-class QModelIndex;
 
 enum class Direction
 {
@@ -19,9 +20,55 @@ enum class Direction
     Callee
 };
 
-QHash<Data::Symbol, QString> writeGraph(QTextStream& stream, const Data::Symbol& symbol,
-                                        Data::CallerCalleeResults& results, float thresholdPercent,
-                                        const QString& fontColor);
-void resultsToDot(int height, Direction direction, const Data::Symbol& symbol, Data::CallerCalleeResults& results,
-                  const QString& parent, QTextStream& stream, QHash<Data::Symbol, QString>& nodeIdLookup,
-                  float thresholdPercent);
+/**
+ * The callers and callees around a symbol, built from the caller/callee results.
+ *
+ * The graph is expanded breadth first and incrementally, i.e. going one level deeper
+ * only looks at the callers or callees of the outermost nodes. Calls below the
+ * threshold are left out.
+ */
+class CallGraph
+{
+public:
+    struct Node
+    {
+        Data::Symbol symbol;
+        // the shortest distance from the root per Direction, -1 when the node wasn't reached that way
+        int distance[2] = {-1, -1};
+    };
+
+    struct Edge
+    {
+        int caller = -1;
+        int callee = -1;
+        Direction direction = Direction::Caller;
+        // the distance of the node whose expansion added this edge
+        int distance = 0;
+    };
+
+    CallGraph(const Data::Symbol& symbol, double thresholdPercent);
+
+    // does nothing when the graph is already expanded that far
+    void expand(const Data::CallerCalleeResults& results, Direction direction, int depth);
+    int depth(Direction direction) const;
+
+    // the root is the first node
+    const QVector<Node>& nodes() const;
+    const QVector<Edge>& edges() const;
+
+    // writes the graph up to the given depths, which must not exceed the expanded ones
+    // the id of a node is "node" followed by its index
+    void writeDot(QTextStream& stream, int callerDepth, int calleeDepth, const QString& fontColor) const;
+
+private:
+    int addNode(const Data::Symbol& symbol);
+
+    QVector<Node> m_nodes;
+    QHash<Data::Symbol, int> m_nodeIndices;
+    QVector<Edge> m_edges;
+    // the nodes that get expanded next, per Direction
+    QVector<int> m_frontier[2];
+    int m_depth[2] = {0, 0};
+    double m_thresholdPercent = 0;
+};
+Q_DECLARE_TYPEINFO(CallGraph::Edge, Q_MOVABLE_TYPE);
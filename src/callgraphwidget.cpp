@@ -55,7 +55,13 @@ CallgraphWidget::CallgraphWidget(const Data::CallerCalleeResults& results, KPart
 
     m_graphFile->open();
 
+    m_callGraphs.setMaxCost(100);
+    m_documents.setMaxCost(100);
+
     connect(Settings::instance(), &Settings::callgraphChanged, this, [this]{
+        // the colors are part of the documents
+        m_documents.clear();
+        m_shownKey = {};
         generateCallgraph(m_currentSymbol);
     });
 }
@@ -89,7 +95,10 @@ void CallgraphWidget::selectSymbol(const Data::Symbol& symbol)
 void CallgraphWidget::setResults(const Data::CallerCalleeResults &results)
 {
     m_callerCalleeResults = results;
-    selectSymbol(m_currentSymbol);
+    clearCaches();
+    if (m_currentSymbol.isValid()) {
+        generateCallgraph(m_currentSymbol);
+    }
 }
 
 void CallgraphWidget::hoverEnter(const QString& node)
@@ -115,7 +124,9 @@ bool CallgraphWidget::eventFilter(QObject* watched, QEvent* event)
 
         if (m_graphview->widget()->geometry().contains(e->pos())) {
             if (e->button() == Qt::MouseButton::LeftButton && !m_currentNode.isEmpty()) {
-                const auto symbol = m_symbolToId.key(m_currentNode);
+                bool ok = false;
+                const auto node = m_currentNode.toInt(&ok);
+                const auto symbol = ok ? m_nodeSymbols.value(node) : Data::Symbol();
                 if (symbol.isValid()) {
                     emit clickedOn(symbol);
                     m_currentNode.clear();
@@ -139,11 +150,12 @@ void CallgraphWidget::changeEvent(QEvent* event)
 void CallgraphWidget::showEvent(QShowEvent* event)
 {
     Q_UNUSED(event);
-    if (!m_graphview) {
+    if (!m_graphview || !m_graphOutdated) {
         return;
     }
 
     m_graphview->openUrl(QUrl::fromLocalFile(m_graphFile->fileName()));
+    m_graphOutdated = false;
 }
 
 void CallgraphWidget::generateCallgraph(const Data::Symbol& symbol)
@@ -152,23 +164,79 @@ void CallgraphWidget::generateCallgraph(const Data::Symbol& symbol)
         return;
     }
 
-    m_graphview->closeUrl();
-    m_graphFile->resize(0);
     m_currentSymbol = symbol;
 
-    QTextStream stream(m_graphFile);
-    m_symbolToId = writeGraph(stream, symbol, m_callerCalleeResults, m_thresholdPercent, m_fontColor);
-    stream.flush();
+    const auto settings = Settings::instance();
+    const GraphKey key = {symbol, settings->callgraphParentDepth(), settings->callgraphChildDepth(),
+                          m_thresholdPercent};
+    if (key == m_shownKey) {
+        return;
+    }
+
+    auto* document = m_documents.object(key);
+    if (!document) {
+        auto* graph = callGraph(symbol);
+        graph->expand(m_callerCalleeResults, Direction::Caller, key.callerDepth);
+        graph->expand(m_callerCalleeResults, Direction::Callee, key.calleeDepth);
+
+        document = new Document;
+        QTextStream stream(&document->dot);
+        graph->writeDot(stream, key.callerDepth, key.calleeDepth, m_fontColor);
+        stream.flush();
+
+        const auto& nodes = graph->nodes();
+        document->symbols.reserve(nodes.size());
+        for (const auto& node : nodes) {
+            document->symbols.append(node.symbol);
+        }
+        m_documents.insert(key, document);
+    }
+    m_nodeSymbols = document->symbols;
+
+    m_graphview->closeUrl();
+    m_graphFile->resize(0);
+    m_graphFile->write(document->dot);
+    m_graphFile->flush();
+    m_shownKey = key;
 
     // if openUrl is called before the window is open it will freeze the application
     if (isVisible()) {
         m_graphview->openUrl(QUrl::fromLocalFile(m_graphFile->fileName()));
+        m_graphOutdated = false;
+    } else {
+        m_graphOutdated = true;
+    }
+}
+
+CallGraph* CallgraphWidget::callGraph(const Data::Symbol& symbol)
+{
+    const auto key = qMakePair(symbol, m_thresholdPercent);
+    auto* graph = m_callGraphs.object(key);
+    if (!graph) {
+        graph = new CallGraph(symbol, m_thresholdPercent);
+        m_callGraphs.insert(key, graph);
     }
+    return graph;
+}
+
+void CallgraphWidget::clearCaches()
+{
+    m_callGraphs.clear();
+    m_documents.clear();
+    m_shownKey = {};
 }
 
 void CallgraphWidget::updateColors()
 {
     KColorScheme scheme(palette().currentColorGroup());
     m_interface->setBackgroundColor(scheme.background(KColorScheme::NormalBackground).color());
-    m_fontColor = scheme.foreground().color().name();
+    const auto fontColor = scheme.foreground().color().name();
+    if (fontColor != m_fontColor) {
+        m_fontColor = fontColor;
+        m_documents.clear();
+        m_shownKey = {};
+        if (m_currentSymbol.isValid()) {
+            generateCallgraph(m_currentSymbol);
+        }
+    }
 }
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <QCache>
 #include <QWidget>
 
 #include "data.h"
@@ -24,6 +25,7 @@ class QTextStream;
 
 class CallerModel;
 class CalleeModel;
+class CallGraph;
 
 namespace Ui {
 class CallgraphWidget;
@@ -58,7 +60,40 @@ private:
     CallgraphWidget(const Data::CallerCalleeResults& results, KParts::ReadOnlyPart* view,
                     KGraphViewer::KGraphViewerInterface* interface, QWidget* parent = nullptr);
 
+    struct GraphKey
+    {
+        Data::Symbol symbol;
+        int callerDepth = 0;
+        int calleeDepth = 0;
+        double thresholdPercent = -1;
+
+        bool operator==(const GraphKey& rhs) const
+        {
+            return std::tie(symbol, callerDepth, calleeDepth, thresholdPercent)
+                == std::tie(rhs.symbol, rhs.callerDepth, rhs.calleeDepth, rhs.thresholdPercent);
+        }
+
+        friend uint qHash(const GraphKey& key, uint seed = 0)
+        {
+            Util::HashCombine hash;
+            seed = hash(seed, key.symbol);
+            seed = hash(seed, key.callerDepth);
+            seed = hash(seed, key.calleeDepth);
+            return seed;
+        }
+    };
+
+    struct Document
+    {
+        QByteArray dot;
+        // indexed by the node ids
+        QVector<Data::Symbol> symbols;
+    };
+
     void generateCallgraph(const Data::Symbol& symbol);
+    // the graph for the current threshold, expanded incrementally when the depth changes
+    CallGraph* callGraph(const Data::Symbol& symbol);
+    void clearCaches();
     void updateColors();
 
     std::unique_ptr<Ui::CallgraphWidget> ui;
@@ -67,7 +102,13 @@ private:
     KParts::ReadOnlyPart* m_graphview = nullptr;
     KGraphViewer::KGraphViewerInterface* m_interface = nullptr;
     Data::CallerCalleeResults m_callerCalleeResults;
-    QHash<Data::Symbol, QString> m_symbolToId;
+    QCache<QPair<Data::Symbol, double>, CallGraph> m_callGraphs;
+    QCache<GraphKey, Document> m_documents;
+    // the graph in m_graphFile
+    GraphKey m_shownKey;
+    // whether m_graphFile changed since the viewer loaded it
+    bool m_graphOutdated = false;
+    QVector<Data::Symbol> m_nodeSymbols;
     Data::Symbol m_currentSymbol;
     QString m_currentNode;
     QString m_fontColor;
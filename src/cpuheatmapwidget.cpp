@@ -0,0 +1,323 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "cpuheatmapwidget.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <QVBoxLayout>
+
+#include "models/filterandzoomstack.h"
+#include "parsers/perf/perfparser.h"
+#include "resultsutil.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// the minimum width of a bucket in pixels, the number of buckets follows the width of the view
+const constexpr int CELL_WIDTH = 4;
+
+QRgb cellColor(quint64 value, quint64 maxValue, const QColor& idle)
+{
+    if (!value || !maxValue) {
+        return idle.rgb();
+    }
+    // the square root keeps lightly loaded buckets visible next to the busiest ones
+    const auto ratio = std::sqrt(static_cast<double>(value) / maxValue);
+    // from a pale yellow to red, like the "hot" colors of the flame graph
+    return QColor::fromHsvF((1. - ratio) / 6., 0.25 + 0.75 * ratio, 1.).rgb();
+}
+}
+
+CpuHeatmapView::CpuHeatmapView(FilterAndZoomStack* filterAndZoomStack, QWidget* parent)
+    : QWidget(parent)
+    , m_filterAndZoomStack(filterAndZoomStack)
+{
+    setMinimumHeight(100);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+CpuHeatmapView::~CpuHeatmapView() = default;
+
+void CpuHeatmapView::setHeatmap(const Data::CpuHeatmap& heatmap, Data::CpuHeatmap::Value value)
+{
+    m_heatmap = heatmap;
+    m_value = value;
+
+    // one pixel per cell, scaled up when painting
+    m_image = {};
+    if (!m_heatmap.isEmpty()) {
+        const auto idle = palette().color(QPalette::Base);
+        m_image = QImage(m_heatmap.numBuckets, m_heatmap.cpuIds.size(), QImage::Format_RGB32);
+        for (int row = 0; row < m_heatmap.cpuIds.size(); ++row) {
+            auto* line = reinterpret_cast<QRgb*>(m_image.scanLine(row));
+            for (int bucket = 0; bucket < m_heatmap.numBuckets; ++bucket) {
+                line[bucket] = cellColor(m_heatmap.cell(row, bucket), m_heatmap.maxCell, idle);
+            }
+        }
+    }
+    update();
+}
+
+void CpuHeatmapView::setTimeRange(const Data::TimeRange& time)
+{
+    m_time = time;
+}
+
+Data::TimeRange CpuHeatmapView::visibleTime() const
+{
+    const auto zoom = m_filterAndZoomStack->zoom();
+    return zoom.isValid() ? zoom.time : m_time;
+}
+
+int CpuHeatmapView::numBuckets() const
+{
+    return std::max(1, cellsRect().width() / CELL_WIDTH);
+}
+
+int CpuHeatmapView::labelWidth() const
+{
+    // independent of the CPU ids, so the number of buckets doesn't change with the data
+    return fontMetrics().horizontalAdvance(QStringLiteral("0000")) + 8;
+}
+
+QRect CpuHeatmapView::cellsRect() const
+{
+    return rect().adjusted(labelWidth(), 0, 0, 0);
+}
+
+bool CpuHeatmapView::cellAt(QPoint pos, int* row, int* bucket) const
+{
+    const auto cells = cellsRect();
+    if (m_heatmap.isEmpty() || !cells.contains(pos)) {
+        return false;
+    }
+    *row = std::min((pos.y() - cells.top()) * m_heatmap.cpuIds.size() / cells.height(), m_heatmap.cpuIds.size() - 1);
+    *bucket = std::min((pos.x() - cells.left()) * m_heatmap.numBuckets / cells.width(), m_heatmap.numBuckets - 1);
+    return true;
+}
+
+void CpuHeatmapView::paintEvent(QPaintEvent* /*event*/)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    if (m_heatmap.isEmpty()) {
+        painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+        painter.drawText(rect(), Qt::AlignCenter, tr("No samples of the selected cost on any CPU."));
+        return;
+    }
+
+    const auto cells = cellsRect();
+    painter.drawImage(cells, m_image);
+
+    // label as many rows as there is room for
+    const auto numRows = m_heatmap.cpuIds.size();
+    const auto rowHeight = static_cast<double>(cells.height()) / numRows;
+    const auto textHeight = fontMetrics().height();
+    const auto step = std::max(1, static_cast<int>(std::ceil(textHeight / rowHeight)));
+    painter.setPen(palette().color(QPalette::Text));
+    for (int row = 0; row < numRows; row += step) {
+        const QRectF labelRect(0, cells.top() + row * rowHeight, labelWidth() - 4,
+                               std::max(rowHeight, 1. * textHeight));
+        painter.drawText(labelRect, Qt::AlignRight | (step == 1 ? Qt::AlignVCenter : Qt::AlignTop),
+                         QString::number(m_heatmap.cpuIds[row]));
+    }
+}
+
+void CpuHeatmapView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    const auto buckets = numBuckets();
+    if (buckets != m_numBuckets) {
+        m_numBuckets = buckets;
+        emit numBucketsChanged();
+    }
+}
+
+bool CpuHeatmapView::event(QEvent* event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QWidget::event(event);
+    }
+
+    auto* helpEvent = static_cast<QHelpEvent*>(event);
+    int row = 0;
+    int bucket = 0;
+    if (!cellAt(helpEvent->pos(), &row, &bucket)) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+
+    const auto time = m_heatmap.bucketTime(bucket);
+    const auto start = time.start - std::min(time.start, m_time.start);
+    const auto value = m_heatmap.cell(row, bucket);
+    const auto valueText = m_value == Data::CpuHeatmap::Value::Samples
+        ? tr("Samples: %1").arg(QString::number(value))
+        : tr("Cost: %1").arg(Util::formatCost(value));
+    QToolTip::showText(helpEvent->globalPos(),
+                       tr("CPU #%1\nFrom %2 to %3\n%4\nClick to filter in on this CPU and time range.")
+                           .arg(QString::number(m_heatmap.cpuIds[row]), Util::formatTimeString(start),
+                                Util::formatTimeString(start + time.delta()), valueText),
+                       this);
+    return true;
+}
+
+void CpuHeatmapView::mousePressEvent(QMouseEvent* event)
+{
+    m_pressPos = event->pos();
+}
+
+void CpuHeatmapView::mouseReleaseEvent(QMouseEvent* event)
+{
+    int row = 0;
+    int bucket = 0;
+    int pressRow = -1;
+    int pressBucket = -1;
+    if (!cellAt(event->pos(), &row, &bucket) || !cellAt(m_pressPos, &pressRow, &pressBucket) || row != pressRow
+        || bucket != pressBucket) {
+        return;
+    }
+
+    const auto cpuId = m_heatmap.cpuIds[row];
+    const auto time = m_heatmap.bucketTime(bucket);
+    if (event->button() == Qt::LeftButton) {
+        m_filterAndZoomStack->filterInByCpuAndTime(cpuId, time);
+        return;
+    }
+    if (event->button() != Qt::RightButton) {
+        return;
+    }
+
+    auto* contextMenu = new QMenu(this);
+    contextMenu->setAttribute(Qt::WA_DeleteOnClose, true);
+    contextMenu->addAction(QIcon::fromTheme(QStringLiteral("zoom-in")), tr("Zoom In On Time Range"), this,
+                           [this, time]() { m_filterAndZoomStack->zoomIn(time); });
+    if (m_filterAndZoomStack->zoom().isValid()) {
+        contextMenu->addAction(m_filterAndZoomStack->actions().zoomOut);
+        contextMenu->addAction(m_filterAndZoomStack->actions().resetZoom);
+    }
+    if (m_filterAndZoomStack->isFilterEnabled()) {
+        contextMenu->addSeparator();
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
+                               tr("Filter In On CPU #%1 And Time Range").arg(cpuId), this,
+                               [this, cpuId, time]() { m_filterAndZoomStack->filterInByCpuAndTime(cpuId, time); });
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
+                               tr("Filter In On CPU #%1").arg(cpuId), this,
+                               [this, cpuId]() { m_filterAndZoomStack->filterInByCpu(cpuId); });
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-remove-filters")),
+                               tr("Filter Out CPU #%1").arg(cpuId), this,
+                               [this, cpuId]() { m_filterAndZoomStack->filterOutByCpu(cpuId); });
+    }
+    contextMenu->popup(event->globalPos());
+}
+
+CpuHeatmapWidget::CpuHeatmapWidget(PerfParser* parser, FilterAndZoomStack* filterAndZoomStack, QWidget* parent)
+    : QWidget(parent)
+    , m_filterAndZoomStack(filterAndZoomStack)
+    , m_costSource(new QComboBox(this))
+    , m_valueBox(new QComboBox(this))
+    , m_summary(new QLabel(this))
+    , m_view(new CpuHeatmapView(filterAndZoomStack, this))
+{
+    m_valueBox->addItem(tr("Samples"), static_cast<int>(Data::CpuHeatmap::Value::Samples));
+    m_valueBox->addItem(tr("Cost"), static_cast<int>(Data::CpuHeatmap::Value::Cost));
+    m_valueBox->setToolTip(tr("Color the cells by the number of samples or by their summed up cost."));
+
+    auto* controls = new QHBoxLayout;
+    controls->addWidget(new QLabel(tr("Cost:"), this));
+    controls->addWidget(m_costSource);
+    controls->addWidget(new QLabel(tr("Show:"), this));
+    controls->addWidget(m_valueBox);
+    controls->addWidget(m_summary, 1);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controls);
+    layout->addWidget(m_view);
+
+    setToolTip(tr("How busy every CPU was over time, the time buckets follow the zoom. Click a cell to filter in on "
+                  "its CPU and time range."));
+
+    connect(parser, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
+        ResultsUtil::fillEventSourceComboBox(m_costSource, data.costs, tr("Show the CPU heatmap for %1 events."));
+    });
+    connect(parser, &PerfParser::eventsAvailable, this, &CpuHeatmapWidget::setEvents);
+
+    connect(m_costSource, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &CpuHeatmapWidget::updateHeatmap);
+    connect(m_valueBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &CpuHeatmapWidget::updateHeatmap);
+    connect(m_filterAndZoomStack, &FilterAndZoomStack::zoomChanged, this, &CpuHeatmapWidget::updateHeatmap);
+    connect(m_view, &CpuHeatmapView::numBucketsChanged, this, &CpuHeatmapWidget::updateHeatmap);
+}
+
+CpuHeatmapWidget::~CpuHeatmapWidget() = default;
+
+void CpuHeatmapWidget::clear()
+{
+    m_jobs.cancel();
+    m_cpus = {};
+    m_summary->clear();
+    m_view->setTimeRange({});
+    m_view->setHeatmap({}, Data::CpuHeatmap::Value::Samples);
+}
+
+void CpuHeatmapWidget::setEvents(const Data::EventResults& events)
+{
+    m_cpus = events.cpus;
+
+    Data::TimeRange time;
+    if (!events.threads.isEmpty()) {
+        time = events.threads.constFirst().time;
+        for (const auto& thread : events.threads) {
+            time.start = std::min(thread.time.start, time.start);
+            time.end = std::max(thread.time.end, time.end);
+        }
+    }
+    m_view->setTimeRange(time);
+
+    updateHeatmap();
+}
+
+void CpuHeatmapWidget::updateHeatmap()
+{
+    const auto value = static_cast<Data::CpuHeatmap::Value>(m_valueBox->currentData().toInt());
+    const auto time = m_view->visibleTime();
+    if (m_cpus.isEmpty() || m_costSource->currentIndex() == -1 || !time.isValid()) {
+        m_jobs.cancel();
+        m_summary->clear();
+        m_view->setHeatmap({}, value);
+        return;
+    }
+
+    const auto cpus = m_cpus;
+    const auto costType = m_costSource->currentData().toInt();
+    const auto numBuckets = m_view->numBuckets();
+
+    m_jobs.schedule(
+        "CpuHeatmapWidget::updateHeatmap", this,
+        [cpus, costType, value, time, numBuckets](auto) {
+            return Data::CpuHeatmap::fromEvents(cpus, costType, value, time, numBuckets);
+        },
+        [this, value](const Data::CpuHeatmap& heatmap) {
+            m_view->setHeatmap(heatmap, value);
+            m_summary->setText(
+                tr("%1 CPUs, %2 per bucket")
+                    .arg(QString::number(heatmap.cpuIds.size()),
+                         Util::formatTimeString(heatmap.time.delta() / std::max(heatmap.numBuckets, 1))));
+        });
+}
@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QImage>
+#include <QWidget>
+
+#include "jobscheduler.h"
+#include "models/data.h"
+
+class QComboBox;
+class QLabel;
+
+class FilterAndZoomStack;
+class PerfParser;
+
+/**
+ * Paints a Data::CpuHeatmap with one row per CPU and the time buckets on the x-axis, the hotter the color the
+ * more samples or cost fell into the bucket. Clicking a cell filters in on that CPU and time range.
+ */
+class CpuHeatmapView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CpuHeatmapView(FilterAndZoomStack* filterAndZoomStack, QWidget* parent = nullptr);
+    ~CpuHeatmapView();
+
+    void setHeatmap(const Data::CpuHeatmap& heatmap, Data::CpuHeatmap::Value value);
+    // the time range shown when not zoomed in
+    void setTimeRange(const Data::TimeRange& time);
+
+    Data::TimeRange visibleTime() const;
+    // the number of buckets that fit into the current width
+    int numBuckets() const;
+
+signals:
+    void numBucketsChanged();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    bool event(QEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+
+private:
+    int labelWidth() const;
+    QRect cellsRect() const;
+    // returns false when pos is not on a cell
+    bool cellAt(QPoint pos, int* row, int* bucket) const;
+
+    FilterAndZoomStack* m_filterAndZoomStack;
+    Data::CpuHeatmap m_heatmap;
+    Data::CpuHeatmap::Value m_value = Data::CpuHeatmap::Value::Samples;
+    Data::TimeRange m_time;
+    QImage m_image;
+    QPoint m_pressPos;
+    int m_numBuckets = 0;
+};
+
+/**
+ * Shows how busy every CPU was over time. Unlike the per CPU rows of the time line this scales to hundreds of
+ * CPUs and hours of data, so idle CPUs and an imbalanced load can be spotted at a glance.
+ */
+class CpuHeatmapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CpuHeatmapWidget(PerfParser* parser, FilterAndZoomStack* filterAndZoomStack, QWidget* parent = nullptr);
+    ~CpuHeatmapWidget();
+
+    void clear();
+
+private:
+    void setEvents(const Data::EventResults& events);
+    void updateHeatmap();
+
+    FilterAndZoomStack* m_filterAndZoomStack;
+    QComboBox* m_costSource;
+    QComboBox* m_valueBox;
+    QLabel* m_summary;
+    CpuHeatmapView* m_view;
+    QVector<Data::CpuEvents> m_cpus;
+    JobScheduler m_jobs;
+};
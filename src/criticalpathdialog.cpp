@@ -0,0 +1,117 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "criticalpathdialog.h"
+
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "util.h"
+
+namespace {
+enum Columns
+{
+    ThreadColumn,
+    StateColumn,
+    StartColumn,
+    DurationColumn,
+    BlockedInColumn,
+    WokenByColumn,
+    NUM_COLUMNS
+};
+
+QString stateName(Data::CriticalPathSegment::State state)
+{
+    switch (state) {
+    case Data::CriticalPathSegment::State::Running:
+        return CriticalPathDialog::tr("Running");
+    case Data::CriticalPathSegment::State::Runnable:
+        return CriticalPathDialog::tr("Waiting for CPU");
+    case Data::CriticalPathSegment::State::Blocked:
+        return CriticalPathDialog::tr("Blocked");
+    }
+    Q_UNREACHABLE();
+}
+}
+
+CriticalPathDialog::CriticalPathDialog(QWidget* parent)
+    : QDialog(parent)
+    , m_summary(new QLabel(this))
+    , m_segments(new QTreeWidget(this))
+{
+    m_summary->setWordWrap(true);
+
+    m_segments->setColumnCount(NUM_COLUMNS);
+    m_segments->setHeaderLabels(
+        {tr("Thread"), tr("State"), tr("Start"), tr("Duration"), tr("Blocked In"), tr("Woken By")});
+    m_segments->setRootIsDecorated(false);
+    m_segments->setToolTip(tr("A thread that got woken up by another thread continues the path with the waker. "
+                              "The stack of the waker shows what unblocked the thread, e.g. a mutex unlock."));
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addWidget(m_summary);
+    layout->addWidget(m_segments);
+    layout->addWidget(buttons);
+
+    resize(900, 500);
+}
+
+CriticalPathDialog::~CriticalPathDialog() = default;
+
+void CriticalPathDialog::setPath(const QString& thread, const Data::TimeRange& time, const QVector<Entry>& entries)
+{
+    setWindowTitle(tr("Critical Path of %1").arg(thread));
+
+    quint64 running = 0;
+    quint64 runnable = 0;
+    quint64 blocked = 0;
+
+    m_segments->clear();
+    for (const auto& entry : entries) {
+        const auto duration = entry.time.delta();
+        switch (entry.state) {
+        case Data::CriticalPathSegment::State::Running:
+            running += duration;
+            break;
+        case Data::CriticalPathSegment::State::Runnable:
+            runnable += duration;
+            break;
+        case Data::CriticalPathSegment::State::Blocked:
+            blocked += duration;
+            break;
+        }
+
+        auto* item = new QTreeWidgetItem;
+        item->setText(ThreadColumn, entry.thread);
+        item->setText(StateColumn, stateName(entry.state));
+        item->setText(StartColumn, Util::formatTimeString(entry.time.start - time.start));
+        item->setText(DurationColumn, Util::formatTimeString(duration));
+        item->setText(BlockedInColumn, entry.blockedIn);
+        item->setText(WokenByColumn, entry.wokenBy);
+        m_segments->addTopLevelItem(item);
+    }
+
+    for (int column = 0; column < NUM_COLUMNS; ++column) {
+        m_segments->resizeColumnToContents(column);
+    }
+
+    if (entries.isEmpty()) {
+        m_summary->setText(tr("No critical path found. Record with <code>--switch-events</code> and the "
+                              "<code>sched:sched_switch</code> and <code>sched:sched_wakeup</code> tracepoints."));
+        return;
+    }
+    m_summary->setText(tr("%1 segments over %2. Running: %3, waiting for CPU: %4, blocked without known waker: %5")
+                           .arg(QString::number(entries.size()), Util::formatTimeString(time.delta()),
+                                Util::formatTimeString(running), Util::formatTimeString(runnable),
+                                Util::formatTimeString(blocked)));
+}
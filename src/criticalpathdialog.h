@@ -0,0 +1,43 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QDialog>
+
+#include "models/data.h"
+
+class QLabel;
+class QTreeWidget;
+
+/**
+ * Lists the segments of the critical path of a thread, i.e. the chain of threads that woke each other up
+ * and thereby bounded how long the thread took, e.g. a lock holder or an I/O completion.
+ */
+class CriticalPathDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    struct Entry
+    {
+        QString thread;
+        Data::CriticalPathSegment::State state = Data::CriticalPathSegment::State::Running;
+        Data::TimeRange time;
+        // the symbols are resolved in the background already
+        QString blockedIn;
+        QString wokenBy;
+    };
+
+    explicit CriticalPathDialog(QWidget* parent = nullptr);
+    ~CriticalPathDialog();
+
+    void setPath(const QString& thread, const Data::TimeRange& time, const QVector<Entry>& entries);
+
+private:
+    QLabel* m_summary;
+    QTreeWidget* m_segments;
+};
@@ -0,0 +1,448 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "flamechartwidget.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+
+#include "models/filterandzoomstack.h"
+#include "parsers/perf/perfparser.h"
+#include "resultsutil.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace {
+// similar to the "hot" colors of the flame graph, but stable across repaints
+QColor spanColor(const Data::Symbol& symbol)
+{
+    const auto hash = qHash(symbol);
+    return QColor(205 + hash % 50, (hash >> 8) % 230, (hash >> 16) % 55, 125);
+}
+
+enum ThreadRoles
+{
+    ProcessIdRole = Qt::UserRole,
+    ThreadIdRole,
+};
+}
+
+FlameChartView::FlameChartView(FilterAndZoomStack* filterAndZoomStack, QWidget* parent)
+    : QWidget(parent)
+    , m_filterAndZoomStack(filterAndZoomStack)
+{
+    setMinimumHeight(100);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    connect(m_filterAndZoomStack, &FilterAndZoomStack::zoomChanged, this, QOverload<>::of(&QWidget::update));
+    connect(m_filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, [this]() {
+        m_timeSlice = {};
+        update();
+    });
+}
+
+FlameChartView::~FlameChartView() = default;
+
+void FlameChartView::setFlameChart(const Data::FlameChart& flameChart)
+{
+    m_flameChart = flameChart;
+    m_selectedSymbolIndex = static_cast<qint32>(m_flameChart.symbols.indexOf(m_selectedSymbol));
+    setFirstDepth(m_firstDepth);
+}
+
+void FlameChartView::setTimeRange(const Data::TimeRange& time)
+{
+    m_time = time;
+    update();
+}
+
+void FlameChartView::setFirstDepth(int depth)
+{
+    m_firstDepth = qBound(0, depth, std::max(0, m_flameChart.depth() - 1));
+    update();
+}
+
+void FlameChartView::selectSymbol(const Data::Symbol& symbol)
+{
+    m_selectedSymbol = symbol;
+    m_selectedSymbolIndex = static_cast<qint32>(m_flameChart.symbols.indexOf(symbol));
+    update();
+}
+
+int FlameChartView::rowHeight() const
+{
+    return fontMetrics().height() + 4;
+}
+
+int FlameChartView::visibleDepths() const
+{
+    return height() / rowHeight();
+}
+
+Data::TimeRange FlameChartView::visibleTime() const
+{
+    const auto zoom = m_filterAndZoomStack->zoom();
+    if (zoom.isValid()) {
+        return zoom.time;
+    }
+    return m_time.isValid() ? m_time : m_flameChart.time;
+}
+
+int FlameChartView::mapTimeToX(quint64 time) const
+{
+    const auto visible = visibleTime();
+    if (time <= visible.start) {
+        return 0;
+    } else if (time >= visible.end) {
+        return width();
+    }
+    return static_cast<int>(double(time - visible.start) * width() / std::max(visible.delta(), quint64(1)));
+}
+
+quint64 FlameChartView::mapXToTime(int x) const
+{
+    const auto visible = visibleTime();
+    return visible.start + static_cast<quint64>(double(std::max(x, 0)) * visible.delta() / std::max(width(), 1));
+}
+
+int FlameChartView::currentLevel() const
+{
+    return m_flameChart.levelForResolution(visibleTime().delta() / std::max(width(), 1));
+}
+
+const Data::FlameChart::Span* FlameChartView::spanAt(QPoint pos) const
+{
+    if (pos.y() < 0) {
+        return nullptr;
+    }
+    const auto depth = m_firstDepth + pos.y() / rowHeight();
+    const auto time = mapXToTime(pos.x());
+    // tiny spans are painted one pixel wide, so look at the whole pixel
+    const auto timePerPixel = visibleTime().delta() / std::max(width(), 1);
+    const auto spans = m_flameChart.spans(currentLevel(), depth, {time, time + timePerPixel});
+    return spans.first == spans.second ? nullptr : spans.first;
+}
+
+void FlameChartView::paintEvent(QPaintEvent* /*event*/)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    if (m_flameChart.isEmpty()) {
+        painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+        painter.drawText(rect(), Qt::AlignCenter, tr("No samples with stacks for the selected thread and cost."));
+        return;
+    }
+
+    const auto time = visibleTime();
+    const auto level = currentLevel();
+    const auto height = rowHeight();
+    const auto& metrics = fontMetrics();
+    const auto minTextWidth = 3 * metrics.averageCharWidth();
+
+    for (int depth = m_firstDepth, y = 0; depth < m_flameChart.depth() && y < this->height();
+         ++depth, y += height) {
+        const auto spans = m_flameChart.spans(level, depth, time);
+        // the spans are sorted, so this paints at most one span per pixel
+        int lastRight = -1;
+        for (auto* span = spans.first; span != spans.second; ++span) {
+            const auto left = mapTimeToX(span->time.start);
+            const auto right = std::max(mapTimeToX(span->time.end), left + 1);
+            if (right <= lastRight) {
+                continue;
+            }
+            lastRight = right;
+
+            const QRect rect(left, y, right - left, height - 1);
+            if (span->symbol == -1) {
+                painter.fillRect(rect, palette().mid());
+                continue;
+            }
+
+            const auto& symbol = m_flameChart.symbols[span->symbol];
+            const auto isSelected = span->symbol == m_selectedSymbolIndex;
+            painter.fillRect(rect, isSelected ? palette().highlight().color() : spanColor(symbol));
+            if (rect.width() > minTextWidth) {
+                painter.setPen(palette().color(QPalette::Text));
+                const auto textRect = rect.adjusted(2, 0, -2, 0);
+                painter.drawText(textRect, Qt::AlignVCenter | Qt::AlignLeft,
+                                 metrics.elidedText(Util::formatSymbol(symbol), Qt::ElideRight, textRect.width()));
+            }
+        }
+    }
+
+    if (m_timeSlice.isValid()) {
+        const auto timeSlice = m_timeSlice.normalized();
+        auto color = palette().highlight().color();
+        color.setAlpha(128);
+        const auto left = mapTimeToX(timeSlice.start);
+        painter.fillRect(QRect(left, 0, mapTimeToX(timeSlice.end) - left, this->height()), color);
+    }
+}
+
+void FlameChartView::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    emit visibleDepthsChanged();
+}
+
+bool FlameChartView::event(QEvent* event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QWidget::event(event);
+    }
+
+    auto* helpEvent = static_cast<QHelpEvent*>(event);
+    const auto* span = spanAt(helpEvent->pos());
+    if (!span) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+
+    const auto duration = Util::formatTimeString(span->time.delta());
+    if (span->symbol == -1) {
+        QToolTip::showText(helpEvent->globalPos(),
+                           tr("Several short frames, zoom in to tell them apart.\nDuration: %1, samples: %2")
+                               .arg(duration, QString::number(span->samples)),
+                           this);
+    } else {
+        const auto& symbol = m_flameChart.symbols[span->symbol];
+        QToolTip::showText(helpEvent->globalPos(),
+                           tr("%1 in %2\nDuration: %3, samples: %4")
+                               .arg(Util::formatSymbol(symbol), symbol.binary, duration,
+                                    QString::number(span->samples)),
+                           this);
+    }
+    return true;
+}
+
+void FlameChartView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        const auto time = mapXToTime(event->pos().x());
+        m_timeSlice = {time, time};
+        update();
+    }
+}
+
+void FlameChartView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (event->buttons() == Qt::LeftButton) {
+        m_timeSlice.end = mapXToTime(event->pos().x());
+        update();
+    }
+}
+
+void FlameChartView::mouseReleaseEvent(QMouseEvent* event)
+{
+    const auto zoom = m_filterAndZoomStack->zoom();
+    const auto timeSlice = m_timeSlice.normalized();
+    const bool isTimeSpanSelected = event->button() == Qt::LeftButton && !timeSlice.isEmpty();
+    const auto* span = event->button() == Qt::RightButton ? spanAt(event->pos()) : nullptr;
+    if (!isTimeSpanSelected && !span && !(event->button() == Qt::RightButton && zoom.isValid())) {
+        return;
+    }
+
+    auto* contextMenu = new QMenu(this);
+    contextMenu->setAttribute(Qt::WA_DeleteOnClose, true);
+
+    if (isTimeSpanSelected) {
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("zoom-in")), tr("Zoom In On Selection"), this,
+                               [this, timeSlice]() { m_filterAndZoomStack->zoomIn(timeSlice); });
+    }
+    if (span) {
+        const auto spanTime = span->time;
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("zoom-in")), tr("Zoom In On Frame"), this,
+                               [this, spanTime]() { m_filterAndZoomStack->zoomIn(spanTime); });
+    }
+    if (event->button() == Qt::RightButton && zoom.isValid()) {
+        contextMenu->addAction(m_filterAndZoomStack->actions().zoomOut);
+        contextMenu->addAction(m_filterAndZoomStack->actions().resetZoom);
+    }
+
+    contextMenu->addSeparator();
+
+    const bool canFilter = m_filterAndZoomStack->isFilterEnabled();
+    if (canFilter && isTimeSpanSelected) {
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")), tr("Filter In On Selection"), this,
+                               [this, timeSlice]() { m_filterAndZoomStack->filterInByTime(timeSlice); });
+    }
+    if (canFilter && span) {
+        const auto spanTime = span->time;
+        contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")), tr("Filter In On Frame"), this,
+                               [this, spanTime]() { m_filterAndZoomStack->filterInByTime(spanTime); });
+    }
+
+    contextMenu->popup(event->globalPos());
+}
+
+void FlameChartView::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (const auto* span = spanAt(event->pos())) {
+        m_filterAndZoomStack->zoomIn(span->time);
+    }
+}
+
+void FlameChartView::wheelEvent(QWheelEvent* event)
+{
+    const auto delta = event->angleDelta().y();
+    if (!delta) {
+        event->ignore();
+        return;
+    }
+    setFirstDepth(m_firstDepth + (delta > 0 ? -3 : 3));
+    emit visibleDepthsChanged();
+}
+
+FlameChartWidget::FlameChartWidget(PerfParser* parser, FilterAndZoomStack* filterAndZoomStack, QWidget* parent)
+    : QWidget(parent)
+    , m_parser(parser)
+    , m_filterAndZoomStack(filterAndZoomStack)
+    , m_threadBox(new QComboBox(this))
+    , m_costSource(new QComboBox(this))
+    , m_summary(new QLabel(this))
+    , m_view(new FlameChartView(filterAndZoomStack, this))
+    , m_scrollBar(new QScrollBar(Qt::Vertical, this))
+{
+    m_threadBox->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    m_threadBox->setToolTip(tr("The thread whose samples are shown over time."));
+
+    auto* controls = new QHBoxLayout;
+    controls->addWidget(new QLabel(tr("Thread:"), this));
+    controls->addWidget(m_threadBox);
+    controls->addWidget(new QLabel(tr("Cost:"), this));
+    controls->addWidget(m_costSource);
+    controls->addWidget(m_summary, 1);
+
+    auto* chart = new QHBoxLayout;
+    chart->setSpacing(0);
+    chart->addWidget(m_view);
+    chart->addWidget(m_scrollBar);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controls);
+    layout->addLayout(chart);
+
+    setToolTip(tr("The stacks of a thread over time. Select a time range to zoom or filter in on it, "
+                  "double click a frame to zoom in on it."));
+
+    connect(parser, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
+        ResultsUtil::fillEventSourceComboBox(m_costSource, data.costs, tr("Show the flame chart for %1 events."));
+    });
+    connect(parser, &PerfParser::eventsAvailable, this, &FlameChartWidget::setEvents);
+
+    connect(m_threadBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &FlameChartWidget::updateFlameChart);
+    connect(m_costSource, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &FlameChartWidget::updateFlameChart);
+
+    connect(m_scrollBar, &QScrollBar::valueChanged, m_view, &FlameChartView::setFirstDepth);
+    connect(m_view, &FlameChartView::visibleDepthsChanged, this, &FlameChartWidget::updateScrollBar);
+}
+
+FlameChartWidget::~FlameChartWidget() = default;
+
+void FlameChartWidget::clear()
+{
+    m_jobs.cancel();
+    m_events = {};
+    m_threadBox->clear();
+    m_summary->clear();
+    m_view->setFlameChart({});
+    updateScrollBar();
+}
+
+void FlameChartWidget::selectSymbol(const Data::Symbol& symbol)
+{
+    m_view->selectSymbol(symbol);
+}
+
+void FlameChartWidget::setEvents(const Data::EventResults& events)
+{
+    m_events = events;
+
+    Data::TimeRange time;
+    if (!m_events.threads.isEmpty()) {
+        time = m_events.threads.constFirst().time;
+        for (const auto& thread : qAsConst(m_events.threads)) {
+            time.start = std::min(thread.time.start, time.start);
+            time.end = std::max(thread.time.end, time.end);
+        }
+    }
+    m_view->setTimeRange(time);
+
+    // follow a thread filter, otherwise keep the current thread
+    const auto filter = m_filterAndZoomStack->filter();
+    auto tid = filter.threadId != Data::INVALID_TID ? filter.threadId : m_threadBox->currentData(ThreadIdRole).toInt();
+
+    QSignalBlocker blocker(m_threadBox);
+    m_threadBox->clear();
+    for (const auto& thread : qAsConst(m_events.threads)) {
+        if (thread.events.isEmpty()) {
+            continue;
+        }
+        m_threadBox->addItem(tr("%1 (#%2)").arg(thread.name, QString::number(thread.tid)));
+        const auto index = m_threadBox->count() - 1;
+        m_threadBox->setItemData(index, thread.pid, ProcessIdRole);
+        m_threadBox->setItemData(index, thread.tid, ThreadIdRole);
+    }
+    m_threadBox->setCurrentIndex(std::max(0, m_threadBox->findData(tid, ThreadIdRole)));
+
+    updateFlameChart();
+}
+
+void FlameChartWidget::updateFlameChart()
+{
+    const auto pid = m_threadBox->currentData(ProcessIdRole).toInt();
+    const auto tid = m_threadBox->currentData(ThreadIdRole).toInt();
+    const auto* thread = m_events.findThread(pid, tid);
+    if (!thread || m_costSource->currentIndex() == -1) {
+        m_jobs.cancel();
+        m_summary->clear();
+        m_view->setFlameChart({});
+        updateScrollBar();
+        return;
+    }
+
+    const auto threadEvents = *thread;
+    const auto stacks = m_events.stacks;
+    const auto bottomUpData = m_parser->bottomUpResults();
+    const auto costType = m_costSource->currentData().toInt();
+
+    m_jobs.schedule(
+        "FlameChartWidget::updateFlameChart", this,
+        [threadEvents, stacks, bottomUpData, costType](auto) {
+            return Data::FlameChart::fromEvents(threadEvents, stacks, bottomUpData, costType);
+        },
+        [this](const Data::FlameChart& flameChart) {
+            m_view->setFlameChart(flameChart);
+            m_summary->setText(tr("Sampled every %1, %2 frames deep")
+                                   .arg(Util::formatTimeString(flameChart.sampleInterval),
+                                        QString::number(flameChart.depth())));
+            updateScrollBar();
+        });
+}
+
+void FlameChartWidget::updateScrollBar()
+{
+    const auto visible = m_view->visibleDepths();
+    QSignalBlocker blocker(m_scrollBar);
+    m_scrollBar->setRange(0, std::max(0, m_view->depth() - visible));
+    m_scrollBar->setPageStep(std::max(1, visible));
+    m_scrollBar->setValue(m_view->firstDepth());
+}
@@ -0,0 +1,108 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QWidget>
+
+#include "jobscheduler.h"
+#include "models/data.h"
+
+class QComboBox;
+class QLabel;
+class QScrollBar;
+
+class FilterAndZoomStack;
+class PerfParser;
+
+/**
+ * Paints the spans of a Data::FlameChart with the time on the x-axis and the stack depth on the y-axis.
+ * The visible time range follows the zoom of the FilterAndZoomStack, selecting a time range offers to zoom
+ * or filter in on it, just like in the time line.
+ */
+class FlameChartView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FlameChartView(FilterAndZoomStack* filterAndZoomStack, QWidget* parent = nullptr);
+    ~FlameChartView();
+
+    void setFlameChart(const Data::FlameChart& flameChart);
+    // the time range shown when not zoomed in
+    void setTimeRange(const Data::TimeRange& time);
+    void setFirstDepth(int depth);
+    void selectSymbol(const Data::Symbol& symbol);
+
+    int rowHeight() const;
+    int visibleDepths() const;
+    int firstDepth() const
+    {
+        return m_firstDepth;
+    }
+    int depth() const
+    {
+        return m_flameChart.depth();
+    }
+
+signals:
+    void visibleDepthsChanged();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    bool event(QEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+
+private:
+    Data::TimeRange visibleTime() const;
+    int mapTimeToX(quint64 time) const;
+    quint64 mapXToTime(int x) const;
+    int currentLevel() const;
+    const Data::FlameChart::Span* spanAt(QPoint pos) const;
+
+    FilterAndZoomStack* m_filterAndZoomStack;
+    Data::FlameChart m_flameChart;
+    Data::TimeRange m_time;
+    Data::TimeRange m_timeSlice;
+    int m_firstDepth = 0;
+    Data::Symbol m_selectedSymbol;
+    qint32 m_selectedSymbolIndex = -1;
+};
+
+/**
+ * Shows the flame chart of a single thread, i.e. the stacks of its samples in time order instead of aggregated
+ * like in the flame graph. This reveals phases, e.g. the startup, pauses or periodic work.
+ */
+class FlameChartWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FlameChartWidget(PerfParser* parser, FilterAndZoomStack* filterAndZoomStack, QWidget* parent = nullptr);
+    ~FlameChartWidget();
+
+    void clear();
+    void selectSymbol(const Data::Symbol& symbol);
+
+private:
+    void setEvents(const Data::EventResults& events);
+    void updateFlameChart();
+    void updateScrollBar();
+
+    PerfParser* m_parser;
+    FilterAndZoomStack* m_filterAndZoomStack;
+    QComboBox* m_threadBox;
+    QComboBox* m_costSource;
+    QLabel* m_summary;
+    FlameChartView* m_view;
+    QScrollBar* m_scrollBar;
+    Data::EventResults m_events;
+    JobScheduler m_jobs;
+};
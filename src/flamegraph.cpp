@@ -7,6 +7,7 @@
 
 #include "flamegraph.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QAction>
@@ -24,11 +25,13 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenu>
+#include <QPointer>
 #include <QPushButton>
 #include <QRandomGenerator>
+#include <QSaveFile>
 #include <QScrollBar>
 #include <QStyleOption>
-#include <QSvgGenerator>
+#include <QTextStream>
 #include <QToolTip>
 #include <QVBoxLayout>
 #include <QWheelEvent>
@@ -40,6 +43,7 @@
 #include <ThreadWeaver/ThreadWeaver>
 
 #include "models/filterandzoomstack.h"
+#include "phasetrace.h"
 #include "resultsutil.h"
 #include "settings.h"
 
@@ -60,6 +64,9 @@ public:
 
     qint64 cost() const;
     void setCost(qint64 cost);
+    // the cost compared to the baseline recording, zero unless comparing recordings
+    qint64 diffCost() const;
+    void setDiffCost(qint64 diffCost);
     Data::Symbol symbol() const;
 
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
@@ -76,6 +83,7 @@ protected:
 
 private:
     qint64 m_cost;
+    qint64 m_diffCost = 0;
     Data::Symbol m_symbol;
     bool m_isHovered;
     bool m_isExternallyHovered;
@@ -130,6 +138,16 @@ void FrameGraphicsItem::setCost(qint64 cost)
     m_cost = cost;
 }
 
+qint64 FrameGraphicsItem::diffCost() const
+{
+    return m_diffCost;
+}
+
+void FrameGraphicsItem::setDiffCost(qint64 diffCost)
+{
+    m_diffCost = diffCost;
+}
+
 Data::Symbol FrameGraphicsItem::symbol() const
 {
     return m_symbol;
@@ -219,23 +237,33 @@ QString FrameGraphicsItem::description() const
         return symbol;
     }
 
+    QString ret;
     switch (root->unit()) {
     case Data::Costs::Unit::Unknown:
-        return i18nc("%1: aggregated sample costs, %2: relative number, %3: function label, %4: binary, %5: cost name",
-                     "%1 (%2%) aggregated %5 costs in %3 (%4) and below.",
-                     Data::Costs::formatCost(root->unit(), m_cost), Util::formatCostRelative(m_cost, root->cost()),
-                     symbol, m_symbol.binary, root->costName());
+        ret = i18nc("%1: aggregated sample costs, %2: relative number, %3: function label, %4: binary, %5: cost name",
+                    "%1 (%2%) aggregated %5 costs in %3 (%4) and below.",
+                    Data::Costs::formatCost(root->unit(), m_cost), Util::formatCostRelative(m_cost, root->cost()),
+                    symbol, m_symbol.binary, root->costName());
+        break;
     case Data::Costs::Unit::Tracepoint:
-        return i18nc("%1: number of tracepoint events, %2: relative number, %3: function label, %4: binary",
-                     "%1 (%2%) aggregated %5 events in %3 (%4) and below.",
-                     Data::Costs::formatCost(root->unit(), m_cost), Util::formatCostRelative(m_cost, root->cost()),
-                     symbol, m_symbol.binary, root->costName());
+        ret = i18nc("%1: number of tracepoint events, %2: relative number, %3: function label, %4: binary",
+                    "%1 (%2%) aggregated %5 events in %3 (%4) and below.",
+                    Data::Costs::formatCost(root->unit(), m_cost), Util::formatCostRelative(m_cost, root->cost()),
+                    symbol, m_symbol.binary, root->costName());
+        break;
     case Data::Costs::Unit::Time:
-        return i18nc("%1: elapsed time, %2: relative number, %3: function label, %4: binary",
-                     "%1 (%2%) aggregated %5 in %3 (%4) and below.", Data::Costs::formatCost(root->unit(), m_cost),
-                     Util::formatCostRelative(m_cost, root->cost()), symbol, m_symbol.binary, root->costName());
+        ret = i18nc("%1: elapsed time, %2: relative number, %3: function label, %4: binary",
+                    "%1 (%2%) aggregated %5 in %3 (%4) and below.", Data::Costs::formatCost(root->unit(), m_cost),
+                    Util::formatCostRelative(m_cost, root->cost()), symbol, m_symbol.binary, root->costName());
+        break;
     }
-    Q_UNREACHABLE();
+
+    if (m_diffCost) {
+        ret += QLatin1Char(' ')
+            + i18nc("%1: signed cost difference", "%1 compared to the baseline.",
+                    Data::Costs::formatCost(root->unit(), m_diffCost));
+    }
+    return ret;
 }
 
 void FrameGraphicsItem::setSearchMatchType(SearchMatchType matchType)
@@ -365,9 +393,33 @@ QBrush brushSystem(const Data::Symbol& symbol)
     return user;
 }
 
-QBrush brush(const Data::Symbol& entry, Settings::ColorScheme scheme)
+QBrush brushDifference(qint64 cost, qint64 diffCost)
+{
+    // intern the brushes, from saturated blue for removed costs over white to saturated red for new costs
+    constexpr int steps = 10;
+    static const QVector<QBrush> brushes = []() {
+        QVector<QBrush> ret;
+        ret.reserve(2 * steps + 1);
+        for (int i = -steps; i <= steps; ++i) {
+            const auto ratio = static_cast<qreal>(std::abs(i)) / steps;
+            ret.append(i < 0 ? QColor::fromRgbF(1 - ratio, 1 - ratio, 1, 0.5)
+                             : QColor::fromRgbF(1, 1 - ratio, 1 - ratio, 0.5));
+        }
+        return ret;
+    }();
+
+    // relate the difference to the larger one of the comparison and the baseline cost
+    const auto baselineCost = cost - diffCost;
+    const auto ratio = static_cast<qreal>(diffCost) / std::max({cost, baselineCost, qint64(1)});
+    const auto index = qBound(-steps, qRound(ratio * steps), steps);
+    return brushes.at(index + steps);
+}
+
+QBrush brush(const Data::Symbol& entry, qint64 cost, qint64 diffCost, Settings::ColorScheme scheme)
 {
     switch (scheme) {
+    case Settings::ColorScheme::Difference:
+        return brushDifference(cost, diffCost);
     case Settings::ColorScheme::Binary:
         return brushBinary(entry);
     case Settings::ColorScheme::Kernel:
@@ -382,6 +434,11 @@ QBrush brush(const Data::Symbol& entry, Settings::ColorScheme scheme)
     return QBrush();
 }
 
+QBrush brush(const FrameGraphicsItem* item, Settings::ColorScheme scheme)
+{
+    return brush(item->symbol(), item->cost(), item->diffCost(), scheme);
+}
+
 /**
  * Layout the flame graph and hide tiny items.
  */
@@ -432,6 +489,7 @@ template<typename Tree>
 void toGraphicsItems(const Data::Costs& costs, int type, const QVector<Tree>& data, FrameGraphicsItem* parent,
                      const double costThreshold, const Settings::ColorScheme& colorScheme, bool collapseRecursion)
 {
+    const auto diffType = costs.diffType(type);
     foreach (const auto& row, data) {
         if (collapseRecursion && !row.symbol.symbol.isEmpty() && row.symbol == parent->symbol()) {
             if (costs.cost(type, row.id) > costThreshold) {
@@ -443,10 +501,14 @@ void toGraphicsItems(const Data::Costs& costs, int type, const QVector<Tree>& da
         if (!item) {
             item = new FrameGraphicsItem(costs.cost(type, row.id), row.symbol, parent);
             item->setPen(parent->pen());
-            item->setBrush(brush(row.symbol, colorScheme));
         } else {
             item->setCost(item->cost() + costs.cost(type, row.id));
         }
+        if (diffType >= 0) {
+            item->setDiffCost(item->diffCost() + costs.cost(diffType, row.id));
+        }
+        // the difference color depends on the accumulated costs
+        item->setBrush(brush(item, colorScheme));
         if (item->cost() > costThreshold) {
             toGraphicsItems(costs, type, row.children, item, costThreshold, colorScheme, collapseRecursion);
         }
@@ -471,6 +533,218 @@ FrameGraphicsItem* parseData(const Data::Costs& costs, int type, const QVector<T
     return rootItem;
 }
 
+/**
+ * The children of a frame in the exported flame graph, merged by symbol like in toGraphicsItems.
+ * Only the frames along the current path are kept in memory while streaming.
+ */
+template<typename Tree>
+struct ExportFrame
+{
+    Data::Symbol symbol;
+    qint64 cost = 0;
+    qint64 diffCost = 0;
+    QVector<const QVector<Tree>*> children;
+};
+
+struct ExportContext
+{
+    const Data::Costs* costs = nullptr;
+    int type = 0;
+    int diffType = -1;
+    // absolute cost, frames below that are not expanded
+    double costThreshold = 0;
+    bool collapseRecursion = false;
+};
+
+// rows maps the symbols to their index in frames, a linear search gets quadratic for wide frames
+template<typename Tree>
+void mergeExportFrames(const ExportContext& context, const QVector<Tree>& data, const Data::Symbol& parentSymbol,
+                       QVector<ExportFrame<Tree>>* frames, QHash<Data::Symbol, int>* rows)
+{
+    for (const auto& row : data) {
+        const auto cost = context.costs->cost(context.type, row.id);
+        if (context.collapseRecursion && !row.symbol.symbol.isEmpty() && row.symbol == parentSymbol) {
+            if (cost > context.costThreshold) {
+                mergeExportFrames(context, row.children, parentSymbol, frames, rows);
+            }
+            continue;
+        }
+        auto it = rows->find(row.symbol);
+        if (it == rows->end()) {
+            it = rows->insert(row.symbol, frames->size());
+            ExportFrame<Tree> frame;
+            frame.symbol = row.symbol;
+            frames->append(frame);
+        }
+        auto& frame = (*frames)[*it];
+        frame.cost += cost;
+        if (context.diffType >= 0) {
+            frame.diffCost += context.costs->cost(context.diffType, row.id);
+        }
+        frame.children.append(&row.children);
+    }
+}
+
+/**
+ * Walk the visible frames depth first with the same layout as layoutItems, the callback gets the frame,
+ * its x position and width and its depth, starting at 1 for the children of the root.
+ */
+template<typename Tree, typename Callback>
+void walkExportFrames(const ExportContext& context, const ExportFrame<Tree>& parent, qreal x, qreal width, int depth,
+                      const Callback& callback)
+{
+    if (parent.cost <= context.costThreshold) {
+        return;
+    }
+
+    QVector<ExportFrame<Tree>> frames;
+    QHash<Data::Symbol, int> rows;
+    for (const auto* children : parent.children) {
+        mergeExportFrames(context, *children, parent.symbol, &frames, &rows);
+    }
+    // sort to get reproducible graphs
+    std::sort(frames.begin(), frames.end(), [](const ExportFrame<Tree>& lhs, const ExportFrame<Tree>& rhs) {
+        return lhs.symbol < rhs.symbol;
+    });
+
+    for (const auto& frame : qAsConst(frames)) {
+        const qreal w = width * double(frame.cost) / parent.cost;
+        if (w <= 1) {
+            continue;
+        }
+        callback(frame, x, w, depth);
+        walkExportFrames(context, frame, x, w, depth + 1, callback);
+        x += w;
+    }
+}
+
+QString svgColor(const QColor& color)
+{
+    return QStringLiteral("fill=\"rgb(%1,%2,%3)\" fill-opacity=\"%4\"")
+        .arg(QString::number(color.red()), QString::number(color.green()), QString::number(color.blue()),
+             QString::number(color.alphaF(), 'f', 2));
+}
+
+template<typename Tree>
+bool writeSvgImpl(QIODevice* device, const Data::Costs& costs, const QVector<Tree>& data,
+                  const FlameGraph::ExportSettings& settings)
+{
+    const auto totalCost = costs.totalCost(settings.costType);
+
+    ExportContext context;
+    context.costs = &costs;
+    context.type = settings.costType;
+    context.diffType = costs.diffType(settings.costType);
+    context.costThreshold = static_cast<double>(totalCost) * settings.costThreshold / 100.;
+    context.collapseRecursion = settings.collapseRecursion;
+
+    ExportFrame<Tree> root;
+    root.cost = totalCost;
+    root.children.append(&data);
+
+    const int imageWidth = 1200;
+    const int frameHeight = 16;
+    const int margin = 10;
+    const int headerHeight = 50;
+    const qreal frameWidth = imageWidth - 2 * margin;
+    // the first pass only finds the height of the image, so that we never have to keep the frames around
+    int maxDepth = 0;
+    walkExportFrames(context, root, margin, frameWidth, 1,
+                     [&maxDepth](const ExportFrame<Tree>& /*frame*/, qreal /*x*/, qreal /*width*/, int depth) {
+                         maxDepth = std::max(maxDepth, depth);
+                     });
+    const int imageHeight = headerHeight + (maxDepth + 1) * frameHeight + margin;
+
+    QTextStream stream(device);
+    stream.setCodec("UTF-8");
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+           << "<svg version=\"1.1\" xmlns=\"http://www.w3.org/2000/svg\" width=\"" << imageWidth << "\" height=\""
+           << imageHeight << "\" viewBox=\"0 0 " << imageWidth << ' ' << imageHeight << "\">\n"
+           << "<title>" << settings.title.toHtmlEscaped() << "</title>\n"
+           << "<desc>" << settings.description.toHtmlEscaped() << "</desc>\n"
+           << "<rect x=\"0\" y=\"0\" width=\"100%\" height=\"100%\" fill=\"white\"/>\n"
+           << "<g font-family=\"Verdana, sans-serif\" font-size=\"12\">\n"
+           << "<text x=\"" << imageWidth / 2 << "\" y=\"24\" font-size=\"17\" text-anchor=\"middle\">"
+           << settings.title.toHtmlEscaped() << "</text>\n";
+
+    auto writeFrame = [&stream](qreal x, qreal y, qreal width, const QString& tooltip, const QString& label,
+                                const QString& fill) {
+        stream << "<g><title>" << tooltip.toHtmlEscaped() << "</title><rect x=\"" << QString::number(x, 'f', 1)
+               << "\" y=\"" << QString::number(y, 'f', 1) << "\" width=\"" << QString::number(width, 'f', 1)
+               << "\" height=\"" << frameHeight - 1 << "\" " << fill << "/>";
+        // approximate the text width like flamegraph.pl does, as we cannot measure it without a font
+        const int maxChars = static_cast<int>((width - 6) / 7);
+        if (maxChars >= 3) {
+            const auto text = label.size() > maxChars ? label.left(maxChars - 2) + QLatin1String("..") : label;
+            stream << "<text x=\"" << QString::number(x + 3, 'f', 1) << "\" y=\""
+                   << QString::number(y + frameHeight - 4, 'f', 1) << "\">" << text.toHtmlEscaped() << "</text>";
+        }
+        stream << "</g>\n";
+    };
+    auto frameY = [imageHeight](int depth) { return imageHeight - margin - (depth + 1) * frameHeight; };
+
+    const auto totalLabel = i18n("%1 aggregated %2 cost in total", costs.formatCost(settings.costType, totalCost),
+                                 costs.typeName(settings.costType));
+    writeFrame(margin, frameY(0), frameWidth, totalLabel, totalLabel,
+               QStringLiteral("fill=\"white\" stroke=\"black\" stroke-width=\"0.5\""));
+
+    walkExportFrames(
+        context, root, margin, frameWidth, 1,
+        [&](const ExportFrame<Tree>& frame, qreal x, qreal width, int depth) {
+            const auto symbol = Util::formatSymbol(frame.symbol, false);
+            const auto label = symbol.isEmpty() ? i18n("?? [%1]", Util::formatString(frame.symbol.binary)) : symbol;
+            auto tooltip = i18nc("%1: function label, %2: binary, %3: cost, %4: relative number",
+                                 "%1 (%2): %3 (%4%)", label, Util::formatString(frame.symbol.binary),
+                                 costs.formatCost(settings.costType, frame.cost),
+                                 Util::formatCostRelative(frame.cost, totalCost));
+            if (frame.diffCost) {
+                tooltip += QLatin1Char(' ')
+                    + i18nc("%1: signed cost difference", "%1 compared to the baseline.",
+                            costs.formatCost(settings.costType, frame.diffCost));
+            }
+            const auto color = brush(frame.symbol, frame.cost, frame.diffCost, settings.colorScheme).color();
+            writeFrame(x, frameY(depth), width, tooltip, label, svgColor(color));
+        });
+
+    stream << "</g>\n</svg>\n";
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+QString foldedFrameName(const Data::Symbol& symbol)
+{
+    auto name = symbol.symbol.isEmpty() ? (QLatin1Char('[') + Util::formatString(symbol.binary) + QLatin1Char(']'))
+                                        : Util::formatSymbol(symbol, false);
+    // the separators of the folded format must not appear in the frames
+    name.replace(QLatin1Char(';'), QLatin1Char(':'));
+    name.replace(QLatin1Char('\n'), QLatin1Char(' '));
+    // the annotation used by stackcollapse-perf.pl, so that flamegraph.pl --color=java highlights kernel frames
+    if (symbol.isKernel) {
+        name += QLatin1String("_[k]");
+    }
+    return name;
+}
+
+void writeFoldedStacksImpl(QTextStream& stream, const Data::Costs& selfCosts, int type,
+                           const QVector<Data::TopDown>& data, QString* stack)
+{
+    for (const auto& row : data) {
+        const auto oldSize = stack->size();
+        if (oldSize) {
+            stack->append(QLatin1Char(';'));
+        }
+        stack->append(foldedFrameName(row.symbol));
+
+        const auto cost = selfCosts.cost(type, row.id);
+        if (cost > 0) {
+            stream << *stack << ' ' << cost << '\n';
+        }
+        writeFoldedStacksImpl(stream, selfCosts, type, row.children, stack);
+
+        stack->truncate(oldSize);
+    }
+}
+
 struct SearchResults
 {
     SearchMatchType matchType = NoMatch;
@@ -561,7 +835,7 @@ void hoverStacks(FrameGraphicsItem* rootItem, const QVector<QVector<Data::Symbol
 
 void updateFlameGraphColorScheme(FrameGraphicsItem* item, Settings::ColorScheme scheme)
 {
-    item->setBrush(brush(item->symbol(), scheme));
+    item->setBrush(brush(item, scheme));
     const auto children = item->childItems();
     for (const auto& child : children) {
         updateFlameGraphColorScheme(static_cast<FrameGraphicsItem*>(child), scheme);
@@ -713,6 +987,12 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
     m_colorSchemeSelector->addItem(tr("Binary"), QVariant::fromValue(Settings::ColorScheme::Binary));
     m_colorSchemeSelector->addItem(tr("Kernel"), QVariant::fromValue(Settings::ColorScheme::Kernel));
     m_colorSchemeSelector->addItem(tr("System"), QVariant::fromValue(Settings::ColorScheme::System));
+    m_colorSchemeSelector->addItem(tr("Difference"), QVariant::fromValue(Settings::ColorScheme::Difference));
+    m_colorSchemeSelector->setItemData(
+        m_colorSchemeSelector->count() - 1,
+        tr("When comparing two recordings, frames whose costs increased compared to the baseline are colored red "
+           "and frames whose costs decreased are colored blue."),
+        Qt::ToolTipRole);
 
     auto setColorScheme = [this](Settings::ColorScheme scheme) {
         Settings::instance()->setColorScheme(scheme);
@@ -885,36 +1165,95 @@ QImage FlameGraph::toImage() const
     return image;
 }
 
-void FlameGraph::saveSvg(const QString& fileName) const
+void FlameGraph::saveSvg(const QString& fileName)
 {
-    if (!m_rootItem)
-        return;
+    saveInBackground(fileName, ExportFormat::Svg);
+}
 
-    const auto sceneRect = m_scene->sceneRect();
+void FlameGraph::saveFoldedStacks(const QString& fileName)
+{
+    saveInBackground(fileName, ExportFormat::FoldedStacks);
+}
+
+bool FlameGraph::writeSvg(QIODevice* device, const Data::BottomUpResults& bottomUpData,
+                          const Data::TopDownResults& topDownData, const ExportSettings& settings)
+{
+    PHASE_TRACE("FlameGraph::writeSvg");
+    if (settings.showBottomUpData) {
+        return writeSvgImpl(device, bottomUpData.costs, bottomUpData.root.children, settings);
+    }
+    return writeSvgImpl(device, topDownData.inclusiveCosts, topDownData.root.children, settings);
+}
+
+bool FlameGraph::writeFoldedStacks(QIODevice* device, const Data::TopDownResults& topDownData, int costType)
+{
+    PHASE_TRACE("FlameGraph::writeFoldedStacks");
+    QTextStream stream(device);
+    stream.setCodec("UTF-8");
+    QString stack;
+    writeFoldedStacksImpl(stream, topDownData.selfCosts, costType, topDownData.root.children, &stack);
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+QString FlameGraph::writeFile(const QString& fileName, ExportFormat format, const Data::BottomUpResults& bottomUpData,
+                              const Data::TopDownResults& topDownData, const ExportSettings& settings)
+{
+    // only replace an existing file once the export succeeded
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return file.errorString();
+    }
 
-    QSvgGenerator generator;
-    generator.setSize(sceneRect.size().toSize());
-    generator.setViewBox({{0, 0}, sceneRect.size()});
-    generator.setFileName(fileName);
-    if (m_showBottomUpData)
-        generator.setTitle(tr("Bottom Up FlameGraph"));
-    else
-        generator.setTitle(tr("Top Down FlameGraph"));
-    const auto costType = m_bottomUpData.costs.typeName(m_costSource->currentData().value<int>());
-    generator.setDescription(tr("Cost type: %1, cost threshold: %2\n%3")
-                                 .arg(costType, QString::number(m_costThreshold), m_displayLabel->text())
-                                 .toHtmlEscaped());
+    const bool written = format == ExportFormat::Svg
+        ? writeSvg(&file, bottomUpData, topDownData, settings)
+        : writeFoldedStacks(&file, topDownData, settings.costType);
+    if (!written || !file.commit()) {
+        return file.errorString();
+    }
+    return {};
+}
 
-    const auto oldPen = m_rootItem->pen();
-    const auto oldBrush = m_rootItem->brush();
-    m_rootItem->setPen(QPen(Qt::black));
-    m_rootItem->setBrush(QBrush(Qt::white));
+FlameGraph::ExportSettings FlameGraph::exportSettings() const
+{
+    ExportSettings settings;
+    settings.costType = m_costSource->currentData().value<int>();
+    settings.showBottomUpData = m_showBottomUpData;
+    settings.collapseRecursion = m_collapseRecursion;
+    settings.costThreshold = m_costThreshold;
+    settings.colorScheme = Settings::instance()->colorScheme();
+    settings.title = m_showBottomUpData ? tr("Bottom Up FlameGraph") : tr("Top Down FlameGraph");
+    settings.description = tr("Cost type: %1, cost threshold: %2\n%3")
+                               .arg(m_bottomUpData.costs.typeName(settings.costType),
+                                    QString::number(m_costThreshold), m_displayLabel->text());
+    return settings;
+}
 
-    QPainter painter(&generator);
-    m_scene->render(&painter, generator.viewBoxF(), sceneRect);
+void FlameGraph::saveInBackground(const QString& fileName, ExportFormat format)
+{
+    if ((m_showBottomUpData && !m_bottomUpData.costs.numTypes()) || !m_topDownData.selfCosts.numTypes()) {
+        return;
+    }
 
-    m_rootItem->setPen(oldPen);
-    m_rootItem->setBrush(oldBrush);
+    using namespace ThreadWeaver;
+    auto bottomUpData = m_bottomUpData;
+    auto topDownData = m_topDownData;
+    const auto settings = exportSettings();
+    // the flame graph may get destroyed while the file gets written, so only check it on the GUI thread
+    QPointer<FlameGraph> smartThis(this);
+    stream() << make_job([fileName, format, bottomUpData, topDownData, settings, smartThis]() {
+        const auto errorMessage = writeFile(fileName, format, bottomUpData, topDownData, settings);
+        if (!errorMessage.isEmpty()) {
+            QMetaObject::invokeMethod(
+                qApp,
+                [smartThis, errorMessage]() {
+                    if (smartThis) {
+                        emit smartThis->exportFailed(errorMessage);
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+    });
 }
 
 void FlameGraph::showData()
@@ -938,6 +1277,7 @@ void FlameGraph::showData()
     const auto colorScheme = Settings::instance()->colorScheme();
     stream() << make_job(
         [showBottomUpData, bottomUpData, topDownData, type, threshold, colorScheme, collapseRecursion, this]() {
+            PHASE_TRACE("FlameGraph::parseData");
             FrameGraphicsItem* parsedData = nullptr;
             if (showBottomUpData) {
                 parsedData = parseData(bottomUpData.costs, type, bottomUpData.root.children, threshold, colorScheme,
@@ -12,9 +12,12 @@
 
 #include <models/data.h>
 
+#include "settings.h"
+
 class QGraphicsScene;
 class QGraphicsView;
 class QComboBox;
+class QIODevice;
 class QLabel;
 class QLineEdit;
 class QPushButton;
@@ -38,7 +41,38 @@ public:
     void clear();
 
     QImage toImage() const;
-    void saveSvg(const QString& fileName) const;
+    // both write the file in the background and emit exportFailed on errors
+    void saveSvg(const QString& fileName);
+    void saveFoldedStacks(const QString& fileName);
+
+    enum class ExportFormat
+    {
+        Svg,
+        FoldedStacks
+    };
+
+    // cost threshold in percent, items below that value will not be shown
+    static const constexpr double DEFAULT_COST_THRESHOLD = 0.1;
+
+    struct ExportSettings
+    {
+        int costType = 0;
+        bool showBottomUpData = false;
+        bool collapseRecursion = false;
+        double costThreshold = DEFAULT_COST_THRESHOLD;
+        Settings::ColorScheme colorScheme = Settings::ColorScheme::Default;
+        QString title;
+        QString description;
+    };
+
+    // the writers walk the results directly instead of the scene, the memory use only grows with the stack depth
+    static bool writeSvg(QIODevice* device, const Data::BottomUpResults& bottomUpData,
+                         const Data::TopDownResults& topDownData, const ExportSettings& settings);
+    // one line per stack with its self cost, the format of stackcollapse-perf.pl as read by flamegraph.pl
+    static bool writeFoldedStacks(QIODevice* device, const Data::TopDownResults& topDownData, int costType);
+    // blocks until the file got written, returns the error message on failure
+    static QString writeFile(const QString& fileName, ExportFormat format, const Data::BottomUpResults& bottomUpData,
+                             const Data::TopDownResults& topDownData, const ExportSettings& settings);
 
 protected:
     bool eventFilter(QObject* object, QEvent* event) override;
@@ -56,6 +90,7 @@ signals:
     void selectStack(const QVector<Data::Symbol>& stack);
     void jumpToDisassembly(const Data::Symbol& symbol);
     void uiResetRequested();
+    void exportFailed(const QString& errorMessage);
 
 private:
     void setTooltipItem(const FrameGraphicsItem* item);
@@ -65,6 +100,8 @@ private:
     void selectItem(FrameGraphicsItem* item);
     void updateNavigationActions();
     void rebuild();
+    ExportSettings exportSettings() const;
+    void saveInBackground(const QString& fileName, ExportFormat format);
 
     Data::TopDownResults m_topDownData;
     Data::BottomUpResults m_bottomUpData;
@@ -91,8 +128,6 @@ private:
     bool m_showBottomUpData = false;
     bool m_collapseRecursion = false;
     bool m_buildingScene = false;
-    // cost threshold in percent, items below that value will not be shown
-    static const constexpr double DEFAULT_COST_THRESHOLD = 0.1;
     double m_costThreshold = DEFAULT_COST_THRESHOLD;
     QVector<QVector<Data::Symbol>> m_hoveredStacks;
 };
@@ -12,16 +12,14 @@
 #include <KColorScheme>
 #include <QDebug>
 
+#include <algorithm>
+#include <limits>
+
 #include "parsers/perf/perfparser.h"
 #include "ui_frequencypage.h"
 #include "util.h"
 
 namespace {
-struct PlotData
-{
-    quint64 applicationStartTime = 0;
-};
-
 class TimeAxis : public QCPAxisTicker
 {
 public:
@@ -51,12 +49,11 @@ FrequencyPage::FrequencyPage(PerfParser* parser, QWidget* parent)
 
     m_page->layout->replaceWidget(m_page->plotWidget, m_plot);
 
-    auto plotData = QSharedPointer<PlotData>::create();
-
-    connect(parser, &PerfParser::summaryDataAvailable,
-            [plotData](const Data::Summary data) { plotData->applicationStartTime = data.applicationTime.start; });
+    connect(parser, &PerfParser::summaryDataAvailable, this,
+            [this](const Data::Summary& data) { m_applicationStartTime = data.applicationTime.start; });
 
     connect(parser, &PerfParser::frequencyDataAvailable, this, [this](const Data::FrequencyResults& results) {
+        m_graphs.clear();
         m_results = results;
 
         m_page->costSelectionCombobox->clear();
@@ -72,49 +69,69 @@ FrequencyPage::FrequencyPage(PerfParser* parser, QWidget* parent)
         }
     });
 
-    connect(m_page->costSelectionCombobox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
-            [this, plotData]() {
-                m_plot->clearGraphs();
-                const auto selectedCost = m_page->costSelectionCombobox->currentText();
-                const auto numCores = m_results.cores.size();
-                quint32 core = 0;
-                for (const auto& coreData : m_results.cores) {
-                    for (const auto& costData : coreData.costs) {
-                        if (costData.costName != selectedCost) {
-                            continue;
-                        }
-
-                        auto graph = m_plot->addGraph();
-                        graph->setLayer(QStringLiteral("main"));
-                        graph->setLineStyle(QCPGraph::lsNone);
-
-                        auto color = QColor::fromHsv(static_cast<int>(255. * (static_cast<float>(core) / numCores)),
-                                                     255, 255, 150);
-                        graph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssSquare, color, color, 4));
-                        graph->setAdaptiveSampling(false);
-                        graph->setName(QLatin1String("%1 (CPU #%2)").arg(costData.costName, QString::number(core)));
-                        graph->addToLegend();
-                        graph->setVisible(true);
-
-                        const auto numValues = costData.values.size();
-                        QVector<double> times(numValues);
-                        QVector<double> costs(numValues);
-                        for (int i = 0; i < numValues; ++i) {
-                            const auto value = costData.values[i];
-                            const auto time = static_cast<double>(value.time - plotData->applicationStartTime);
-                            times[i] = time;
-                            costs[i] = value.cost;
-                        }
-                        graph->setData(times, costs, true);
-                    }
-
-                    ++core;
+    connect(m_page->costSelectionCombobox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        m_plot->clearPlottables();
+        m_graphs.clear();
+        const auto selectedCost = m_page->costSelectionCombobox->currentText();
+        const auto numCores = m_results.cores.size();
+        auto start = std::numeric_limits<quint64>::max();
+        quint64 end = 0;
+        for (int core = 0; core < numCores; ++core) {
+            const auto& coreData = m_results.cores[core];
+            for (int cost = 0, numCosts = coreData.costs.size(); cost < numCosts; ++cost) {
+                const auto& costData = coreData.costs[cost];
+                if (costData.costName != selectedCost || costData.levels.isEmpty()
+                    || costData.levels.last().isEmpty()) {
+                    continue;
                 }
-                m_plot->xAxis->rescale();
-                m_plot->yAxis->rescale();
-                m_plot->yAxis->setRangeLower(0.);
-                m_plot->replot(QCustomPlot::rpQueuedRefresh);
-            });
+
+                auto graph = m_plot->addGraph();
+                graph->setLayer(QStringLiteral("main"));
+                graph->setLineStyle(QCPGraph::lsNone);
+
+                auto color =
+                    QColor::fromHsv(static_cast<int>(255. * (static_cast<float>(core) / numCores)), 255, 255, 150);
+                graph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssSquare, color, color, 4));
+                // the data is already downsampled to the current viewport, see updateGraphData
+                graph->setAdaptiveSampling(false);
+                graph->setName(QLatin1String("%1 (CPU #%2)").arg(costData.costName, QString::number(core)));
+                graph->addToLegend();
+                graph->setVisible(true);
+
+                // show the min/max range of every bucket around its mean value
+                auto errorBars = new QCPErrorBars(m_plot->xAxis, m_plot->yAxis);
+                errorBars->removeFromLegend();
+                errorBars->setDataPlottable(graph);
+                errorBars->setPen(QPen(color));
+
+                m_graphs.push_back({graph, errorBars, core, cost});
+
+                const auto& coarsest = costData.levels.last();
+                start = std::min(start, coarsest.first().time);
+                end = std::max(end, coarsest.last().time
+                                   + Data::PerCostFrequencyData::bucketWidth(costData.levels.size() - 1));
+            }
+        }
+
+        if (m_graphs.isEmpty()) {
+            m_plot->replot(QCustomPlot::rpQueuedRefresh);
+            return;
+        }
+
+        // this triggers updateGraphData through the rangeChanged signal
+        m_plot->xAxis->setRange(static_cast<double>(start) - static_cast<double>(m_applicationStartTime),
+                                static_cast<double>(end) - static_cast<double>(m_applicationStartTime));
+        m_plot->yAxis->rescale();
+        m_plot->yAxis->setRangeLower(0.);
+        m_plot->replot(QCustomPlot::rpQueuedRefresh);
+    });
+
+    connect(m_plot->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), this,
+            &FrequencyPage::updateGraphData);
+
+    m_plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    m_plot->axisRect()->setRangeDrag(Qt::Horizontal);
+    m_plot->axisRect()->setRangeZoom(Qt::Horizontal);
 
     m_plot->xAxis->setLabel(tr("Time"));
     m_plot->xAxis->setTicker(QSharedPointer<TimeAxis>(new TimeAxis()));
@@ -124,6 +141,52 @@ FrequencyPage::FrequencyPage(PerfParser* parser, QWidget* parent)
 
 FrequencyPage::~FrequencyPage() = default;
 
+void FrequencyPage::updateGraphData()
+{
+    const auto range = m_plot->xAxis->range();
+    const auto start = m_applicationStartTime + static_cast<quint64>(std::max(0., range.lower));
+    const auto end = m_applicationStartTime + static_cast<quint64>(std::max(0., range.upper));
+    // don't feed more than one bucket per pixel into the plot
+    const auto maxBuckets = std::max(1, m_plot->axisRect()->width());
+
+    for (const auto& graph : qAsConst(m_graphs)) {
+        const auto& costData = m_results.cores[graph.core].costs[graph.cost];
+        const auto level = costData.levelForRange(end > start ? end - start : 0, maxBuckets);
+        if (level < 0) {
+            continue;
+        }
+
+        const auto& buckets = costData.levels[level];
+        const auto width = Data::PerCostFrequencyData::bucketWidth(level);
+        const auto firstTime = start > width ? start - width : 0;
+        auto it = std::lower_bound(buckets.begin(), buckets.end(), firstTime,
+                                   [](const Data::FrequencyBucket& bucket, quint64 time) { return bucket.time < time; });
+        const auto last = std::upper_bound(
+            it, buckets.end(), end, [](quint64 time, const Data::FrequencyBucket& bucket) { return time < bucket.time; });
+
+        const auto numBuckets = static_cast<int>(std::distance(it, last));
+        QVector<double> times;
+        times.reserve(numBuckets);
+        QVector<double> means;
+        means.reserve(numBuckets);
+        QVector<double> errorMinus;
+        errorMinus.reserve(numBuckets);
+        QVector<double> errorPlus;
+        errorPlus.reserve(numBuckets);
+        for (; it != last; ++it) {
+            times.push_back(static_cast<double>(it->time) + width / 2.
+                            - static_cast<double>(m_applicationStartTime));
+            means.push_back(it->mean);
+            errorMinus.push_back(it->mean - it->min);
+            errorPlus.push_back(it->max - it->mean);
+        }
+        graph.graph->setData(times, means, true);
+        graph.errorBars->setData(errorMinus, errorPlus);
+    }
+
+    m_plot->replot(QCustomPlot::rpQueuedRefresh);
+}
+
 void FrequencyPage::changeEvent(QEvent *event)
 {
     if (event->type() == QEvent::PaletteChange) {
@@ -13,6 +13,8 @@
 
 class PerfParser;
 class QCustomPlot;
+class QCPGraph;
+class QCPErrorBars;
 
 namespace Ui {
 class FrequencyPage;
@@ -30,8 +32,20 @@ protected:
 
 private:
     void updateColors();
+    // feed the graphs with the bucket level that matches the visible time range
+    void updateGraphData();
+
+    struct Graph
+    {
+        QCPGraph* graph = nullptr;
+        QCPErrorBars* errorBars = nullptr;
+        int core = 0;
+        int cost = 0;
+    };
 
     QCustomPlot *m_plot = nullptr;
     QScopedPointer<Ui::FrequencyPage> m_page;
     Data::FrequencyResults m_results;
+    QVector<Graph> m_graphs;
+    quint64 m_applicationStartTime = 0;
 };
@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QCoreApplication>
+#include <QPointer>
+
+#include <ThreadWeaver/ThreadWeaver>
+
+#include <atomic>
+#include <memory>
+
+#include "phasetrace.h"
+
+/**
+ * Runs jobs in the background and hands their results to the GUI thread. Only the results of the latest job get
+ * applied, scheduling another job or cancelling lets the running one stop early.
+ *
+ * The jobs only share the job id with the scheduler, they never access the object that owns it. So that object
+ * may get destroyed while a job is still running.
+ */
+class JobScheduler
+{
+public:
+    JobScheduler()
+        : m_currentJobId(std::make_shared<std::atomic<uint>>(0))
+    {
+    }
+
+    ~JobScheduler()
+    {
+        cancel();
+    }
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    // name must be a string literal, it is used for the phase trace
+    // job is called with a functor that returns true once the job got cancelled and should return early
+    // setData is called on the GUI thread, unless the job got cancelled or the context got destroyed meanwhile
+    template<typename Context, typename Job, typename SetData>
+    void schedule(const char* name, Context* context, Job&& job, SetData&& setData)
+    {
+        const auto currentJobId = m_currentJobId;
+        const auto jobId = ++(*currentJobId);
+        auto jobCancelled = [currentJobId, jobId]() { return jobId != *currentJobId; };
+        QPointer<Context> smartContext(context);
+
+        using namespace ThreadWeaver;
+        stream() << make_job([name, smartContext, jobCancelled, job, setData]() {
+            PhaseTrace::Scope trace(name);
+            if (jobCancelled())
+                return;
+            auto results = job(jobCancelled);
+
+            // the context may get destroyed meanwhile, so only check it on the GUI thread
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [smartContext, results, jobCancelled, setData]() {
+                    if (smartContext && !jobCancelled()) {
+                        setData(results);
+                    }
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    // drops the results of the running job
+    void cancel()
+    {
+        ++(*m_currentJobId);
+    }
+
+private:
+    std::shared_ptr<std::atomic<uint>> m_currentJobId;
+};
@@ -13,14 +13,18 @@
 #include <QProcessEnvironment>
 
 #include "dockwidgetsetup.h"
+#include "flamegraph.h"
 #include "hotspot-config.h"
 #include "mainwindow.h"
 #include "models/data.h"
+#include "parsers/perf/perfparser.h"
+#include "phasetrace.h"
 #include "settings.h"
 #include "util.h"
 
 #include <ThreadWeaver/ThreadWeaver>
 #include <QThread>
+#include <QTimer>
 
 #if APPIMAGE_BUILD
 #include <KIconTheme>
@@ -54,6 +58,26 @@ void Q_DECL_UNUSED initRCCIconTheme()
 }
 #endif
 
+namespace {
+// the exports never show a window, so they must not require a display either
+// this has to be known before the application gets created, i.e. before the command line gets parsed
+bool isHeadlessExport(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const auto arg = QByteArray(argv[i]);
+        if (arg == "--") {
+            break;
+        }
+        for (const char* option : {"--exportFlameGraph", "--exportFoldedStacks"}) {
+            if (arg == option || arg.startsWith(QByteArray(option) + '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+}
+
 int main(int argc, char** argv)
 {
     QCoreApplication::setOrganizationName(QStringLiteral("KDAB"));
@@ -62,11 +86,30 @@ int main(int argc, char** argv)
     QCoreApplication::setApplicationVersion(QStringLiteral(HOTSPOT_VERSION_STRING));
     QGuiApplication::setAttribute(Qt::AA_UseHighDpiPixmaps, true);
 
+    // the flame graph colors still need a QGuiApplication, so fall back to the offscreen platform instead
+    if (isHeadlessExport(argc, argv) && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication app(argc, argv);
 
     // init
     Util::appImageEnvironment();
 
+    // records the phases of hotspot itself and writes them as Chrome trace on exit
+    const auto phaseTracePath = QString::fromLocal8Bit(qgetenv("HOTSPOT_PHASE_TRACE"));
+    if (!phaseTracePath.isEmpty()) {
+        PhaseTrace::setEnabled(true);
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, &app, [phaseTracePath]() {
+            QFile file(phaseTracePath);
+            if (!file.open(QIODevice::WriteOnly)) {
+                qWarning() << "failed to write phase trace:" << file.errorString();
+                return;
+            }
+            file.write(PhaseTrace::toChromeTrace(PhaseTrace::events(), PhaseTrace::threads()));
+        });
+    }
+
 #if APPIMAGE_BUILD
 
     // cleanup the environment when we are running from within the AppImage
@@ -122,6 +165,36 @@ int main(int argc, char** argv)
                             QLatin1String("path"));
     parser.addOption(arch);
 
+    QCommandLineOption merge(
+        QLatin1String("merge"),
+        QCoreApplication::translate("main",
+                                    "Open all input files as one profile, e.g. the segments of perf record "
+                                    "--switch-output or the recordings of multiple hosts."));
+    parser.addOption(merge);
+
+    QCommandLineOption compare(
+        QLatin1String("compare"),
+        QCoreApplication::translate("main",
+                                    "Compare two input files, showing how the costs changed from the first, the "
+                                    "baseline, to the second one."));
+    parser.addOption(compare);
+
+    QCommandLineOption exportFlameGraph(
+        QLatin1String("exportFlameGraph"),
+        QCoreApplication::translate("main",
+                                    "Write the flame graph of the input files as SVG to the given path and quit "
+                                    "without showing the GUI."),
+        QLatin1String("path"));
+    parser.addOption(exportFlameGraph);
+
+    QCommandLineOption exportFoldedStacks(
+        QLatin1String("exportFoldedStacks"),
+        QCoreApplication::translate("main",
+                                    "Write the stacks of the input files in the folded format of flamegraph.pl to the "
+                                    "given path and quit without showing the GUI."),
+        QLatin1String("path"));
+    parser.addOption(exportFoldedStacks);
+
     parser.addPositionalArgument(
         QStringLiteral("files"),
         QCoreApplication::translate("main", "Optional input files to open on startup, i.e. perf.data files."),
@@ -161,6 +234,82 @@ int main(int argc, char** argv)
     // remove leading executable name and trailing positional arguments
     const auto minimalArguments = originalArguments.mid(1, originalArguments.size() - 1 - files.size());
 
+    if (parser.isSet(exportFlameGraph) || parser.isSet(exportFoldedStacks)) {
+        if (files.isEmpty() || (files.size() > 1 && !parser.isSet(merge))) {
+            qWarning() << "exporting requires one input file, or --merge for multiple ones";
+            return 1;
+        }
+
+        Data::BottomUpResults bottomUpData;
+        Data::TopDownResults topDownData;
+        PerfParser perfParser;
+        QObject::connect(&perfParser, &PerfParser::bottomUpDataAvailable, &app,
+                         [&bottomUpData](const Data::BottomUpResults& data) { bottomUpData = data; });
+        QObject::connect(&perfParser, &PerfParser::topDownDataAvailable, &app,
+                         [&topDownData](const Data::TopDownResults& data) { topDownData = data; });
+        QObject::connect(&perfParser, &PerfParser::parsingFailed, &app, [](const QString& errorMessage) {
+            qWarning().noquote() << "failed to parse the input:" << errorMessage;
+            QCoreApplication::exit(1);
+        });
+        QObject::connect(&perfParser, &PerfParser::parsingFinished, &app, [&]() {
+            FlameGraph::ExportSettings exportSettings;
+            exportSettings.colorScheme = settings->colorScheme();
+            exportSettings.title = QCoreApplication::translate("main", "Top Down FlameGraph");
+            exportSettings.description = files.join(QLatin1Char(' '));
+
+            QVector<QPair<QString, FlameGraph::ExportFormat>> exports;
+            if (parser.isSet(exportFlameGraph)) {
+                exports.append({parser.value(exportFlameGraph), FlameGraph::ExportFormat::Svg});
+            }
+            if (parser.isSet(exportFoldedStacks)) {
+                exports.append({parser.value(exportFoldedStacks), FlameGraph::ExportFormat::FoldedStacks});
+            }
+
+            using namespace ThreadWeaver;
+            stream() << make_job([exports, bottomUpData, topDownData, exportSettings]() {
+                int exitCode = 0;
+                for (const auto& exportFile : exports) {
+                    const auto errorMessage = FlameGraph::writeFile(exportFile.first, exportFile.second, bottomUpData,
+                                                                    topDownData, exportSettings);
+                    if (!errorMessage.isEmpty()) {
+                        qWarning().noquote() << "failed to write" << exportFile.first << ":" << errorMessage;
+                        exitCode = 1;
+                    }
+                }
+                QMetaObject::invokeMethod(
+                    qApp, [exitCode]() { QCoreApplication::exit(exitCode); }, Qt::QueuedConnection);
+            });
+        });
+
+        // parsing may fail right away, which must only quit once the event loop is running
+        QTimer::singleShot(0, &perfParser, [&perfParser, &files]() {
+            if (files.size() > 1) {
+                perfParser.startParseFiles(files);
+            } else {
+                perfParser.startParseFile(files.first());
+            }
+        });
+        return app.exec();
+    }
+
+    if (parser.isSet(compare)) {
+        if (files.size() != 2) {
+            qWarning() << "--compare requires exactly two input files";
+            return 1;
+        }
+        auto window = new MainWindow;
+        window->compareFiles(files.first(), files.last());
+        window->show();
+        return app.exec();
+    }
+
+    if (parser.isSet(merge) && files.size() > 1) {
+        auto window = new MainWindow;
+        window->openFiles(files);
+        window->show();
+        return app.exec();
+    }
+
     while (files.size() > 1) {
         // spawn new instances if we have more than one file argument
         const auto file = files.takeLast();
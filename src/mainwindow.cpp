@@ -8,16 +8,20 @@
 
 #include "mainwindow.h"
 #include "costcontextmenu.h"
+#include "phasetracedialog.h"
 #include "recordpage.h"
 #include "resultspage.h"
 #include "settings.h"
 #include "settingsdialog.h"
 #include "startpage.h"
+#include "tracepointlatencydialog.h"
 #include "ui_mainwindow.h"
 #include "ui_unwindsettingspage.h"
 
+#include <QActionGroup>
 #include <QApplication>
 #include <QFileDialog>
+#include <QMenu>
 #include <QStackedWidget>
 #include <QVBoxLayout>
 
@@ -51,6 +55,12 @@
 #include <functional>
 
 namespace {
+QString dataFilesFilter()
+{
+    return MainWindow::tr("Data Files (perf*.data perf.data.*);;Other Samplers (*.folded *.collapsed *.pprof *.pb "
+                          "*.pb.gz);;All Files (*)");
+}
+
 struct IdeSettings
 {
     const char* const app;
@@ -146,7 +156,8 @@ MainWindow::MainWindow(QWidget* parent)
 
     connect(m_parser, &PerfParser::parsingFinished, this, [this]() {
         m_reloadAction->setEnabled(true);
-        m_exportAction->setEnabled(true);
+        // exporting writes the output of a single hotspot-perfparser run
+        m_exportAction->setEnabled(m_parser->canExport());
         m_pageStack->setCurrentWidget(m_resultsPage);
     });
     connect(m_parser, &PerfParser::exportFinished, this, [this](const QUrl& url) {
@@ -175,12 +186,36 @@ MainWindow::MainWindow(QWidget* parent)
     auto openNewWindow = new QAction(QIcon::fromTheme(QStringLiteral("document-open")), tr("Open in new window"), this);
     openNewWindow->setShortcut(Qt::Key_O | Qt::ControlModifier | Qt::ShiftModifier);
     connect(openNewWindow, &QAction::triggered, this, [this] {
-        const auto fileName = QFileDialog::getOpenFileName(this, tr("Open File"), QDir::currentPath(),
-                                                           tr("Data Files (perf*.data perf.data.*);;All Files (*)"));
+        const auto fileName =
+            QFileDialog::getOpenFileName(this, tr("Open File"), QDir::currentPath(), dataFilesFilter());
         if (!fileName.isEmpty())
             openInNewWindow(fileName);
     });
     ui->fileMenu->addAction(openNewWindow);
+    auto openMerged = new QAction(QIcon::fromTheme(QStringLiteral("document-open")), tr("Open and Merge..."), this);
+    openMerged->setToolTip(tr("Open several recordings as one profile, e.g. the segments of perf record "
+                              "--switch-output or the recordings of multiple hosts."));
+    connect(openMerged, &QAction::triggered, this, [this] {
+        const auto fileNames =
+            QFileDialog::getOpenFileNames(this, tr("Open Files"), QDir::currentPath(), dataFilesFilter());
+        if (!fileNames.isEmpty())
+            openFiles(fileNames);
+    });
+    ui->fileMenu->addAction(openMerged);
+    auto compare = new QAction(QIcon::fromTheme(QStringLiteral("document-open")), tr("Compare Recordings..."), this);
+    compare->setToolTip(tr("Open two recordings and show how the costs changed from the baseline to the comparison, "
+                           "e.g. before and after an optimization."));
+    connect(compare, &QAction::triggered, this, [this] {
+        const auto filter = dataFilesFilter();
+        const auto baseline = QFileDialog::getOpenFileName(this, tr("Open Baseline"), QDir::currentPath(), filter);
+        if (baseline.isEmpty())
+            return;
+        const auto comparison =
+            QFileDialog::getOpenFileName(this, tr("Open Comparison"), QFileInfo(baseline).absolutePath(), filter);
+        if (!comparison.isEmpty())
+            compareFiles(baseline, comparison);
+    });
+    ui->fileMenu->addAction(compare);
     m_recentFilesAction = KStandardAction::openRecent(this, SLOT(openFile(QUrl)), this);
     m_recentFilesAction->loadEntries(m_config->group("RecentFiles"));
     ui->fileMenu->addAction(m_recentFilesAction);
@@ -200,7 +235,60 @@ MainWindow::MainWindow(QWidget* parent)
     connect(ui->settingsAction, &QAction::triggered, this, &MainWindow::openSettingsDialog);
     connect(ui->actionAbout_Hotspot, &QAction::triggered, this, &MainWindow::aboutHotspot);
 
-    connect(Settings::instance(), &Settings::costAggregationChanged, this, &MainWindow::reload);
+    auto* phaseTraceAction = new QAction(tr("Analysis Performance..."), this);
+    phaseTraceAction->setToolTip(tr("Show how long hotspot itself takes to parse, filter and display the data."));
+    connect(phaseTraceAction, &QAction::triggered, this, [this]() {
+        if (!m_phaseTraceDialog) {
+            m_phaseTraceDialog = new PhaseTraceDialog(this);
+        }
+        m_phaseTraceDialog->show();
+        m_phaseTraceDialog->raise();
+    });
+    ui->helpMenu->insertAction(ui->actionAbout_Hotspot, phaseTraceAction);
+    ui->helpMenu->insertSeparator(ui->actionAbout_Hotspot);
+
+    connect(Settings::instance(), &Settings::costAggregationChanged, this, [this]() {
+        if (m_parser->isComparing()) {
+            // only the aggregated results of the baseline are kept
+            reload();
+        } else if (m_pageStack->currentWidget() == m_resultsPage) {
+            // the stored events get re-aggregated in the background, the files are not parsed again
+            m_resultsPage->refilter();
+        } else if (m_parser->isParsing()) {
+            // the ongoing import still uses the old aggregation
+            reload();
+        }
+    });
+
+    auto* normalizationMenu = ui->viewMenu->addMenu(tr("Normalize Comparison"));
+    normalizationMenu->setToolTip(tr("Scale the baseline to the total cost of the comparison before computing the "
+                                     "differences, e.g. to compare recordings of different durations."));
+    normalizationMenu->setEnabled(false);
+    auto* normalizationGroup = new QActionGroup(normalizationMenu);
+    connect(normalizationGroup, &QActionGroup::triggered, this, [this](QAction* action) {
+        m_parser->setDiffNormalization(action->data().toInt());
+        m_resultsPage->refilter();
+    });
+    connect(m_parser, &PerfParser::parsingFinished, this, [this, normalizationMenu, normalizationGroup]() {
+        normalizationMenu->clear();
+        normalizationMenu->setEnabled(m_parser->isComparing());
+        if (!m_parser->isComparing()) {
+            return;
+        }
+
+        auto addType = [&](const QString& name, int type) {
+            auto* action = normalizationMenu->addAction(name);
+            action->setCheckable(true);
+            action->setChecked(type == m_parser->diffNormalization());
+            action->setData(type);
+            normalizationGroup->addAction(action);
+        };
+        addType(tr("None"), -1);
+        const auto costs = m_parser->bottomUpResults().costs;
+        for (int i = 0, c = costs.numTypes(); i < c; ++i) {
+            addType(costs.typeName(i), i);
+        }
+    });
 
     auto* prettifySymbolsAction = ui->viewMenu->addAction(tr("Prettify Symbols"));
     prettifySymbolsAction->setCheckable(true);
@@ -244,6 +332,16 @@ MainWindow::MainWindow(QWidget* parent)
     ui->viewMenu->addSeparator();
     ui->viewMenu->addMenu(m_resultsPage->exportMenu());
 
+    // created right away to receive the tracepoints of the next parse
+    m_tracepointLatencyDialog = new TracepointLatencyDialog(m_parser, this);
+    auto* tracepointLatencyAction = ui->viewMenu->addAction(tr("Tracepoint Latencies..."));
+    tracepointLatencyAction->setToolTip(
+        tr("Show the latency histograms of paired tracepoints, e.g. of block I/O requests or syscalls."));
+    connect(tracepointLatencyAction, &QAction::triggered, this, [this]() {
+        m_tracepointLatencyDialog->show();
+        m_tracepointLatencyDialog->raise();
+    });
+
     ui->windowMenu->addActions(m_resultsPage->windowActions());
 
     setupCodeNavigationMenu();
@@ -281,8 +379,8 @@ void MainWindow::closeEvent(QCloseEvent* event)
 
 void MainWindow::onOpenFileButtonClicked()
 {
-    const auto fileName = QFileDialog::getOpenFileName(this, tr("Open File"), QDir::currentPath(),
-                                                       tr("Data Files (perf*.data perf.data.*);;All Files (*)"));
+    const auto fileName =
+        QFileDialog::getOpenFileName(this, tr("Open File"), QDir::currentPath(), dataFilesFilter());
     if (fileName.isEmpty()) {
         return;
     }
@@ -324,29 +422,54 @@ void MainWindow::clear()
     clear(false);
 }
 
-void MainWindow::openFile(const QString& path, bool isReload)
+void MainWindow::openFiles(const QStringList& paths, bool isReload, bool compare)
 {
+    Q_ASSERT(!paths.isEmpty());
+    Q_ASSERT(!compare || paths.size() == 2);
     clear(isReload);
 
-    QFileInfo file(path);
-    setWindowTitle(tr("%1 - Hotspot").arg(file.fileName()));
+    QFileInfo file(paths.first());
+    if (compare) {
+        setWindowTitle(tr("%1 compared to %2 - Hotspot").arg(QFileInfo(paths.last()).fileName(), file.fileName()));
+    } else if (paths.size() == 1) {
+        setWindowTitle(tr("%1 - Hotspot").arg(file.fileName()));
+    } else {
+        setWindowTitle(tr("%1 and %n more - Hotspot", nullptr, paths.size() - 1).arg(file.fileName()));
+    }
 
     m_startPage->showParseFileProgress();
     m_pageStack->setCurrentWidget(m_startPage);
 
     // TODO: support input files of different types via plugins
-    m_parser->startParseFile(path);
-    m_reloadAction->setData(path);
+    if (compare) {
+        m_parser->startCompareFiles(paths.first(), paths.last());
+    } else {
+        m_parser->startParseFiles(paths);
+    }
+    m_reloadAction->setData(paths);
     m_exportAction->setData(QUrl::fromLocalFile(file.absoluteFilePath() + QLatin1String(".perfparser")));
 
-    m_recentFilesAction->addUrl(QUrl::fromLocalFile(file.absoluteFilePath()));
-    m_recentFilesAction->saveEntries(m_config->group("RecentFiles"));
-    m_config->sync();
+    // the recent files only restore single files
+    if (paths.size() == 1) {
+        m_recentFilesAction->addUrl(QUrl::fromLocalFile(file.absoluteFilePath()));
+        m_recentFilesAction->saveEntries(m_config->group("RecentFiles"));
+        m_config->sync();
+    }
 }
 
 void MainWindow::openFile(const QString& path)
 {
-    openFile(path, false);
+    openFiles({path}, false);
+}
+
+void MainWindow::openFiles(const QStringList& paths)
+{
+    openFiles(paths, false);
+}
+
+void MainWindow::compareFiles(const QString& baseline, const QString& comparison)
+{
+    openFiles({baseline, comparison}, false, true);
 }
 
 void MainWindow::openFile(const QUrl& url)
@@ -355,12 +478,12 @@ void MainWindow::openFile(const QUrl& url)
         emit openFileError(tr("Cannot open remote file %1.").arg(url.toString()));
         return;
     }
-    openFile(url.toLocalFile(), false);
+    openFiles({url.toLocalFile()}, false);
 }
 
 void MainWindow::reload()
 {
-    openFile(m_reloadAction->data().toString(), true);
+    openFiles(m_reloadAction->data().toStringList(), true, m_parser->isComparing());
 }
 
 void MainWindow::saveAs()
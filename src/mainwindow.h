@@ -27,6 +27,8 @@ class StartPage;
 class ResultsPage;
 class RecordPage;
 class SettingsDialog;
+class PhaseTraceDialog;
+class TracepointLatencyDialog;
 
 class MainWindow : public KParts::MainWindow
 {
@@ -40,6 +42,8 @@ public slots:
     void clear();
     void openFile(const QString& path);
     void openFile(const QUrl& url);
+    void openFiles(const QStringList& paths);
+    void compareFiles(const QString& baseline, const QString& comparison);
     void reload();
     void saveAs();
 
@@ -61,7 +65,7 @@ signals:
 
 private:
     void clear(bool isReload);
-    void openFile(const QString& path, bool isReload);
+    void openFiles(const QStringList& paths, bool isReload, bool compare = false);
     void closeEvent(QCloseEvent* event) override;
     void setupCodeNavigationMenu();
 
@@ -73,6 +77,8 @@ private:
     RecordPage* m_recordPage;
     ResultsPage* m_resultsPage;
     SettingsDialog* m_settingsDialog;
+    PhaseTraceDialog* m_phaseTraceDialog = nullptr;
+    TracepointLatencyDialog* m_tracepointLatencyDialog = nullptr;
 
     KRecentFilesAction* m_recentFilesAction = nullptr;
     QAction* m_reloadAction = nullptr;
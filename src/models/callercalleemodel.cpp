@@ -11,6 +11,8 @@
 
 #include <QDebug>
 
+#include <utility>
+
 CallerCalleeModel::CallerCalleeModel(QObject* parent)
     : HashModel(parent)
 {
@@ -33,8 +35,35 @@ CallerCalleeModel::~CallerCalleeModel() = default;
 
 void CallerCalleeModel::setResults(const Data::CallerCalleeResults& results)
 {
-    m_results = results;
-    setRows(results.entries);
+    // the cells show the costs relative to the totals
+    const auto totalsChanged = m_results.selfCosts.totalCosts() != results.selfCosts.totalCosts()
+        || m_results.inclusiveCosts.totalCosts() != results.inclusiveCosts.totalCosts();
+    m_previousResults = std::exchange(m_results, results);
+    setRows(results.entries, totalsChanged);
+    m_previousResults = {};
+}
+
+bool CallerCalleeModel::isRowEqual(const Data::CallerCalleeEntry& oldEntry,
+                                   const Data::CallerCalleeEntry& newEntry) const
+{
+    // the ids get assigned anew for every result, so compare the costs they refer to
+    auto costsEqual = [](const Data::Costs& oldCosts, quint32 oldId, const Data::Costs& newCosts, quint32 newId) {
+        if (oldCosts.numTypes() != newCosts.numTypes()) {
+            return false;
+        }
+        for (int type = 0, numTypes = newCosts.numTypes(); type < numTypes; ++type) {
+            if (oldCosts.cost(type, oldId) != newCosts.cost(type, newId)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    return costsEqual(m_previousResults.selfCosts, oldEntry.id, m_results.selfCosts, newEntry.id)
+        && costsEqual(m_previousResults.inclusiveCosts, oldEntry.id, m_results.inclusiveCosts, newEntry.id)
+        && HashModelDetail::isEqual(oldEntry.callers, newEntry.callers)
+        && HashModelDetail::isEqual(oldEntry.callees, newEntry.callees)
+        && HashModelDetail::isEqual(oldEntry.sourceMap, newEntry.sourceMap);
 }
 
 QVariant CallerCalleeModel::headerCell(int column, int role) const
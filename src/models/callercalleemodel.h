@@ -53,8 +53,14 @@ public:
     int numColumns() const final override;
     QModelIndex indexForSymbol(const Data::Symbol& symbol) const;
 
+protected:
+    bool isRowEqual(const Data::CallerCalleeEntry& oldEntry,
+                    const Data::CallerCalleeEntry& newEntry) const final override;
+
 private:
     Data::CallerCalleeResults m_results;
+    // only set while the rows get updated, the ids of the old entries refer to its costs
+    Data::CallerCalleeResults m_previousResults;
 };
 
 template<typename ModelImpl>
@@ -84,8 +90,10 @@ public:
 
     void setResults(const Data::SymbolCostMap& map, const Data::Costs& costs)
     {
+        // the cells show the costs relative to the totals
+        const auto totalsChanged = m_costs.totalCosts() != costs.totalCosts();
         m_costs = costs;
-        HashModel<Data::SymbolCostMap, ModelImpl>::setRows(map);
+        HashModel<Data::SymbolCostMap, ModelImpl>::setRows(map, totalsChanged);
     }
 
     enum Columns
@@ -208,8 +216,9 @@ public:
 
     void setResults(const Data::SourceLocationCostMap& map, const Data::Costs& totalCosts)
     {
+        const auto totalsChanged = m_totalCosts.totalCosts() != totalCosts.totalCosts();
         m_totalCosts = totalCosts;
-        HashModel<Data::SourceLocationCostMap, ModelImpl>::setRows(map);
+        HashModel<Data::SourceLocationCostMap, ModelImpl>::setRows(map, totalsChanged);
     }
 
     enum Columns
@@ -18,13 +18,16 @@ bool matchImpl(const QString& needle, const QString& haystack)
 }
 
 namespace CallerCalleeProxyDetail {
-bool match(const QSortFilterProxyModel* proxy, const Data::Symbol& symbol)
+bool match(const QString& needle, const Data::Symbol& symbol)
 {
-    const auto needle = proxy->filterRegExp().pattern();
-
     return matchImpl(needle, symbol.symbol) || matchImpl(needle, symbol.binary);
 }
 
+bool match(const QSortFilterProxyModel* proxy, const Data::Symbol& symbol)
+{
+    return match(proxy->filterRegExp().pattern(), symbol);
+}
+
 bool match(const QSortFilterProxyModel* proxy, const QString& location)
 {
     const auto needle = proxy->filterRegExp().pattern();
@@ -15,6 +15,8 @@ struct Symbol;
 }
 
 namespace CallerCalleeProxyDetail {
+// thread safe, case insensitive match against the symbol name or binary
+bool match(const QString& needle, const Data::Symbol& symbol);
 bool match(const QSortFilterProxyModel* proxy, const Data::Symbol& symbol);
 bool match(const QSortFilterProxyModel* proxy, const QString& location);
 }
@@ -0,0 +1,379 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "controlflowgraph.h"
+
+#include <QBitArray>
+#include <QMap>
+
+#include <algorithm>
+
+namespace {
+enum class Branch
+{
+    None,
+    Conditional,
+    Unconditional,
+    // returns, tail calls and indirect jumps: no successor within the function
+    Exit,
+};
+
+struct Instruction
+{
+    int line = -1;
+    quint64 addr = 0;
+    Branch branch = Branch::None;
+    // relative to the entry of the function
+    int targetOffset = 0;
+    // index into the instructions, -1 when the jump leaves the function
+    int target = -1;
+};
+
+bool isPrefix(const QStringRef& word)
+{
+    static const QLatin1String prefixes[] = {
+        QLatin1String("bnd"),  QLatin1String("notrack"), QLatin1String("lock"), QLatin1String("rep"),
+        QLatin1String("repz"), QLatin1String("repnz"),   QLatin1String("repe"), QLatin1String("repne"),
+        QLatin1String("ds"),   QLatin1String("cs"),      QLatin1String("data16"),
+    };
+    return std::find(std::begin(prefixes), std::end(prefixes), word) != std::end(prefixes);
+}
+
+// objdump lines look like "  4f616:\t84 c0\ttest %al,%al"
+// an empty mnemonic is returned for the continuation lines of long instruction encodings
+QString mnemonic(const QString& disassembly)
+{
+    const auto bytesStart = disassembly.indexOf(QLatin1Char('\t'));
+    const auto mnemonicStart = bytesStart == -1 ? -1 : disassembly.indexOf(QLatin1Char('\t'), bytesStart + 1);
+    if (mnemonicStart == -1) {
+        return {};
+    }
+
+    const auto words = disassembly.midRef(mnemonicStart + 1).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    for (const auto& word : words) {
+        if (!isPrefix(word)) {
+            return word.toString();
+        }
+    }
+    return {};
+}
+
+bool isCall(const QString& mnemonic)
+{
+    return mnemonic.startsWith(QLatin1String("call")) || mnemonic == QLatin1String("bl")
+        || mnemonic == QLatin1String("blr") || mnemonic == QLatin1String("blx");
+}
+
+bool isReturn(const QString& mnemonic)
+{
+    return mnemonic.startsWith(QLatin1String("ret")) || mnemonic == QLatin1String("eret");
+}
+
+bool isUnconditionalJump(const QString& mnemonic)
+{
+    return mnemonic == QLatin1String("jmp") || mnemonic == QLatin1String("jmpq") || mnemonic == QLatin1String("b")
+        || mnemonic == QLatin1String("b.n") || mnemonic == QLatin1String("b.w") || mnemonic == QLatin1String("bal")
+        || mnemonic == QLatin1String("br") || mnemonic == QLatin1String("bx");
+}
+
+bool isConditionalJump(QString mnemonic)
+{
+    // x86: je, jne, jrcxz, loop, ...
+    if (mnemonic.startsWith(QLatin1Char('j')) || mnemonic.startsWith(QLatin1String("loop"))) {
+        return true;
+    }
+
+    // aarch64: b.eq, b.ne, ...
+    if (mnemonic.startsWith(QLatin1String("b.")) && !isUnconditionalJump(mnemonic)) {
+        return true;
+    }
+    if (mnemonic == QLatin1String("cbz") || mnemonic == QLatin1String("cbnz") || mnemonic == QLatin1String("tbz")
+        || mnemonic == QLatin1String("tbnz")) {
+        return true;
+    }
+
+    // arm: beq, bne, ... with an optional width qualifier
+    if (mnemonic.endsWith(QLatin1String(".n")) || mnemonic.endsWith(QLatin1String(".w"))) {
+        mnemonic.chop(2);
+    }
+    static const QLatin1String conditions[] = {
+        QLatin1String("eq"), QLatin1String("ne"), QLatin1String("cs"), QLatin1String("hs"), QLatin1String("cc"),
+        QLatin1String("lo"), QLatin1String("mi"), QLatin1String("pl"), QLatin1String("vs"), QLatin1String("vc"),
+        QLatin1String("hi"), QLatin1String("ls"), QLatin1String("ge"), QLatin1String("lt"), QLatin1String("gt"),
+        QLatin1String("le"),
+    };
+    return mnemonic.size() == 3 && mnemonic.startsWith(QLatin1Char('b'))
+        && std::find(std::begin(conditions), std::end(conditions), mnemonic.midRef(1)) != std::end(conditions);
+}
+
+QVector<Instruction> parseInstructions(const DisassemblyOutput& disassemblyOutput)
+{
+    const auto& lines = disassemblyOutput.disassemblyLines;
+
+    QVector<Instruction> instructions;
+    for (int i = 0, c = lines.size(); i < c; ++i) {
+        const auto& line = lines[i];
+        if (!line.addr) {
+            continue;
+        }
+
+        const auto mnemonic = ::mnemonic(line.disassembly);
+        if (mnemonic.isEmpty()) {
+            continue;
+        }
+
+        // like the disassembly delegate, a jump within the function links to the function itself
+        const auto isLocal = !line.linkedFunction.name.isEmpty()
+            && line.linkedFunction.name == disassemblyOutput.symbol.symbol && !isCall(mnemonic);
+
+        auto branch = Branch::None;
+        if (isReturn(mnemonic)) {
+            branch = Branch::Exit;
+        } else if (isUnconditionalJump(mnemonic)) {
+            branch = isLocal ? Branch::Unconditional : Branch::Exit;
+        } else if (isLocal && isConditionalJump(mnemonic)) {
+            branch = Branch::Conditional;
+        }
+
+        instructions.push_back({i, line.addr, branch, line.linkedFunction.offset, -1});
+    }
+
+    std::stable_sort(instructions.begin(), instructions.end(),
+                     [](const Instruction& lhs, const Instruction& rhs) { return lhs.addr < rhs.addr; });
+
+    // resolve the jump targets to instruction indices, the offsets are relative to the entry of the function
+    for (auto& instruction : instructions) {
+        if (instruction.branch != Branch::Conditional && instruction.branch != Branch::Unconditional) {
+            continue;
+        }
+        const auto targetAddr = instructions.first().addr + instruction.targetOffset;
+        const auto it = std::lower_bound(
+            instructions.cbegin(), instructions.cend(), targetAddr,
+            [](const Instruction& instruction, quint64 addr) { return instruction.addr < addr; });
+        if (it != instructions.cend() && it->addr == targetAddr) {
+            instruction.target = std::distance(instructions.cbegin(), it);
+        } else if (instruction.branch == Branch::Unconditional) {
+            // jumps into the middle of an instruction, we can't follow them
+            instruction.branch = Branch::Exit;
+        }
+    }
+
+    return instructions;
+}
+
+// the immediate dominators of the blocks after Cooper, Harvey and Kennedy's "A Simple, Fast Dominance Algorithm"
+// unreachable blocks get -1
+QVector<int> immediateDominators(const QVector<ControlFlowGraph::BasicBlock>& blocks)
+{
+    const auto numBlocks = blocks.size();
+
+    // iterative depth first search from the entry
+    QVector<int> postOrder;
+    QVector<int> postOrderIndex(numBlocks, -1);
+    postOrder.reserve(numBlocks);
+    QBitArray visited(numBlocks);
+    QVector<QPair<int, int>> stack = {{0, 0}};
+    visited.setBit(0);
+    while (!stack.isEmpty()) {
+        auto& top = stack.last();
+        const auto& successors = blocks[top.first].successors;
+        if (top.second < successors.size()) {
+            const auto successor = successors[top.second++];
+            if (!visited.testBit(successor)) {
+                visited.setBit(successor);
+                stack.push_back({successor, 0});
+            }
+        } else {
+            postOrderIndex[top.first] = postOrder.size();
+            postOrder.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+
+    auto intersect = [&](int lhs, int rhs, const QVector<int>& dominators) {
+        while (lhs != rhs) {
+            while (postOrderIndex[lhs] < postOrderIndex[rhs]) {
+                lhs = dominators[lhs];
+            }
+            while (postOrderIndex[rhs] < postOrderIndex[lhs]) {
+                rhs = dominators[rhs];
+            }
+        }
+        return lhs;
+    };
+
+    QVector<int> dominators(numBlocks, -1);
+    dominators[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        // in reverse post order, skipping the entry
+        for (auto it = postOrder.crbegin() + 1, end = postOrder.crend(); it != end; ++it) {
+            const auto block = *it;
+            int dominator = -1;
+            for (const auto predecessor : blocks[block].predecessors) {
+                if (dominators[predecessor] == -1) {
+                    continue;
+                }
+                dominator = dominator == -1 ? predecessor : intersect(predecessor, dominator, dominators);
+            }
+            if (dominators[block] != dominator) {
+                dominators[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+    return dominators;
+}
+
+bool dominates(int dominator, int block, const QVector<int>& dominators)
+{
+    while (block != -1) {
+        if (block == dominator) {
+            return true;
+        }
+        if (block == 0) {
+            return false;
+        }
+        block = dominators[block];
+    }
+    return false;
+}
+}
+
+ControlFlowGraph ControlFlowGraph::build(const DisassemblyOutput& disassemblyOutput,
+                                         const Data::CallerCalleeEntry& entry, int numTypes)
+{
+    ControlFlowGraph graph;
+    graph.totalCost = Data::ItemCost(numTypes);
+
+    const auto instructions = parseInstructions(disassemblyOutput);
+    if (instructions.isEmpty()) {
+        return graph;
+    }
+
+    // a block starts at the entry, at every jump target and after every branch
+    QBitArray leaders(instructions.size());
+    leaders.setBit(0);
+    for (int i = 0, c = instructions.size(); i < c; ++i) {
+        const auto& instruction = instructions[i];
+        if (instruction.target != -1) {
+            leaders.setBit(instruction.target);
+        }
+        if (instruction.branch != Branch::None && i + 1 < c) {
+            leaders.setBit(i + 1);
+        }
+    }
+
+    QVector<int> blockOfInstruction(instructions.size());
+    for (int i = 0, c = instructions.size(); i < c; ++i) {
+        const auto& instruction = instructions[i];
+        if (leaders.testBit(i)) {
+            BasicBlock block;
+            block.firstLine = instruction.line;
+            block.startAddr = instruction.addr;
+            block.cost = Data::ItemCost(numTypes);
+            graph.blocks.push_back(block);
+        }
+        auto& block = graph.blocks.last();
+        block.lastLine = instruction.line;
+        block.endAddr = instruction.addr;
+        ++block.numInstructions;
+        blockOfInstruction[i] = graph.blocks.size() - 1;
+
+        const auto it = entry.offsetMap.constFind(instruction.addr);
+        if (it != entry.offsetMap.constEnd() && it->selfCost.size() == static_cast<size_t>(numTypes)) {
+            block.cost += it->selfCost;
+        }
+    }
+
+    // the edges, looking at the last instruction of every block
+    for (int i = 0, c = instructions.size(); i < c; ++i) {
+        const auto& instruction = instructions[i];
+        const auto isLast = i + 1 == c || leaders.testBit(i + 1);
+        if (!isLast) {
+            continue;
+        }
+
+        auto& successors = graph.blocks[blockOfInstruction[i]].successors;
+        if (instruction.target != -1) {
+            successors.push_back(blockOfInstruction[instruction.target]);
+        }
+        const auto fallsThrough = instruction.branch == Branch::None || instruction.branch == Branch::Conditional;
+        if (fallsThrough && i + 1 < c && !successors.contains(blockOfInstruction[i + 1])) {
+            successors.push_back(blockOfInstruction[i + 1]);
+        }
+    }
+    for (int i = 0, c = graph.blocks.size(); i < c; ++i) {
+        graph.totalCost += graph.blocks[i].cost;
+        for (const auto successor : qAsConst(graph.blocks[i].successors)) {
+            graph.blocks[successor].predecessors.push_back(i);
+        }
+    }
+
+    // a back edge goes to a block that dominates its source, the natural loop of such an edge
+    // consists of all blocks that reach the source without passing the header
+    const auto dominators = immediateDominators(graph.blocks);
+    QMap<int, QVector<int>> latchesOfHeader;
+    for (int i = 0, c = graph.blocks.size(); i < c; ++i) {
+        if (dominators[i] == -1) {
+            continue;
+        }
+        for (const auto successor : qAsConst(graph.blocks[i].successors)) {
+            if (dominates(successor, i, dominators)) {
+                latchesOfHeader[successor].push_back(i);
+            }
+        }
+    }
+
+    for (auto it = latchesOfHeader.cbegin(), end = latchesOfHeader.cend(); it != end; ++it) {
+        Loop loop;
+        loop.header = it.key();
+        loop.cost = Data::ItemCost(numTypes);
+
+        QBitArray inLoop(graph.blocks.size());
+        inLoop.setBit(loop.header);
+        auto pending = it.value();
+        while (!pending.isEmpty()) {
+            const auto block = pending.takeLast();
+            if (inLoop.testBit(block) || dominators[block] == -1) {
+                continue;
+            }
+            inLoop.setBit(block);
+            pending += graph.blocks[block].predecessors;
+        }
+
+        loop.startAddr = graph.blocks[loop.header].startAddr;
+        for (int i = 0, c = graph.blocks.size(); i < c; ++i) {
+            if (!inLoop.testBit(i)) {
+                continue;
+            }
+            const auto& block = graph.blocks[i];
+            loop.blocks.push_back(i);
+            loop.startAddr = std::min(loop.startAddr, block.startAddr);
+            loop.endAddr = std::max(loop.endAddr, block.endAddr);
+            loop.numInstructions += block.numInstructions;
+            loop.cost += block.cost;
+        }
+        graph.loops.push_back(loop);
+    }
+
+    return graph;
+}
+
+QVector<int> ControlFlowGraph::hottestLoops(int type) const
+{
+    QVector<int> hottest;
+    for (int i = 0, c = loops.size(); i < c; ++i) {
+        if (static_cast<size_t>(type) < loops[i].cost.size() && loops[i].cost[type] > 0) {
+            hottest.push_back(i);
+        }
+    }
+    std::stable_sort(hottest.begin(), hottest.end(),
+                     [this, type](int lhs, int rhs) { return loops[lhs].cost[type] > loops[rhs].cost[type]; });
+    return hottest;
+}
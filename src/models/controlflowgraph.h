@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QVector>
+
+#include "data.h"
+#include "disassemblyoutput.h"
+
+/**
+ * The control flow graph of a disassembled function.
+ *
+ * The per-instruction self costs of the function are aggregated into its basic
+ * blocks and natural loops, which makes it easy to find the hot loops of a function.
+ */
+struct ControlFlowGraph
+{
+    struct BasicBlock
+    {
+        // indices into DisassemblyOutput::disassemblyLines of the first and last instruction
+        int firstLine = -1;
+        int lastLine = -1;
+        quint64 startAddr = 0;
+        // the address of the last instruction
+        quint64 endAddr = 0;
+        int numInstructions = 0;
+        QVector<int> successors;
+        QVector<int> predecessors;
+        Data::ItemCost cost;
+    };
+
+    struct Loop
+    {
+        // the block that dominates all other blocks of the loop
+        int header = -1;
+        // sorted indices into blocks, including those of nested loops
+        QVector<int> blocks;
+        quint64 startAddr = 0;
+        quint64 endAddr = 0;
+        int numInstructions = 0;
+        Data::ItemCost cost;
+    };
+
+    // sorted by address
+    QVector<BasicBlock> blocks;
+    // sorted by the address of their header
+    QVector<Loop> loops;
+    // the self cost of the whole function
+    Data::ItemCost totalCost;
+
+    static ControlFlowGraph build(const DisassemblyOutput& disassemblyOutput, const Data::CallerCalleeEntry& entry,
+                                  int numTypes);
+
+    // indices into loops that have a cost of the given type, the most expensive one first
+    QVector<int> hottestLoops(int type) const;
+};
+Q_DECLARE_TYPEINFO(ControlFlowGraph::BasicBlock, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(ControlFlowGraph::Loop, Q_MOVABLE_TYPE);
@@ -10,6 +10,7 @@
 #include <QDebug>
 #include <QPainter>
 
+#include <algorithm>
 #include <cmath>
 
 CostDelegate::CostDelegate(quint32 sortRole, quint32 totalCostRole, QObject* parent)
@@ -23,15 +24,15 @@ CostDelegate::~CostDelegate() = default;
 
 void CostDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    // TODO: handle negative values
-    const auto cost = index.data(m_sortRole).toULongLong();
-    if (cost == 0) {
+    // the differences of compared recordings are negative when the cost decreased
+    const auto cost = index.data(m_sortRole).toLongLong();
+    const auto totalCost = index.data(m_totalCostRole).toLongLong();
+    if (cost == 0 || totalCost == 0) {
         QStyledItemDelegate::paint(painter, option, index);
         return;
     }
 
-    const auto totalCost = index.data(m_totalCostRole).toULongLong();
-    const auto fraction = std::abs(float(cost) / totalCost);
+    const auto fraction = std::min(1.f, std::abs(float(cost) / totalCost));
 
     auto rect = option.rect;
     rect.setWidth(rect.width() * fraction);
@@ -48,7 +49,9 @@ void CostDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option,
         painter->drawRect(option.rect);
     }
 
-    auto color = QColor::fromHsv(120 - fraction * 120, 255, 255, (-((fraction - 1) * (fraction - 1))) * 120 + 120);
+    // green to red for costs, blue for decreased costs
+    const auto hue = cost < 0 ? 240 : 120 - fraction * 120;
+    auto color = QColor::fromHsv(hue, 255, 255, (-((fraction - 1) * (fraction - 1))) * 120 + 120);
     painter->setBrush(color);
     painter->drawRect(rect);
 
@@ -7,13 +7,29 @@
 
 #include "data.h"
 
+#include "../phasetrace.h"
+
+#include <QCoreApplication>
 #include <QDebug>
 #include <QSet>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
 
 using namespace Data;
 
 namespace {
 
+// compared recordings have signed costs, which may add up to zero in total
+bool hasCost(const ItemCost& cost)
+{
+    return std::any_of(std::begin(cost), std::end(cost), [](qint64 value) { return value != 0; });
+}
+
 ItemCost buildTopDownResult(const BottomUp& bottomUpData, const Costs& bottomUpCosts, TopDown* topDownData,
                             Costs* inclusiveCosts, Costs* selfCosts, quint32* maxId)
 {
@@ -24,7 +40,7 @@ ItemCost buildTopDownResult(const BottomUp& bottomUpData, const Costs& bottomUpC
         const auto childCost = buildTopDownResult(row, bottomUpCosts, topDownData, inclusiveCosts, selfCosts, maxId);
         const auto rowCost = bottomUpCosts.itemCost(row.id);
         const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
+        if (hasCost(diff)) {
             // this row is (partially) a leaf
             // bubble up the parent chain to build a top-down tree
             auto node = &row;
@@ -66,7 +82,7 @@ ItemCost buildCallerCalleeResult(const BottomUp& data, const Costs& bottomUpCost
         const auto childCost = buildCallerCalleeResult(row, bottomUpCosts, results);
         const auto rowCost = bottomUpCosts.itemCost(row.id);
         const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
+        if (hasCost(diff)) {
             // this row is (partially) a leaf
 
             // leaf node found, bubble up the parent chain to add cost for all frames
@@ -275,6 +291,22 @@ void buildPerLibrary(const TopDown* node, PerLibraryResults& results, QHash<QStr
         buildPerLibrary(&child, results, binaryToResultIndex, costs);
     }
 }
+
+QVector<qint32> intersectStacks(const QVector<qint32>& lhs, const QVector<qint32>& rhs)
+{
+    QVector<qint32> ret;
+    ret.reserve(std::min(lhs.size(), rhs.size()));
+    std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(ret));
+    return ret;
+}
+
+void appendStack(QVector<qint32>* stacks, qint32 stackId)
+{
+    // stacks are visited in order, so checking the last entry suffices to keep the list unique and sorted
+    if (stacks->isEmpty() || stacks->last() != stackId) {
+        stacks->push_back(stackId);
+    }
+}
 }
 
 QString Data::prettifySymbol(const QString& name)
@@ -285,6 +317,7 @@ QString Data::prettifySymbol(const QString& name)
 
 TopDownResults TopDownResults::fromBottomUp(const BottomUpResults& bottomUpData)
 {
+    PHASE_TRACE("TopDownResults::fromBottomUp");
     TopDownResults results;
     results.selfCosts.initializeCostsFrom(bottomUpData.costs);
     results.inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
@@ -297,6 +330,7 @@ TopDownResults TopDownResults::fromBottomUp(const BottomUpResults& bottomUpData)
 
 PerLibraryResults PerLibraryResults::fromTopDown(const TopDownResults& topDownData)
 {
+    PHASE_TRACE("PerLibraryResults::fromTopDown");
     PerLibraryResults results;
     QHash<QString, int> binaryToResultIndex;
     results.costs.initializeCostsFrom(topDownData.selfCosts);
@@ -304,17 +338,825 @@ PerLibraryResults PerLibraryResults::fromTopDown(const TopDownResults& topDownDa
     buildPerLibrary(&topDownData.root, results, binaryToResultIndex, topDownData.selfCosts);
 
     PerLibrary::initializeParents(&results.root);
+    results.topRows = topChildren(results.root.children, results.costs);
 
     return results;
 }
 
 void Data::callerCalleesFromBottomUpData(const BottomUpResults& bottomUpData, CallerCalleeResults* results)
 {
+    PHASE_TRACE("Data::callerCalleesFromBottomUpData");
     results->inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
     results->selfCosts.initializeCostsFrom(bottomUpData.costs);
     buildCallerCalleeResult(bottomUpData.root, bottomUpData.costs, results);
 }
 
+namespace {
+ItemCost mapCost(const ItemCost& cost, const MergeMapping& mapping, int numTypes)
+{
+    ItemCost ret(numTypes);
+    for (int type = 0, c = static_cast<int>(cost.size()); type < c; ++type) {
+        const auto mergedType = mapping.costType(type);
+        if (mergedType >= 0) {
+            ret[mergedType] += cost[type];
+        }
+    }
+    return ret;
+}
+
+void mergeCost(ItemCost* cost, const ItemCost& other, const MergeMapping& mapping)
+{
+    *cost += mapCost(other, mapping, static_cast<int>(cost->size()));
+}
+
+void mergeCosts(Costs* costs, quint32 id, const Costs& other, quint32 otherId, const MergeMapping& mapping)
+{
+    for (int type = 0, c = other.numTypes(); type < c; ++type) {
+        const auto mergedType = mapping.costType(type);
+        const auto cost = other.cost(type, otherId);
+        if (mergedType >= 0 && cost) {
+            costs->add(mergedType, id, cost);
+        }
+    }
+}
+
+void mergeTotalCosts(Costs* costs, const Costs& other, const MergeMapping& mapping)
+{
+    for (int type = 0, c = other.numTypes(); type < c; ++type) {
+        const auto mergedType = mapping.costType(type);
+        if (mergedType >= 0) {
+            costs->addTotalCost(mergedType, other.totalCost(type));
+        }
+    }
+}
+}
+
+void BottomUpResults::merge(const BottomUpResults& other, const MergeMapping& mapping)
+{
+    Q_ASSERT(mapping.locationOffset == locations.size());
+    Q_ASSERT(symbols.size() == locations.size());
+
+    locations.reserve(locations.size() + other.locations.size());
+    for (const auto& location : other.locations) {
+        const auto parent = location.parentLocationId == -1 ? -1 : location.parentLocationId + mapping.locationOffset;
+        locations.push_back({parent, location.location});
+    }
+    symbols += other.symbols;
+
+    mergeTotalCosts(&costs, other.costs, mapping);
+    mergeChildren(&root, other.root, other, mapping);
+}
+
+void BottomUpResults::mergeChildren(BottomUp* parent, const BottomUp& otherParent, const BottomUpResults& other,
+                                    const MergeMapping& mapping)
+{
+    for (const auto& otherChild : otherParent.children) {
+        // entryForSymbol may reallocate the children, but never moves the parent
+        auto* child = parent->entryForSymbol(otherChild.symbol, &maxBottomUpId);
+        mergeCosts(&costs, child->id, other.costs, otherChild.id, mapping);
+        mergeChildren(child, otherChild, other, mapping);
+    }
+}
+
+namespace {
+struct DiffMapping
+{
+    // the baseline cost type for every comparison cost type, or -1
+    QVector<qint32> baselineTypes;
+    double scale = 1.;
+};
+
+void copyComparisonCosts(const BottomUp& parent, const Costs& comparisonCosts, int numTypes, Costs* costs)
+{
+    for (const auto& child : parent.children) {
+        for (int type = 0; type < numTypes; ++type) {
+            const auto cost = comparisonCosts.cost(type, child.id);
+            if (cost) {
+                costs->add(type, child.id, cost);
+                costs->add(numTypes + type, child.id, cost);
+            }
+        }
+        copyComparisonCosts(child, comparisonCosts, numTypes, costs);
+    }
+}
+
+void subtractBaseline(BottomUp* parent, const BottomUp& baselineParent, const Costs& baselineCosts,
+                      const DiffMapping& mapping, Costs* costs, quint32* maxId)
+{
+    if (baselineParent.children.isEmpty()) {
+        return;
+    }
+
+    // entryForSymbol is a linear search, which gets quadratic for the wide nodes of huge trees
+    const bool useIndex = parent->children.size() > 16 && baselineParent.children.size() > 16;
+    QHash<Symbol, int> rows;
+    if (useIndex) {
+        rows.reserve(parent->children.size() + baselineParent.children.size());
+        for (int row = 0, numRows = parent->children.size(); row < numRows; ++row) {
+            rows.insert(parent->children[row].symbol, row);
+        }
+    }
+
+    const auto numTypes = mapping.baselineTypes.size();
+    for (const auto& baselineChild : baselineParent.children) {
+        BottomUp* child = nullptr;
+        if (useIndex) {
+            auto it = rows.find(baselineChild.symbol);
+            if (it == rows.end()) {
+                BottomUp frame;
+                frame.symbol = baselineChild.symbol;
+                frame.id = (*maxId)++;
+                it = rows.insert(frame.symbol, parent->children.size());
+                parent->children.append(frame);
+            }
+            child = &parent->children[*it];
+        } else {
+            child = parent->entryForSymbol(baselineChild.symbol, maxId);
+        }
+
+        for (int type = 0; type < numTypes; ++type) {
+            const auto baselineType = mapping.baselineTypes[type];
+            const auto cost = baselineType < 0 ? 0 : baselineCosts.cost(baselineType, baselineChild.id);
+            if (cost) {
+                costs->add(numTypes + type, child->id, -std::llround(mapping.scale * cost));
+            }
+        }
+
+        // only the children of child get modified, so the pointer stays valid
+        subtractBaseline(child, baselineChild, baselineCosts, mapping, costs, maxId);
+    }
+}
+}
+
+BottomUpResults BottomUpResults::diff(const BottomUpResults& baseline, const BottomUpResults& comparison,
+                                      int normalizationType)
+{
+    PHASE_TRACE("BottomUpResults::diff");
+    const auto numTypes = comparison.costs.numTypes();
+
+    DiffMapping mapping;
+    mapping.baselineTypes.fill(-1, numTypes);
+    for (int type = 0; type < numTypes; ++type) {
+        for (int baselineType = 0, c = baseline.costs.numTypes(); baselineType < c; ++baselineType) {
+            if (baseline.costs.typeName(baselineType) == comparison.costs.typeName(type)) {
+                mapping.baselineTypes[type] = baselineType;
+                break;
+            }
+        }
+    }
+    if (normalizationType >= 0 && normalizationType < numTypes && mapping.baselineTypes[normalizationType] >= 0) {
+        const auto baselineTotal = baseline.costs.totalCost(mapping.baselineTypes[normalizationType]);
+        if (baselineTotal) {
+            mapping.scale = static_cast<double>(comparison.costs.totalCost(normalizationType)) / baselineTotal;
+        }
+    }
+
+    BottomUpResults ret;
+    ret.root = comparison.root;
+    ret.symbols = comparison.symbols;
+    ret.locations = comparison.locations;
+    ret.maxBottomUpId = comparison.maxBottomUpId;
+
+    QVector<qint64> totalCosts(2 * numTypes, 0);
+    for (int type = 0; type < numTypes; ++type) {
+        const auto name = comparison.costs.typeName(type);
+        const auto unit = comparison.costs.unit(type);
+        ret.costs.addType(type, name, unit);
+        ret.costs.addType(numTypes + type, QCoreApplication::translate("Data", "Δ %1").arg(name), unit);
+        ret.costs.setDiffType(type, numTypes + type);
+
+        totalCosts[type] = comparison.costs.totalCost(type);
+        // the differences are relative to the baseline, e.g. +5% means that the function takes 5% longer than the
+        // whole baseline did
+        const auto baselineType = mapping.baselineTypes[type];
+        totalCosts[numTypes + type] = baselineType < 0
+            ? totalCosts[type]
+            : std::llround(mapping.scale * baseline.costs.totalCost(baselineType));
+    }
+    ret.costs.setTotalCosts(totalCosts);
+
+    copyComparisonCosts(ret.root, comparison.costs, numTypes, &ret.costs);
+    subtractBaseline(&ret.root, baseline.root, baseline.costs, mapping, &ret.costs, &ret.maxBottomUpId);
+
+    BottomUp::initializeParents(&ret.root);
+    ret.topRows = topChildren(ret.root.children, ret.costs);
+    return ret;
+}
+
+void CallerCalleeResults::merge(const CallerCalleeResults& other, const MergeMapping& mapping)
+{
+    const auto numTypes = inclusiveCosts.numTypes();
+    for (auto it = other.entries.cbegin(), end = other.entries.cend(); it != end; ++it) {
+        auto& entry = this->entry(it.key());
+        const auto& otherEntry = it.value();
+        mergeCosts(&selfCosts, entry.id, other.selfCosts, otherEntry.id, mapping);
+        mergeCosts(&inclusiveCosts, entry.id, other.inclusiveCosts, otherEntry.id, mapping);
+
+        for (auto caller = otherEntry.callers.cbegin(); caller != otherEntry.callers.cend(); ++caller) {
+            mergeCost(&entry.caller(caller.key(), numTypes), *caller, mapping);
+        }
+        for (auto callee = otherEntry.callees.cbegin(); callee != otherEntry.callees.cend(); ++callee) {
+            mergeCost(&entry.callee(callee.key(), numTypes), *callee, mapping);
+        }
+        for (auto source = otherEntry.sourceMap.cbegin(); source != otherEntry.sourceMap.cend(); ++source) {
+            auto& cost = entry.source(source.key(), numTypes);
+            mergeCost(&cost.selfCost, source->selfCost, mapping);
+            mergeCost(&cost.inclusiveCost, source->inclusiveCost, mapping);
+        }
+        for (auto offset = otherEntry.offsetMap.cbegin(); offset != otherEntry.offsetMap.cend(); ++offset) {
+            auto& cost = entry.offset(offset.key(), numTypes);
+            mergeCost(&cost.selfCost, offset->selfCost, mapping);
+            mergeCost(&cost.inclusiveCost, offset->inclusiveCost, mapping);
+        }
+    }
+    mergeTotalCosts(&selfCosts, other.selfCosts, mapping);
+    mergeTotalCosts(&inclusiveCosts, other.inclusiveCosts, mapping);
+}
+
+const constexpr quint64 PerCostFrequencyData::BASE_BUCKET_WIDTH;
+const constexpr quint64 PerCostFrequencyData::LEVEL_FACTOR;
+const constexpr int PerCostFrequencyData::MAX_BUCKETS_PER_LEVEL;
+
+void PerCostFrequencyData::addValue(quint64 time, qreal cost)
+{
+    if (levels.isEmpty()) {
+        levels.resize(1);
+    }
+
+    auto& buckets = levels[0];
+    const auto bucketTime = time - time % BASE_BUCKET_WIDTH;
+    if (buckets.isEmpty() || buckets.last().time < bucketTime) {
+        FrequencyBucket bucket;
+        bucket.time = bucketTime;
+        buckets.push_back(bucket);
+    } else if (buckets.last().time > bucketTime) {
+        // samples of different threads can arrive slightly out of order
+        auto it = std::lower_bound(buckets.begin(), buckets.end(), bucketTime,
+                                   [](const FrequencyBucket& bucket, quint64 time) { return bucket.time < time; });
+        if (it == buckets.end() || it->time != bucketTime) {
+            FrequencyBucket bucket;
+            bucket.time = bucketTime;
+            it = buckets.insert(it, bucket);
+        }
+        it->add(cost);
+        return;
+    }
+    buckets.last().add(cost);
+}
+
+void PerCostFrequencyData::buildLevels()
+{
+    if (levels.isEmpty()) {
+        return;
+    }
+
+    levels.resize(1);
+    for (int level = 1; levels.last().size() > MAX_BUCKETS_PER_LEVEL; ++level) {
+        const auto width = bucketWidth(level);
+        const auto& finer = levels.last();
+        QVector<FrequencyBucket> coarser;
+        coarser.reserve(static_cast<int>(finer.size() / LEVEL_FACTOR) + 1);
+        for (const auto& bucket : finer) {
+            const auto bucketTime = bucket.time - bucket.time % width;
+            if (coarser.isEmpty() || coarser.last().time != bucketTime) {
+                FrequencyBucket coarseBucket;
+                coarseBucket.time = bucketTime;
+                coarser.push_back(coarseBucket);
+            }
+            coarser.last().merge(bucket);
+        }
+        levels.push_back(coarser);
+    }
+}
+
+void PerCostFrequencyData::filterByTime(const TimeRange& time)
+{
+    for (int level = 0, c = levels.size(); level < c; ++level) {
+        const auto width = bucketWidth(level);
+        auto& buckets = levels[level];
+        auto it = std::remove_if(buckets.begin(), buckets.end(), [time, width](const FrequencyBucket& bucket) {
+            return bucket.time > time.end || bucket.time + width <= time.start;
+        });
+        buckets.erase(it, buckets.end());
+    }
+}
+
+int PerCostFrequencyData::levelForRange(quint64 rangeDelta, int maxBuckets) const
+{
+    for (int level = 0, c = levels.size(); level < c; ++level) {
+        if (rangeDelta / bucketWidth(level) <= static_cast<quint64>(maxBuckets)) {
+            return level;
+        }
+    }
+    return levels.size() - 1;
+}
+
+void PerCostFrequencyData::merge(const PerCostFrequencyData& other)
+{
+    if (other.levels.isEmpty()) {
+        return;
+    } else if (levels.isEmpty()) {
+        levels = other.levels;
+        return;
+    }
+
+    const auto& lhs = levels.constFirst();
+    const auto& rhs = other.levels.constFirst();
+    QVector<FrequencyBucket> merged;
+    merged.reserve(lhs.size() + rhs.size());
+    auto lhsIt = lhs.cbegin();
+    auto rhsIt = rhs.cbegin();
+    while (lhsIt != lhs.cend() || rhsIt != rhs.cend()) {
+        if (rhsIt == rhs.cend() || (lhsIt != lhs.cend() && lhsIt->time < rhsIt->time)) {
+            merged.push_back(*lhsIt++);
+        } else if (lhsIt == lhs.cend() || rhsIt->time < lhsIt->time) {
+            merged.push_back(*rhsIt++);
+        } else {
+            merged.push_back(*lhsIt++);
+            merged.last().merge(*rhsIt++);
+        }
+    }
+
+    levels = {merged};
+    buildLevels();
+}
+
+SymbolStackIndex SymbolStackIndex::fromStacks(const BottomUpResults& bottomUpData, const Stacks& stacks)
+{
+    SymbolStackIndex index;
+    index.numStacks = stacks.size();
+
+    for (qint32 stackId = 0; stackId < index.numStacks; ++stackId) {
+        bottomUpData.foreachFrame(stacks.at(stackId),
+                                  [&index, stackId](const Data::Symbol& symbol, const Data::Location& /*location*/) {
+                                      auto symbolIt = index.symbolIds.find(symbol);
+                                      if (symbolIt == index.symbolIds.end()) {
+                                          symbolIt = index.symbolIds.insert(symbol, index.symbolStacks.size());
+                                          index.symbolStacks.push_back({});
+                                      }
+                                      appendStack(&index.symbolStacks[*symbolIt], stackId);
+
+                                      auto binaryIt = index.binaryIds.find(symbol.binary);
+                                      if (binaryIt == index.binaryIds.end()) {
+                                          binaryIt = index.binaryIds.insert(symbol.binary, index.binaryStacks.size());
+                                          index.binaryStacks.push_back({});
+                                      }
+                                      appendStack(&index.binaryStacks[*binaryIt], stackId);
+                                      return true;
+                                  });
+    }
+
+    return index;
+}
+
+QVector<bool> SymbolStackIndex::filterStacks(const FilterAction& filter) const
+{
+    const bool hasIncludes = !filter.includeSymbols.isEmpty() || !filter.includeBinaries.isEmpty();
+    // without include filters every stack is included unless it gets excluded below
+    QVector<bool> ret(numStacks, !hasIncludes);
+
+    if (hasIncludes) {
+        // a stack must contain all of the included symbols and binaries
+        QVector<const QVector<qint32>*> includes;
+        for (const auto& symbol : filter.includeSymbols) {
+            const auto it = symbolIds.constFind(symbol);
+            if (it == symbolIds.cend()) {
+                return ret;
+            }
+            includes.push_back(&symbolStacks[*it]);
+        }
+        for (const auto& binary : filter.includeBinaries) {
+            const auto it = binaryIds.constFind(binary);
+            if (it == binaryIds.cend()) {
+                return ret;
+            }
+            includes.push_back(&binaryStacks[*it]);
+        }
+
+        // start with the shortest list to keep the intermediate results small
+        std::sort(includes.begin(), includes.end(),
+                  [](const QVector<qint32>* lhs, const QVector<qint32>* rhs) { return lhs->size() < rhs->size(); });
+        auto included = *includes.first();
+        for (int i = 1, c = includes.size(); i < c && !included.isEmpty(); ++i) {
+            included = intersectStacks(included, *includes[i]);
+        }
+        for (auto stackId : qAsConst(included)) {
+            ret[stackId] = true;
+        }
+    }
+
+    auto exclude = [&ret](const QVector<qint32>& stacks) {
+        for (auto stackId : stacks) {
+            ret[stackId] = false;
+        }
+    };
+    for (const auto& symbol : filter.excludeSymbols) {
+        const auto it = symbolIds.constFind(symbol);
+        if (it != symbolIds.cend()) {
+            exclude(symbolStacks[*it]);
+        }
+    }
+    for (const auto& binary : filter.excludeBinaries) {
+        const auto it = binaryIds.constFind(binary);
+        if (it != binaryIds.cend()) {
+            exclude(binaryStacks[*it]);
+        }
+    }
+
+    return ret;
+}
+
+CostCheckpoints CostCheckpoints::fromEvents(const EventResults& events, const GroupOf& groupOf, int interval)
+{
+    PHASE_TRACE("CostCheckpoints::fromEvents");
+    CostCheckpoints checkpoints;
+    checkpoints.interval = std::max(1, interval);
+
+    // the stack and the cost type are packed into the first member
+    QHash<QPair<qint64, qint64>, qint32> slotIds;
+    for (int threadIndex = 0, numThreads = events.threads.size(); threadIndex < numThreads; ++threadIndex) {
+        const auto& thread = events.threads[threadIndex];
+        for (const auto& event : thread.events) {
+            if (event.stackId == -1 || event.type < 0) {
+                continue;
+            }
+            const auto key =
+                qMakePair((static_cast<qint64>(event.stackId) << 32) | static_cast<quint32>(event.type),
+                          groupOf(thread, event));
+            auto it = slotIds.find(key);
+            if (it == slotIds.end()) {
+                it = slotIds.insert(key, checkpoints.slots.size());
+                checkpoints.slots.push_back({event.stackId, event.type, threadIndex, event.cpuId});
+            }
+            checkpoints.samples.push_back({event.time, event.cost, *it});
+        }
+    }
+
+    // the events of every thread are sorted already, keep that order for equal times
+    std::stable_sort(checkpoints.samples.begin(), checkpoints.samples.end(),
+                     [](const Sample& lhs, const Sample& rhs) { return lhs.time < rhs.time; });
+
+    const auto numSlots = checkpoints.slots.size();
+    const auto numCheckpoints = checkpoints.samples.size() / checkpoints.interval;
+
+    QVector<quint64> delta(numSlots, 0);
+    QVector<bool> changed(numSlots, false);
+    QVector<qint32> changedSlots;
+    auto add = [&](qint32 slot, quint64 cost) {
+        if (!changed[slot]) {
+            changed[slot] = true;
+            changedSlots.push_back(slot);
+        }
+        delta[slot] += cost;
+    };
+
+    checkpoints.deltaOffsets.push_back(0);
+    for (int checkpoint = 1; checkpoint <= numCheckpoints; ++checkpoint) {
+        // the checkpoints that cover the earlier part of the range, e.g. 11 and 10 for 12
+        const auto lowestBit = checkpoint & -checkpoint;
+        for (int covered = 1; covered < lowestBit; covered *= 2) {
+            const auto other = checkpoint - covered;
+            for (int i = checkpoints.deltaOffsets[other - 1], end = checkpoints.deltaOffsets[other]; i < end; ++i) {
+                add(checkpoints.deltaSlots[i], checkpoints.deltaCosts[i]);
+            }
+        }
+        for (int i = (checkpoint - 1) * checkpoints.interval, end = checkpoint * checkpoints.interval; i < end; ++i) {
+            const auto& sample = checkpoints.samples[i];
+            add(sample.slot, sample.cost);
+        }
+
+        // sorted slots keep the memory accesses of the queries ordered
+        std::sort(changedSlots.begin(), changedSlots.end());
+        for (auto slot : qAsConst(changedSlots)) {
+            checkpoints.deltaSlots.push_back(slot);
+            checkpoints.deltaCosts.push_back(delta[slot]);
+            delta[slot] = 0;
+            changed[slot] = false;
+        }
+        changedSlots.clear();
+        checkpoints.deltaOffsets.push_back(checkpoints.deltaSlots.size());
+    }
+
+    return checkpoints;
+}
+
+void CostCheckpoints::addPrefix(QVector<quint64>* costs, int sampleIndex, bool subtract) const
+{
+    // unsigned arithmetic wraps around, the difference of two prefix sums is correct nevertheless
+    auto add = [costs, subtract](qint32 slot, quint64 cost) {
+        if (subtract) {
+            (*costs)[slot] -= cost;
+        } else {
+            (*costs)[slot] += cost;
+        }
+    };
+
+    const auto checkpoint = sampleIndex / interval;
+    for (int i = checkpoint; i > 0; i -= i & -i) {
+        for (int j = deltaOffsets[i - 1], end = deltaOffsets[i]; j < end; ++j) {
+            add(deltaSlots[j], deltaCosts[j]);
+        }
+    }
+    for (int i = checkpoint * interval; i < sampleIndex; ++i) {
+        add(samples[i].slot, samples[i].cost);
+    }
+}
+
+QVector<quint64> CostCheckpoints::costs(const TimeRange& time) const
+{
+    PHASE_TRACE("CostCheckpoints::costs");
+    QVector<quint64> ret(slots.size(), 0);
+
+    const auto begin = static_cast<int>(
+        std::lower_bound(samples.cbegin(), samples.cend(), time.start,
+                         [](const Sample& sample, quint64 value) { return sample.time < value; })
+        - samples.cbegin());
+    const auto end = static_cast<int>(
+        std::upper_bound(samples.cbegin(), samples.cend(), time.end,
+                         [](quint64 value, const Sample& sample) { return value < sample.time; })
+        - samples.cbegin());
+
+    if (end - begin <= 2 * interval) {
+        // short ranges are cheaper to sum up directly
+        for (int i = begin; i < end; ++i) {
+            ret[samples[i].slot] += samples[i].cost;
+        }
+        return ret;
+    }
+
+    addPrefix(&ret, end, false);
+    addPrefix(&ret, begin, true);
+    return ret;
+}
+
+quint64 FlameChart::minDuration(int level) const
+{
+    if (level == 0) {
+        return 0;
+    }
+    auto duration = sampleInterval;
+    for (int i = 1; i < level; ++i) {
+        duration *= LEVEL_FACTOR;
+    }
+    return duration;
+}
+
+namespace {
+// merges the spans of one depth into the next coarser level, the previous depth got merged already
+// mapping gets the index of the merged span for every input span, or -1 when it got dropped
+QVector<FlameChart::Span> mergeSpans(const QVector<FlameChart::Span>& spans, const QVector<FlameChart::Span>& parents,
+                                     const QVector<qint32>& parentMapping, quint64 minDuration,
+                                     QVector<qint32>* mapping)
+{
+    auto isShort = [minDuration](const FlameChart::Span& span) { return span.time.delta() < minDuration; };
+
+    QVector<FlameChart::Span> ret;
+    mapping->resize(spans.size());
+    for (int i = 0, c = spans.size(); i < c; ++i) {
+        auto span = spans[i];
+        if (span.parent != -1) {
+            span.parent = parentMapping[span.parent];
+            if (span.parent == -1 || parents[span.parent].symbol == -1) {
+                // the callees of collapsed spans are too short to be shown
+                (*mapping)[i] = -1;
+                continue;
+            }
+        }
+
+        if (!ret.isEmpty()) {
+            auto& last = ret.last();
+            // only merge within the same caller, so that the spans stay nested
+            if (last.parent == span.parent && span.time.start - last.time.end < minDuration
+                && (last.symbol == span.symbol || (isShort(last) && isShort(span)))) {
+                if (last.symbol != span.symbol) {
+                    last.symbol = -1;
+                }
+                last.time.end = span.time.end;
+                last.samples += span.samples;
+                (*mapping)[i] = ret.size() - 1;
+                continue;
+            }
+        }
+
+        (*mapping)[i] = ret.size();
+        ret.append(span);
+    }
+    return ret;
+}
+}
+
+FlameChart FlameChart::fromEvents(const ThreadEvents& thread, const Stacks& stacks, const BottomUpResults& bottomUpData,
+                                  qint32 costType)
+{
+    PHASE_TRACE("FlameChart::fromEvents");
+    FlameChart ret;
+
+    auto isSample = [costType](const Event& event) { return event.type == costType && event.stackId >= 0; };
+
+    QVector<quint64> intervals;
+    quint64 lastTime = 0;
+    bool hasSamples = false;
+    for (const auto& event : thread.events) {
+        if (!isSample(event)) {
+            continue;
+        }
+        if (hasSamples && event.time > lastTime) {
+            intervals.append(event.time - lastTime);
+        }
+        lastTime = event.time;
+        hasSamples = true;
+    }
+    if (!hasSamples) {
+        return ret;
+    }
+
+    // the median is robust against the long gaps while the thread sleeps
+    if (!intervals.isEmpty()) {
+        const auto median = intervals.begin() + intervals.size() / 2;
+        std::nth_element(intervals.begin(), median, intervals.end());
+        ret.sampleInterval = *median;
+    }
+    ret.sampleInterval = std::max(ret.sampleInterval, quint64(1));
+
+    QHash<Symbol, qint32> symbolIds;
+    QHash<qint32, QVector<qint32>> stackSymbols;
+    auto symbolsOf = [&](qint32 stackId) {
+        auto it = stackSymbols.constFind(stackId);
+        if (it != stackSymbols.constEnd()) {
+            return *it;
+        }
+        QVector<qint32> frames;
+        bottomUpData.foreachFrame(stacks.at(stackId), [&](const Symbol& symbol, const Location& /*location*/) {
+            auto symbolIt = symbolIds.constFind(symbol);
+            if (symbolIt == symbolIds.constEnd()) {
+                symbolIt = symbolIds.insert(symbol, ret.symbols.size());
+                ret.symbols.append(symbol);
+            }
+            frames.append(*symbolIt);
+            return true;
+        });
+        // the stacks start with the innermost frame
+        std::reverse(frames.begin(), frames.end());
+        stackSymbols.insert(stackId, frames);
+        return frames;
+    };
+
+    QVector<QVector<Span>> spans;
+    // the spans that the next sample may extend, as indices into spans per depth
+    QVector<qint32> open;
+    QVector<qint32> openSymbols;
+    hasSamples = false;
+    for (const auto& event : thread.events) {
+        if (!isSample(event)) {
+            continue;
+        }
+
+        // a sample lasts until the next one, unless the thread didn't get sampled for a while
+        const auto time = event.time;
+        const auto isContiguous = !hasSamples || time - lastTime <= 2 * ret.sampleInterval;
+        const auto previousEnd = isContiguous ? time : lastTime + ret.sampleInterval;
+        for (int depth = 0, c = open.size(); depth < c; ++depth) {
+            spans[depth][open[depth]].time.end = previousEnd;
+        }
+        if (!hasSamples) {
+            ret.time.start = time;
+        }
+        lastTime = time;
+        hasSamples = true;
+
+        const auto frames = symbolsOf(event.stackId);
+        int shared = 0;
+        if (isContiguous) {
+            const auto numFrames = std::min(frames.size(), openSymbols.size());
+            while (shared < numFrames && frames[shared] == openSymbols[shared]) {
+                ++shared;
+            }
+        }
+        open.resize(shared);
+        openSymbols.resize(shared);
+        for (int depth = 0; depth < shared; ++depth) {
+            ++spans[depth][open[depth]].samples;
+        }
+
+        if (spans.size() < frames.size()) {
+            spans.resize(frames.size());
+        }
+        for (int depth = shared, c = frames.size(); depth < c; ++depth) {
+            Span span;
+            span.time = {time, time};
+            span.symbol = frames[depth];
+            span.parent = depth == 0 ? -1 : open[depth - 1];
+            span.samples = 1;
+            open.append(spans[depth].size());
+            openSymbols.append(frames[depth]);
+            spans[depth].append(span);
+        }
+    }
+    ret.time.end = lastTime + ret.sampleInterval;
+    for (int depth = 0, c = open.size(); depth < c; ++depth) {
+        spans[depth][open[depth]].time.end = ret.time.end;
+    }
+    ret.levels.append(spans);
+
+    // each level merges what is shorter than LEVEL_FACTOR pixels of the previous one
+    while (ret.time.delta() / std::max(ret.minDuration(ret.levels.size() - 1), ret.sampleInterval)
+           > MIN_SPANS_PER_LEVEL) {
+        const auto& previous = ret.levels.constLast();
+        const auto minDuration = ret.minDuration(ret.levels.size());
+
+        QVector<QVector<Span>> level;
+        level.reserve(previous.size());
+        QVector<qint32> parentMapping;
+        for (const auto& depthSpans : previous) {
+            QVector<qint32> mapping;
+            const auto parents = level.isEmpty() ? QVector<Span>() : level.constLast();
+            level.append(mergeSpans(depthSpans, parents, parentMapping, minDuration, &mapping));
+            parentMapping = std::move(mapping);
+        }
+        while (!level.isEmpty() && level.constLast().isEmpty()) {
+            level.removeLast();
+        }
+        ret.levels.append(level);
+    }
+
+    return ret;
+}
+
+int FlameChart::levelForResolution(quint64 timePerPixel) const
+{
+    int level = 0;
+    while (level + 1 < levels.size() && minDuration(level + 1) <= timePerPixel) {
+        ++level;
+    }
+    return level;
+}
+
+std::pair<const FlameChart::Span*, const FlameChart::Span*> FlameChart::spans(int level, int depth,
+                                                                              const TimeRange& time) const
+{
+    if (level < 0 || level >= levels.size() || depth < 0 || depth >= levels[level].size()) {
+        return {nullptr, nullptr};
+    }
+
+    // the spans of one depth don't overlap, so both their starts and ends are sorted
+    const auto& row = levels[level][depth];
+    const auto begin = std::lower_bound(row.cbegin(), row.cend(), time.start,
+                                        [](const Span& span, quint64 start) { return span.time.end < start; });
+    const auto end = std::upper_bound(begin, row.cend(), time.end,
+                                      [](quint64 end, const Span& span) { return end < span.time.start; });
+    return {begin, end};
+}
+
+TimeRange CpuHeatmap::bucketTime(int bucket) const
+{
+    const auto delta = time.delta();
+    return {time.start + delta * bucket / numBuckets, time.start + delta * (bucket + 1) / numBuckets};
+}
+
+int CpuHeatmap::bucketAt(quint64 time) const
+{
+    if (!numBuckets || time < this->time.start || time > this->time.end) {
+        return -1;
+    }
+    const auto delta = std::max(this->time.delta(), quint64(1));
+    return std::min(static_cast<int>((time - this->time.start) * numBuckets / delta), numBuckets - 1);
+}
+
+CpuHeatmap CpuHeatmap::fromEvents(const QVector<CpuEvents>& cpus, qint32 costType, Value value, const TimeRange& time,
+                                  int numBuckets)
+{
+    PHASE_TRACE("CpuHeatmap::fromEvents");
+    CpuHeatmap ret;
+    if (!time.isValid() || numBuckets <= 0) {
+        return ret;
+    }
+    ret.time = time;
+    ret.numBuckets = numBuckets;
+
+    QVector<quint64> row(numBuckets);
+    for (const auto& cpu : cpus) {
+        // idle CPUs stay in, that's what the heatmap is for, but not those that never got any events
+        if (cpu.events.isEmpty()) {
+            continue;
+        }
+
+        row.fill(0);
+        // the events are sorted by time, so only those in the visible time get looked at
+        auto it = std::lower_bound(cpu.events.begin(), cpu.events.end(), time.start,
+                                   [](const Event& event, quint64 start) { return event.time < start; });
+        for (const auto end = cpu.events.end(); it != end && it->time <= time.end; ++it) {
+            if (it->type == costType) {
+                row[ret.bucketAt(it->time)] += value == Value::Samples ? 1 : it->cost;
+            }
+        }
+
+        ret.cpuIds.append(cpu.cpuId);
+        ret.cells += row;
+        ret.maxCell = std::max(ret.maxCell, *std::max_element(row.cbegin(), row.cend()));
+    }
+    return ret;
+}
+
 QDebug Data::operator<<(QDebug stream, const Symbol& symbol)
 {
     stream.noquote().nospace() << "Symbol{"
@@ -369,3 +1211,682 @@ const Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
 {
     return const_cast<Data::EventResults*>(this)->findThread(pid, tid);
 }
+
+qint64 Data::EventResults::memoryUsage() const
+{
+    auto usage = stacks.memoryUsage();
+    for (const auto& thread : threads) {
+        usage += thread.events.memoryUsage();
+    }
+    for (const auto& cpu : cpus) {
+        usage += cpu.events.memoryUsage();
+    }
+    return usage;
+}
+
+void Data::EventResults::spill(SpillFile* file, qint64 budget)
+{
+    PHASE_TRACE("EventResults::spill");
+
+    stacks.spill(file);
+
+    QVector<Events*> candidates;
+    candidates.reserve(threads.size() + cpus.size());
+    for (auto& thread : threads) {
+        candidates.push_back(&thread.events);
+    }
+    for (auto& cpu : cpus) {
+        candidates.push_back(&cpu.events);
+    }
+
+    // spilling rewrites all events of an array, so prefer the ones that at least doubled in size
+    // since they were spilled last, this keeps the amortized cost linear
+    for (auto* events : qAsConst(candidates)) {
+        if (events->numInMemory() > 0 && events->numInMemory() >= events->numSpilled()) {
+            events->spill(file);
+        }
+    }
+
+    auto usage = memoryUsage();
+    if (usage <= budget / 2) {
+        return;
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Events* lhs, const Events* rhs) { return lhs->memoryUsage() > rhs->memoryUsage(); });
+    for (auto* events : qAsConst(candidates)) {
+        if (usage <= budget / 2 || !events->numInMemory()) {
+            break;
+        }
+        const auto eventsUsage = events->memoryUsage();
+        if (events->spill(file)) {
+            usage -= eventsUsage;
+        }
+    }
+}
+
+void Data::EventResults::makeContiguous(SpillFile* file)
+{
+    for (auto& thread : threads) {
+        thread.events.makeContiguous(file);
+    }
+    for (auto& cpu : cpus) {
+        cpu.events.makeContiguous(file);
+    }
+}
+
+void Data::EventResults::merge(const EventResults& other, const MergeMapping& mapping, SpillFile* file, qint64 budget)
+{
+    const auto stackOffset = stacks.size();
+    QVector<qint32> frames;
+    for (int stackId = 0, c = other.stacks.size(); stackId < c; ++stackId) {
+        const auto otherFrames = other.stacks.at(stackId);
+        frames.resize(otherFrames.size());
+        std::transform(otherFrames.begin(), otherFrames.end(), frames.begin(),
+                       [&mapping](qint32 locationId) { return locationId + mapping.locationOffset; });
+        stacks.push_back(frames);
+        // checked in batches like during parsing, so the spilled blocks don't get too small
+        if (file && stackId % 4096 == 4095 && stacks.memoryUsage() > budget / 2) {
+            stacks.spill(file);
+        }
+    }
+
+    auto mapEvent = [&mapping, stackOffset](Event event) {
+        event.type = mapping.costType(event.type);
+        if (event.stackId != -1) {
+            event.stackId += stackOffset;
+        }
+        if (event.cpuId != INVALID_CPU_ID) {
+            event.cpuId += mapping.cpuOffset;
+        }
+        return event;
+    };
+
+    // both sides are sorted by time already, the other events get mapped on the fly
+    // the merged events go straight into the spill file when keeping them in memory would exceed the budget
+    auto mergeEvents = [this, file, budget, &mapEvent](const Events& lhs, const Events& rhs) {
+        const auto numEvents = lhs.size() + rhs.size();
+        int i = 0;
+        int j = 0;
+        auto next = [&]() {
+            if (j == rhs.size() || (i < lhs.size() && lhs.at(i).time <= rhs.at(j).time)) {
+                return lhs.at(i++);
+            }
+            return mapEvent(rhs.at(j++));
+        };
+
+        Events ret;
+        if (file && memoryUsage() + static_cast<qint64>(numEvents) * sizeof(Event) > budget
+            && ret.assignSpilled(file, numEvents, next)) {
+            return ret;
+        }
+
+        i = 0;
+        j = 0;
+        ret.reserve(numEvents);
+        while (i < lhs.size() || j < rhs.size()) {
+            ret.push_back(next());
+        }
+        return ret;
+    };
+    auto enforceBudget = [this, file, budget]() {
+        if (file && memoryUsage() > budget) {
+            spill(file, budget);
+        }
+    };
+
+    auto mapId = [&mapping](qint32 id) { return id < 0 ? id : id + mapping.pidOffset; };
+
+    for (const auto& otherThread : other.threads) {
+        const auto pid = mapId(otherThread.pid);
+        const auto tid = mapId(otherThread.tid);
+
+        auto wakeups = otherThread.wakeups;
+        for (auto& wakeup : wakeups) {
+            wakeup.wakerPid = mapId(wakeup.wakerPid);
+            wakeup.wakerTid = mapId(wakeup.wakerTid);
+            if (wakeup.stackId != -1) {
+                wakeup.stackId += stackOffset;
+            }
+            if (wakeup.wakerStackId != -1) {
+                wakeup.wakerStackId += stackOffset;
+            }
+            if (wakeup.wakerCpuId != INVALID_CPU_ID) {
+                wakeup.wakerCpuId += mapping.cpuOffset;
+            }
+        }
+
+        auto* thread = findThread(pid, tid);
+        if (!thread) {
+            ThreadEvents newThread = otherThread;
+            newThread.pid = pid;
+            newThread.tid = tid;
+            newThread.events = mergeEvents({}, otherThread.events);
+            newThread.wakeups = wakeups;
+            if (!mapping.threadSuffix.isEmpty()) {
+                newThread.name += mapping.threadSuffix;
+            }
+            threads.push_back(newThread);
+            enforceBudget();
+            continue;
+        }
+
+        thread->events = mergeEvents(thread->events, otherThread.events);
+        enforceBudget();
+        thread->wakeups += wakeups;
+        std::stable_sort(thread->wakeups.begin(), thread->wakeups.end(),
+                         [](const Wakeup& lhs, const Wakeup& rhs) { return lhs.offCpu.end < rhs.offCpu.end; });
+        thread->time.start = std::min(thread->time.start, otherThread.time.start);
+        thread->time.end = std::max(thread->time.end, otherThread.time.end);
+        thread->offCpuTime += otherThread.offCpuTime;
+        if (otherThread.time.end >= thread->time.end) {
+            thread->lastSwitchTime = otherThread.lastSwitchTime;
+            thread->state = otherThread.state;
+        }
+    }
+
+    for (const auto& otherCpu : other.cpus) {
+        const auto cpuId = otherCpu.cpuId + mapping.cpuOffset;
+        if (static_cast<quint32>(cpus.size()) <= cpuId) {
+            const auto oldSize = cpus.size();
+            cpus.resize(cpuId + 1);
+            for (int i = oldSize; i < cpus.size(); ++i) {
+                cpus[i].cpuId = i;
+            }
+        }
+        auto& cpu = cpus[cpuId];
+        cpu.events = mergeEvents(cpu.events, otherCpu.events);
+        enforceBudget();
+    }
+
+    if (offCpuTimeCostId == -1) {
+        offCpuTimeCostId = mapping.costType(other.offCpuTimeCostId);
+    }
+    if (lostEventCostId == -1) {
+        lostEventCostId = mapping.costType(other.lostEventCostId);
+    }
+}
+
+QVector<Data::CriticalPathSegment> Data::EventResults::criticalPath(qint32 pid, qint32 tid, const TimeRange& time) const
+{
+    PHASE_TRACE("EventResults::criticalPath");
+
+    QVector<CriticalPathSegment> path;
+    auto addSegment = [&path, time](const ThreadEvents* thread, quint64 start, quint64 end,
+                                    CriticalPathSegment::State state, const Wakeup* wakeup) {
+        start = std::max(start, time.start);
+        if (start >= end) {
+            return;
+        }
+        CriticalPathSegment segment;
+        segment.pid = thread->pid;
+        segment.tid = thread->tid;
+        segment.time = {start, end};
+        segment.state = state;
+        if (wakeup) {
+            segment.stackId = wakeup->stackId;
+            segment.wakerPid = wakeup->wakerPid;
+            segment.wakerTid = wakeup->wakerTid;
+            segment.wakerStackId = wakeup->wakerStackId;
+        }
+        path.push_back(segment);
+    };
+
+    // every step consumes a wakeup, so this bounds the walk even when the times don't advance
+    int maxSteps = 1;
+    for (const auto& thread : threads) {
+        maxSteps += thread.wakeups.size();
+    }
+
+    const auto* thread = findThread(pid, tid);
+    auto end = time.end;
+    while (thread && end > time.start && maxSteps-- > 0) {
+        // the last time the thread got switched in before the end
+        const auto& wakeups = thread->wakeups;
+        auto it = std::upper_bound(wakeups.cbegin(), wakeups.cend(), end,
+                                   [](quint64 value, const Wakeup& wakeup) { return value < wakeup.offCpu.end; });
+        if (it == wakeups.cbegin()) {
+            addSegment(thread, thread->time.start, end, CriticalPathSegment::State::Running, nullptr);
+            break;
+        }
+        const auto& wakeup = *(--it);
+
+        addSegment(thread, wakeup.offCpu.end, end, CriticalPathSegment::State::Running, nullptr);
+
+        const auto* waker = findThread(wakeup.wakerPid, wakeup.wakerTid);
+        if (waker && waker != thread && wakeup.time <= wakeup.offCpu.end) {
+            addSegment(thread, wakeup.time, wakeup.offCpu.end, CriticalPathSegment::State::Runnable, &wakeup);
+            // the waker was running when it woke up the thread
+            thread = waker;
+            end = wakeup.time;
+        } else {
+            addSegment(thread, wakeup.offCpu.start, wakeup.offCpu.end, CriticalPathSegment::State::Blocked, &wakeup);
+            end = wakeup.offCpu.start;
+        }
+    }
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+static_assert(std::is_trivially_copyable<Data::Event>::value, "events get spilled byte-wise");
+
+void Data::Events::clear()
+{
+    m_block.reset();
+    m_numSpilled = 0;
+    m_memory = QVector<Event>();
+    m_windowStart = 0;
+    m_windowSize = -1;
+}
+
+void Data::Events::detachWindow()
+{
+    QVector<Event> events;
+    events.reserve(m_windowSize);
+    for (int i = 0; i < m_windowSize; ++i) {
+        events.push_back(at(i));
+    }
+    clear();
+    m_memory = std::move(events);
+}
+
+bool Data::Events::spill(SpillFile* file)
+{
+    detach();
+    if (m_memory.isEmpty()) {
+        return true;
+    }
+
+    const auto spilledSize = static_cast<qint64>(m_numSpilled) * sizeof(Event);
+    const auto memorySize = static_cast<qint64>(m_memory.size()) * sizeof(Event);
+    auto block = file->append({{m_numSpilled ? spilledData() : nullptr, spilledSize}, {m_memory.constData(), memorySize}});
+    if (!block) {
+        return false;
+    }
+
+    m_block = std::move(block);
+    m_numSpilled += m_memory.size();
+    m_memory = QVector<Event>();
+    return true;
+}
+
+void Data::Events::makeContiguous(SpillFile* file)
+{
+    if (isContiguous() || (file && spill(file))) {
+        return;
+    }
+
+    QVector<Event> events;
+    events.reserve(size());
+    for (int i = 0, c = size(); i < c; ++i) {
+        events.push_back(at(i));
+    }
+    clear();
+    m_memory = std::move(events);
+}
+
+bool Data::Events::operator==(const Events& rhs) const
+{
+    if (size() != rhs.size()) {
+        return false;
+    }
+    for (int i = 0, c = size(); i < c; ++i) {
+        if (!(at(i) == rhs.at(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Data::StackFrames Data::Stacks::at(int stackId) const
+{
+    Q_ASSERT(stackId >= 0 && stackId < size());
+    const auto begin = m_offsets[stackId];
+    const auto end = m_offsets[stackId + 1];
+
+    if (begin >= m_memoryStart) {
+        const auto* frames = m_frames.constData();
+        return {frames + (begin - m_memoryStart), frames + (end - m_memoryStart)};
+    }
+
+    // stacks never cross block boundaries, find the last block that starts before this stack
+    auto it = std::upper_bound(m_spilled.cbegin(), m_spilled.cend(), begin,
+                               [](quint64 frame, const SpilledFrames& spilled) { return frame < spilled.firstFrame; });
+    Q_ASSERT(it != m_spilled.cbegin());
+    --it;
+    const auto* frames = reinterpret_cast<const qint32*>(it->block->data());
+    return {frames + (begin - it->firstFrame), frames + (end - it->firstFrame)};
+}
+
+bool Data::Stacks::spill(SpillFile* file)
+{
+    if (m_frames.isEmpty()) {
+        return true;
+    }
+
+    auto block = file->append({{m_frames.constData(), static_cast<qint64>(m_frames.size()) * sizeof(qint32)}});
+    if (!block) {
+        return false;
+    }
+
+    m_spilled.push_back({m_memoryStart, std::move(block)});
+    m_memoryStart += m_frames.size();
+    m_frames = QVector<qint32>();
+    return true;
+}
+
+bool Data::Stacks::operator==(const Stacks& rhs) const
+{
+    if (size() != rhs.size()) {
+        return false;
+    }
+    for (int i = 0, c = size(); i < c; ++i) {
+        if (!(at(i) == rhs.at(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const constexpr int Data::LatencyHistogram::NUM_BUCKETS;
+
+int Data::LatencyHistogram::bucketForDuration(quint64 duration)
+{
+    if (!duration) {
+        return 0;
+    }
+    return std::min(64 - static_cast<int>(qCountLeadingZeroBits(duration)), NUM_BUCKETS - 1);
+}
+
+const Data::TracepointField* Data::TracepointFormat::field(const QString& fieldName) const
+{
+    auto it = std::find_if(fields.cbegin(), fields.cend(),
+                           [&fieldName](const TracepointField& field) { return field.name == fieldName; });
+    return it == fields.cend() ? nullptr : &(*it);
+}
+
+const Data::TracepointFormat* Data::TracepointResults::format(const QString& name) const
+{
+    auto it = std::find_if(formats.cbegin(), formats.cend(),
+                           [&name](const TracepointFormat& format) { return format.name == name; });
+    return it == formats.cend() ? nullptr : &(*it);
+}
+
+QVector<Data::TracepointPair> Data::TracepointResults::latencyPairs() const
+{
+    using Scope = TracepointPair::Scope;
+    const QVector<TracepointPair> knownPairs = {
+        {QStringLiteral("block:block_rq_issue"),
+         QStringLiteral("block:block_rq_complete"),
+         {QStringLiteral("dev"), QStringLiteral("sector")},
+         Scope::Global},
+        {QStringLiteral("irq:irq_handler_entry"), QStringLiteral("irq:irq_handler_exit"), {QStringLiteral("irq")},
+         Scope::Cpu},
+        {QStringLiteral("irq:softirq_entry"), QStringLiteral("irq:softirq_exit"), {QStringLiteral("vec")}, Scope::Cpu},
+        {QStringLiteral("raw_syscalls:sys_enter"), QStringLiteral("raw_syscalls:sys_exit"), {QStringLiteral("id")},
+         Scope::Thread},
+    };
+
+    QVector<TracepointPair> pairs;
+    for (const auto& pair : knownPairs) {
+        if (format(pair.begin) && format(pair.end)) {
+            pairs.push_back(pair);
+        }
+    }
+
+    // the per-syscall tracepoints, e.g. syscalls:sys_enter_read and syscalls:sys_exit_read
+    const auto enterPrefix = QStringLiteral("syscalls:sys_enter_");
+    for (const auto& candidate : formats) {
+        if (!candidate.name.startsWith(enterPrefix)) {
+            continue;
+        }
+        const auto exit = QStringLiteral("syscalls:sys_exit_") + candidate.name.mid(enterPrefix.size());
+        if (format(exit)) {
+            pairs.push_back({candidate.name, exit, {}, Scope::Thread});
+        }
+    }
+    return pairs;
+}
+
+Data::LatencyHistogram Data::TracepointResults::latencies(const TracepointPair& pair,
+                                                          const TracepointFieldFilter& filter) const
+{
+    PHASE_TRACE("TracepointResults::latencies");
+
+    LatencyHistogram histogram;
+    histogram.pair = pair;
+    histogram.buckets.resize(LatencyHistogram::NUM_BUCKETS);
+
+    const auto* begin = format(pair.begin);
+    const auto* end = format(pair.end);
+    if (!begin || !end) {
+        return histogram;
+    }
+
+    // the filter applies to the end samples too when they have the field, e.g. the id of raw_syscalls:sys_exit
+    // string values are looked up per format, their indices differ between the two tracepoints
+    struct FieldFilter
+    {
+        const TracepointField* field = nullptr;
+        qint64 value = 0;
+
+        bool accepts(int sample) const
+        {
+            return !field || field->values[sample] == value;
+        }
+    };
+    auto fieldFilter = [&filter](const TracepointFormat* format, bool* ok) {
+        FieldFilter ret;
+        ret.field = filter.isValid() ? format->field(filter.field) : nullptr;
+        *ok = true;
+        if (!ret.field) {
+            return ret;
+        } else if (ret.field->isString) {
+            ret.value = ret.field->strings.indexOf(filter.value);
+            *ok = ret.value != -1;
+        } else {
+            ret.value = filter.value.toLongLong(ok, 0);
+        }
+        return ret;
+    };
+    bool beginOk = false;
+    bool endOk = false;
+    const auto beginFilter = fieldFilter(begin, &beginOk);
+    const auto endFilter = fieldFilter(end, &endOk);
+    if (!beginOk || !endOk || (filter.isValid() && !beginFilter.field)) {
+        return histogram;
+    }
+
+    // the key that identifies the end sample of a begin sample
+    // strings are compared by hash as their indices differ between the two tracepoints
+    auto keyFields = [&pair](const TracepointFormat* format) {
+        QVector<const TracepointField*> fields;
+        for (const auto& key : pair.keys) {
+            fields.push_back(format->field(key));
+        }
+        return fields;
+    };
+    const auto beginKeys = keyFields(begin);
+    const auto endKeys = keyFields(end);
+    auto key = [&pair](const TracepointFormat* format, const QVector<const TracepointField*>& fields, int sample) {
+        QVector<qint64> ret;
+        ret.reserve(fields.size() + 1);
+        switch (pair.scope) {
+        case TracepointPair::Scope::Thread:
+            ret.push_back(format->tids[sample]);
+            break;
+        case TracepointPair::Scope::Cpu:
+            ret.push_back(format->cpuIds[sample]);
+            break;
+        case TracepointPair::Scope::Global:
+            break;
+        }
+        for (const auto* field : fields) {
+            if (!field) {
+                ret.push_back(0);
+            } else if (field->isString) {
+                ret.push_back(qHash(field->displayValue(sample)));
+            } else {
+                ret.push_back(field->values[sample]);
+            }
+        }
+        return ret;
+    };
+
+    // merged recordings are not sorted by time
+    auto samplesByTime = [](const TracepointFormat* format) {
+        QVector<int> samples(format->size());
+        std::iota(samples.begin(), samples.end(), 0);
+        if (!std::is_sorted(format->times.cbegin(), format->times.cend())) {
+            std::stable_sort(samples.begin(), samples.end(),
+                             [format](int lhs, int rhs) { return format->times[lhs] < format->times[rhs]; });
+        }
+        return samples;
+    };
+    const auto beginSamples = samplesByTime(begin);
+    const auto endSamples = samplesByTime(end);
+
+    // a begin sample without end gets replaced by the next begin sample with the same key
+    QHash<QVector<qint64>, int> pending;
+    auto beginIt = beginSamples.cbegin();
+    auto endIt = endSamples.cbegin();
+    while (endIt != endSamples.cend()) {
+        if (beginIt != beginSamples.cend() && begin->times[*beginIt] <= end->times[*endIt]) {
+            const auto sample = *beginIt++;
+            if (beginFilter.accepts(sample)) {
+                pending.insert(key(begin, beginKeys, sample), sample);
+            }
+            continue;
+        }
+
+        const auto sample = *endIt++;
+        if (!endFilter.accepts(sample)) {
+            continue;
+        }
+        auto it = pending.find(key(end, endKeys, sample));
+        if (it == pending.end()) {
+            continue;
+        }
+        const auto beginSample = it.value();
+        pending.erase(it);
+
+        Latency latency;
+        latency.time = begin->times[beginSample];
+        latency.duration = end->times[sample] - latency.time;
+        latency.tid = begin->tids[beginSample];
+        latency.cpuId = begin->cpuIds[beginSample];
+        histogram.latencies.push_back(latency);
+    }
+
+    if (histogram.latencies.isEmpty()) {
+        return histogram;
+    }
+
+    std::sort(histogram.latencies.begin(), histogram.latencies.end(),
+              [](const Latency& lhs, const Latency& rhs) { return lhs.time < rhs.time; });
+
+    QVector<quint64> durations;
+    durations.reserve(histogram.latencies.size());
+    for (const auto& latency : qAsConst(histogram.latencies)) {
+        durations.push_back(latency.duration);
+        ++histogram.buckets[LatencyHistogram::bucketForDuration(latency.duration)];
+        histogram.total += latency.duration;
+    }
+    std::sort(durations.begin(), durations.end());
+    auto percentile = [&durations](int percent) {
+        return durations[static_cast<int>((static_cast<qint64>(durations.size()) - 1) * percent / 100)];
+    };
+    histogram.minimum = durations.first();
+    histogram.median = percentile(50);
+    histogram.p99 = percentile(99);
+    histogram.maximum = durations.last();
+    return histogram;
+}
+
+void Data::TracepointResults::filterByTime(const TimeRange& time)
+{
+    auto it = std::remove_if(tracepoints.begin(), tracepoints.end(),
+                             [time](const Tracepoint& tracepoint) { return !time.contains(tracepoint.time); });
+    tracepoints.erase(it, tracepoints.end());
+
+    for (auto& format : formats) {
+        // filter() only overwrites the samples it already looked at
+        format.filter([&format, time](int sample) { return time.contains(format.times.at(sample)); });
+    }
+}
+
+void Data::TracepointResults::merge(const TracepointResults& other, const MergeMapping& mapping)
+{
+    tracepoints += other.tracepoints;
+
+    for (const auto& otherFormat : other.formats) {
+        auto it = std::find_if(formats.begin(), formats.end(), [&otherFormat](const TracepointFormat& format) {
+            return format.name == otherFormat.name;
+        });
+        if (it == formats.end()) {
+            TracepointFormat format;
+            format.name = otherFormat.name;
+            formats.push_back(format);
+            it = formats.end() - 1;
+        }
+        auto& format = *it;
+        const auto oldSize = format.size();
+
+        format.times += otherFormat.times;
+        for (auto tid : otherFormat.tids) {
+            format.tids.push_back(tid < 0 ? tid : tid + mapping.pidOffset);
+        }
+        for (auto cpuId : otherFormat.cpuIds) {
+            format.cpuIds.push_back(cpuId == INVALID_CPU_ID ? cpuId : cpuId + mapping.cpuOffset);
+        }
+
+        for (const auto& otherField : otherFormat.fields) {
+            auto fieldIt = std::find_if(format.fields.begin(), format.fields.end(),
+                                        [&otherField](const TracepointField& field) {
+                                            return field.name == otherField.name;
+                                        });
+            if (fieldIt == format.fields.end()) {
+                TracepointField field;
+                field.name = otherField.name;
+                field.isString = otherField.isString;
+                field.values.fill(0, oldSize);
+                format.fields.push_back(field);
+                fieldIt = format.fields.end() - 1;
+            }
+            auto& field = *fieldIt;
+            if (field.isString != otherField.isString) {
+                // left at zero by the padding below
+                continue;
+            }
+
+            if (!field.isString) {
+                field.values += otherField.values;
+                continue;
+            }
+
+            QHash<QString, qint64> stringIds;
+            for (int i = 0, c = field.strings.size(); i < c; ++i) {
+                stringIds.insert(field.strings[i], i);
+            }
+            QVector<qint64> mappedIds;
+            mappedIds.reserve(otherField.strings.size());
+            for (const auto& string : otherField.strings) {
+                auto stringId = stringIds.find(string);
+                if (stringId == stringIds.end()) {
+                    stringId = stringIds.insert(string, field.strings.size());
+                    field.strings.push_back(string);
+                }
+                mappedIds.push_back(*stringId);
+            }
+            for (auto value : otherField.values) {
+                field.values.push_back(mappedIds.value(static_cast<int>(value)));
+            }
+        }
+
+        // fields that only one of the recordings knows
+        for (auto& field : format.fields) {
+            field.values.resize(format.size());
+        }
+    }
+}
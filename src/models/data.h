@@ -11,15 +11,21 @@
 #include <QMetaType>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QTypeInfo>
 #include <QVector>
 
 #include "../util.h"
+#include "spillfile.h"
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <limits>
 #include <tuple>
+#include <utility>
 #include <valarray>
+#include <vector>
 
 namespace Data {
 QString prettifySymbol(const QString& symbol);
@@ -199,6 +205,29 @@ public:
         m_units[type] = unit;
     }
 
+    // differential profiles have a second cost type for every cost type, holding the signed difference to the
+    // costs of the baseline recording
+    void setDiffType(int type, int diffType)
+    {
+        if (m_diffTypes.size() <= type) {
+            m_diffTypes.resize(type + 1);
+            std::fill(m_diffTypes.begin() + type, m_diffTypes.end(), -1);
+        }
+        m_diffTypes[type] = diffType;
+    }
+
+    // the type holding the difference of the given type to the baseline, or -1 when not comparing recordings
+    int diffType(int type) const
+    {
+        return m_diffTypes.value(type, -1);
+    }
+
+    // the type whose difference the given type holds, or -1 when it isn't a difference
+    int diffBaseType(int diffType) const
+    {
+        return diffType < 0 ? -1 : static_cast<int>(m_diffTypes.indexOf(diffType));
+    }
+
     QString typeName(int type) const
     {
         return m_typeNames[type];
@@ -255,17 +284,22 @@ public:
     {
         m_typeNames = rhs.m_typeNames;
         m_units = rhs.m_units;
+        m_diffTypes = rhs.m_diffTypes;
         m_costs.resize(rhs.m_costs.size());
         m_totalCosts = rhs.m_totalCosts;
     }
 
-    QString formatCost(int type, quint64 cost) const
+    QString formatCost(int type, qint64 cost) const
     {
         return formatCost(m_units[type], cost);
     }
 
-    static QString formatCost(Unit unit, quint64 cost)
+    static QString formatCost(Unit unit, qint64 cost)
     {
+        if (cost < 0) {
+            // only the differences of compared recordings are negative
+            return QLatin1Char('-') + formatCost(unit, -cost);
+        }
         switch (unit) {
         case Unit::Time:
             return Util::formatTimeString(cost);
@@ -293,6 +327,7 @@ private:
     QVector<QVector<qint64>> m_costs;
     QVector<qint64> m_totalCosts;
     QVector<Unit> m_units;
+    QVector<qint32> m_diffTypes;
 };
 
 template<typename T>
@@ -365,21 +400,87 @@ struct SymbolTree : Tree<Impl>
     }
 };
 
+// per cost type, the rows of the top-level nodes with the highest cost, sorted by descending cost
+using TopRows = QVector<QVector<int>>;
+
+// select the maxResults children with the highest cost for every cost type through a bounded heap,
+// i.e. without sorting all children. children without any cost of a given type are skipped
+template<typename T>
+TopRows topChildren(const QVector<T>& children, const Costs& costs, int maxResults = 5)
+{
+    using Entry = std::pair<qint64, int>;
+    // orders by descending cost, using the row to get a stable result for equal costs
+    const auto greater = [](const Entry& lhs, const Entry& rhs) {
+        return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+    };
+
+    TopRows ret(costs.numTypes());
+    std::vector<Entry> heap;
+    heap.reserve(maxResults);
+    for (int type = 0, numTypes = costs.numTypes(); type < numTypes; ++type) {
+        heap.clear();
+        for (int row = 0, numRows = children.size(); row < numRows; ++row) {
+            const Entry entry = {costs.cost(type, children[row].id), row};
+            if (entry.first <= 0) {
+                continue;
+            } else if (heap.size() < static_cast<size_t>(maxResults)) {
+                heap.push_back(entry);
+                std::push_heap(heap.begin(), heap.end(), greater);
+            } else if (maxResults > 0 && greater(entry, heap.front())) {
+                // replace the cheapest entry
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                heap.back() = entry;
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), greater);
+
+        auto& rows = ret[type];
+        rows.reserve(heap.size());
+        for (const auto& entry : heap) {
+            rows.push_back(entry.second);
+        }
+    }
+    return ret;
+}
+
 struct BottomUp : SymbolTree<BottomUp>
 {
     quint32 id;
 };
 
+// how the ids of one recording map into a profile that merges several of them
+struct MergeMapping
+{
+    // the merged cost type for every cost type of the recording
+    QVector<qint32> costTypes;
+    // added to location ids, i.e. to the frames of the stacks
+    qint32 locationOffset = 0;
+    // added to process and thread ids, keeps the ids of different recordings apart
+    qint32 pidOffset = 0;
+    // added to CPU ids, keeps the CPUs of different hosts apart
+    quint32 cpuOffset = 0;
+    // appended to the thread names when not empty
+    QString threadSuffix;
+
+    qint32 costType(qint32 type) const
+    {
+        return type < 0 ? type : costTypes.value(type, -1);
+    }
+};
+
 struct BottomUpResults
 {
     BottomUp root;
     Costs costs;
     QVector<Data::Symbol> symbols;
     QVector<Data::FrameLocation> locations;
+    // the hottest symbols, only available once the tree is complete
+    TopRows topRows;
 
     // callback should return true to continue iteration or false otherwise
-    template<typename FrameCallback>
-    void foreachFrame(const QVector<qint32>& frames, FrameCallback frameCallback) const
+    template<typename Frames, typename FrameCallback>
+    void foreachFrame(const Frames& frames, FrameCallback frameCallback) const
     {
         for (auto id : frames) {
             if (!handleFrame(id, frameCallback)) {
@@ -389,8 +490,8 @@ struct BottomUpResults
     }
 
     // callback return type is ignored, all frames will be iterated over
-    template<typename FrameCallback>
-    const BottomUp* addEvent(int type, quint64 cost, const QVector<qint32>& frames, const FrameCallback& frameCallback)
+    template<typename Frames, typename FrameCallback>
+    const BottomUp* addEvent(int type, quint64 cost, const Frames& frames, const FrameCallback& frameCallback)
     {
         costs.addTotalCost(type, cost);
         auto parent = &root;
@@ -405,8 +506,8 @@ struct BottomUpResults
         return parent;
     }
 
-    template<typename FrameCallback>
-    const BottomUp* addEvent(const Symbol& rootSymbol, int type, quint64 cost, const QVector<qint32>& frames,
+    template<typename Frames, typename FrameCallback>
+    const BottomUp* addEvent(const Symbol& rootSymbol, int type, quint64 cost, const Frames& frames,
                              const FrameCallback& frameCallback)
     {
         auto parent = root.entryForSymbol(rootSymbol, &maxBottomUpId);
@@ -425,7 +526,19 @@ struct BottomUpResults
         return parent;
     }
 
+    // adds the locations and the tree of another recording, the cost types must have been added already
+    void merge(const BottomUpResults& other, const MergeMapping& mapping);
+
+    // aligns the trees of two recordings by symbol, the result has the costs of the comparison and additionally a
+    // difference type for every cost type, i.e. the comparison cost minus the baseline cost of the same type name
+    // unless normalizationType is -1, the baseline costs get scaled to the total comparison cost of that type first
+    static BottomUpResults diff(const BottomUpResults& baseline, const BottomUpResults& comparison,
+                                int normalizationType = -1);
+
 private:
+    void mergeChildren(BottomUp* parent, const BottomUp& otherParent, const BottomUpResults& other,
+                       const MergeMapping& mapping);
+
     quint32 maxBottomUpId = 0;
     QHash<quint32, BottomUp*> tidToBottomUp;
 
@@ -481,20 +594,89 @@ struct PerLibraryResults
 {
     PerLibrary root;
     Costs costs;
+    // the hottest libraries
+    TopRows topRows;
 
     static PerLibraryResults fromTopDown(const TopDownResults& topDownData);
 };
 
-struct FrequencyData
+struct TimeRange;
+
+// aggregated frequency values of all samples that fall into a fixed time bucket
+struct FrequencyBucket
 {
-    quint64 time;
-    qreal cost;
+    // start of the bucket
+    quint64 time = 0;
+    float min = 0;
+    float max = 0;
+    float mean = 0;
+    quint32 count = 0;
+
+    void add(qreal cost)
+    {
+        const auto value = static_cast<float>(cost);
+        if (!count) {
+            min = value;
+            max = value;
+        } else {
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        ++count;
+        mean += (value - mean) / count;
+    }
+
+    void merge(const FrequencyBucket& rhs)
+    {
+        if (!rhs.count) {
+            return;
+        } else if (!count) {
+            min = rhs.min;
+            max = rhs.max;
+            mean = rhs.mean;
+            count = rhs.count;
+            return;
+        }
+        min = std::min(min, rhs.min);
+        max = std::max(max, rhs.max);
+        const auto newCount = count + rhs.count;
+        mean = (mean * count + rhs.mean * rhs.count) / newCount;
+        count = newCount;
+    }
 };
 
 struct PerCostFrequencyData
 {
+    // width of the buckets in level 0, in ns
+    static const constexpr quint64 BASE_BUCKET_WIDTH = 1000000;
+    // number of buckets of one level that get merged into a single bucket of the next level
+    static const constexpr quint64 LEVEL_FACTOR = 8;
+    // coarser levels are added until a level has at most this many buckets
+    static const constexpr int MAX_BUCKETS_PER_LEVEL = 1024;
+
     QString costName;
-    QVector<FrequencyData> values;
+    // sparse, time-sorted buckets per resolution level, level 0 is the finest
+    QVector<QVector<FrequencyBucket>> levels;
+
+    static quint64 bucketWidth(int level)
+    {
+        quint64 width = BASE_BUCKET_WIDTH;
+        for (int i = 0; i < level; ++i) {
+            width *= LEVEL_FACTOR;
+        }
+        return width;
+    }
+
+    // add a value to the finest level, the values are expected to arrive mostly in time order
+    void addValue(quint64 time, qreal cost);
+    // build the coarser levels from level 0, call this once all values got added
+    void buildLevels();
+    // only keep buckets that overlap with the given time range
+    void filterByTime(const TimeRange& time);
+    // merge the buckets of another recording and rebuild the coarser levels
+    void merge(const PerCostFrequencyData& other);
+    // the finest level that shows the given time range with no more than maxBuckets buckets
+    int levelForRange(quint64 rangeDelta, int maxBuckets) const;
 };
 
 struct PerCoreFrequencyData
@@ -589,6 +771,9 @@ struct CallerCalleeResults
     Costs selfCosts;
     Costs inclusiveCosts;
 
+    // the cost types must have been added already
+    void merge(const CallerCalleeResults& other, const MergeMapping& mapping);
+
     CallerCalleeEntry& entry(const Symbol& symbol)
     {
         auto it = entries.find(symbol);
@@ -621,7 +806,243 @@ struct Event
     }
 };
 
-using Events = QVector<Event>;
+/**
+ * The events of a thread or CPU, sorted by time.
+ *
+ * When the import exceeds its memory budget, the events get moved into a SpillFile and are
+ * mapped back from there. Events appended afterwards stay in memory until the next spill.
+ *
+ * mid returns a window that shares the events, they only get copied once the window gets modified.
+ */
+class Events
+{
+public:
+    using value_type = Event;
+    using const_iterator = const Event*;
+    using iterator = const_iterator;
+
+    Events() = default;
+    Events(std::initializer_list<Event> events)
+        : m_memory(events)
+    {
+    }
+
+    int size() const
+    {
+        return m_windowSize == -1 ? storageSize() : m_windowSize;
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    const Event& at(int i) const
+    {
+        Q_ASSERT(i >= 0 && i < size());
+        i += m_windowStart;
+        return i < m_numSpilled ? spilledData()[i] : m_memory.at(i - m_numSpilled);
+    }
+
+    const Event& operator[](int i) const
+    {
+        return at(i);
+    }
+
+    const Event& first() const
+    {
+        return at(0);
+    }
+
+    const Event& last() const
+    {
+        return at(size() - 1);
+    }
+
+    // pointer-based iteration requires all events to be either spilled or in memory, see makeContiguous
+    bool isContiguous() const
+    {
+        return !m_numSpilled || m_memory.isEmpty();
+    }
+
+    const Event* constData() const
+    {
+        Q_ASSERT(isContiguous());
+        return (m_numSpilled ? spilledData() : m_memory.constData()) + m_windowStart;
+    }
+
+    const_iterator constBegin() const
+    {
+        return constData();
+    }
+
+    const_iterator constEnd() const
+    {
+        return constData() + size();
+    }
+
+    const_iterator begin() const
+    {
+        return constBegin();
+    }
+
+    const_iterator end() const
+    {
+        return constEnd();
+    }
+
+    const_iterator cbegin() const
+    {
+        return constBegin();
+    }
+
+    const_iterator cend() const
+    {
+        return constEnd();
+    }
+
+    void push_back(const Event& event)
+    {
+        detach();
+        m_memory.push_back(event);
+    }
+
+    void append(const Event& event)
+    {
+        detach();
+        m_memory.append(event);
+    }
+
+    Events& operator<<(const Event& event)
+    {
+        detach();
+        m_memory.append(event);
+        return *this;
+    }
+
+    void reserve(int numEvents)
+    {
+        detach();
+        m_memory.reserve(numEvents - m_numSpilled);
+    }
+
+    void clear();
+
+    // the count events starting at first, without copying them
+    Events mid(int first, int count) const
+    {
+        Q_ASSERT(first >= 0 && count >= 0 && first + count <= size());
+        Events ret = *this;
+        ret.m_windowStart = m_windowStart + first;
+        ret.m_windowSize = count;
+        return ret;
+    }
+
+    template<typename Predicate>
+    void removeIf(Predicate predicate)
+    {
+        detach();
+        if (!m_numSpilled) {
+            auto it = std::remove_if(m_memory.begin(), m_memory.end(), predicate);
+            m_memory.erase(it, m_memory.end());
+            return;
+        }
+
+        // the spilled events are read-only, copy the remaining ones back into memory
+        QVector<Event> remaining;
+        for (int i = 0, c = size(); i < c; ++i) {
+            const auto& event = at(i);
+            if (!predicate(event)) {
+                remaining.push_back(event);
+            }
+        }
+        clear();
+        m_memory = std::move(remaining);
+    }
+
+    // writes all events into a new block of the spill file and frees the in-memory ones
+    // returns false and keeps the events in memory when that fails
+    bool spill(SpillFile* file);
+
+    // replaces the events with the numEvents ones returned by next, which get written into the spill file
+    // without ever holding all of them in memory. returns false and keeps the events when that fails
+    template<typename Next>
+    bool assignSpilled(SpillFile* file, int numEvents, Next next)
+    {
+        const auto eventSize = static_cast<qint64>(sizeof(Event));
+        auto block = file->append(numEvents * eventSize, [&next, eventSize](char* buffer, qint64 maxSize) {
+            const auto numBuffered = maxSize / eventSize;
+            for (qint64 i = 0; i < numBuffered; ++i) {
+                const Event event = next();
+                std::memcpy(buffer + i * eventSize, &event, sizeof(Event));
+            }
+            return numBuffered * eventSize;
+        });
+        if (!block) {
+            return false;
+        }
+
+        m_block = std::move(block);
+        m_numSpilled = numEvents;
+        m_memory = QVector<Event>();
+        m_windowStart = 0;
+        m_windowSize = -1;
+        return true;
+    }
+
+    // spills the events again or copies them back into memory when that fails
+    void makeContiguous(SpillFile* file);
+
+    // these count all events of the storage that a window shares
+    int numSpilled() const
+    {
+        return m_numSpilled;
+    }
+
+    int numInMemory() const
+    {
+        return m_memory.size();
+    }
+
+    qint64 memoryUsage() const
+    {
+        return static_cast<qint64>(m_memory.capacity()) * sizeof(Event);
+    }
+
+    bool operator==(const Events& rhs) const;
+
+    bool operator!=(const Events& rhs) const
+    {
+        return !operator==(rhs);
+    }
+
+private:
+    const Event* spilledData() const
+    {
+        return reinterpret_cast<const Event*>(m_block->data());
+    }
+
+    int storageSize() const
+    {
+        return m_numSpilled + m_memory.size();
+    }
+
+    void detach()
+    {
+        if (m_windowSize != -1) {
+            detachWindow();
+        }
+    }
+    // copies the events of a window into their own storage
+    void detachWindow();
+
+    SpilledBlockPtr m_block;
+    int m_numSpilled = 0;
+    QVector<Event> m_memory;
+    // the part of the storage that a window returned by mid covers, the size is -1 when not a window
+    int m_windowStart = 0;
+    int m_windowSize = -1;
+};
 
 struct TimeRange
 {
@@ -676,6 +1097,30 @@ struct TimeRange
 const constexpr auto MAX_TIME = std::numeric_limits<quint64>::max();
 const constexpr auto MAX_TIME_RANGE = TimeRange {0, MAX_TIME};
 
+// an off-CPU interval of a thread and the thread that woke it up, see sched:sched_wakeup
+// the waker ids are invalid when no wakeup got recorded for the interval
+struct Wakeup
+{
+    // from the switch out to the switch in of the woken thread
+    TimeRange offCpu;
+    // of the wakeup, the woken thread waits for a CPU afterwards
+    quint64 time = 0;
+    // where the woken thread was blocked
+    qint32 stackId = -1;
+    qint32 wakerPid = INVALID_PID;
+    qint32 wakerTid = INVALID_TID;
+    // what the waker did, e.g. unlocking a mutex or completing an I/O request
+    qint32 wakerStackId = -1;
+    quint32 wakerCpuId = INVALID_CPU_ID;
+
+    bool operator==(const Wakeup& rhs) const
+    {
+        return std::tie(offCpu, time, stackId, wakerPid, wakerTid, wakerStackId, wakerCpuId)
+            == std::tie(rhs.offCpu, rhs.time, rhs.stackId, rhs.wakerPid, rhs.wakerTid, rhs.wakerStackId,
+                        rhs.wakerCpuId);
+    }
+};
+
 struct ThreadEvents
 {
     qint32 pid = INVALID_PID;
@@ -692,19 +1137,44 @@ struct ThreadEvents
         OffCpu
     };
     State state = Unknown;
+    // one per off-CPU interval, sorted by its end
+    QVector<Wakeup> wakeups;
 
     bool operator==(const ThreadEvents& rhs) const
     {
-        return std::tie(pid, tid, time, events, name, lastSwitchTime, offCpuTime, state)
+        return std::tie(pid, tid, time, events, name, lastSwitchTime, offCpuTime, state, wakeups)
             == std::tie(rhs.pid, rhs.tid, rhs.time, rhs.events, rhs.name, rhs.lastSwitchTime, rhs.offCpuTime,
-                        rhs.state);
+                        rhs.state, rhs.wakeups);
     }
 };
 
+// a piece of the chain of threads that bounded how long a thread took to get somewhere
+struct CriticalPathSegment
+{
+    enum class State
+    {
+        Running,
+        // woken up, but still waiting for a CPU
+        Runnable,
+        // off-CPU without a known waker, e.g. woken from an interrupt or idle
+        Blocked,
+    };
+
+    qint32 pid = INVALID_PID;
+    qint32 tid = INVALID_TID;
+    TimeRange time;
+    State state = State::Running;
+    // where the thread was blocked, only set when it is not running
+    qint32 stackId = -1;
+    qint32 wakerPid = INVALID_PID;
+    qint32 wakerTid = INVALID_TID;
+    qint32 wakerStackId = -1;
+};
+
 struct CpuEvents
 {
     quint32 cpuId = INVALID_CPU_ID;
-    QVector<Event> events;
+    Events events;
 
     bool operator==(const CpuEvents& rhs) const
     {
@@ -766,11 +1236,134 @@ struct Summary
     QStringList errors;
 };
 
+// read-only view on the frames of a stack, which may point into a SpillFile
+class StackFrames
+{
+public:
+    StackFrames() = default;
+    StackFrames(const qint32* begin, const qint32* end)
+        : m_begin(begin)
+        , m_end(end)
+    {
+    }
+
+    const qint32* begin() const
+    {
+        return m_begin;
+    }
+
+    const qint32* end() const
+    {
+        return m_end;
+    }
+
+    int size() const
+    {
+        return static_cast<int>(m_end - m_begin);
+    }
+
+    bool isEmpty() const
+    {
+        return m_begin == m_end;
+    }
+
+    qint32 operator[](int i) const
+    {
+        Q_ASSERT(i >= 0 && i < size());
+        return m_begin[i];
+    }
+
+    qint32 at(int i) const
+    {
+        return operator[](i);
+    }
+
+    bool operator==(const StackFrames& rhs) const
+    {
+        return std::equal(m_begin, m_end, rhs.m_begin, rhs.m_end);
+    }
+
+    bool operator==(const QVector<qint32>& rhs) const
+    {
+        return std::equal(m_begin, m_end, rhs.constBegin(), rhs.constEnd());
+    }
+
+private:
+    const qint32* m_begin = nullptr;
+    const qint32* m_end = nullptr;
+};
+
+/**
+ * The unique stacks of a profile, indexed by stack id.
+ *
+ * The frames of all stacks are stored back to back. Spilling moves the frames that are in memory
+ * into a new block of the SpillFile, only the offsets stay in memory.
+ */
+class Stacks
+{
+public:
+    Stacks() = default;
+    Stacks(std::initializer_list<QVector<qint32>> stacks)
+    {
+        for (const auto& frames : stacks) {
+            push_back(frames);
+        }
+    }
+
+    int size() const
+    {
+        return m_offsets.size() - 1;
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    StackFrames at(int stackId) const;
+
+    StackFrames operator[](int stackId) const
+    {
+        return at(stackId);
+    }
+
+    void push_back(const QVector<qint32>& frames)
+    {
+        m_frames.append(frames);
+        m_offsets.push_back(m_offsets.constLast() + frames.size());
+    }
+
+    // returns false and keeps the frames in memory when writing fails
+    bool spill(SpillFile* file);
+
+    qint64 memoryUsage() const
+    {
+        return static_cast<qint64>(m_frames.capacity()) * sizeof(qint32)
+            + static_cast<qint64>(m_offsets.capacity()) * sizeof(quint64);
+    }
+
+    bool operator==(const Stacks& rhs) const;
+
+private:
+    struct SpilledFrames
+    {
+        quint64 firstFrame;
+        SpilledBlockPtr block;
+    };
+
+    // the offset of the first frame of each stack, plus the end of the last one
+    QVector<quint64> m_offsets = {0};
+    QVector<SpilledFrames> m_spilled;
+    // the offset of the first frame in m_frames
+    quint64 m_memoryStart = 0;
+    QVector<qint32> m_frames;
+};
+
 struct EventResults
 {
     QVector<ThreadEvents> threads;
     QVector<CpuEvents> cpus;
-    QVector<QVector<qint32>> stacks;
+    Stacks stacks;
     QVector<CostSummary> totalCosts;
     qint32 offCpuTimeCostId = -1;
     qint32 lostEventCostId = -1;
@@ -778,6 +1371,21 @@ struct EventResults
     ThreadEvents* findThread(qint32 pid, qint32 tid);
     const ThreadEvents* findThread(qint32 pid, qint32 tid) const;
 
+    // bytes taken by the events and stacks that are held in memory
+    qint64 memoryUsage() const;
+    // moves events and stacks into the spill file until at most half of the budget remains in memory
+    void spill(SpillFile* file, qint64 budget);
+    // required before iterating the events of spilled threads and CPUs that got appended to
+    void makeContiguous(SpillFile* file);
+
+    // threads that end up with the same ids get their events merged
+    // with a spill file, the merged events that exceed the budget get written to it right away
+    void merge(const EventResults& other, const MergeMapping& mapping, SpillFile* file = nullptr, qint64 budget = 0);
+
+    // follows the wakeups backwards from the end of time, ordered by time
+    // whenever the thread was woken up by another thread, the path continues with the waker
+    QVector<CriticalPathSegment> criticalPath(qint32 pid, qint32 tid, const TimeRange& time) const;
+
     bool operator==(const EventResults& rhs) const
     {
         return std::tie(threads, cpus, stacks, totalCosts, offCpuTimeCostId)
@@ -791,9 +1399,152 @@ struct Tracepoint
     QString name;
 };
 
+// one decoded field of a tracepoint, with a value for every sample of it
+struct TracepointField
+{
+    QString name;
+    // numbers are stored as is, strings as index into strings
+    QVector<qint64> values;
+    QVector<QString> strings;
+    bool isString = false;
+
+    QString displayValue(int sample) const
+    {
+        const auto value = values.value(sample);
+        return isString ? strings.value(static_cast<int>(value)) : QString::number(value);
+    }
+
+    bool operator==(const TracepointField& rhs) const
+    {
+        return std::tie(name, values, strings, isString)
+            == std::tie(rhs.name, rhs.values, rhs.strings, rhs.isString);
+    }
+};
+
+// the decoded samples of one tracepoint, e.g. block:block_rq_issue, stored column-wise
+struct TracepointFormat
+{
+    QString name;
+    QVector<quint64> times;
+    QVector<qint32> tids;
+    QVector<quint32> cpuIds;
+    QVector<TracepointField> fields;
+
+    int size() const
+    {
+        return times.size();
+    }
+
+    const TracepointField* field(const QString& fieldName) const;
+
+    // keeps only the samples for which keep(sample) returns true
+    template<typename Predicate>
+    void filter(Predicate keep)
+    {
+        int numKept = 0;
+        for (int i = 0, c = size(); i < c; ++i) {
+            if (!keep(i)) {
+                continue;
+            }
+            times[numKept] = times[i];
+            tids[numKept] = tids[i];
+            cpuIds[numKept] = cpuIds[i];
+            for (auto& field : fields) {
+                field.values[numKept] = field.values[i];
+            }
+            ++numKept;
+        }
+        times.resize(numKept);
+        tids.resize(numKept);
+        cpuIds.resize(numKept);
+        for (auto& field : fields) {
+            field.values.resize(numKept);
+        }
+    }
+
+    bool operator==(const TracepointFormat& rhs) const
+    {
+        return std::tie(name, times, tids, cpuIds, fields)
+            == std::tie(rhs.name, rhs.times, rhs.tids, rhs.cpuIds, rhs.fields);
+    }
+};
+
+// restricts the samples of a tracepoint to those where the given field has the given value
+struct TracepointFieldFilter
+{
+    QString field;
+    QString value;
+
+    bool isValid() const
+    {
+        return !field.isEmpty();
+    }
+};
+
+// two tracepoints that mark the begin and end of something, e.g. a block I/O request or a syscall
+struct TracepointPair
+{
+    enum class Scope
+    {
+        Global,
+        Thread,
+        Cpu,
+    };
+
+    QString begin;
+    QString end;
+    // the fields that have to match between begin and end, in addition to the scope
+    QStringList keys;
+    Scope scope = Scope::Global;
+
+    bool operator==(const TracepointPair& rhs) const
+    {
+        return std::tie(begin, end, keys, scope) == std::tie(rhs.begin, rhs.end, rhs.keys, rhs.scope);
+    }
+};
+
+struct Latency
+{
+    // of the begin event
+    quint64 time = 0;
+    quint64 duration = 0;
+    qint32 tid = INVALID_TID;
+    quint32 cpuId = INVALID_CPU_ID;
+};
+
+struct LatencyHistogram
+{
+    // bucket i counts the latencies below 2^i ns that did not fit into the previous bucket
+    static const constexpr int NUM_BUCKETS = 64;
+
+    TracepointPair pair;
+    // sorted by time
+    QVector<Latency> latencies;
+    QVector<quint64> buckets;
+    quint64 minimum = 0;
+    quint64 median = 0;
+    quint64 p99 = 0;
+    quint64 maximum = 0;
+    quint64 total = 0;
+
+    static int bucketForDuration(quint64 duration);
+};
+
 struct TracepointResults
 {
     QVector<Tracepoint> tracepoints;
+    QVector<TracepointFormat> formats;
+
+    const TracepointFormat* format(const QString& name) const;
+
+    // the known begin/end pairs for which both tracepoints got recorded
+    QVector<TracepointPair> latencyPairs() const;
+    // matches the begin samples that pass the filter with their end samples, end samples that have the
+    // filtered field must pass it too
+    LatencyHistogram latencies(const TracepointPair& pair, const TracepointFieldFilter& filter = {}) const;
+
+    void filterByTime(const TimeRange& time);
+    void merge(const TracepointResults& other, const MergeMapping& mapping);
 };
 
 struct FilterAction
@@ -818,6 +1569,173 @@ struct FilterAction
     }
 };
 
+// inverted index from symbols and binaries to the ids of the stacks they occur in
+// this turns symbol and binary filters into intersections and differences of sorted lists
+struct SymbolStackIndex
+{
+    QHash<Data::Symbol, qint32> symbolIds;
+    QHash<QString, qint32> binaryIds;
+    // sorted stack ids per symbol id
+    QVector<QVector<qint32>> symbolStacks;
+    // sorted stack ids per binary id
+    QVector<QVector<qint32>> binaryStacks;
+    qint32 numStacks = 0;
+
+    bool isEmpty() const
+    {
+        return numStacks == 0;
+    }
+
+    static SymbolStackIndex fromStacks(const BottomUpResults& bottomUpData, const Stacks& stacks);
+
+    // returns a bitmap indexed by stack id, true for all stacks that pass the symbol and binary filters
+    QVector<bool> filterStacks(const FilterAction& filter) const;
+};
+
+// prefix sums of the event costs in time order, snapshotted at regular intervals
+// the costs of a time range are the difference of two prefix sums plus the few events next to the two checkpoints,
+// so selecting a time range doesn't have to replay every event within it
+struct CostCheckpoints
+{
+    // the costs of all events with the same stack, cost type and aggregation group get summed up in one slot
+    struct Slot
+    {
+        qint32 stackId = -1;
+        qint32 type = -1;
+        // the first thread and CPU with an event of this slot, used to aggregate the slot cost
+        qint32 threadIndex = -1;
+        quint32 cpuId = INVALID_CPU_ID;
+    };
+
+    struct Sample
+    {
+        quint64 time = 0;
+        quint64 cost = 0;
+        qint32 slot = -1;
+    };
+
+    // the number of samples between two checkpoints
+    static const constexpr int CHECKPOINT_INTERVAL = 4096;
+
+    QVector<Slot> slots;
+    // all events with a stack, sorted by time
+    QVector<Sample> samples;
+    int interval = CHECKPOINT_INTERVAL;
+    // the delta encoded checkpoints, i.e. the slots that changed and by how much. like the nodes of a fenwick tree,
+    // checkpoint i covers the samples since checkpoint i - (i & -i), so the prefix sums of any checkpoint are the sum
+    // of at most log2(number of checkpoints) deltas
+    // checkpoint i owns the range deltaOffsets[i - 1] to deltaOffsets[i] of deltaSlots and deltaCosts
+    QVector<qint32> deltaOffsets;
+    QVector<qint32> deltaSlots;
+    QVector<quint64> deltaCosts;
+
+    bool isEmpty() const
+    {
+        return samples.isEmpty();
+    }
+
+    // groupOf returns the aggregation group of an event, e.g. the CPU when aggregating by CPU
+    using GroupOf = std::function<qint64(const ThreadEvents& thread, const Event& event)>;
+    static CostCheckpoints fromEvents(const EventResults& events, const GroupOf& groupOf,
+                                      int interval = CHECKPOINT_INTERVAL);
+
+    // returns the summed up cost of every slot for the events within time
+    QVector<quint64> costs(const TimeRange& time) const;
+
+private:
+    // adds the costs of all samples before the given sample index
+    void addPrefix(QVector<quint64>* costs, int sampleIndex, bool subtract) const;
+};
+
+// the stacks of a single thread over time, consecutive samples that share the outer frames of their stacks get merged
+// into one span per shared frame. coarser levels merge spans of the same symbol across small gaps and collapse runs
+// of short spans, so that the level matching the zoom only holds a bounded number of spans per pixel
+struct FlameChart
+{
+    struct Span
+    {
+        TimeRange time;
+        // index into symbols, or -1 for a run of spans that are too short to be shown on their own at this level
+        qint32 symbol = -1;
+        // index of the enclosing span at the previous depth of the same level, -1 at depth 0
+        qint32 parent = -1;
+        quint32 samples = 0;
+    };
+
+    // the minimum span duration grows by this factor from one level to the next
+    static const constexpr quint64 LEVEL_FACTOR = 4;
+    // coarser levels are added until the time of the thread fits into this many spans of the minimum duration
+    static const constexpr quint64 MIN_SPANS_PER_LEVEL = 256;
+
+    QVector<Symbol> symbols;
+    // the typical time between two samples, samples further apart than twice this are not merged
+    quint64 sampleInterval = 0;
+    TimeRange time;
+    // levels[level][depth] holds the time-sorted spans at that stack depth, depth 0 is the outermost caller
+    // level 0 has the exact spans of the samples
+    QVector<QVector<QVector<Span>>> levels;
+
+    bool isEmpty() const
+    {
+        return levels.isEmpty();
+    }
+
+    int depth() const
+    {
+        return levels.isEmpty() ? 0 : levels.constFirst().size();
+    }
+
+    // spans shorter than this get collapsed in the given level
+    quint64 minDuration(int level) const;
+
+    static FlameChart fromEvents(const ThreadEvents& thread, const Stacks& stacks,
+                                 const BottomUpResults& bottomUpData, qint32 costType);
+
+    // the coarsest level that merges nothing wider than timePerPixel, i.e. nothing that would be visible
+    int levelForResolution(quint64 timePerPixel) const;
+
+    // the spans of the given level and depth that overlap with time
+    std::pair<const Span*, const Span*> spans(int level, int depth, const TimeRange& time) const;
+};
+
+// the samples of every CPU binned into equally long time buckets, to spot idle or overloaded CPUs at a glance
+// the buckets get computed for the visible time only, so their duration follows the zoom
+struct CpuHeatmap
+{
+    enum class Value
+    {
+        // the number of samples, i.e. how often the CPU was busy
+        Samples,
+        // the summed up cost of the samples
+        Cost
+    };
+
+    TimeRange time;
+    int numBuckets = 0;
+    // one row per CPU that got any events
+    QVector<quint32> cpuIds;
+    // numBuckets cells per row
+    QVector<quint64> cells;
+    quint64 maxCell = 0;
+
+    bool isEmpty() const
+    {
+        return cpuIds.isEmpty() || numBuckets == 0;
+    }
+
+    quint64 cell(int row, int bucket) const
+    {
+        return cells[row * numBuckets + bucket];
+    }
+
+    TimeRange bucketTime(int bucket) const;
+    // -1 when time lies outside of the heatmap
+    int bucketAt(quint64 time) const;
+
+    static CpuHeatmap fromEvents(const QVector<CpuEvents>& cpus, qint32 costType, Value value, const TimeRange& time,
+                                 int numBuckets);
+};
+
 struct ZoomAction
 {
     TimeRange time;
@@ -868,8 +1786,11 @@ Q_DECLARE_TYPEINFO(Data::CallerCalleeResults, Q_MOVABLE_TYPE);
 Q_DECLARE_METATYPE(Data::Event)
 Q_DECLARE_TYPEINFO(Data::Event, Q_MOVABLE_TYPE);
 
-Q_DECLARE_METATYPE(Data::FrequencyData)
-Q_DECLARE_TYPEINFO(Data::FrequencyData, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(Data::Events)
+Q_DECLARE_TYPEINFO(Data::Events, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::FrequencyBucket)
+Q_DECLARE_TYPEINFO(Data::FrequencyBucket, Q_MOVABLE_TYPE);
 
 Q_DECLARE_METATYPE(Data::PerCostFrequencyData)
 Q_DECLARE_TYPEINFO(Data::PerCostFrequencyData, Q_MOVABLE_TYPE);
@@ -901,8 +1822,29 @@ Q_DECLARE_TYPEINFO(Data::Tracepoint, Q_MOVABLE_TYPE);
 Q_DECLARE_METATYPE(Data::TracepointResults)
 Q_DECLARE_TYPEINFO(Data::TracepointResults, Q_MOVABLE_TYPE);
 
+Q_DECLARE_TYPEINFO(Data::Wakeup, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::CriticalPathSegment, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::TracepointField, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::TracepointFormat, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::TracepointPair, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::Latency, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::LatencyHistogram)
+Q_DECLARE_TYPEINFO(Data::LatencyHistogram, Q_MOVABLE_TYPE);
+
 Q_DECLARE_METATYPE(Data::TimeRange)
 Q_DECLARE_TYPEINFO(Data::TimeRange, Q_MOVABLE_TYPE);
 
 Q_DECLARE_TYPEINFO(Data::FilterAction, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::SymbolStackIndex, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::CostCheckpoints::Slot, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::CostCheckpoints::Sample, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::CostCheckpoints, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::FlameChart::Span, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::FlameChart, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::CpuHeatmap, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(Data::ZoomAction, Q_MOVABLE_TYPE);
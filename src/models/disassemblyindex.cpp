@@ -0,0 +1,272 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "disassemblyindex.h"
+
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const char MAGIC[8] = {'H', 'S', 'D', 'I', 'S', 'A', 'S', 'M'};
+const quint32 VERSION = 1;
+}
+
+// the file starts with the header, followed by the text of all lines, the lines and the instruction table
+struct DisassemblyIndex::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 numLines;
+    quint64 numInstructions;
+    quint64 textOffset;
+    quint64 textSize;
+    quint64 linesOffset;
+    quint64 instructionsOffset;
+};
+
+struct DisassemblyIndex::Line
+{
+    // zero for lines without an instruction, e.g. source code
+    quint64 addr;
+    quint64 textOffset;
+    quint32 textSize;
+    quint32 padding;
+};
+
+DisassemblyIndex::DisassemblyIndex() = default;
+DisassemblyIndex::~DisassemblyIndex() = default;
+
+bool DisassemblyIndex::isValid() const
+{
+    return m_data != nullptr;
+}
+
+int DisassemblyIndex::numLines() const
+{
+    return m_data ? header()->numLines : 0;
+}
+
+const DisassemblyIndex::Header* DisassemblyIndex::header() const
+{
+    return reinterpret_cast<const Header*>(m_data);
+}
+
+const DisassemblyIndex::Line* DisassemblyIndex::lines() const
+{
+    return reinterpret_cast<const Line*>(m_data + header()->linesOffset);
+}
+
+// indices into lines(), sorted by address
+const quint32* DisassemblyIndex::instructions() const
+{
+    return reinterpret_cast<const quint32*>(m_data + header()->instructionsOffset);
+}
+
+QString DisassemblyIndex::indexPath(const QString& objdump, const QString& actualPath)
+{
+    // the modification time stands in for a build id
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(objdump.toUtf8());
+    hash.addData(actualPath.toUtf8());
+    hash.addData(QByteArray::number(QFileInfo(actualPath).lastModified().toMSecsSinceEpoch()));
+
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/disassembly/")
+        + QString::fromLatin1(hash.result().toHex()) + QLatin1String(".index");
+}
+
+void DisassemblyIndex::evictCache(const QString& directory, qint64 maxSize, qint64 maxAge)
+{
+    // sorted by modification time, the most recently used first
+    const auto indices =
+        QDir(directory).entryInfoList({QStringLiteral("*.index")}, QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    const auto oldest = QDateTime::currentDateTime().addSecs(-maxAge);
+    qint64 size = 0;
+    for (const auto& index : indices) {
+        size += index.size();
+        // the indices that are still in use stay mapped until they get closed
+        if (size > maxSize || index.lastModified() < oldest) {
+            QFile::remove(index.absoluteFilePath());
+        }
+    }
+}
+
+DisassemblyIndex DisassemblyIndex::build(const QString& objdump, const QString& actualPath, const QString& indexPath,
+                                         QString* errorMessage)
+{
+    if (QStandardPaths::findExecutable(objdump).isEmpty()) {
+        *errorMessage = QApplication::tr("Cannot find objdump process %1").arg(objdump);
+        return {};
+    }
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *errorMessage = file.errorString();
+        return {};
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.textOffset = sizeof(Header);
+    // gets overwritten once we know all offsets
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // the text goes straight to disk, only the compact line table is kept in memory
+    QVector<Line> lines;
+    QVector<quint32> instructions;
+    auto addLine = [&](QByteArray line) {
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        quint64 addr = 0;
+        if (!DisassemblyOutput::parseLine(line, &addr)) {
+            return;
+        }
+        if (addr) {
+            instructions.append(lines.size());
+        }
+        lines.append({addr, header.textSize, static_cast<quint32>(line.size()), 0});
+        file.write(line);
+        header.textSize += line.size();
+    };
+
+    QProcess process;
+    QByteArray pending;
+    auto readOutput = [&]() {
+        pending += process.readAllStandardOutput();
+        int start = 0;
+        for (int end = pending.indexOf('\n'); end != -1; end = pending.indexOf('\n', start)) {
+            addLine(pending.mid(start, end - start));
+            start = end + 1;
+        }
+        pending.remove(0, start);
+    };
+
+    process.start(objdump, {QStringLiteral("-d"), QStringLiteral("-S"), QStringLiteral("-C"), actualPath});
+    if (!process.waitForStarted()) {
+        *errorMessage = QApplication::tr("Process was not started.");
+        return {};
+    }
+    while (process.waitForReadyRead(-1)) {
+        readOutput();
+    }
+    process.waitForFinished(-1);
+    readOutput();
+    if (!pending.isEmpty()) {
+        addLine(pending);
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0 || instructions.isEmpty()) {
+        *errorMessage = QApplication::tr("Failed to disassemble %1: %2")
+                            .arg(actualPath, QString::fromLocal8Bit(process.readAllStandardError()));
+        return {};
+    }
+
+    // sections are usually sorted already, in which case this is cheap
+    std::stable_sort(instructions.begin(), instructions.end(),
+                     [&lines](quint32 lhs, quint32 rhs) { return lines[lhs].addr < lines[rhs].addr; });
+
+    // keep the tables aligned for the memory mapped access
+    while (file.pos() % alignof(Line)) {
+        file.putChar(0);
+    }
+    header.numLines = lines.size();
+    header.linesOffset = file.pos();
+    file.write(reinterpret_cast<const char*>(lines.constData()), lines.size() * sizeof(Line));
+    header.numInstructions = instructions.size();
+    header.instructionsOffset = file.pos();
+    file.write(reinterpret_cast<const char*>(instructions.constData()), instructions.size() * sizeof(quint32));
+
+    file.seek(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file.commit()) {
+        *errorMessage = file.errorString();
+        return {};
+    }
+
+    return load(indexPath);
+}
+
+DisassemblyIndex DisassemblyIndex::load(const QString& indexPath)
+{
+    auto file = QSharedPointer<QFile>::create(indexPath);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(Header))) {
+        return {};
+    }
+
+    const auto size = static_cast<quint64>(file->size());
+    const auto* data = file->map(0, file->size());
+    if (!data) {
+        return {};
+    }
+
+    const auto* header = reinterpret_cast<const Header*>(data);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) || header->version != VERSION
+        || header->textOffset + header->textSize > size
+        || header->linesOffset + header->numLines * sizeof(Line) > size
+        || header->instructionsOffset + header->numInstructions * sizeof(quint32) > size) {
+        return {};
+    }
+
+    // mark the index as used, see evictCache
+    file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    DisassemblyIndex index;
+    index.m_file = file;
+    index.m_data = data;
+    return index;
+}
+
+DisassemblyOutput DisassemblyIndex::disassemble(const Data::Symbol& symbol) const
+{
+    DisassemblyOutput disassemblyOutput;
+    disassemblyOutput.symbol = symbol;
+    if (!m_data) {
+        disassemblyOutput.errorMessage = QApplication::tr("No disassembly index available for %1").arg(symbol.binary);
+        return disassemblyOutput;
+    }
+
+    const auto* lines = this->lines();
+    const auto* instructionsBegin = instructions();
+    const auto* instructionsEnd = instructionsBegin + header()->numInstructions;
+    auto byAddress = [lines](quint32 line, quint64 addr) { return lines[line].addr < addr; };
+    const auto first = std::lower_bound(instructionsBegin, instructionsEnd, symbol.relAddr, byAddress);
+    const auto last = std::lower_bound(first, instructionsEnd, symbol.relAddr + symbol.size, byAddress);
+    if (first == last) {
+        disassemblyOutput.errorMessage =
+            QApplication::tr("No instructions found for %1 in %2").arg(symbol.symbol, symbol.actualPath);
+        return disassemblyOutput;
+    }
+
+    // objdump shows the source code in front of the instructions it belongs to, so include it
+    auto begin = *first;
+    while (begin > 0 && !lines[begin - 1].addr) {
+        --begin;
+    }
+    const auto end = *(last - 1) + 1;
+
+    const auto* text = reinterpret_cast<const char*>(m_data + header()->textOffset);
+    disassemblyOutput.disassemblyLines.reserve(end - begin);
+    for (auto i = begin; i < end; ++i) {
+        const auto& line = lines[i];
+        const auto disassembly = QString::fromUtf8(text + line.textOffset, line.textSize);
+        disassemblyOutput.disassemblyLines.push_back(
+            {line.addr, disassembly, DisassemblyOutput::extractLinkedFunction(disassembly)});
+    }
+    return disassemblyOutput;
+}
@@ -0,0 +1,61 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QSharedPointer>
+#include <QString>
+
+#include "disassemblyoutput.h"
+
+class QFile;
+
+/**
+ * The disassembly of a whole binary, produced by a single objdump pass.
+ *
+ * The index is stored in a compact file that gets memory mapped. The disassembly
+ * of any symbol in the binary can then be sliced out of it by address, without
+ * running objdump again.
+ */
+class DisassemblyIndex
+{
+public:
+    DisassemblyIndex();
+    ~DisassemblyIndex();
+
+    bool isValid() const;
+    int numLines() const;
+
+    // the location of the cached index for the given binary
+    static QString indexPath(const QString& objdump, const QString& actualPath);
+
+    // loading an index marks it as used, so the least recently used indices get evicted first
+    static const constexpr qint64 MAX_CACHE_SIZE = 1024LL * 1024 * 1024;
+    static const constexpr qint64 MAX_CACHE_AGE = 30LL * 24 * 60 * 60; // in seconds
+    // removes the indices not used within maxAge seconds, then the least recently used ones
+    // until at most maxSize bytes remain, thread safe
+    static void evictCache(const QString& directory, qint64 maxSize = MAX_CACHE_SIZE, qint64 maxAge = MAX_CACHE_AGE);
+
+    // thread safe, but blocks until objdump finished
+    static DisassemblyIndex build(const QString& objdump, const QString& actualPath, const QString& indexPath,
+                                  QString* errorMessage);
+    static DisassemblyIndex load(const QString& indexPath);
+
+    // the equivalent of DisassemblyOutput::disassemble for a symbol of the indexed binary
+    DisassemblyOutput disassemble(const Data::Symbol& symbol) const;
+
+private:
+    struct Header;
+    struct Line;
+
+    const Header* header() const;
+    const Line* lines() const;
+    const quint32* instructions() const;
+
+    QSharedPointer<QFile> m_file;
+    const uchar* m_data = nullptr;
+};
@@ -8,6 +8,8 @@
 
 #include "disassemblymodel.h"
 
+#include <algorithm>
+
 DisassemblyModel::DisassemblyModel(QObject *parent)
     : QAbstractTableModel(parent)
 {
@@ -19,19 +21,23 @@ void DisassemblyModel::clear()
 {
     beginResetModel();
     m_data = {};
+    m_instructionRows.clear();
     endResetModel();
 }
 
 QModelIndex DisassemblyModel::findIndexWithOffset(int offset)
 {
-    quint64 address = m_data.disassemblyLines[0].addr + offset;
+    if (m_instructionRows.isEmpty()) {
+        return {};
+    }
 
-    const auto& found =
-        std::find_if(m_data.disassemblyLines.begin(), m_data.disassemblyLines.end(),
-                     [address](const DisassemblyOutput::DisassemblyLine& line) { return line.addr == address; });
+    const auto& lines = m_data.disassemblyLines;
+    const quint64 address = lines[m_instructionRows.first()].addr + offset;
 
-    if (found != m_data.disassemblyLines.end()) {
-        return index(std::distance(m_data.disassemblyLines.begin(), found), 0);
+    const auto found = std::lower_bound(m_instructionRows.cbegin(), m_instructionRows.cend(), address,
+                                        [&lines](int row, quint64 address) { return lines[row].addr < address; });
+    if (found != m_instructionRows.cend() && lines[*found].addr == address) {
+        return index(*found, 0);
     }
     return {};
 }
@@ -40,6 +46,15 @@ void DisassemblyModel::setDisassembly(const DisassemblyOutput& disassemblyOutput
 {
     beginResetModel();
     m_data = disassemblyOutput;
+    m_instructionRows.clear();
+    for (int row = 0, c = m_data.disassemblyLines.size(); row < c; ++row) {
+        if (m_data.disassemblyLines[row].addr) {
+            m_instructionRows.append(row);
+        }
+    }
+    std::stable_sort(m_instructionRows.begin(), m_instructionRows.end(), [this](int lhs, int rhs) {
+        return m_data.disassemblyLines[lhs].addr < m_data.disassemblyLines[rhs].addr;
+    });
     endResetModel();
 }
 
@@ -46,6 +46,8 @@ public:
     };
 private:
     DisassemblyOutput m_data;
+    // rows of the lines that have an instruction, sorted by address
+    QVector<int> m_instructionRows;
     Data::CallerCalleeResults m_results;
     int m_numTypes = 0;
 };
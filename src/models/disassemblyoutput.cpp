@@ -9,13 +9,48 @@
 #include "disassemblyoutput.h"
 #include "data.h"
 #include <QApplication>
+#include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
 #include <QProcess>
-#include <QRegularExpression>
 #include <QStandardPaths>
 
 namespace {
-DisassemblyOutput::LinkedFunction extractLinkedFunction(const QString& disassembly)
+bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+QVector<DisassemblyOutput::DisassemblyLine> objdumpParse(const QByteArray& output)
+{
+    QVector<DisassemblyOutput::DisassemblyLine> disassemblyLines;
+
+    int start = 0;
+    while (start < output.size()) {
+        auto end = output.indexOf('\n', start);
+        if (end == -1) {
+            end = output.size();
+        }
+        auto line = QByteArray::fromRawData(output.constData() + start, end - start);
+        start = end + 1;
+
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+
+        quint64 addr = 0;
+        if (!DisassemblyOutput::parseLine(line, &addr)) {
+            continue;
+        }
+
+        const auto asmLine = QString::fromUtf8(line);
+        disassemblyLines.push_back({addr, asmLine, DisassemblyOutput::extractLinkedFunction(asmLine)});
+    }
+    return disassemblyLines;
+}
+}
+
+DisassemblyOutput::LinkedFunction DisassemblyOutput::extractLinkedFunction(const QString& disassembly)
 {
     DisassemblyOutput::LinkedFunction function = {};
 
@@ -45,48 +80,67 @@ DisassemblyOutput::LinkedFunction extractLinkedFunction(const QString& disassemb
     }
     return function;
 }
-}
 
-static QVector<DisassemblyOutput::DisassemblyLine> objdumpParse(const QByteArray &output)
+bool DisassemblyOutput::parseLine(const QByteArray& line, quint64* addr)
 {
-    QVector<DisassemblyOutput::DisassemblyLine> disassemblyLines;
+    *addr = 0;
 
-    QTextStream stream(output);
-    QString asmLine;
-    // detect lines like:
-    // 4f616: 84 c0 test %al,%al
-    static const QRegularExpression disassemblyRegex(QStringLiteral("^[ ]+([0-9a-f]{4,}):\t[0-9a-f ]{2,}"));
-    while (stream.readLineInto(&asmLine))
-    {
-        if (asmLine.isEmpty() || asmLine.startsWith(QLatin1String("Disassembly")))
-            continue;
+    if (line.isEmpty() || line.startsWith("Disassembly"))
+        return false;
 
-        // skip lines like these: 0000000000001265 <main>:
-        const int colonIndex = asmLine.indexOf(QLatin1Char(':'));
-        const int angleBracketIndex = asmLine.indexOf(QLatin1Char('<'));
-        if (angleBracketIndex > 0 && colonIndex > angleBracketIndex) {
-            continue;
-        }
+    // skip lines like these: 0000000000001265 <main>:
+    const int colonIndex = line.indexOf(':');
+    const int angleBracketIndex = line.indexOf('<');
+    if (angleBracketIndex > 0 && colonIndex > angleBracketIndex) {
+        return false;
+    }
 
-        // we don't care about the file name
-        if (asmLine.startsWith(QLatin1Char('/')) && asmLine.contains(QStringLiteral("file format"))) {
-            continue;
-        }
+    // we don't care about the file name
+    if (line.startsWith('/') && line.contains("file format")) {
+        return false;
+    }
 
-        quint64 addr = 0;
-        const auto match = disassemblyRegex.match(asmLine);
-        if (match.hasMatch()) {
-            bool ok = false;
-            addr = match.capturedRef(1).toULongLong(&ok, 16);
-            if (!ok) {
-                qWarning() << "unhandled asm line format:" << asmLine;
-                continue;
-            }
-        }
+    // detect lines like:
+    // 4f616: 84 c0 test %al,%al
+    // this is hot when indexing whole binaries, so don't use a regular expression here
+    int i = 0;
+    while (i < line.size() && line[i] == ' ') {
+        ++i;
+    }
+    const auto addrStart = i;
+    while (i < line.size() && isHexDigit(line[i])) {
+        ++i;
+    }
+    const auto addrSize = i - addrStart;
+    if (!addrStart || addrSize < 4 || i + 1 >= line.size() || line[i] != ':' || line[i + 1] != '\t') {
+        return true;
+    }
+    i += 2;
+    if (i + 1 >= line.size() || !(isHexDigit(line[i]) || line[i] == ' ')
+        || !(isHexDigit(line[i + 1]) || line[i + 1] == ' ')) {
+        return true;
+    }
 
-        disassemblyLines.push_back({addr, asmLine, extractLinkedFunction(asmLine)});
+    bool ok = false;
+    *addr = line.mid(addrStart, addrSize).toULongLong(&ok, 16);
+    if (!ok) {
+        qWarning() << "unhandled asm line format:" << line;
+        return false;
     }
-    return disassemblyLines;
+    return true;
+}
+
+DisassemblyOutput::CacheKey DisassemblyOutput::CacheKey::forSymbol(const QString& objdump, const Data::Symbol& symbol)
+{
+    CacheKey key;
+    key.objdump = objdump;
+    key.actualPath = symbol.actualPath;
+    if (!symbol.actualPath.isEmpty()) {
+        key.lastModified = QFileInfo(symbol.actualPath).lastModified().toMSecsSinceEpoch();
+    }
+    key.relAddr = symbol.relAddr;
+    key.size = symbol.size;
+    return key;
 }
 
 DisassemblyOutput DisassemblyOutput::disassemble(const QString& objdump, const QString& arch,
@@ -34,6 +34,39 @@ struct DisassemblyOutput
         return errorMessage.isEmpty();
     }
 
+    // identifies the output of disassemble(), the modification time of the binary stands in for its build id
+    struct CacheKey
+    {
+        QString objdump;
+        QString actualPath;
+        qint64 lastModified = 0;
+        quint64 relAddr = 0;
+        quint64 size = 0;
+
+        static CacheKey forSymbol(const QString& objdump, const Data::Symbol& symbol);
+
+        bool operator==(const CacheKey& rhs) const
+        {
+            return std::tie(objdump, actualPath, lastModified, relAddr, size)
+                == std::tie(rhs.objdump, rhs.actualPath, rhs.lastModified, rhs.relAddr, rhs.size);
+        }
+    };
+
+    // thread safe, but blocks until objdump finished
     static DisassemblyOutput disassemble(const QString& objdump, const QString& arch, const Data::Symbol& symbol);
+
+    // parses one line of objdump output, returns false for lines that should be skipped
+    // addr is set to zero for lines without an instruction, e.g. source code lines
+    static bool parseLine(const QByteArray& line, quint64* addr);
+    static LinkedFunction extractLinkedFunction(const QString& disassembly);
 };
 Q_DECLARE_TYPEINFO(DisassemblyOutput::DisassemblyLine, Q_MOVABLE_TYPE);
+
+inline uint qHash(const DisassemblyOutput::CacheKey& key, uint seed = 0)
+{
+    Util::HashCombine hash;
+    seed = hash(seed, key.actualPath);
+    seed = hash(seed, key.relAddr);
+    seed = hash(seed, key.size);
+    return seed;
+}
@@ -7,6 +7,7 @@
 
 #include "eventmodel.h"
 
+#include "../phasetrace.h"
 #include "../util.h"
 
 #include <QDebug>
@@ -282,6 +283,7 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
 
 void EventModel::setData(const Data::EventResults& data)
 {
+    PHASE_TRACE("EventModel::setData");
     beginResetModel();
     m_data = data;
     m_totalEvents = 0;
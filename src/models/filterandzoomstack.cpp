@@ -96,6 +96,22 @@ void FilterAndZoomStack::clear()
     m_zoomStack.clear();
 }
 
+void FilterAndZoomStack::setFilterEnabled(bool enabled)
+{
+    if (m_filterEnabled == enabled)
+        return;
+
+    m_filterEnabled = enabled;
+    if (!enabled)
+        m_filterStack.clear();
+    updateActions();
+}
+
+bool FilterAndZoomStack::isFilterEnabled() const
+{
+    return m_filterEnabled;
+}
+
 void FilterAndZoomStack::filterInByTime(const Data::TimeRange& time)
 {
     zoomIn(time);
@@ -147,6 +163,16 @@ void FilterAndZoomStack::filterOutByCpu(quint32 cpuId)
     applyFilter(filter);
 }
 
+void FilterAndZoomStack::filterInByCpuAndTime(quint32 cpuId, const Data::TimeRange& time)
+{
+    zoomIn(time);
+
+    Data::FilterAction filter;
+    filter.cpuId = cpuId;
+    filter.time = time.normalized();
+    applyFilter(filter);
+}
+
 void FilterAndZoomStack::filterInBySymbol(const Data::Symbol& symbol)
 {
     Data::FilterAction filter;
@@ -177,6 +203,9 @@ void FilterAndZoomStack::filterOutByBinary(const QString& binary)
 
 void FilterAndZoomStack::applyFilter(Data::FilterAction filter)
 {
+    if (!m_filterEnabled)
+        return;
+
     if (!m_filterStack.isEmpty()) {
         // apply previous filter state
         const auto& lastFilter = m_filterStack.last();
@@ -244,6 +273,10 @@ void FilterAndZoomStack::updateActions()
     const bool isFiltered = filter().isValid();
     m_actions.filterOut->setEnabled(isFiltered);
     m_actions.resetFilter->setEnabled(isFiltered);
+    m_actions.filterInBySymbol->setEnabled(m_filterEnabled);
+    m_actions.filterOutBySymbol->setEnabled(m_filterEnabled);
+    m_actions.filterInByBinary->setEnabled(m_filterEnabled);
+    m_actions.filterOutByBinary->setEnabled(m_filterEnabled);
 
     const bool isZoomed = zoom().isValid();
     m_actions.zoomOut->setEnabled(isZoomed);
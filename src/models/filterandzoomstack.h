@@ -40,6 +40,12 @@ public:
 
     void clear();
 
+    // filters can't be applied while comparing two recordings, when disabled they are ignored and the actions
+    // get disabled, zooming still works. disabling drops the current filters without refiltering, so it is meant
+    // to be called before new data gets loaded
+    void setFilterEnabled(bool enabled);
+    bool isFilterEnabled() const;
+
 public slots:
     void filterInByTime(const Data::TimeRange& time);
     void filterInByProcess(qint32 processId);
@@ -48,6 +54,8 @@ public slots:
     void filterOutByThread(qint32 threadId);
     void filterInByCpu(quint32 cpuId);
     void filterOutByCpu(quint32 cpuId);
+    // zooms in on the time range as well, like filterInByTime
+    void filterInByCpuAndTime(quint32 cpuId, const Data::TimeRange& time);
     void filterInBySymbol(const Data::Symbol& symbol);
     void filterOutBySymbol(const Data::Symbol& symbol);
     void filterInByBinary(const QString& binary);
@@ -70,4 +78,5 @@ private:
     Actions m_actions;
     QVector<Data::FilterAction> m_filterStack;
     QVector<Data::ZoomAction> m_zoomStack;
+    bool m_filterEnabled = true;
 };
@@ -20,7 +20,7 @@ int FrequencyModel::rowCount(const QModelIndex& parent) const
     if (parent.isValid() || m_frequencyData.isEmpty()) {
         return 0;
     }
-    return m_frequencyData[parent.column() / 2].values.size();
+    return m_frequencyData[parent.column() / 2].levels.value(0).size();
 }
 
 int FrequencyModel::columnCount(const QModelIndex& parent) const
@@ -37,14 +37,16 @@ QVariant FrequencyModel::data(const QModelIndex& index, int role) const
         return {};
     }
 
-    if (index.row() >= m_frequencyData[index.column() / 2].values.size()) {
+    const auto& levels = m_frequencyData[index.column() / 2].levels;
+    if (levels.isEmpty() || index.row() >= levels[0].size()) {
         return {};
     }
 
+    const auto& bucket = levels[0][index.row()];
     if (index.column() % 2 == 0) {
-        return m_frequencyData[index.column() / 2].values[index.row()].time;
+        return bucket.time;
     } else {
-        return m_frequencyData[index.column() / 2].values[index.row()].cost;
+        return bucket.mean;
     }
 }
 
@@ -69,7 +71,7 @@ void FrequencyModel::setResults(const Data::FrequencyResults& results)
     for (const auto& core : results.cores) {
         for (const auto& eventType : core.costs) {
             m_frequencyData.push_back(
-                {tr("CPU %1 - %2").arg(QString::number(coreIndex), eventType.costName), eventType.values});
+                {tr("CPU %1 - %2").arg(QString::number(coreIndex), eventType.costName), eventType.levels});
         }
         coreIndex++;
     }
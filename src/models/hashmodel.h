@@ -11,6 +11,47 @@
 #include <QHash>
 #include <QVector>
 
+#include <algorithm>
+
+#include "../phasetrace.h"
+#include "data.h"
+
+namespace HashModelDetail {
+// whether a row shows the same cells for both values, unknown types are assumed to always change
+template<typename Value>
+bool isEqual(const Value& /*lhs*/, const Value& /*rhs*/)
+{
+    return false;
+}
+
+inline bool isEqual(const Data::ItemCost& lhs, const Data::ItemCost& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(std::begin(lhs), std::end(lhs), std::begin(rhs));
+}
+
+inline bool isEqual(const Data::LocationCost& lhs, const Data::LocationCost& rhs)
+{
+    return isEqual(lhs.selfCost, rhs.selfCost) && isEqual(lhs.inclusiveCost, rhs.inclusiveCost);
+}
+
+template<typename Key, typename Value>
+bool isEqual(const QHash<Key, Value>& lhs, const QHash<Key, Value>& rhs)
+{
+    if (lhs.isSharedWith(rhs)) {
+        return true;
+    } else if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (auto it = lhs.cbegin(), end = lhs.cend(); it != end; ++it) {
+        const auto other = rhs.constFind(it.key());
+        if (other == rhs.cend() || !isEqual(it.value(), other.value())) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
 template<typename Rows, typename ModelImpl>
 class HashModel : public QAbstractTableModel
 {
@@ -47,19 +88,18 @@ public:
             return {};
         }
 
-        const auto& key = m_keys.value(index.row());
-        const auto& value = m_values.value(index.row());
+        const auto& key = m_keys[index.row()];
+        const auto& value = m_values[index.row()];
 
         return cell(index.column(), role, key, value);
     }
 
     QModelIndex indexForKey(const typename Rows::key_type& key, int column = 0) const
     {
-        auto it = std::find(m_keys.begin(), m_keys.end(), key);
-        if (it == m_keys.end()) {
+        const auto row = rows().value(key, -1);
+        if (row == -1) {
             return {};
         }
-        const int row = std::distance(m_keys.begin(), it);
         return index(row, column);
     }
 
@@ -69,18 +109,99 @@ public:
     }
 
 protected:
-    void setRows(const Rows& rows)
+    // applies the difference to the current rows, so that views keep their selection, sorting and scroll position
+    // pass allCellsChanged when the cells depend on more than the values, e.g. on total costs that changed
+    void setRows(const Rows& rows, bool allCellsChanged = false)
     {
-        beginResetModel();
-        m_keys.reserve(rows.size());
-        m_values.reserve(rows.size());
-        m_keys.clear();
-        m_values.clear();
-        for (auto it = rows.constBegin(), end = rows.constEnd(); it != end; ++it) {
-            m_keys.push_back(it.key());
-            m_values.push_back(it.value());
+        PHASE_TRACE("HashModel::setRows");
+        int numRemoved = 0;
+        for (const auto& key : qAsConst(m_keys)) {
+            if (!rows.contains(key)) {
+                ++numRemoved;
+            }
+        }
+
+        // a reset is cheaper when most rows are gone, and required when the columns changed
+        if (m_numColumns != numColumns() || numRemoved > m_keys.size() / 2) {
+            beginResetModel();
+            m_keys.clear();
+            m_values.clear();
+            m_keys.reserve(rows.size());
+            m_values.reserve(rows.size());
+            for (auto it = rows.constBegin(), end = rows.constEnd(); it != end; ++it) {
+                m_keys.push_back(it.key());
+                m_values.push_back(it.value());
+            }
+            m_rowsValid = false;
+            m_numColumns = numColumns();
+            endResetModel();
+            return;
+        }
+
+        // back to front, to keep the row numbers of the pending removals valid
+        for (int last = m_keys.size() - 1; last >= 0;) {
+            if (rows.contains(m_keys[last])) {
+                --last;
+                continue;
+            }
+            auto first = last;
+            while (first > 0 && !rows.contains(m_keys[first - 1])) {
+                --first;
+            }
+            beginRemoveRows({}, first, last);
+            m_keys.remove(first, last - first + 1);
+            m_values.remove(first, last - first + 1);
+            m_rowsValid = false;
+            endRemoveRows();
+            last = first - 1;
+        }
+
+        if (allCellsChanged) {
+            emit headerDataChanged(Qt::Horizontal, 0, m_numColumns - 1);
+        }
+
+        // update the remaining rows in place, signalling contiguous ranges of changed rows
+        int firstChanged = -1;
+        auto emitDataChanged = [this, &firstChanged](int lastChanged) {
+            if (firstChanged != -1) {
+                emit dataChanged(index(firstChanged, 0), index(lastChanged, m_numColumns - 1));
+                firstChanged = -1;
+            }
+        };
+        for (int row = 0, c = m_keys.size(); row < c; ++row) {
+            const auto& value = rows.constFind(m_keys[row]).value();
+            if (allCellsChanged || !isRowEqual(m_values[row], value)) {
+                m_values[row] = value;
+                if (firstChanged == -1) {
+                    firstChanged = row;
+                }
+            } else {
+                emitDataChanged(row - 1);
+            }
+        }
+        emitDataChanged(m_keys.size() - 1);
+
+        // append the new rows
+        const auto& existingRows = this->rows();
+        const auto numAdded = rows.size() - m_keys.size();
+        if (numAdded > 0) {
+            beginInsertRows({}, m_keys.size(), m_keys.size() + numAdded - 1);
+            for (auto it = rows.constBegin(), end = rows.constEnd(); it != end; ++it) {
+                if (!existingRows.contains(it.key())) {
+                    m_rows.insert(it.key(), m_keys.size());
+                    m_keys.push_back(it.key());
+                    m_values.push_back(it.value());
+                }
+            }
+            endInsertRows();
         }
-        endResetModel();
+    }
+
+    // whether a row shows the same cells for both values, to be overridden when the cells depend on more
+    virtual bool isRowEqual(const typename Rows::mapped_type& oldValue,
+                            const typename Rows::mapped_type& newValue) const
+    {
+        return HashModelDetail::isEqual(oldValue, newValue);
     }
 
     virtual QVariant headerCell(int column, int role) const = 0;
@@ -90,4 +211,23 @@ protected:
 
     QVector<typename Rows::key_type> m_keys;
     QVector<typename Rows::mapped_type> m_values;
+
+private:
+    // maps the keys to their row, rebuilt lazily after rows got removed
+    const QHash<typename Rows::key_type, int>& rows() const
+    {
+        if (!m_rowsValid) {
+            m_rows.clear();
+            m_rows.reserve(m_keys.size());
+            for (int row = 0, c = m_keys.size(); row < c; ++row) {
+                m_rows.insert(m_keys[row], row);
+            }
+            m_rowsValid = true;
+        }
+        return m_rows;
+    }
+
+    mutable QHash<typename Rows::key_type, int> m_rows;
+    mutable bool m_rowsValid = true;
+    int m_numColumns = -1;
 };
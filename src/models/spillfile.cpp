@@ -0,0 +1,130 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "spillfile.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+
+namespace Data {
+struct SpillSegment
+{
+    // guards the file, blocks get unmapped from arbitrary threads
+    QMutex mutex;
+    QTemporaryFile file;
+};
+}
+
+using namespace Data;
+
+SpilledBlock::SpilledBlock(QSharedPointer<SpillSegment> segment, uchar* data, qint64 size)
+    : m_segment(std::move(segment))
+    , m_data(data)
+    , m_size(size)
+{
+}
+
+SpilledBlock::~SpilledBlock()
+{
+    if (m_data) {
+        QMutexLocker locker(&m_segment->mutex);
+        m_segment->file.unmap(m_data);
+    }
+}
+
+SpillFile::SpillFile(const QString& directory, qint64 maxSegmentSize)
+    : m_directory(directory.isEmpty() ? QDir::tempPath() : directory)
+    , m_maxSegmentSize(maxSegmentSize)
+{
+}
+
+SpillFile::~SpillFile() = default;
+
+SpilledBlockPtr SpillFile::append(std::initializer_list<Chunk> chunks)
+{
+    qint64 size = 0;
+    for (const auto& chunk : chunks) {
+        size += chunk.size;
+    }
+
+    return appendBlock(size, [chunks](QFileDevice* file) {
+        for (const auto& chunk : chunks) {
+            if (chunk.size && file->write(reinterpret_cast<const char*>(chunk.data), chunk.size) != chunk.size) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+SpilledBlockPtr SpillFile::append(qint64 size, const Producer& produce)
+{
+    return appendBlock(size, [size, &produce](QFileDevice* file) {
+        QByteArray buffer(static_cast<int>(std::min(size, qint64(1024 * 1024))), Qt::Uninitialized);
+        for (qint64 written = 0; written < size;) {
+            const auto produced = produce(buffer.data(), std::min(static_cast<qint64>(buffer.size()), size - written));
+            if (produced <= 0 || file->write(buffer.constData(), produced) != produced) {
+                return false;
+            }
+            written += produced;
+        }
+        return true;
+    });
+}
+
+SpilledBlockPtr SpillFile::appendBlock(qint64 size, const std::function<bool(QFileDevice* file)>& write)
+{
+    if (size == 0) {
+        return {};
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_segment || m_segment->file.size() + size > m_maxSegmentSize) {
+        auto segment = QSharedPointer<SpillSegment>::create();
+        segment->file.setFileTemplate(m_directory + QLatin1String("/hotspot-spill-XXXXXX"));
+        if (!segment->file.open()) {
+            qWarning() << "failed to create spill file in" << m_directory << segment->file.errorString();
+            return {};
+        }
+        m_segment = segment;
+    }
+
+    QMutexLocker segmentLocker(&m_segment->mutex);
+    auto& file = m_segment->file;
+
+    // keep the blocks aligned for the types stored in them
+    const auto offset = (file.size() + 7) & ~qint64(7);
+    if (!file.seek(offset)) {
+        return {};
+    }
+    if (!write(&file) || file.pos() != offset + size) {
+        qWarning() << "failed to write spill file" << file.fileName() << file.errorString();
+        return {};
+    }
+    if (!file.flush()) {
+        return {};
+    }
+
+    auto* data = file.map(offset, size, QFileDevice::NoOptions);
+    if (!data) {
+        qWarning() << "failed to map spill file" << file.fileName() << file.errorString();
+        return {};
+    }
+
+    m_spilledBytes += size;
+    return SpilledBlockPtr(new SpilledBlock(m_segment, data, size));
+}
+
+qint64 SpillFile::spilledBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_spilledBytes;
+}
@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+#include <functional>
+#include <initializer_list>
+
+class QFileDevice;
+
+namespace Data {
+struct SpillSegment;
+
+// a read-only, memory mapped block of a spill file, unmapped when the last reference is gone
+class SpilledBlock
+{
+public:
+    ~SpilledBlock();
+
+    const char* data() const
+    {
+        return reinterpret_cast<const char*>(m_data);
+    }
+
+    qint64 size() const
+    {
+        return m_size;
+    }
+
+private:
+    friend class SpillFile;
+    SpilledBlock(QSharedPointer<SpillSegment> segment, uchar* data, qint64 size);
+
+    QSharedPointer<SpillSegment> m_segment;
+    uchar* m_data;
+    qint64 m_size;
+};
+
+using SpilledBlockPtr = QSharedPointer<const SpilledBlock>;
+
+/**
+ * Append-only temporary segment files for data that exceeds the memory budget.
+ *
+ * The blocks get memory mapped back, so the kernel pages them in and out as needed.
+ * Segment files are removed once the spill file and all of its blocks are gone.
+ */
+class SpillFile
+{
+public:
+    struct Chunk
+    {
+        const void* data;
+        qint64 size;
+    };
+
+    // uses the system temp directory when directory is empty
+    explicit SpillFile(const QString& directory = {}, qint64 maxSegmentSize = 1024 * 1024 * 1024);
+    ~SpillFile();
+
+    // writes the chunks as one contiguous, 8 byte aligned block
+    // returns null when writing failed, e.g. because the disk is full
+    SpilledBlockPtr append(std::initializer_list<Chunk> chunks);
+
+    // fills the buffer with the next bytes of the block and returns how many it wrote, zero on errors
+    using Producer = std::function<qint64(char* buffer, qint64 maxSize)>;
+
+    // writes a block of the given size that gets produced piece by piece, so it never has to be in memory
+    // as a whole. the producer must not release blocks of this spill file
+    SpilledBlockPtr append(qint64 size, const Producer& produce);
+
+    qint64 spilledBytes() const;
+
+private:
+    SpilledBlockPtr appendBlock(qint64 size, const std::function<bool(QFileDevice* file)>& write);
+
+    QString m_directory;
+    qint64 m_maxSegmentSize;
+    mutable QMutex m_mutex;
+    QSharedPointer<SpillSegment> m_segment;
+    qint64 m_spilledBytes = 0;
+};
+}
@@ -8,18 +8,22 @@
 #include "timelinedelegate.h"
 
 #include <QAbstractItemView>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QEvent>
 #include <QHelpEvent>
 #include <QMenu>
 #include <QPainter>
+#include <QPointer>
 #include <QToolTip>
 
+#include "../phasetrace.h"
 #include "../util.h"
 #include "eventmodel.h"
 #include "filterandzoomstack.h"
 
 #include <KColorScheme>
+#include <ThreadWeaver/ThreadWeaver>
 
 #include <algorithm>
 
@@ -125,6 +129,170 @@ TimeLineData dataFromIndex(const QModelIndex& index, QRect rect, const Data::Zoo
     return data;
 }
 
+struct TimeLineColors
+{
+    explicit TimeLineColors(const QPalette& palette)
+    {
+        // KColorScheme is not thread safe, so resolve all colors upfront
+        KColorScheme scheme(palette.currentColorGroup());
+
+        running = scheme.background(KColorScheme::PositiveBackground).color();
+        running.setAlpha(128);
+        runningOutline = scheme.foreground(KColorScheme::PositiveText).color();
+        runningOutline.setAlpha(128);
+
+        offCpu = scheme.background(KColorScheme::NegativeBackground).color();
+        offCpuSelected = scheme.foreground(KColorScheme::NegativeText).color();
+        offCpuHovered = toHoverColor(offCpuSelected);
+
+        selected = scheme.foreground(KColorScheme::ActiveText).color();
+        hovered = toHoverColor(selected);
+        event = scheme.foreground(KColorScheme::NeutralText).color();
+        lostEvent = scheme.foreground(KColorScheme::NegativeText).color();
+    }
+
+    QColor running;
+    QColor runningOutline;
+    QColor offCpu;
+    QColor offCpuSelected;
+    QColor offCpuHovered;
+    QColor selected;
+    QColor hovered;
+    QColor event;
+    QColor lostEvent;
+};
+
+// everything needed to paint the events of a row, without touching the model or the delegate
+struct TimeLineRenderInput
+{
+    TimeLineRenderInput(const TimeLineData& data, const QPalette& palette, int eventType, int offCpuCostId,
+                        int lostEventCostId, const QSet<qint32>& selectedStacks, const QSet<qint32>& hoveredStacks)
+        : data(data)
+        , eventType(eventType)
+        , offCpuCostId(offCpuCostId)
+        , lostEventCostId(lostEventCostId)
+        , selectedStacks(selectedStacks)
+        , hoveredStacks(hoveredStacks)
+        , colors(palette)
+    {
+    }
+
+    TimeLineData data;
+    int eventType = 0;
+    int offCpuCostId = -1;
+    int lostEventCostId = -1;
+    QSet<qint32> selectedStacks;
+    QSet<qint32> hoveredStacks;
+    TimeLineColors colors;
+};
+
+// paints the thread time and the events, with the painter translated to the top left corner of the row
+void paintTimeLine(QPainter* painter, const TimeLineRenderInput& input)
+{
+    const auto& data = input.data;
+    const auto& colors = input.colors;
+    const auto width = data.w + 2 * data.padding;
+
+    // account for padding
+    painter->translate(data.padding, data.padding);
+
+    // visualize the time where the thread was active
+    // i.e. paint events for threads that have any in the selected time range
+    auto threadTimeRect =
+        QRect(QPoint(data.mapTimeToX(data.threadTime.start), 0), QPoint(data.mapTimeToX(data.threadTime.end), data.h));
+    if (threadTimeRect.left() >= width || threadTimeRect.right() <= 0) {
+        // skip threads that are outside the visible (zoomed) region
+        return;
+    }
+
+    if (threadTimeRect.left() < 0)
+        threadTimeRect.setLeft(0);
+    if (threadTimeRect.right() > width)
+        threadTimeRect.setRight(width);
+
+    painter->setBrush(QBrush(colors.running));
+    painter->setPen(QPen(colors.runningOutline, 1));
+    painter->drawRect(threadTimeRect.adjusted(-1, -1, 0, 0));
+
+    // visualize all events
+    painter->setBrush({});
+
+    if (input.offCpuCostId != -1) {
+        for (const auto& event : data.events) {
+            if (event.type != input.offCpuCostId) {
+                continue;
+            }
+
+            const auto x = data.mapTimeToX(event.time);
+            const auto x2 = data.mapTimeToX(event.time + event.cost);
+            const auto& color = input.selectedStacks.contains(event.stackId)
+                ? colors.offCpuSelected
+                : (input.hoveredStacks.contains(event.stackId) ? colors.offCpuHovered : colors.offCpu);
+            painter->fillRect(x, 0, x2 - x, data.h, color);
+        }
+    }
+
+    const QPen selectedPen(colors.selected, 1);
+    const QPen hoveredPen(colors.hovered, 1);
+    const QPen eventPen(colors.event, 1);
+    const QPen lostEventPen(colors.lostEvent, 1);
+
+    int last_x = -1;
+    // TODO: accumulate cost for events that fall to the same pixel somehow
+    // but how to then sync the y scale across different delegates?
+    // somehow deduce threshold via min time delta and max cost?
+    // TODO: how to deal with broken cycle counts in frequency mode? For now,
+    // we simply always fill the complete height which is also what we'd get
+    // from a graph in count mode (perf record -F vs. perf record -c)
+    // see also: https://www.spinics.net/lists/linux-perf-users/msg03486.html
+    for (const auto& event : data.events) {
+        const auto isLostEvent = event.type == input.lostEventCostId;
+        if (event.type != input.eventType && !isLostEvent) {
+            continue;
+        }
+
+        const auto x = data.mapTimeToX(event.time);
+        if (x < data.padding || x >= data.w) {
+            continue;
+        }
+
+        // only draw a line when it changes anything visually
+        // but always force drawing of lost events
+        if (x != last_x || isLostEvent) {
+            if (isLostEvent)
+                painter->setPen(lostEventPen);
+            else if (input.selectedStacks.contains(event.stackId))
+                painter->setPen(selectedPen);
+            else if (input.hoveredStacks.contains(event.stackId))
+                painter->setPen(hoveredPen);
+            else
+                painter->setPen(eventPen);
+
+            painter->drawLine(x, 0, x, data.h);
+        }
+
+        last_x = x;
+    }
+}
+
+// thread safe, used to pre-render the rows in the background
+QImage renderTimeLine(const TimeLineRenderInput& input, QSize size, qreal devicePixelRatio)
+{
+    QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    paintTimeLine(&painter, input);
+    return image;
+}
+
+QSet<qint32> intersected(QSet<qint32> stacks, const QSet<qint32>& other)
+{
+    stacks.intersect(other);
+    return stacks;
+}
+
 Data::Events::const_iterator findEvent(Data::Events::const_iterator begin, Data::Events::const_iterator end,
                                        quint64 time)
 {
@@ -136,14 +304,47 @@ Data::Events::const_iterator findEvent(Data::Events::const_iterator begin, Data:
 }
 }
 
+QSet<qint32> highlightableStacks(const Data::Events& events, int eventType, int offCpuCostId)
+{
+    QSet<qint32> stacks;
+    for (const auto& event : events) {
+        if (event.stackId != -1 && (event.type == eventType || (offCpuCostId != -1 && event.type == offCpuCostId))) {
+            stacks.insert(event.stackId);
+        }
+    }
+    return stacks;
+}
+
+bool TimeLineRenderedRow::isUpToDate(const TimeLineRenderKey& key, const QSet<qint32>& hoveredStacks) const
+{
+    if (!(this->key == key)) {
+        return false;
+    }
+    int numHovered = 0;
+    for (const auto stackId : hoveredStacks) {
+        if (stacks.contains(stackId)) {
+            if (!this->hoveredStacks.contains(stackId)) {
+                return false;
+            }
+            ++numHovered;
+        }
+    }
+    return numHovered == this->hoveredStacks.size();
+}
+
 TimeLineDelegate::TimeLineDelegate(FilterAndZoomStack* filterAndZoomStack, QAbstractItemView* view)
     : QStyledItemDelegate(view)
     , m_filterAndZoomStack(filterAndZoomStack)
     , m_view(view)
 {
     m_view->viewport()->installEventFilter(this);
+    m_renderedRows.setMaxCost(128 * 1024); // in KiB
 
-    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, &TimeLineDelegate::updateView);
+    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, [this]() {
+        // the filtered events replace the current ones, don't keep the old ones alive
+        m_renderedRows.clear();
+        invalidateRenderedRows();
+    });
     connect(filterAndZoomStack, &FilterAndZoomStack::zoomChanged, this, &TimeLineDelegate::updateZoomState);
 }
 
@@ -152,108 +353,44 @@ TimeLineDelegate::~TimeLineDelegate() = default;
 void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
     const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom());
-    const auto results = index.data(EventModel::EventResultsRole).value<Data::EventResults>();
-    const auto offCpuCostId = results.offCpuTimeCostId;
-    const auto lostEventCostId = results.lostEventCostId;
     const bool is_alternate = option.features & QStyleOptionViewItem::Alternate;
     const auto& palette = option.palette;
 
     painter->fillRect(option.rect, is_alternate ? palette.base() : palette.alternateBase());
 
-    // skip threads that are outside the visible (zoomed) region
-    painter->save();
-
-    // transform into target coordinate system
-    painter->translate(option.rect.topLeft());
-    // account for padding
-    painter->translate(data.padding, data.padding);
-
-    // visualize the time where the thread was active
-    // i.e. paint events for threads that have any in the selected time range
-    auto threadTimeRect =
-        QRect(QPoint(data.mapTimeToX(data.threadTime.start), 0), QPoint(data.mapTimeToX(data.threadTime.end), data.h));
-    if (threadTimeRect.left() < option.rect.width() && threadTimeRect.right() > 0) {
-        if (threadTimeRect.left() < 0)
-            threadTimeRect.setLeft(0);
-        if (threadTimeRect.right() > option.rect.width())
-            threadTimeRect.setRight(option.rect.width());
-
-        KColorScheme scheme(palette.currentColorGroup());
-
-        auto runningColor = scheme.background(KColorScheme::PositiveBackground).color();
-        runningColor.setAlpha(128);
-        auto runningOutlineColor = scheme.foreground(KColorScheme::PositiveText).color();
-        runningOutlineColor.setAlpha(128);
-        painter->setBrush(QBrush(runningColor));
-        painter->setPen(QPen(runningOutlineColor, 1));
-        painter->drawRect(threadTimeRect.adjusted(-1, -1, 0, 0));
-
-        // visualize all events
-        painter->setBrush({});
-
-        if (offCpuCostId != -1) {
-            const auto offCpuColor = scheme.background(KColorScheme::NegativeBackground).color();
-            const auto offCpuColorSelected = scheme.foreground(KColorScheme::NegativeText).color();
-            const auto offCpuColorHovered = toHoverColor(offCpuColorSelected);
-            for (const auto& event : data.events) {
-                if (event.type != offCpuCostId) {
-                    continue;
-                }
-
-                const auto x = data.mapTimeToX(event.time);
-                const auto x2 = data.mapTimeToX(event.time + event.cost);
-                const auto& color = m_selectedStacks.contains(event.stackId)
-                    ? offCpuColorSelected
-                    : (m_hoveredStacks.contains(event.stackId) ? offCpuColorHovered : offCpuColor);
-                painter->fillRect(x, 0, x2 - x, data.h, color);
-            }
-        }
-
-        QPen selectedPen(scheme.foreground(KColorScheme::ActiveText), 1);
-        QPen hoveredPen(toHoverColor(selectedPen.color()), 1);
-        QPen eventPen(scheme.foreground(KColorScheme::NeutralText), 1);
-        QPen lostEventPen(scheme.foreground(KColorScheme::NegativeText), 1);
-
-        int last_x = -1;
-        // TODO: accumulate cost for events that fall to the same pixel somehow
-        // but how to then sync the y scale across different delegates?
-        // somehow deduce threshold via min time delta and max cost?
-        // TODO: how to deal with broken cycle counts in frequency mode? For now,
-        // we simply always fill the complete height which is also what we'd get
-        // from a graph in count mode (perf record -F vs. perf record -c)
-        // see also: https://www.spinics.net/lists/linux-perf-users/msg03486.html
-        for (const auto& event : data.events) {
-            const auto isLostEvent = event.type == lostEventCostId;
-            if (event.type != m_eventType && !isLostEvent) {
-                continue;
-            }
-
-            const auto x = data.mapTimeToX(event.time);
-            if (x < data.padding || x >= data.w) {
-                continue;
-            }
-
-            // only draw a line when it changes anything visually
-            // but always force drawing of lost events
-            if (x != last_x || isLostEvent) {
-                if (isLostEvent)
-                    painter->setPen(lostEventPen);
-                else if (m_selectedStacks.contains(event.stackId))
-                    painter->setPen(selectedPen);
-                else if (m_hoveredStacks.contains(event.stackId))
-                    painter->setPen(hoveredPen);
-                else
-                    painter->setPen(eventPen);
-
-                painter->drawLine(x, 0, x, data.h);
-            }
-
-            last_x = x;
+    TimeLineRenderKey key;
+    key.events = data.events.constData();
+    key.threadTime = data.threadTime;
+    key.time = data.time;
+    key.size = option.rect.size();
+    key.devicePixelRatio = painter->device()->devicePixelRatioF();
+    key.eventType = m_eventType;
+    key.colorGroup = palette.currentColorGroup();
+    key.generation = *m_renderGeneration;
+
+    if (data.events.isEmpty()) {
+        // only the thread time gets visualized, which isn't worth a background job
+        painter->save();
+        painter->translate(option.rect.topLeft());
+        paintTimeLine(painter, TimeLineRenderInput(data, palette, m_eventType, -1, -1, {}, {}));
+        painter->restore();
+    } else if (const auto* row = m_renderedRows.object(key.events)) {
+        if (row->isUpToDate(key, m_hoveredStacks)) {
+            painter->drawImage(option.rect.topLeft(), row->image);
+        } else {
+            // stretch the outdated image until the new one is ready, this keeps zooming smooth
+            painter->drawImage(option.rect, row->image);
+            scheduleRender(key, data, index, palette);
         }
+    } else {
+        scheduleRender(key, data, index, palette);
     }
 
     if (m_timeSlice.isValid()) {
-        // the painter is translated to option.rect.topLeft
+        painter->save();
+        painter->translate(option.rect.topLeft());
+        painter->translate(data.padding, data.padding);
+
         // clamp to available width to prevent us from painting over the other columns
         const auto startX = std::max(data.mapTimeToX(m_timeSlice.normalized().start), 0);
         const auto endX = std::min(data.mapTimeToX(m_timeSlice.normalized().end), data.w);
@@ -265,9 +402,55 @@ void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& opti
         color.setAlpha(128);
         brush.setColor(color);
         painter->fillRect(timeSlice, brush);
+
+        painter->restore();
+    }
+}
+
+void TimeLineDelegate::scheduleRender(const TimeLineRenderKey& key, const TimeLineData& data,
+                                      const QModelIndex& index, const QPalette& palette) const
+{
+    if (m_pendingRenders.contains(key)) {
+        return;
     }
+    m_pendingRenders.insert(key);
+
+    const auto results = index.data(EventModel::EventResultsRole).value<Data::EventResults>();
+    const auto input = TimeLineRenderInput(data, palette, m_eventType, results.offCpuTimeCostId,
+                                           results.lostEventCostId, m_selectedStacks, m_hoveredStacks);
+    // only ever dereferenced on the GUI thread, the jobs just check the shared generation
+    QPointer<TimeLineDelegate> smartThis(const_cast<TimeLineDelegate*>(this));
+    auto generation = m_renderGeneration;
+    auto* context = QCoreApplication::instance();
+
+    using namespace ThreadWeaver;
+    stream() << make_job([smartThis, generation, context, key, input]() {
+        PHASE_TRACE("TimeLineDelegate::renderTimeLine");
+        if (*generation != key.generation) {
+            // the pending renders got cleared when the generation changed
+            return;
+        }
 
-    painter->restore();
+        TimeLineRenderedRow row;
+        row.key = key;
+        row.image = renderTimeLine(input, key.size, key.devicePixelRatio);
+        row.events = input.data.events;
+        row.stacks = highlightableStacks(input.data.events, input.eventType, input.offCpuCostId);
+        row.hoveredStacks = intersected(input.hoveredStacks, row.stacks);
+
+        QMetaObject::invokeMethod(
+            context,
+            [smartThis, generation, row]() {
+                if (!smartThis || *generation != row.key.generation) {
+                    return;
+                }
+                smartThis->m_pendingRenders.remove(row.key);
+                const auto costInKiB = static_cast<int>(row.image.sizeInBytes() / 1024);
+                smartThis->m_renderedRows.insert(row.key.events, new TimeLineRenderedRow(row), costInKiB);
+                smartThis->updateView();
+            },
+            Qt::QueuedConnection);
+    });
 }
 
 bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, const QStyleOptionViewItem& option,
@@ -398,6 +581,7 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
         if (stacks != m_hoveredStacks) {
             m_hoveredStacks = stacks;
             emit stacksHovered(stacks);
+            // only the rows that contain the old or new hovered stacks get re-rendered, see isUpToDate
             updateView();
         }
 
@@ -468,13 +652,14 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
 
         contextMenu->addSeparator();
 
-        if (isTimeSpanSelected
+        const bool canFilter = m_filterAndZoomStack->isFilterEnabled();
+        if (canFilter && isTimeSpanSelected
             && (!isFiltered || filter.time.end != timeSlice.start || filter.time.end != timeSlice.end)) {
             contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")), tr("Filter In On Selection"),
                                    this, [this, timeSlice]() { m_filterAndZoomStack->filterInByTime(timeSlice); });
         }
 
-        if (isRightButtonEvent && index.isValid() && numThreads > 1 && threadId != Data::INVALID_TID) {
+        if (canFilter && isRightButtonEvent && index.isValid() && numThreads > 1 && threadId != Data::INVALID_TID) {
             if ((!isFiltered && !isMainThread)
                 || (isFiltered && filter.time.end != threadStartTime && filter.time.end != threadEndTime)) {
                 contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
@@ -502,7 +687,7 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
             }
         }
 
-        if (isRightButtonEvent && index.isValid() && cpuId != Data::INVALID_CPU_ID && numCpus > 1
+        if (canFilter && isRightButtonEvent && index.isValid() && cpuId != Data::INVALID_CPU_ID && numCpus > 1
             && (!isFiltered || filter.cpuId != cpuId)) {
             contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
                                    tr("Filter In On CPU #%1").arg(cpuId), this,
@@ -511,6 +696,17 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
                                    this, [this, cpuId]() { m_filterAndZoomStack->filterOutByCpu(cpuId); });
         }
 
+        if (isRightButtonEvent && index.isValid() && threadId != Data::INVALID_TID) {
+            // up to the end of the selection, or of the thread
+            const auto pathTime = isTimeSpanSelected ? timeSlice : Data::TimeRange(threadStartTime, threadEndTime);
+            contextMenu->addSeparator();
+            contextMenu->addAction(QIcon::fromTheme(QStringLiteral("debug-step-out")),
+                                   tr("Critical Path of Thread #%1").arg(threadId), this,
+                                   [this, processId, threadId, pathTime]() {
+                                       emit criticalPathRequested(processId, threadId, pathTime);
+                                   });
+        }
+
         if (isRightButtonEvent && isFiltered) {
             contextMenu->addAction(m_filterAndZoomStack->actions().filterOut);
             contextMenu->addAction(m_filterAndZoomStack->actions().resetFilter);
@@ -562,12 +758,20 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
 void TimeLineDelegate::setEventType(int type)
 {
     m_eventType = type;
-    updateView();
+    invalidateRenderedRows();
 }
 
 void TimeLineDelegate::setSelectedStacks(const QSet<qint32>& selectedStacks)
 {
     m_selectedStacks = selectedStacks;
+    invalidateRenderedRows();
+}
+
+void TimeLineDelegate::invalidateRenderedRows()
+{
+    // outdated jobs bail out early, the outdated images are still shown until they got replaced
+    ++(*m_renderGeneration);
+    m_pendingRenders.clear();
     updateView();
 }
 
@@ -579,5 +783,5 @@ void TimeLineDelegate::updateView()
 void TimeLineDelegate::updateZoomState()
 {
     m_timeSlice = {};
-    updateView();
+    invalidateRenderedRows();
 }
@@ -7,10 +7,15 @@
 
 #pragma once
 
+#include <QCache>
+#include <QImage>
 #include <QScopedPointer>
 #include <QStyledItemDelegate>
 #include <QSet>
 
+#include <atomic>
+#include <memory>
+
 #include "data.h"
 
 class QAbstractItemView;
@@ -49,6 +54,56 @@ struct TimeLineData
 };
 Q_DECLARE_METATYPE(TimeLineData)
 
+// identifies one pre-rendered row of the time line
+struct TimeLineRenderKey
+{
+    // the events are shared with the model, so their data pointer identifies the row
+    const void* events = nullptr;
+    Data::TimeRange threadTime;
+    Data::TimeRange time;
+    QSize size;
+    qreal devicePixelRatio = 1;
+    int eventType = 0;
+    int colorGroup = 0;
+    uint generation = 0;
+
+    bool operator==(const TimeLineRenderKey& rhs) const
+    {
+        return events == rhs.events && threadTime == rhs.threadTime && time == rhs.time && size == rhs.size && devicePixelRatio == rhs.devicePixelRatio
+            && eventType == rhs.eventType && colorGroup == rhs.colorGroup && generation == rhs.generation;
+    }
+};
+
+inline uint qHash(const TimeLineRenderKey& key, uint seed = 0)
+{
+    Util::HashCombine hash;
+    seed = hash(seed, reinterpret_cast<quintptr>(key.events));
+    seed = hash(seed, key.time.start);
+    seed = hash(seed, key.time.end);
+    seed = hash(seed, key.size.width());
+    seed = hash(seed, key.generation);
+    return seed;
+}
+
+// the stacks of all events that get highlighted when they are selected or hovered
+QSet<qint32> highlightableStacks(const Data::Events& events, int eventType, int offCpuCostId);
+
+// a pre-rendered row of the time line
+struct TimeLineRenderedRow
+{
+    TimeLineRenderKey key;
+    QImage image;
+    // keeps the events alive, so their address cannot get reused by another row while we are cached
+    Data::Events events;
+    // see highlightableStacks
+    QSet<qint32> stacks;
+    // the subset of stacks that got painted as hovered
+    QSet<qint32> hoveredStacks;
+
+    // true when the image still shows the row for key, hovering stacks of other rows doesn't outdate it
+    bool isUpToDate(const TimeLineRenderKey& key, const QSet<qint32>& hoveredStacks) const;
+};
+
 class TimeLineDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -66,6 +121,7 @@ public:
 
 signals:
     void stacksHovered(const QSet<qint32>& stacks);
+    void criticalPathRequested(qint32 processId, qint32 threadId, const Data::TimeRange& time);
 
 protected:
     bool eventFilter(QObject* watched, QEvent* event) override;
@@ -73,6 +129,10 @@ protected:
 private:
     void updateView();
     void updateZoomState();
+    // invalidates all rendered rows, they will be re-rendered in the background
+    void invalidateRenderedRows();
+    void scheduleRender(const TimeLineRenderKey& key, const TimeLineData& data, const QModelIndex& index,
+                        const QPalette& palette) const;
 
     FilterAndZoomStack* m_filterAndZoomStack = nullptr;
     QAbstractItemView* m_view = nullptr;
@@ -80,4 +140,9 @@ private:
     QSet<qint32> m_selectedStacks;
     QSet<qint32> m_hoveredStacks;
     int m_eventType = 0;
+    // shared with the render jobs, which bail out once it changed
+    std::shared_ptr<std::atomic<uint>> m_renderGeneration = std::make_shared<std::atomic<uint>>(0);
+    // the last rendered image per row, keyed by TimeLineRenderKey::events
+    mutable QCache<const void*, TimeLineRenderedRow> m_renderedRows;
+    mutable QSet<TimeLineRenderKey> m_pendingRenders;
 };
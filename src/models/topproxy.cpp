@@ -9,28 +9,89 @@
 
 #include "treemodel.h"
 
+#include <algorithm>
+
 TopProxy::TopProxy(QObject* parent)
-    : QSortFilterProxyModel(parent)
+    : QAbstractProxyModel(parent)
     , m_costColumn(BottomUpModel::InitialSortColumn)
     , m_numBaseColumns(BottomUpModel::NUM_BASE_COLUMNS)
 {
-    sort(m_costColumn, Qt::DescendingOrder);
-    setSortRole(AbstractTreeModel::SortRole);
 }
 
 TopProxy::~TopProxy() = default;
 
+void TopProxy::setSourceModel(QAbstractItemModel* sourceModel)
+{
+    beginResetModel();
+    if (auto* oldModel = this->sourceModel()) {
+        disconnect(oldModel, nullptr, this, nullptr);
+    }
+    m_topRows.clear();
+    m_rows.clear();
+    m_treeModel = qobject_cast<AbstractTreeModel*>(sourceModel);
+    Q_ASSERT(!sourceModel || m_treeModel);
+    QAbstractProxyModel::setSourceModel(sourceModel);
+    if (sourceModel) {
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, [this]() {
+            // the old rows are meaningless for the new data, wait for setTopRows
+            m_topRows.clear();
+            m_rows.clear();
+            endResetModel();
+        });
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &TopProxy::sourceDataChanged);
+        // sorting or filtering the source moves the top rows around or hides some of them
+        connect(sourceModel, &QAbstractItemModel::layoutAboutToBeChanged, this,
+                [this]() { emit layoutAboutToBeChanged(); });
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &TopProxy::sourceLayoutChanged);
+        auto beginReset = [this]() { beginResetModel(); };
+        auto endReset = [this]() {
+            updateRows();
+            endResetModel();
+        };
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, beginReset);
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, endReset);
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, beginReset);
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, endReset);
+    }
+    endResetModel();
+}
+
 void TopProxy::setCostColumn(int costColumn)
 {
+    beginResetModel();
     m_costColumn = costColumn;
-    invalidate();
-    sort(m_costColumn, Qt::DescendingOrder);
+    updateRows();
+    endResetModel();
 }
 
 void TopProxy::setNumBaseColumns(int numBaseColumns)
 {
+    beginResetModel();
     m_numBaseColumns = numBaseColumns;
-    invalidate();
+    updateRows();
+    endResetModel();
+}
+
+void TopProxy::setTopRows(const Data::TopRows& topRows)
+{
+    beginResetModel();
+    m_topRows = topRows;
+    updateRows();
+    endResetModel();
+}
+
+QModelIndex TopProxy::index(int row, int column, const QModelIndex& parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount()) {
+        return {};
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex TopProxy::parent(const QModelIndex& /*child*/) const
+{
+    return {};
 }
 
 int TopProxy::rowCount(const QModelIndex& parent) const
@@ -38,21 +99,113 @@ int TopProxy::rowCount(const QModelIndex& parent) const
     if (parent.isValid() || !sourceModel()) {
         return 0; // this is not a tree
     }
-    return std::min(5, QSortFilterProxyModel::rowCount(parent));
+    return m_rows.size();
+}
+
+int TopProxy::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid() || !sourceModel()) {
+        return 0;
+    }
+    // the base columns plus the selected cost column
+    return std::min(m_numBaseColumns + 1, sourceModel()->columnCount());
+}
+
+QVariant TopProxy::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (!sourceModel() || orientation != Qt::Horizontal || section < 0 || section >= columnCount()) {
+        return {};
+    }
+    return sourceModel()->headerData(sourceColumn(section), orientation, role);
+}
+
+QModelIndex TopProxy::mapToSource(const QModelIndex& proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !m_treeModel || proxyIndex.row() >= m_rows.size()) {
+        return {};
+    }
+    return m_treeModel->topLevelIndex(m_rows[proxyIndex.row()], sourceColumn(proxyIndex.column()));
+}
+
+QModelIndex TopProxy::mapFromSource(const QModelIndex& sourceIndex) const
+{
+    if (!sourceIndex.isValid() || !m_treeModel) {
+        return {};
+    }
+
+    int column = -1;
+    if (sourceIndex.column() < m_numBaseColumns) {
+        column = sourceIndex.column();
+    } else if (sourceIndex.column() == m_costColumn) {
+        column = m_numBaseColumns;
+    } else {
+        return {};
+    }
+
+    const auto position = m_treeModel->topLevelPosition(sourceIndex);
+    const auto row = position == -1 ? -1 : m_rows.indexOf(position);
+    if (row == -1) {
+        return {};
+    }
+    return index(row, column);
+}
+
+void TopProxy::sourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                 const QVector<int>& roles)
+{
+    if (topLeft.parent().isValid() || !m_treeModel) {
+        return; // only the top-level rows are shown
+    }
+
+    int first = -1;
+    int last = -1;
+    for (int row = 0, c = m_rows.size(); row < c; ++row) {
+        const auto sourceRow = m_treeModel->topLevelIndex(m_rows[row], 0).row();
+        if (sourceRow >= topLeft.row() && sourceRow <= bottomRight.row()) {
+            if (first == -1) {
+                first = row;
+            }
+            last = row;
+        }
+    }
+    if (first != -1) {
+        emit dataChanged(index(first, 0), index(last, columnCount() - 1), roles);
+    }
+}
+
+void TopProxy::sourceLayoutChanged()
+{
+    // the top rows keep their order, but the source may have filtered some of them out or back in
+    const auto oldRows = m_rows;
+    updateRows();
+
+    const auto oldIndices = persistentIndexList();
+    QModelIndexList newIndices;
+    newIndices.reserve(oldIndices.size());
+    for (const auto& oldIndex : oldIndices) {
+        const auto row = m_rows.indexOf(oldRows.value(oldIndex.row(), -1));
+        newIndices.append(row == -1 ? QModelIndex() : index(row, oldIndex.column()));
+    }
+    changePersistentIndexList(oldIndices, newIndices);
+
+    emit layoutChanged();
 }
 
-bool TopProxy::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+void TopProxy::updateRows()
 {
-    if (source_parent.isValid()) {
-        return false;
+    m_rows.clear();
+    if (!m_treeModel) {
+        return;
     }
-    if (!sourceModel()->index(source_row, m_costColumn, source_parent).data(sortRole()).value<quint64>()) {
-        return false;
+    const auto topRows = m_topRows.value(m_costColumn - m_numBaseColumns);
+    for (const auto position : topRows) {
+        if (m_treeModel->topLevelIndex(position, 0).isValid()) {
+            m_rows.append(position);
+        }
     }
-    return true;
 }
 
-bool TopProxy::filterAcceptsColumn(int source_column, const QModelIndex& /*source_parent*/) const
+int TopProxy::sourceColumn(int proxyColumn) const
 {
-    return source_column < m_numBaseColumns || source_column == m_costColumn;
+    return proxyColumn < m_numBaseColumns ? proxyColumn : m_costColumn;
 }
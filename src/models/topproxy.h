@@ -7,9 +7,20 @@
 
 #pragma once
 
-#include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
 
-class TopProxy : public QSortFilterProxyModel
+#include "data.h"
+
+class AbstractTreeModel;
+
+/**
+ * Flat view on the top-level rows of a cost tree model with the highest cost.
+ *
+ * The rows are selected in the data layer, see Data::topChildren, so no sorting of the
+ * full source model is required. They are positions in the data, which get looked up in
+ * the source model, so sorting or filtering it doesn't mix them up.
+ */
+class TopProxy : public QAbstractProxyModel
 {
     Q_OBJECT
 
@@ -17,15 +28,33 @@ public:
     explicit TopProxy(QObject* parent = nullptr);
     ~TopProxy() override;
 
+    // the source model needs to be one of the tree models, see AbstractTreeModel
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
     void setCostColumn(int costColumn);
     void setNumBaseColumns(int numBaseColumns);
+    // needs to be called after every reset of the source model
+    void setTopRows(const Data::TopRows& topRows);
 
-    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
-    bool filterAcceptsColumn(int source_column, const QModelIndex& source_parent) const override;
-
+    QModelIndex index(int row, int column, const QModelIndex& parent = {}) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
     int rowCount(const QModelIndex& parent = {}) const override;
+    int columnCount(const QModelIndex& parent = {}) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    QModelIndex mapToSource(const QModelIndex& proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex& sourceIndex) const override;
 
 private:
+    void sourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void sourceLayoutChanged();
+    void updateRows();
+    int sourceColumn(int proxyColumn) const;
+
+    AbstractTreeModel* m_treeModel = nullptr;
     int m_costColumn;
     int m_numBaseColumns;
+    Data::TopRows m_topRows;
+    // the top rows of the cost column that the source model currently shows
+    QVector<int> m_rows;
 };
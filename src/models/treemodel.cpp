@@ -9,12 +9,40 @@
 #include "../settings.h"
 #include "../util.h"
 
+#include <QMutex>
+#include <QThreadPool>
+
+struct AbstractTreeModel::JobGuard
+{
+    QMutex mutex;
+    AbstractTreeModel* model = nullptr;
+};
+
 AbstractTreeModel::AbstractTreeModel(QObject* parent)
     : QAbstractItemModel(parent)
+    , m_jobGuard(new JobGuard)
 {
+    m_jobGuard->model = this;
 }
 
-AbstractTreeModel::~AbstractTreeModel() = default;
+AbstractTreeModel::~AbstractTreeModel()
+{
+    QMutexLocker locker(&m_jobGuard->mutex);
+    m_jobGuard->model = nullptr;
+}
+
+void AbstractTreeModel::runInBackground(std::function<std::function<void()>()> job)
+{
+    auto guard = m_jobGuard;
+    QThreadPool::globalInstance()->start([guard, job]() {
+        auto continuation = job();
+        // pending events get discarded when the model is deleted, so we only have to guard the posting
+        QMutexLocker locker(&guard->mutex);
+        if (guard->model) {
+            QMetaObject::invokeMethod(guard->model, std::move(continuation), Qt::QueuedConnection);
+        }
+    });
+}
 
 BottomUpModel::BottomUpModel(QObject* parent)
     : CostTreeModel(parent)
@@ -8,7 +8,15 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QBitArray>
+#include <QHash>
+#include <QSharedPointer>
 
+#include <algorithm>
+#include <functional>
+
+#include "../phasetrace.h"
+#include "callercalleeproxy.h"
 #include "data.h"
 
 class AbstractTreeModel : public QAbstractItemModel
@@ -24,6 +32,23 @@ public:
         TotalCostRole,
         SymbolRole
     };
+
+    // the index of the top-level node at @p position in the data, independent of sorting and filtering
+    // returns an invalid index when that node is filtered out
+    virtual QModelIndex topLevelIndex(int position, int column) const = 0;
+    // the inverse of topLevelIndex, returns -1 for nodes that aren't on the top level
+    virtual int topLevelPosition(const QModelIndex& index) const = 0;
+
+protected:
+    /**
+     * Runs @p job on the global thread pool. The function returned by the job is then
+     * invoked on the thread of this model, unless the model got destroyed in the meantime.
+     */
+    void runInBackground(std::function<std::function<void()>()> job);
+
+private:
+    struct JobGuard;
+    QSharedPointer<JobGuard> m_jobGuard;
 };
 
 template<typename TreeNode_t, class ModelImpl>
@@ -46,7 +71,11 @@ public:
             return false;
         if (m_simplify && item->children.size() == 1 && item->parent && item->parent->children.size() == 1)
             return false;
-        return item && !item->children.isEmpty();
+        if (m_isFiltered) {
+            return std::any_of(item->children.begin(), item->children.end(),
+                               [this](const TreeNode& child) { return isVisible(&child); });
+        }
+        return !item->children.isEmpty();
     }
 
     int rowCount(const QModelIndex& parent = {}) const final override
@@ -54,19 +83,25 @@ public:
         if (parent.column() >= 1) {
             return 0;
         } else if (auto item = itemFromIndex(parent)) {
-            if (!m_simplify || item == rootItem() || item->children.size() != 1) {
+            if (!m_simplify || item->children.size() != 1) {
+                if (const auto* mapping = childMapping(item)) {
+                    return mapping->rows.size();
+                }
                 return item->children.size();
+            } else if (item == rootItem()) {
+                return isVisible(item->children.constData()) ? 1 : 0;
             } else if (item->parent && item->parent->children.size() == 1) {
                 // simplified
                 return 0;
             }
 
-            // aggregate all simplified nodes
-            int numChildren = 1;
-            item = item->children.constData();
-            while (item->children.size() == 1) {
-                numChildren++;
-                item = item->children.constData();
+            // aggregate all simplified nodes, the chain ends with the first one that is filtered out
+            int numChildren = 0;
+            for (item = item->children.constData(); isVisible(item); item = item->children.constData()) {
+                ++numChildren;
+                if (item->children.size() != 1) {
+                    break;
+                }
             }
             return numChildren;
         } else {
@@ -178,14 +213,236 @@ public:
                 Q_ASSERT(!row);
                 return item;
             }
-            if (index.row() >= parent->children.size()) {
+            int row = index.row();
+            if (const auto* mapping = childMapping(parent)) {
+                if (row >= mapping->rows.size()) {
+                    return nullptr;
+                }
+                row = mapping->rows[row];
+            }
+            if (row >= parent->children.size()) {
                 return nullptr;
             }
-            return parent->children.constData() + index.row();
+            return parent->children.constData() + row;
+        }
+    }
+
+    QModelIndex topLevelIndex(int position, int column) const final override
+    {
+        const auto& children = rootItem()->children;
+        if (position < 0 || position >= children.size() || !isVisible(children.constData() + position)) {
+            return {};
+        }
+        return indexFromItem(children.constData() + position, column);
+    }
+
+    int topLevelPosition(const QModelIndex& index) const final override
+    {
+        if (!index.isValid()) {
+            return -1;
+        }
+        const auto* item = itemFromIndex(index);
+        const auto& children = rootItem()->children;
+        if (!item || item < children.constData() || item >= children.constData() + children.size()) {
+            return -1;
+        }
+        return std::distance(children.constData(), item);
+    }
+
+    void sort(int column, Qt::SortOrder order) final override
+    {
+        changeLayout([this, column, order]() {
+            m_sortColumn = column;
+            m_sortOrder = order;
+        });
+    }
+
+    QString filterText() const
+    {
+        return m_filterText;
+    }
+
+    /**
+     * Only show items whose symbol or binary contains @p filterText (case insensitive), their ancestors and
+     * their direct children. Unlike the recursive proxy that was used before, this includes matching leaves.
+     * Matching runs in the background, the layout gets updated once it finished.
+     */
+    void setFilterText(const QString& filterText)
+    {
+        if (filterText == m_filterText) {
+            return;
+        }
+        m_filterText = filterText;
+        updateFilter();
+    }
+
+protected:
+    // to be called while resetting the model, when the tree got replaced
+    void resetChildMappings()
+    {
+        ++m_filterGeneration;
+        m_mappings.clear();
+        m_visible.clear();
+        m_isFiltered = false;
+    }
+
+    void updateFilter()
+    {
+        const auto generation = ++m_filterGeneration;
+        if (m_filterText.isEmpty()) {
+            if (m_isFiltered) {
+                changeLayout([this]() {
+                    m_visible.clear();
+                    m_isFiltered = false;
+                });
+            }
+            return;
         }
+
+        // the copy shares the child nodes with the model and keeps them alive while the job runs
+        const auto root = *rootItem();
+        const auto needle = m_filterText;
+        runInBackground([this, root, needle, generation]() -> std::function<void()> {
+            QBitArray visible;
+            for (const auto& child : root.children) {
+                markVisible(child, false, needle, &visible);
+            }
+            return [this, visible, generation]() {
+                if (generation != m_filterGeneration) {
+                    return;
+                }
+                changeLayout([this, &visible]() {
+                    m_visible = visible;
+                    m_isFiltered = true;
+                });
+            };
+        });
     }
 
 private:
+    struct ChildMapping
+    {
+        // the indices of the visible children, in the order they are shown
+        QVector<int> rows;
+        // the inverse of rows, -1 for children that are filtered out
+        QVector<int> positions;
+    };
+
+    // returns nullptr when the children are shown unsorted and unfiltered
+    const ChildMapping* childMapping(const TreeNode* item) const
+    {
+        if (m_sortColumn < 0 && !m_isFiltered) {
+            return nullptr;
+        }
+        auto it = m_mappings.constFind(item);
+        if (it == m_mappings.constEnd()) {
+            // sorting lazily means only expanded items ever get sorted
+            it = m_mappings.insert(item, buildChildMapping(item));
+        }
+        return &it.value();
+    }
+
+    ChildMapping buildChildMapping(const TreeNode* item) const
+    {
+        const auto& children = item->children;
+        ChildMapping mapping;
+        mapping.rows.reserve(children.size());
+        for (int i = 0, c = children.size(); i < c; ++i) {
+            if (isVisible(children.constData() + i)) {
+                mapping.rows.append(i);
+            }
+        }
+
+        if (m_sortColumn >= 0 && m_sortColumn < numColumns() && mapping.rows.size() > 1) {
+            sortRows(children, &mapping.rows);
+        }
+
+        mapping.positions.fill(-1, children.size());
+        for (int row = 0, c = mapping.rows.size(); row < c; ++row) {
+            mapping.positions[mapping.rows[row]] = row;
+        }
+        return mapping;
+    }
+
+    void sortRows(const QVector<TreeNode>& children, QVector<int>* rows) const
+    {
+        // query the sort keys once instead of on every comparison
+        QVector<qint64> costs;
+        QVector<QString> texts;
+        const bool sortByText =
+            rowData(children.constData() + rows->first(), m_sortColumn, SortRole).userType() == QMetaType::QString;
+        if (sortByText) {
+            texts.resize(children.size());
+        } else {
+            costs.resize(children.size());
+        }
+        for (int i : qAsConst(*rows)) {
+            const auto key = rowData(children.constData() + i, m_sortColumn, SortRole);
+            if (sortByText) {
+                texts[i] = key.toString();
+            } else {
+                costs[i] = key.toLongLong();
+            }
+        }
+
+        auto lessThan = [&](int lhs, int rhs) { return sortByText ? texts[lhs] < texts[rhs] : costs[lhs] < costs[rhs]; };
+        if (m_sortOrder == Qt::AscendingOrder) {
+            std::stable_sort(rows->begin(), rows->end(), lessThan);
+        } else {
+            std::stable_sort(rows->begin(), rows->end(), [&](int lhs, int rhs) { return lessThan(rhs, lhs); });
+        }
+    }
+
+    bool isVisible(const TreeNode* item) const
+    {
+        const auto id = static_cast<int>(item->id);
+        return !m_isFiltered || (id < m_visible.size() && m_visible.testBit(id));
+    }
+
+    // returns true when the node or one of its descendants matches
+    static bool markVisible(const TreeNode& node, bool parentMatches, const QString& needle, QBitArray* visible)
+    {
+        const bool matches = CallerCalleeProxyDetail::match(needle, node.symbol);
+        bool descendantMatches = false;
+        for (const auto& child : node.children) {
+            descendantMatches |= markVisible(child, matches, needle, visible);
+        }
+
+        const auto id = static_cast<int>(node.id);
+        if (id >= visible->size()) {
+            visible->resize(std::max(id + 1, visible->size() * 2));
+        }
+        visible->setBit(id, matches || parentMatches || descendantMatches);
+        return matches || descendantMatches;
+    }
+
+    // keeps the persistent indices valid while the sorting or filtering changes
+    template<typename Change>
+    void changeLayout(Change change)
+    {
+        emit layoutAboutToBeChanged();
+
+        const auto oldIndices = persistentIndexList();
+        QVector<const TreeNode*> items;
+        items.reserve(oldIndices.size());
+        for (const auto& index : oldIndices) {
+            items.append(itemFromIndex(index));
+        }
+
+        change();
+        m_mappings.clear();
+
+        QModelIndexList newIndices;
+        newIndices.reserve(oldIndices.size());
+        for (int i = 0, c = oldIndices.size(); i < c; ++i) {
+            const auto* item = items[i];
+            newIndices.append(item && item != rootItem() ? indexFromItem(item, oldIndices[i].column()) : QModelIndex());
+        }
+        changePersistentIndexList(oldIndices, newIndices);
+
+        emit layoutChanged();
+    }
+
     QModelIndex indexFromItem(const TreeNode* item, int column) const
     {
         if (!item || column < 0 || column >= numColumns()) {
@@ -208,6 +465,12 @@ private:
             Q_ASSERT(parentItem->children.size() == 1);
         } else {
             row = std::distance(parentItem->children.constData(), item);
+            if (const auto* mapping = childMapping(parentItem)) {
+                row = mapping->positions[row];
+                if (row < 0) {
+                    return {};
+                }
+            }
         }
 
         return createIndex(row, column, const_cast<TreeNode*>(parentItem));
@@ -220,6 +483,14 @@ private:
 
     quint64 m_sampleCount = 0;
     bool m_simplify = true;
+    int m_sortColumn = -1;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+    QString m_filterText;
+    bool m_isFiltered = false;
+    // indexed by node id, only valid while m_isFiltered is set
+    QBitArray m_visible;
+    quint64 m_filterGeneration = 0;
+    mutable QHash<const TreeNode*, ChildMapping> m_mappings;
 
     friend class TestModels;
 };
@@ -238,9 +509,12 @@ public:
     using Base::setData;
     void setData(const Results& data)
     {
+        PHASE_TRACE("CostTreeModel::setData");
         QAbstractItemModel::beginResetModel();
         m_results = data;
+        Base::resetChildMappings();
         QAbstractItemModel::endResetModel();
+        Base::updateFilter();
     }
 
     Results results() const
@@ -0,0 +1,225 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "foldedparser.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "parsers/importedprofile.h"
+#include "phasetrace.h"
+
+namespace {
+// smaller inputs are not worth spawning threads for
+const constexpr qint64 MIN_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * The stacks of a part of the file. Every chunk interns its frame names on its own, so the threads never
+ * have to synchronize, the chunks get merged afterwards.
+ */
+struct Chunk
+{
+    QHash<QByteArray, qint32> frameIds;
+    QVector<QByteArray> frames;
+    // stacks are made of the local frame ids, outermost first like in the file
+    QHash<QVector<qint32>, qint32> stackIds;
+    QVector<QVector<qint32>> stacks;
+    QVector<quint64> counts;
+    qint64 invalidLines = 0;
+};
+
+void parseChunk(const char* begin, const char* end, Chunk* chunk)
+{
+    QVector<qint32> stack;
+    while (begin < end) {
+        auto lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        auto line = QByteArray::fromRawData(begin, static_cast<int>(lineEnd - begin));
+        begin = lineEnd + 1;
+
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        // frames may contain spaces, e.g. in C++ signatures, but the count is always last
+        const auto countStart = line.lastIndexOf(' ');
+        bool ok = false;
+        const auto count = countStart > 0 ? line.mid(countStart + 1).toULongLong(&ok) : 0;
+        if (!ok) {
+            ++chunk->invalidLines;
+            continue;
+        }
+
+        stack.clear();
+        int frameStart = 0;
+        while (frameStart < countStart) {
+            auto frameEnd = line.indexOf(';', frameStart);
+            if (frameEnd == -1 || frameEnd > countStart) {
+                frameEnd = countStart;
+            }
+            // only copy the name when we see it for the first time
+            const auto frame = QByteArray::fromRawData(line.constData() + frameStart, frameEnd - frameStart);
+            auto it = chunk->frameIds.constFind(frame);
+            if (it == chunk->frameIds.constEnd()) {
+                const QByteArray name(frame.constData(), frame.size());
+                it = chunk->frameIds.insert(name, chunk->frames.size());
+                chunk->frames.append(name);
+            }
+            stack.append(*it);
+            frameStart = frameEnd + 1;
+        }
+
+        auto stackId = chunk->stackIds.constFind(stack);
+        if (stackId == chunk->stackIds.constEnd()) {
+            stackId = chunk->stackIds.insert(stack, chunk->stacks.size());
+            chunk->stacks.append(stack);
+            chunk->counts.append(0);
+        }
+        chunk->counts[*stackId] += count;
+    }
+}
+
+ImportedProfile::Frame parseFrame(const QByteArray& name)
+{
+    ImportedProfile::Frame frame;
+    auto symbol = QString::fromUtf8(name);
+
+    // annotations of stackcollapse-perf.pl, e.g. _[k] for kernel or _[j] for jitted frames
+    if (symbol.size() > 4 && symbol.endsWith(QLatin1Char(']')) && symbol.at(symbol.size() - 4) == QLatin1Char('_')
+        && symbol.at(symbol.size() - 3) == QLatin1Char('[')) {
+        frame.isKernel = symbol.at(symbol.size() - 2) == QLatin1Char('k');
+        symbol.chop(4);
+    }
+
+    // unresolved frames only name their binary, e.g. [libc.so.6] or [unknown]
+    if (symbol.size() > 2 && symbol.startsWith(QLatin1Char('[')) && symbol.endsWith(QLatin1Char(']'))) {
+        frame.binary = symbol.mid(1, symbol.size() - 2);
+    } else {
+        frame.symbol = symbol;
+    }
+    if (frame.isKernel && frame.binary.isEmpty()) {
+        frame.binary = QStringLiteral("[kernel.kallsyms]");
+    }
+    return frame;
+}
+}
+
+bool FoldedParser::canParse(const QString& path)
+{
+    return path.endsWith(QLatin1String(".folded")) || path.endsWith(QLatin1String(".collapsed"));
+}
+
+QString FoldedParser::parse(const QString& path, ImportedProfile* profile)
+{
+    PHASE_TRACE("FoldedParser::parse");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QCoreApplication::translate("FoldedParser", "Failed to open file %1: %2")
+            .arg(path, file.errorString());
+    }
+
+    // map the file when possible, so that the chunks can be parsed without copying them first
+    QByteArray contents;
+    const char* data = nullptr;
+    const auto size = file.size();
+    if (auto* mapped = file.map(0, size)) {
+        data = reinterpret_cast<const char*>(mapped);
+    } else {
+        contents = file.readAll();
+        data = contents.constData();
+    }
+    const auto* dataEnd = data + size;
+
+    // split the file at line breaks into one chunk per core
+    const auto numChunks =
+        static_cast<int>(qBound(qint64(1), size / MIN_CHUNK_SIZE, qint64(QThread::idealThreadCount())));
+    QVector<const char*> boundaries;
+    boundaries.append(data);
+    for (int i = 1; i < numChunks; ++i) {
+        const auto* boundary = std::max(boundaries.last(), data + size * i / numChunks);
+        const auto* lineEnd = static_cast<const char*>(std::memchr(boundary, '\n', dataEnd - boundary));
+        boundaries.append(lineEnd ? lineEnd + 1 : dataEnd);
+    }
+    boundaries.append(dataEnd);
+
+    std::vector<Chunk> chunks(numChunks);
+    {
+        PHASE_TRACE("FoldedParser::parseChunks");
+        std::vector<std::unique_ptr<QThread>> threads;
+        threads.reserve(numChunks);
+        for (int i = 0; i < numChunks; ++i) {
+            threads.emplace_back(QThread::create(
+                [&chunks, &boundaries, i]() { parseChunk(boundaries[i], boundaries[i + 1], &chunks[i]); }));
+            threads.back()->setObjectName(QStringLiteral("folded parser %1").arg(i));
+            threads.back()->start();
+        }
+        for (auto& thread : threads) {
+            thread->wait();
+        }
+    }
+
+    PHASE_TRACE("FoldedParser::mergeChunks");
+    profile->costTypes = {{QStringLiteral("samples"), Data::Costs::Unit::Unknown}};
+
+    QHash<QByteArray, qint32> frameIds;
+    QHash<QVector<qint32>, qint32> sampleIds;
+    qint64 invalidLines = 0;
+    for (const auto& chunk : chunks) {
+        QVector<qint32> frameMapping;
+        frameMapping.reserve(chunk.frames.size());
+        for (const auto& name : chunk.frames) {
+            auto it = frameIds.constFind(name);
+            if (it == frameIds.constEnd()) {
+                it = frameIds.insert(name, profile->frames.size());
+                profile->frames.append(parseFrame(name));
+            }
+            frameMapping.append(*it);
+        }
+
+        for (int i = 0; i < chunk.stacks.size(); ++i) {
+            const auto& stack = chunk.stacks[i];
+            QVector<qint32> frames;
+            frames.reserve(stack.size());
+            std::transform(stack.crbegin(), stack.crend(), std::back_inserter(frames),
+                           [&frameMapping](qint32 id) { return frameMapping[id]; });
+
+            auto sampleId = sampleIds.constFind(frames);
+            if (sampleId == sampleIds.constEnd()) {
+                sampleId = sampleIds.insert(frames, profile->samples.size());
+                ImportedProfile::Sample sample;
+                sample.frames = frames;
+                sample.costs.append(0);
+                profile->samples.append(sample);
+            }
+            profile->samples[*sampleId].costs[0] += chunk.counts[i];
+        }
+        invalidLines += chunk.invalidLines;
+    }
+
+    if (profile->samples.isEmpty()) {
+        return QCoreApplication::translate("FoldedParser", "No folded stacks found in %1.").arg(path);
+    }
+    if (invalidLines) {
+        qWarning() << "skipped" << invalidLines << "lines without a sample count in" << path;
+    }
+    return {};
+}
@@ -0,0 +1,24 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QString>
+
+struct ImportedProfile;
+
+/**
+ * Reads folded stacks as written by stackcollapse-perf.pl and similar tools, one line per stack with the frames
+ * separated by semicolons, outermost first, followed by a space and the sample count.
+ */
+namespace FoldedParser {
+// decided by the file extension, i.e. .folded or .collapsed
+bool canParse(const QString& path);
+
+// parses the file in chunks on all cores, returns an error message on failure
+QString parse(const QString& path, ImportedProfile* profile);
+}
@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "models/data.h"
+
+/**
+ * A profile written by another sampler, e.g. folded stacks or pprof. The perf parser replays it like the
+ * samples of a recording of a single thread, so all views work on it.
+ */
+struct ImportedProfile
+{
+    struct Frame
+    {
+        QString symbol;
+        QString binary;
+        QString path;
+        QString file;
+        qint32 line = -1;
+        quint64 address = 0;
+        bool isKernel = false;
+        // the frame this one got inlined into, or -1
+        qint32 parent = -1;
+    };
+
+    struct CostType
+    {
+        QString name;
+        Data::Costs::Unit unit = Data::Costs::Unit::Unknown;
+    };
+
+    struct Sample
+    {
+        // indices into frames, innermost first like the frames of perf samples
+        QVector<qint32> frames;
+        // one cost per cost type
+        QVector<quint64> costs;
+    };
+
+    QVector<Frame> frames;
+    QVector<CostType> costTypes;
+    QVector<Sample> samples;
+    // in nanoseconds, both are zero when the format has no timing information
+    quint64 startTime = 0;
+    quint64 duration = 0;
+};
+
+Q_DECLARE_TYPEINFO(ImportedProfile::Frame, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(ImportedProfile::CostType, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(ImportedProfile::Sample, Q_MOVABLE_TYPE);
@@ -0,0 +1,328 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "debuginfodprefetcher.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSaveFile>
+#include <QSet>
+#include <QtEndian>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "phasetrace.h"
+
+namespace {
+// "PERFILE2" read as little endian, see tools/perf/util/header.h
+const constexpr quint64 PERF_MAGIC = 0x32454c4946524550ULL;
+// struct perf_file_header, the header in pipe mode is shorter and has no features
+const constexpr quint64 PERF_HEADER_SIZE = 104;
+const constexpr int HEADER_BUILD_ID = 2;
+const constexpr quint16 PERF_RECORD_MISC_BUILD_ID_SIZE = 1 << 15;
+// struct build_id_event: the event header, the pid and the build-id padded to 24 bytes, followed by the file name
+const constexpr int BUILD_ID_EVENT_SIZE = 8 + 4 + 24;
+const constexpr int MAX_BUILD_ID_SIZE = 20;
+
+struct Section
+{
+    quint64 offset = 0;
+    quint64 size = 0;
+};
+
+QDataStream& operator>>(QDataStream& stream, Section& section)
+{
+    return stream >> section.offset >> section.size;
+}
+}
+
+DebuginfodPrefetcher::DebuginfodPrefetcher(const QStringList& urls, const QString& cachePath, QObject* parent)
+    : QObject(parent)
+    , m_urls(urls)
+    , m_cachePath(cachePath)
+{
+    for (auto& url : m_urls) {
+        while (url.endsWith(QLatin1Char('/'))) {
+            url.chop(1);
+        }
+    }
+
+    QFile cacheMiss(m_cachePath + QLatin1String("/cache_miss_s"));
+    if (cacheMiss.open(QIODevice::ReadOnly)) {
+        bool ok = false;
+        const auto seconds = cacheMiss.readAll().trimmed().toLongLong(&ok);
+        if (ok && seconds >= 0) {
+            m_cacheMissSeconds = seconds;
+        }
+    }
+}
+
+DebuginfodPrefetcher::~DebuginfodPrefetcher() = default;
+
+QVector<QByteArray> DebuginfodPrefetcher::readBuildIds(const QString& perfDataPath)
+{
+    PHASE_TRACE("DebuginfodPrefetcher::readBuildIds");
+
+    QFile file(perfDataPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint64 magic = 0;
+    quint64 headerSize = 0;
+    quint64 attributeSize = 0;
+    Section attributes;
+    Section data;
+    Section eventTypes;
+    quint64 features[4] = {};
+    stream >> magic >> headerSize >> attributeSize >> attributes >> data >> eventTypes;
+    for (auto& bits : features) {
+        stream >> bits;
+    }
+    // recordings of big endian machines are left to hotspot-perfparser
+    if (stream.status() != QDataStream::Ok || magic != PERF_MAGIC || headerSize < PERF_HEADER_SIZE
+        || !(features[0] & (1ULL << HEADER_BUILD_ID))) {
+        return {};
+    }
+
+    // the sections of the features follow the data, in the order of their feature bits
+    int sectionIndex = 0;
+    for (int bit = 0; bit < HEADER_BUILD_ID; ++bit) {
+        if (features[0] & (1ULL << bit)) {
+            ++sectionIndex;
+        }
+    }
+    Section buildIdSection;
+    if (!file.seek(static_cast<qint64>(data.offset + data.size) + sectionIndex * 16)) {
+        return {};
+    }
+    stream >> buildIdSection;
+    if (stream.status() != QDataStream::Ok || !file.seek(static_cast<qint64>(buildIdSection.offset))) {
+        return {};
+    }
+    const auto section = file.read(static_cast<qint64>(buildIdSection.size));
+
+    QVector<QByteArray> buildIds;
+    QSet<QByteArray> seen;
+    const auto* it = section.constData();
+    const auto* end = it + section.size();
+    while (end - it >= BUILD_ID_EVENT_SIZE) {
+        const auto misc = qFromLittleEndian<quint16>(it + 4);
+        const auto size = qFromLittleEndian<quint16>(it + 6);
+        if (size < BUILD_ID_EVENT_SIZE || size > end - it) {
+            break;
+        }
+
+        // older perf versions always write 20 bytes, shorter build-ids are padded with zeros
+        const auto* id = it + 12;
+        auto idSize = (misc & PERF_RECORD_MISC_BUILD_ID_SIZE) ? static_cast<quint8>(id[MAX_BUILD_ID_SIZE])
+                                                                : MAX_BUILD_ID_SIZE;
+        idSize = std::min(idSize, MAX_BUILD_ID_SIZE);
+        const QByteArray buildId(id, idSize);
+        if (std::any_of(buildId.begin(), buildId.end(), [](char c) { return c != 0; }) && !seen.contains(buildId)) {
+            seen.insert(buildId);
+            buildIds.append(buildId);
+        }
+        it += size;
+    }
+    return buildIds;
+}
+
+QString DebuginfodPrefetcher::defaultCachePath()
+{
+    const auto cachePath = qEnvironmentVariable("DEBUGINFOD_CACHE_PATH");
+    if (!cachePath.isEmpty()) {
+        return cachePath;
+    }
+    auto cacheHome = qEnvironmentVariable("XDG_CACHE_HOME");
+    if (cacheHome.isEmpty()) {
+        cacheHome = QDir::homePath() + QLatin1String("/.cache");
+    }
+    return cacheHome + QLatin1String("/debuginfod_client");
+}
+
+QStringList DebuginfodPrefetcher::serverUrls(const QStringList& urls)
+{
+    auto serverUrls = urls;
+    serverUrls += qEnvironmentVariable("DEBUGINFOD_URLS").split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    serverUrls.removeDuplicates();
+    return serverUrls;
+}
+
+QString DebuginfodPrefetcher::cachedDebugInfo(const QByteArray& buildId) const
+{
+    return m_cachePath + QLatin1Char('/') + QString::fromLatin1(buildId.toHex()) + QLatin1String("/debuginfo");
+}
+
+void DebuginfodPrefetcher::setMaxParallelDownloads(int maxParallelDownloads)
+{
+    m_maxParallelDownloads = std::max(1, maxParallelDownloads);
+}
+
+void DebuginfodPrefetcher::setTimeout(int timeout)
+{
+    m_timeout = timeout;
+}
+
+bool DebuginfodPrefetcher::isAvailable(const QByteArray& buildId) const
+{
+    // the debuginfod client marks failed downloads with empty files
+    if (QFileInfo(cachedDebugInfo(buildId)).size() > 0) {
+        return true;
+    }
+    // installed debug packages are found without debuginfod
+    const auto hex = QString::fromLatin1(buildId.toHex());
+    return hex.size() > 2
+        && QFile::exists(QLatin1String("/usr/lib/debug/.build-id/") + hex.left(2) + QLatin1Char('/') + hex.mid(2)
+                         + QLatin1String(".debug"));
+}
+
+bool DebuginfodPrefetcher::isKnownMissing(const QByteArray& buildId) const
+{
+    const QFileInfo info(cachedDebugInfo(buildId));
+    return info.exists() && info.size() == 0
+        && info.lastModified().secsTo(QDateTime::currentDateTime()) < m_cacheMissSeconds;
+}
+
+DebuginfodPrefetcher::Result DebuginfodPrefetcher::prefetch(const QVector<QByteArray>& buildIds)
+{
+    PHASE_TRACE("DebuginfodPrefetcher::prefetch");
+
+    Result result;
+    QVector<QByteArray> missing;
+    QSet<QByteArray> seen;
+    for (const auto& buildId : buildIds) {
+        if (buildId.isEmpty() || seen.contains(buildId)) {
+            continue;
+        }
+        seen.insert(buildId);
+        if (isAvailable(buildId)) {
+            ++result.cached;
+        } else if (isKnownMissing(buildId)) {
+            ++result.failed;
+        } else {
+            missing.append(buildId);
+        }
+    }
+    if (missing.isEmpty() || m_urls.isEmpty()) {
+        result.failed = missing.size();
+        return result;
+    }
+
+    QNetworkAccessManager manager;
+    // servers usually redirect to the ones they federate
+    manager.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    QEventLoop loop;
+
+    const auto progressUrl = m_urls.join(QLatin1String(", "));
+    const auto numMissing = missing.size();
+    int numFinished = 0;
+    int next = 0;
+    int running = 0;
+    emit downloadProgress(progressUrl, 0, numMissing);
+
+    std::function<void(const QByteArray&, int)> download;
+    auto startNext = [&]() {
+        while (running < m_maxParallelDownloads && next < numMissing && !m_stopRequested) {
+            ++running;
+            download(missing[next++], 0);
+        }
+        if (!running) {
+            loop.quit();
+        }
+    };
+
+    // tries the servers one after the other, the file only shows up in the cache once it is complete
+    download = [&](const QByteArray& buildId, int urlIndex) {
+        const auto path = cachedDebugInfo(buildId);
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        auto file = std::make_shared<QSaveFile>(path);
+
+        QNetworkRequest request(QUrl(m_urls[urlIndex] + QLatin1String("/buildid/")
+                                     + QString::fromLatin1(buildId.toHex()) + QLatin1String("/debuginfo")));
+        request.setTransferTimeout(m_timeout);
+        auto* reply = manager.get(request);
+        m_replies.append(reply);
+
+        connect(reply, &QNetworkReply::readyRead, reply, [reply, file]() {
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+                return;
+            }
+            if (!file->isOpen() && !file->open(QIODevice::WriteOnly)) {
+                reply->abort();
+                return;
+            }
+            file->write(reply->readAll());
+        });
+
+        connect(reply, &QNetworkReply::finished, &loop, [&, reply, file, buildId, urlIndex]() {
+            m_replies.removeOne(reply);
+            reply->deleteLater();
+
+            if (reply->error() == QNetworkReply::NoError && file->isOpen()) {
+                file->write(reply->readAll());
+                if (file->commit()) {
+                    ++result.downloaded;
+                } else {
+                    ++result.failed;
+                }
+            } else {
+                if (file->isOpen()) {
+                    file->cancelWriting();
+                }
+                if (urlIndex + 1 < m_urls.size() && !m_stopRequested) {
+                    download(buildId, urlIndex + 1);
+                    return;
+                }
+                if (reply->error() == QNetworkReply::ContentNotFoundError) {
+                    // the empty file records the miss like the debuginfod client does, so that hotspot-perfparser
+                    // doesn't ask every server again while unwinding
+                    QFile marker(file->fileName());
+                    marker.open(QIODevice::WriteOnly);
+                }
+                ++result.failed;
+            }
+
+            --running;
+            emit downloadProgress(progressUrl, ++numFinished, numMissing);
+            startNext();
+        });
+    };
+
+    startNext();
+    if (running) {
+        loop.exec();
+    }
+
+    // the downloads that never started count as failed when we got stopped
+    result.failed += numMissing - numFinished;
+    if (numFinished < numMissing) {
+        emit downloadProgress(progressUrl, numMissing, numMissing);
+    }
+    return result;
+}
+
+void DebuginfodPrefetcher::stop()
+{
+    m_stopRequested = true;
+    // aborting finishes the replies, which removes them from the list
+    const auto replies = m_replies;
+    for (auto* reply : replies) {
+        reply->abort();
+    }
+}
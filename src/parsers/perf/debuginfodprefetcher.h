@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QNetworkReply;
+
+/**
+ * Downloads the debug information of all binaries of a recording concurrently, before hotspot-perfparser starts
+ * unwinding. Otherwise the debuginfod client of elfutils fetches them one by one whenever the unwinding reaches
+ * a binary it has not seen yet.
+ *
+ * The files are stored in the cache layout of the elfutils debuginfod client, i.e. <cache>/<build-id>/debuginfo,
+ * so hotspot-perfparser finds them there and the cache gets reused across runs, also by other tools. Build-ids
+ * that no server has are recorded like the client does, so that hotspot-perfparser doesn't ask for them again.
+ */
+class DebuginfodPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result
+    {
+        // already in the cache or installed locally
+        int cached = 0;
+        int downloaded = 0;
+        // not found on any server, also according to a recent miss in the cache, or the download failed
+        int failed = 0;
+    };
+
+    explicit DebuginfodPrefetcher(const QStringList& urls, const QString& cachePath, QObject* parent = nullptr);
+    ~DebuginfodPrefetcher();
+
+    // reads the build-id feature of a perf.data file, without going through the samples
+    static QVector<QByteArray> readBuildIds(const QString& perfDataPath);
+
+    // $DEBUGINFOD_CACHE_PATH or $XDG_CACHE_HOME/debuginfod_client, like the debuginfod client of elfutils
+    static QString defaultCachePath();
+    // the given servers, followed by those of $DEBUGINFOD_URLS
+    static QStringList serverUrls(const QStringList& urls);
+
+    QString cachedDebugInfo(const QByteArray& buildId) const;
+
+    void setMaxParallelDownloads(int maxParallelDownloads);
+    // in milliseconds, per download without any data being transferred
+    void setTimeout(int timeout);
+
+    // blocks until all missing debug information got downloaded, runs an event loop meanwhile
+    Result prefetch(const QVector<QByteArray>& buildIds);
+
+public slots:
+    // aborts the running downloads, must be called from the thread running prefetch
+    void stop();
+
+signals:
+    // the number of finished downloads, to be shown like the downloads of hotspot-perfparser
+    void downloadProgress(const QString& url, qint64 numerator, qint64 denominator);
+
+private:
+    bool isAvailable(const QByteArray& buildId) const;
+    // the debuginfod client remembers the build-ids that no server has with empty files, for cache_miss_s seconds
+    bool isKnownMissing(const QByteArray& buildId) const;
+
+    QStringList m_urls;
+    QString m_cachePath;
+    int m_maxParallelDownloads = 8;
+    int m_timeout = 90000;
+    qint64 m_cacheMissSeconds = 600;
+    bool m_stopRequested = false;
+    QVector<QNetworkReply*> m_replies;
+};
@@ -0,0 +1,36 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * The types of the events in the QPERFSTREAM format that hotspot-perfparser writes.
+ *
+ * Each event starts with its type as qint8, the order has to match the perfparser.
+ */
+enum class PerfEventType : qint8
+{
+    ThreadStart,
+    ThreadEnd,
+    Command,
+    LocationDefinition,
+    SymbolDefinition,
+    StringDefinition,
+    LostDefinition,
+    FeaturesDefinition,
+    Error,
+    Progress,
+    TracePointFormat,
+    AttributesDefinition,
+    ContextSwitchDefinition,
+    Sample,
+    TracePointSample,
+    DebugInfoDownloadProgress,
+    InvalidType
+};
@@ -10,15 +10,19 @@
 #include <QBuffer>
 #include <QDataStream>
 #include <QDebug>
+#include <QDir>
 #include <QEventLoop>
 #include <QFileInfo>
 #include <QLoggingCategory>
+#include <QMutex>
 #include <QProcess>
 #include <QScopeGuard>
+#include <QStandardPaths>
 #include <QTemporaryFile>
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
+#include <QVariant>
 #include <QtEndian>
 
 #include <KIO/FileCopyJob>
@@ -26,10 +30,19 @@
 #include <ThreadWeaver/ThreadWeaver>
 
 #include <hotspot-config.h>
+#include <phasetrace.h>
 #include <util.h>
 
 #include <functional>
-
+#include <limits>
+#include <memory>
+#include <numeric>
+
+#include "debuginfodprefetcher.h"
+#include "perfeventtype.h"
+#include "parsers/folded/foldedparser.h"
+#include "parsers/importedprofile.h"
+#include "parsers/pprof/pprofparser.h"
 #include "settings.h"
 
 #if KF5Archive_FOUND
@@ -39,6 +52,16 @@
 Q_LOGGING_CATEGORY(LOG_PERFPARSER, "hotspot.perfparser", QtWarningMsg)
 
 namespace {
+// linux never hands out process ids beyond this limit, the bits above keep the ids of merged files apart
+const constexpr qint32 PID_MAX_LIMIT = 4194304;
+const constexpr int MAX_MERGED_FILES = std::numeric_limits<qint32>::max() / PID_MAX_LIMIT;
+// the single thread that imported profiles of other samplers are attributed to
+const constexpr qint32 IMPORTED_PID = 1;
+
+bool isImportedProfile(const QString& path)
+{
+    return FoldedParser::canParse(path) || PprofParser::canParse(path);
+}
 
 struct Record
 {
@@ -307,6 +330,49 @@ QDebug operator<<(QDebug stream, const Sample& sample)
     return stream;
 }
 
+struct TracePointFormat
+{
+    qint32 id = 0;
+    StringId system;
+    StringId name;
+    quint32 flags = 0;
+};
+
+QDataStream& operator>>(QDataStream& stream, TracePointFormat& format)
+{
+    return stream >> format.id >> format.system >> format.name >> format.flags;
+}
+
+QDebug operator<<(QDebug stream, const TracePointFormat& format)
+{
+    stream.noquote().nospace() << "TracePointFormat{"
+                               << "id=" << format.id << ", "
+                               << "system=" << format.system << ", "
+                               << "name=" << format.name << ", "
+                               << "flags=" << format.flags << "}";
+    return stream;
+}
+
+// the decoded payload of a tracepoint sample, the keys are the string ids of the field names
+struct TracePointData
+{
+    qint32 formatId = 0;
+    QHash<qint32, QVariant> fields;
+};
+
+QDataStream& operator>>(QDataStream& stream, TracePointData& data)
+{
+    return stream >> data.formatId >> data.fields;
+}
+
+QDebug operator<<(QDebug stream, const TracePointData& data)
+{
+    stream.noquote().nospace() << "TracePointData{"
+                               << "formatId=" << data.formatId << ", "
+                               << "fields=" << data.fields << "}";
+    return stream;
+}
+
 struct ContextSwitchDefinition : Record
 {
     bool switchOut = false;
@@ -557,6 +623,42 @@ struct SymbolCount
     qint32 total = 0;
     qint32 missing = 0;
 };
+
+// shared by the parser and the re-aggregation of the stored events, the names fall back to the ids when unknown
+template<typename Frames, typename FrameCallback>
+void addAggregatedEvent(Data::BottomUpResults* bottomUp, Settings::CostAggregation costAggregation,
+                        const QString& threadName, qint32 tid, const QString& processName, qint32 pid, quint32 cpu,
+                        int type, quint64 cost, const Frames& frames, const FrameCallback& frameCallback)
+{
+    switch (costAggregation) {
+    case Settings::CostAggregation::BySymbol:
+        bottomUp->addEvent(type, cost, frames, frameCallback);
+        break;
+    case Settings::CostAggregation::ByThread:
+        bottomUp->addEvent(threadName.isEmpty() ? QString::number(tid) : threadName, type, cost, frames,
+                           frameCallback);
+        break;
+    case Settings::CostAggregation::ByProcess:
+        bottomUp->addEvent(processName.isEmpty() ? QString::number(pid) : processName, type, cost, frames,
+                           frameCallback);
+        break;
+    case Settings::CostAggregation::ByCPU:
+        bottomUp->addEvent({QLatin1String("CPU %1").arg(QString::number(cpu))}, type, cost, frames, frameCallback);
+        break;
+    }
+}
+
+// the process names for addAggregatedEvent when re-aggregating stored events, i.e. the names of the main threads
+QHash<qint32, QString> processNames(const Data::EventResults& events)
+{
+    QHash<qint32, QString> names;
+    for (const auto& thread : events.threads) {
+        if (thread.pid == thread.tid) {
+            names[thread.pid] = thread.name;
+        }
+    }
+    return names;
+}
 }
 
 Q_DECLARE_TYPEINFO(AttributesDefinition, Q_MOVABLE_TYPE);
@@ -566,10 +668,13 @@ class PerfParserPrivate : public QObject
 {
     Q_OBJECT
 public:
-    explicit PerfParserPrivate(Settings::CostAggregation costAggregation = Settings::CostAggregation::BySymbol)
+    explicit PerfParserPrivate(Settings::CostAggregation costAggregation = Settings::CostAggregation::BySymbol,
+                               qint64 memoryBudget = 0, QSharedPointer<Data::SpillFile> spillFile = {})
         : QObject(nullptr)
         , stopRequested(false)
         , costAggregation(costAggregation)
+        , memoryBudget(memoryBudget)
+        , spillFile(std::move(spillFile))
     {
         buffer.buffer().reserve(1024);
         buffer.open(QIODevice::ReadOnly);
@@ -584,6 +689,7 @@ public:
     {
         this->input = input;
         connect(input, &QProcess::readyRead, this, [this] {
+            PHASE_TRACE("PerfParserPrivate::parseEvents");
             while (tryParse()) {
                 // just call tryParse until it fails
             }
@@ -642,6 +748,7 @@ public:
                     state = PARSE_ERROR;
                     return false;
                 }
+                enforceMemoryBudget();
                 // await next event
                 state = EVENT_HEADER;
                 eventSize = 0;
@@ -693,8 +800,16 @@ public:
             addRecord(sample);
             addSample(sample);
 
-            if (static_cast<EventType>(eventType) == EventType::TracePointSample)
-                return true; // TODO: read full data
+            if (static_cast<EventType>(eventType) == EventType::TracePointSample) {
+                TracePointData data;
+                stream >> data;
+                qCDebug(LOG_PERFPARSER) << "parsed:" << data;
+                // older parsers don't send the payload, don't fail on that
+                if (stream.status() == QDataStream::Ok) {
+                    addTracePointData(sample, data);
+                }
+                return true;
+            }
             break;
         }
         case EventType::ThreadStart: {
@@ -802,9 +917,13 @@ public:
             emit debugInfoDownloadProgress(strings.value(url.id), numerator, denominator);
             break;
         }
-        case EventType::TracePointFormat:
-            // TODO: implement me
-            return true;
+        case EventType::TracePointFormat: {
+            TracePointFormat format;
+            stream >> format;
+            qCDebug(LOG_PERFPARSER) << "parsed:" << format;
+            addTracePointFormat(format);
+            break;
+        }
         case EventType::InvalidType:
             break;
         }
@@ -820,7 +939,9 @@ public:
 
     void finalize()
     {
+        PHASE_TRACE("PerfParserPrivate::finalize");
         Data::BottomUp::initializeParents(&bottomUpResult.root);
+        bottomUpResult.topRows = Data::topChildren(bottomUpResult.root.children, bottomUpResult.costs);
 
         summaryResult.applicationTime = applicationTime;
         summaryResult.threadCount = uniqueThreads.size();
@@ -830,6 +951,12 @@ public:
         buildPerLibraryResult();
         buildCallerCalleeResult();
 
+        for (auto& core : frequencyResult.cores) {
+            for (auto& costs : core.costs) {
+                costs.buildLevels();
+            }
+        }
+
         for (auto& thread : eventResult.threads) {
             thread.time.start = std::max(thread.time.start, applicationTime.start);
             thread.time.end = std::min(thread.time.end, applicationTime.end);
@@ -858,6 +985,13 @@ public:
 
         eventResult.totalCosts = summaryResult.costs;
 
+        if (memoryBudget) {
+            if (eventResult.memoryUsage() > memoryBudget) {
+                eventResult.spill(spillFile.data(), memoryBudget);
+            }
+            eventResult.makeContiguous(spillFile.data());
+        }
+
         // Add error messages for all modules with missing debug symbols
         for (auto i = numSymbolsByModule.begin(); i != numSymbolsByModule.end(); ++i) {
             const auto& numSymbols = i.value();
@@ -872,6 +1006,221 @@ public:
         }
     }
 
+    // merges the finalized results of several recordings, e.g. segments of perf record --switch-output
+    // or the recordings of different hosts
+    void merge(const std::vector<std::unique_ptr<PerfParserPrivate>>& parsers, const QStringList& paths)
+    {
+        PHASE_TRACE("PerfParserPrivate::merge");
+        const auto numFiles = static_cast<int>(parsers.size());
+
+        // recordings of the same host share their CPU ids, those of different hosts get their own namespace.
+        // recordings without a host name are never assumed to be from the same host
+        QStringList namespaceLabels;
+        QVector<int> namespaceIds;
+        QVector<quint32> namespaceCpus;
+        for (int i = 0; i < numFiles; ++i) {
+            const auto& hostName = parsers[i]->summaryResult.hostName;
+            auto id = hostName.isEmpty() ? -1 : namespaceLabels.indexOf(hostName);
+            if (id == -1) {
+                id = namespaceLabels.size();
+                namespaceLabels.push_back(hostName.isEmpty() ? QFileInfo(paths[i]).fileName() : hostName);
+                namespaceCpus.push_back(0);
+            }
+            namespaceIds.push_back(id);
+            const auto numCpus = std::max(parsers[i]->eventResult.cpus.size(), parsers[i]->frequencyResult.cores.size());
+            namespaceCpus[id] = std::max(namespaceCpus[id], static_cast<quint32>(numCpus));
+        }
+        QVector<quint32> cpuOffsets;
+        quint32 numCpus = 0;
+        for (auto cpus : qAsConst(namespaceCpus)) {
+            cpuOffsets.push_back(numCpus);
+            numCpus += cpus;
+        }
+
+        // cost types are matched by their name, all of them are needed before any costs get merged
+        QHash<QString, qint32> costTypeIds;
+        QVector<Data::MergeMapping> mappings(numFiles);
+        for (int i = 0; i < numFiles; ++i) {
+            const auto& costs = parsers[i]->bottomUpResult.costs;
+            auto& mapping = mappings[i];
+            for (int type = 0; type < costs.numTypes(); ++type) {
+                const auto name = costs.typeName(type);
+                auto it = costTypeIds.find(name);
+                if (it == costTypeIds.end()) {
+                    it = costTypeIds.insert(name, addCostType(name, costs.unit(type)));
+                }
+                mapping.costTypes.push_back(*it);
+            }
+
+            // process and thread ids get reused across recordings, even between the segments of one
+            // recording, so every file gets its own ids
+            mapping.pidOffset = i * PID_MAX_LIMIT;
+            mapping.cpuOffset = cpuOffsets[namespaceIds[i]];
+            if (numFiles > 1) {
+                mapping.threadSuffix = QLatin1String(" (") + QFileInfo(paths[i]).fileName() + QLatin1Char(')');
+            }
+        }
+        callerCalleeResult.selfCosts.initializeCostsFrom(bottomUpResult.costs);
+        callerCalleeResult.inclusiveCosts.initializeCostsFrom(bottomUpResult.costs);
+
+        QVector<bool> namespaceSeen(namespaceLabels.size(), false);
+        QStringList commands;
+        QStringList hostNames;
+
+        // the events that are yet to be merged count against the memory budget too
+        qint64 pendingMemoryUsage = 0;
+        if (memoryBudget) {
+            for (const auto& parser : parsers) {
+                pendingMemoryUsage += parser->eventResult.memoryUsage();
+            }
+        }
+
+        for (int i = 0; i < numFiles; ++i) {
+            auto& d = *parsers[i];
+            auto& mapping = mappings[i];
+            mapping.locationOffset = bottomUpResult.locations.size();
+
+            bottomUpResult.merge(d.bottomUpResult, mapping);
+            callerCalleeResult.merge(d.callerCalleeResult, mapping);
+            if (memoryBudget) {
+                pendingMemoryUsage -= d.eventResult.memoryUsage();
+                eventResult.merge(d.eventResult, mapping, spillFile.data(),
+                                  std::max(memoryBudget - pendingMemoryUsage, qint64(1)));
+            } else {
+                eventResult.merge(d.eventResult, mapping);
+            }
+            // not needed anymore, free the memory before merging the next one
+            d.eventResult = {};
+            tracepointResult.merge(d.tracepointResult, mapping);
+
+            for (int core = 0; core < d.frequencyResult.cores.size(); ++core) {
+                const auto mergedCore = static_cast<int>(core + mapping.cpuOffset);
+                if (frequencyResult.cores.size() <= mergedCore) {
+                    frequencyResult.cores.resize(mergedCore + 1);
+                }
+                auto& costs = frequencyResult.cores[mergedCore].costs;
+                for (const auto& otherCosts : d.frequencyResult.cores[core].costs) {
+                    auto it = std::find_if(costs.begin(), costs.end(), [&otherCosts](const auto& candidate) {
+                        return candidate.costName == otherCosts.costName;
+                    });
+                    if (it == costs.end()) {
+                        costs.push_back(otherCosts);
+                    } else {
+                        it->merge(otherCosts);
+                    }
+                }
+            }
+
+            const auto& summary = d.summaryResult;
+            const auto namespaceId = namespaceIds[i];
+            if (!namespaceSeen[namespaceId]) {
+                namespaceSeen[namespaceId] = true;
+                summaryResult.cpusOnline += summary.cpusOnline;
+                summaryResult.cpusAvailable += summary.cpusAvailable;
+                summaryResult.totalMemoryInKiB += summary.totalMemoryInKiB;
+            }
+            if (i == 0) {
+                summaryResult.linuxKernelVersion = summary.linuxKernelVersion;
+                summaryResult.perfVersion = summary.perfVersion;
+                summaryResult.cpuDescription = summary.cpuDescription;
+                summaryResult.cpuId = summary.cpuId;
+                summaryResult.cpuArchitecture = summary.cpuArchitecture;
+                summaryResult.cpuSiblingCores = summary.cpuSiblingCores;
+                summaryResult.cpuSiblingThreads = summary.cpuSiblingThreads;
+                summaryResult.applicationTime = summary.applicationTime;
+            } else {
+                summaryResult.applicationTime.start =
+                    std::min(summaryResult.applicationTime.start, summary.applicationTime.start);
+                summaryResult.applicationTime.end =
+                    std::max(summaryResult.applicationTime.end, summary.applicationTime.end);
+            }
+            summaryResult.threadCount += summary.threadCount;
+            summaryResult.processCount += summary.processCount;
+            if (!commands.contains(summary.command)) {
+                commands.push_back(summary.command);
+            }
+            if (!summary.hostName.isEmpty() && !hostNames.contains(summary.hostName)) {
+                hostNames.push_back(summary.hostName);
+            }
+            summaryResult.lostChunks += summary.lostChunks;
+            summaryResult.lostEvents += summary.lostEvents;
+            summaryResult.onCpuTime += summary.onCpuTime;
+            summaryResult.offCpuTime += summary.offCpuTime;
+            summaryResult.sampleCount += summary.sampleCount;
+            for (int type = 0; type < summary.costs.size(); ++type) {
+                auto& cost = summaryResult.costs[mapping.costType(type)];
+                cost.sampleCount += summary.costs[type].sampleCount;
+                cost.totalPeriod += summary.costs[type].totalPeriod;
+            }
+            const auto fileName = QFileInfo(paths[i]).fileName();
+            for (const auto& error : summary.errors) {
+                summaryResult.errors.push_back(QStringLiteral("%1: %2").arg(fileName, error));
+            }
+
+            m_numSamplesWithMoreThanOneFrame += d.m_numSamplesWithMoreThanOneFrame;
+        }
+
+        summaryResult.command = commands.join(QLatin1String("; "));
+        summaryResult.hostName = hostNames.join(QLatin1String(", "));
+
+        std::stable_sort(tracepointResult.tracepoints.begin(), tracepointResult.tracepoints.end(),
+                         [](const Data::Tracepoint& lhs, const Data::Tracepoint& rhs) { return lhs.time < rhs.time; });
+    }
+
+    // the counterpart to finalize for the results of merge
+    void finalizeMerge()
+    {
+        PHASE_TRACE("PerfParserPrivate::finalizeMerge");
+        eventResult.totalCosts = summaryResult.costs;
+
+        if (memoryBudget) {
+            if (eventResult.memoryUsage() > memoryBudget) {
+                eventResult.spill(spillFile.data(), memoryBudget);
+            }
+            eventResult.makeContiguous(spillFile.data());
+        }
+
+        if (costAggregation != Settings::CostAggregation::BySymbol) {
+            reaggregateMergedEvents();
+        }
+
+        Data::BottomUp::initializeParents(&bottomUpResult.root);
+        bottomUpResult.topRows = Data::topChildren(bottomUpResult.root.children, bottomUpResult.costs);
+
+        buildTopDownResult();
+        buildPerLibraryResult();
+    }
+
+    // the aggregation roots of every recording use its own thread, process and CPU ids and names, the merged
+    // events got their ids offset and their thread names suffixed. rebuild the roots from the merged events like
+    // PerfParser::filterResults does, otherwise filtering the merged data would change the roots
+    void reaggregateMergedEvents()
+    {
+        PHASE_TRACE("PerfParserPrivate::reaggregateMergedEvents");
+        Data::BottomUpResults bottomUp;
+        bottomUp.symbols = bottomUpResult.symbols;
+        bottomUp.locations = bottomUpResult.locations;
+        bottomUp.costs.initializeCostsFrom(bottomUpResult.costs);
+        bottomUp.costs.clearTotalCost();
+
+        const auto processNames = ::processNames(eventResult);
+        for (const auto& thread : qAsConst(eventResult.threads)) {
+            const auto processName = processNames.value(thread.pid);
+            for (const auto& event : thread.events) {
+                if (event.stackId == -1) {
+                    continue;
+                }
+                addAggregatedEvent(&bottomUp, costAggregation, thread.name, thread.tid, processName, thread.pid,
+                                   event.cpuId, event.type, event.cost, eventResult.stacks.at(event.stackId),
+                                   [](const Data::Symbol&, const Data::Location&) {});
+            }
+        }
+        bottomUpResult = std::move(bottomUp);
+
+        callerCalleeResult = {};
+        buildCallerCalleeResult();
+    }
+
     qint32 addCostType(const QString& label, Data::Costs::Unit unit)
     {
         auto costId = m_nextCostId;
@@ -985,20 +1334,37 @@ public:
 
     qint32 internStack(const QVector<qint32>& frames)
     {
-        auto& id = stacks[frames];
-        if (!id) {
-            Q_ASSERT(stacks.size() == eventResult.stacks.size() + 1);
-            id = stacks.size();
-            eventResult.stacks.push_back(frames);
+        // only the hashes are kept here, the frames may get spilled to disk
+        const auto hash = qHash(frames);
+        for (auto it = stackIdsByHash.constFind(hash); it != stackIdsByHash.cend() && it.key() == hash; ++it) {
+            if (eventResult.stacks.at(*it) == frames) {
+                return *it;
+            }
+        }
+        const auto id = eventResult.stacks.size();
+        eventResult.stacks.push_back(frames);
+        stackIdsByHash.insert(hash, id);
+        return id;
+    }
+
+    void enforceMemoryBudget()
+    {
+        // summing up the memory usage of all threads is too costly to do for every event
+        if (!memoryBudget || ++numEventsSinceBudgetCheck < 4096) {
+            return;
+        }
+        numEventsSinceBudgetCheck = 0;
+        if (eventResult.memoryUsage() > memoryBudget) {
+            eventResult.spill(spillFile.data(), memoryBudget);
         }
-        return id - 1;
     }
 
     void addSampleToFrequencyData(const Sample& sample)
     {
         auto& lastTime = m_lastSampleTimePerCore[sample.cpu];
         auto updateTime = qScopeGuard([&]() { lastTime = sample.time; });
-        if (!lastTime) {
+        // imported profiles have the same time for all samples
+        if (!lastTime || lastTime == sample.time) {
             return;
         }
 
@@ -1020,7 +1386,7 @@ public:
             auto& costs = core.costs[cost.attributeId];
 
             auto frequency = static_cast<double>(cost.cost) / (sample.time - lastTime);
-            costs.values.push_back({sample.time, frequency});
+            costs.addValue(sample.time, frequency);
         }
     }
 
@@ -1047,6 +1413,10 @@ public:
             thread->events.push_back(event);
             cpu.events.push_back(event);
 
+            if (event.type == m_schedSwitchCostId && m_schedSwitchCostId != -1) {
+                lastSchedSwitchStackIds[sample.tid] = event.stackId;
+            }
+
             const auto attribute = attributes.value(event.type);
             if (attribute.type == static_cast<quint32>(AttributesDefinition::Type::Tracepoint)) {
                 Data::Tracepoint tracepoint;
@@ -1067,12 +1437,192 @@ public:
         }
     }
 
+    void addTracePointFormat(const TracePointFormat& format)
+    {
+        tracePointFormatNames[format.id] =
+            strings.value(format.system.id) + QLatin1Char(':') + strings.value(format.name.id);
+    }
+
+    // appends the fields of the sample to the columns of its tracepoint
+    void addTracePointData(const Sample& sample, const TracePointData& data)
+    {
+        auto& columns = tracePointColumns[data.formatId];
+        if (columns.formatIndex == -1) {
+            columns.formatIndex = tracepointResult.formats.size();
+            Data::TracepointFormat format;
+            format.name = tracePointFormatNames.value(data.formatId);
+            if (format.name.isEmpty()) {
+                format.name = QStringLiteral("tracepoint %1").arg(data.formatId);
+            }
+            tracepointResult.formats.push_back(format);
+        }
+
+        auto& format = tracepointResult.formats[columns.formatIndex];
+        const auto sampleIndex = format.size();
+        format.times.push_back(sample.time);
+        format.tids.push_back(sample.tid);
+        format.cpuIds.push_back(sample.cpu);
+
+        for (auto it = data.fields.cbegin(), end = data.fields.cend(); it != end; ++it) {
+            const auto& value = it.value();
+            const auto isString = value.userType() == QMetaType::QByteArray || value.userType() == QMetaType::QString
+                || value.userType() == QMetaType::QVariantList;
+
+            auto fieldIndex = columns.fieldIndices.value(it.key(), -1);
+            if (fieldIndex == -1) {
+                fieldIndex = format.fields.size();
+                columns.fieldIndices.insert(it.key(), fieldIndex);
+                columns.stringIds.push_back({});
+                Data::TracepointField field;
+                field.name = strings.value(it.key());
+                field.isString = isString;
+                format.fields.push_back(field);
+            }
+
+            auto& field = format.fields[fieldIndex];
+            // fields missing in earlier samples are zero
+            field.values.resize(sampleIndex);
+            if (field.isString) {
+                QString string;
+                if (value.userType() == QMetaType::QByteArray) {
+                    // char arrays are zero padded
+                    string = QString::fromUtf8(value.toByteArray().constData());
+                } else if (value.userType() == QMetaType::QVariantList) {
+                    string = value.toStringList().join(QLatin1String(", "));
+                } else {
+                    string = value.toString();
+                }
+                auto& stringIds = columns.stringIds[fieldIndex];
+                auto stringId = stringIds.find(string);
+                if (stringId == stringIds.end()) {
+                    stringId = stringIds.insert(string, field.strings.size());
+                    field.strings.push_back(string);
+                }
+                field.values.push_back(*stringId);
+            } else if (value.userType() == QMetaType::ULongLong) {
+                field.values.push_back(static_cast<qint64>(value.toULongLong()));
+            } else {
+                field.values.push_back(value.toLongLong());
+            }
+        }
+
+        for (auto& field : format.fields) {
+            field.values.resize(sampleIndex + 1);
+        }
+
+        if (format.name == QLatin1String("sched:sched_wakeup")
+            || format.name == QLatin1String("sched:sched_wakeup_new")) {
+            // the sample is taken in the context of the waker, the pid field is the tid of the woken thread
+            if (const auto* wakee = format.field(QStringLiteral("pid"))) {
+                addWakeup(sample, static_cast<qint32>(wakee->values.last()));
+            }
+        }
+    }
+
+    // remembered until the woken thread gets switched in again
+    void addWakeup(const Sample& sample, qint32 wakeeTid)
+    {
+        Data::Wakeup wakeup;
+        wakeup.time = sample.time;
+        wakeup.wakerPid = sample.pid;
+        wakeup.wakerTid = sample.tid;
+        wakeup.wakerStackId = internStack(sample.frames);
+        wakeup.wakerCpuId = sample.cpu;
+        pendingWakeups[wakeeTid] = wakeup;
+    }
+
     void addString(const StringDefinition& string)
     {
         Q_ASSERT(string.id == strings.size());
         strings.push_back(QString::fromUtf8(string.string));
     }
 
+    // replays a profile of another sampler like the events of a recording of a single thread
+    void addImportedProfile(const ImportedProfile& profile, const QString& command)
+    {
+        PHASE_TRACE("PerfParserPrivate::addImportedProfile");
+        QHash<QString, qint32> stringIds;
+        auto addString = [this, &stringIds](const QString& string) {
+            StringId id;
+            id.id = stringIds.value(string, -1);
+            if (id.id == -1) {
+                id.id = strings.size();
+                stringIds.insert(string, id.id);
+                strings.push_back(string);
+            }
+            return id;
+        };
+
+        for (int i = 0; i < profile.costTypes.size(); ++i) {
+            const auto& costType = profile.costTypes[i];
+            AttributesDefinition attributesDefinition;
+            attributesDefinition.id = i;
+            attributesDefinition.name = addString(costType.name);
+            attributeIdsToCostIds[i] = addCostType(costType.name, costType.unit);
+            attributeNameToCostIds.insert(attributesDefinition.name.id, attributeIdsToCostIds[i]);
+            attributes.push_back(attributesDefinition);
+        }
+
+        for (int i = 0; i < profile.frames.size(); ++i) {
+            const auto& frame = profile.frames[i];
+            LocationDefinition locationDefinition;
+            locationDefinition.id = i;
+            locationDefinition.location.address = frame.address;
+            if (!frame.file.isEmpty()) {
+                locationDefinition.location.file = addString(frame.file);
+            }
+            locationDefinition.location.line = frame.line;
+            locationDefinition.location.parentLocationId = frame.parent;
+            addLocation(locationDefinition);
+
+            SymbolDefinition symbolDefinition;
+            symbolDefinition.id = i;
+            symbolDefinition.symbol.name = addString(frame.symbol);
+            symbolDefinition.symbol.binary = addString(frame.binary);
+            symbolDefinition.symbol.path = addString(frame.path);
+            symbolDefinition.symbol.isKernel = frame.isKernel;
+            addSymbol(symbolDefinition);
+        }
+
+        Command commandDefinition;
+        commandDefinition.pid = IMPORTED_PID;
+        commandDefinition.tid = IMPORTED_PID;
+        commandDefinition.comm = addString(command);
+        addCommand(commandDefinition);
+        summaryResult.command = command;
+
+        const auto numSamples = profile.samples.size();
+        for (int i = 0; i < numSamples; ++i) {
+            if (stopRequested) {
+                return;
+            }
+            const auto& importedSample = profile.samples[i];
+            Sample sample;
+            sample.pid = IMPORTED_PID;
+            sample.tid = IMPORTED_PID;
+            sample.time = profile.startTime;
+            sample.frames = importedSample.frames;
+            for (int j = 0; j < importedSample.costs.size(); ++j) {
+                if (importedSample.costs[j]) {
+                    SampleCost sampleCost;
+                    sampleCost.attributeId = j;
+                    sampleCost.cost = importedSample.costs[j];
+                    sample.costs.push_back(sampleCost);
+                }
+            }
+            addRecord(sample);
+            addSample(sample);
+
+            if (i % 4096 == 0) {
+                emit progress(static_cast<float>(i) / numSamples);
+            }
+        }
+
+        if (profile.duration) {
+            applicationTime.end = applicationTime.start + profile.duration;
+        }
+    }
+
     void addSampleToBottomUp(const Sample& sample)
     {
         // TODO: optimize for groups, don't repeat the same lookup multiple times
@@ -1183,16 +1733,9 @@ public:
             totalCost.sampleCount++;
             totalCost.totalPeriod += switchTime;
 
-            qint32 stackId = -1;
-            if (!thread->events.isEmpty() && m_schedSwitchCostId != -1) {
-                auto it = std::find_if(thread->events.rbegin(), thread->events.rend(),
-                                       [this](const Data::Event& event) { return event.type == m_schedSwitchCostId; });
-                if (it != thread->events.rend()) {
-                    stackId = it->stackId;
-                }
-            }
+            const auto stackId = lastSchedSwitchStackIds.value(contextSwitch.tid, -1);
             if (stackId != -1) {
-                const auto& frames = eventResult.stacks[stackId];
+                const auto frames = eventResult.stacks.at(stackId);
                 QSet<Data::Symbol> recursionGuard;
                 auto frameCallback = [this, &recursionGuard, switchTime](const Data::Symbol& symbol,
                                                                          const Data::Location& location) {
@@ -1210,37 +1753,35 @@ public:
             event.stackId = stackId;
             event.cpuId = contextSwitch.cpu;
             thread->events.push_back(event);
+
+            Data::Wakeup wakeup;
+            wakeup.offCpu = {thread->lastSwitchTime, contextSwitch.time};
+            wakeup.stackId = stackId;
+            const auto pending = pendingWakeups.find(contextSwitch.tid);
+            if (pending != pendingWakeups.end()) {
+                if (pending->time >= thread->lastSwitchTime && pending->time <= contextSwitch.time) {
+                    wakeup.time = pending->time;
+                    wakeup.wakerPid = pending->wakerPid;
+                    wakeup.wakerTid = pending->wakerTid;
+                    wakeup.wakerStackId = pending->wakerStackId;
+                    wakeup.wakerCpuId = pending->wakerCpuId;
+                }
+                pendingWakeups.erase(pending);
+            }
+            thread->wakeups.push_back(wakeup);
         }
 
         thread->lastSwitchTime = contextSwitch.time;
         thread->state = contextSwitch.switchOut ? Data::ThreadEvents::OffCpu : Data::ThreadEvents::OnCpu;
     }
 
-    template<typename FrameCallback>
-    void addBottomUpResult(int type, quint64 cost, qint32 pid, qint32 tid, quint32 cpu, const QVector<qint32>& frames,
+    template<typename Frames, typename FrameCallback>
+    void addBottomUpResult(int type, quint64 cost, qint32 pid, qint32 tid, quint32 cpu, const Frames& frames,
                            const FrameCallback& frameCallback)
     {
-        switch (costAggregation) {
-        case Settings::CostAggregation::BySymbol:
-            bottomUpResult.addEvent(type, cost, frames, frameCallback);
-            break;
-        case Settings::CostAggregation::ByThread: {
-            auto thread = commands.value(pid).value(tid);
-            bottomUpResult.addEvent(thread.isEmpty() ? QString::number(tid) : thread, type, cost, frames,
-                                    frameCallback);
-            break;
-        }
-        case Settings::CostAggregation::ByProcess: {
-            auto process = commands.value(pid).value(pid);
-            bottomUpResult.addEvent(process.isEmpty() ? QString::number(pid) : process, type, cost, frames,
-                                    frameCallback);
-            break;
-        }
-        case Settings::CostAggregation::ByCPU:
-            bottomUpResult.addEvent({QLatin1String("CPU %1").arg(QString::number(cpu))}, type, cost, frames,
-                                    frameCallback);
-            break;
-        }
+        const auto threads = commands.value(pid);
+        addAggregatedEvent(&bottomUpResult, costAggregation, threads.value(tid), tid, threads.value(pid), pid, cpu,
+                           type, cost, frames, frameCallback);
     }
 
     void addLost(const LostDefinition& lost)
@@ -1314,26 +1855,7 @@ public:
         PARSE_ERROR
     };
 
-    enum class EventType
-    {
-        ThreadStart,
-        ThreadEnd,
-        Command,
-        LocationDefinition,
-        SymbolDefinition,
-        StringDefinition,
-        LostDefinition,
-        FeaturesDefinition,
-        Error,
-        Progress,
-        TracePointFormat,
-        AttributesDefinition,
-        ContextSwitchDefinition,
-        Sample,
-        TracePointSample,
-        DebugInfoDownloadProgress,
-        InvalidType
-    };
+    using EventType = PerfEventType;
 
     State state = HEADER;
     quint32 eventSize = 0;
@@ -1357,7 +1879,20 @@ public:
     QScopedPointer<QTextStream> perfScriptOutput;
     QHash<qint32, SymbolCount> numSymbolsByModule;
     QSet<QString> encounteredErrors;
-    QHash<QVector<qint32>, qint32> stacks;
+    QMultiHash<uint, qint32> stackIdsByHash;
+    struct TracePointColumns
+    {
+        int formatIndex = -1;
+        // from the string id of the field name to its index in the format
+        QHash<qint32, int> fieldIndices;
+        QVector<QHash<QString, qint64>> stringIds;
+    };
+    QHash<qint32, QString> tracePointFormatNames;
+    QHash<qint32, TracePointColumns> tracePointColumns;
+    // by tid, the stack of the last sched_switch sample, i.e. where the thread went off-CPU
+    QHash<qint32, qint32> lastSchedSwitchStackIds;
+    // by the tid of the woken thread
+    QHash<qint32, Data::Wakeup> pendingWakeups;
     std::atomic<bool> stopRequested;
     QHash<qint32, qint32> attributeIdsToCostIds;
     QHash<int, qint32> attributeNameToCostIds;
@@ -1365,6 +1900,10 @@ public:
     qint32 m_schedSwitchCostId = -1;
     QHash<quint32, quint64> m_lastSampleTimePerCore;
     Settings::CostAggregation costAggregation;
+    // in bytes, zero means unlimited
+    qint64 memoryBudget = 0;
+    QSharedPointer<Data::SpillFile> spillFile;
+    int numEventsSinceBudgetCheck = 0;
 
     // samples recorded without --call-graph have only one frame
     int m_numSamplesWithMoreThanOneFrame = 0;
@@ -1430,7 +1969,7 @@ PerfParser::PerfParser(QObject* parent)
 
     auto parsingStopped = [this] {
         m_isParsing = false;
-        m_decompressed.reset();
+        m_decompressed.clear();
     };
 
     connect(this, &PerfParser::parsingFailed, this, parsingStopped);
@@ -1440,26 +1979,51 @@ PerfParser::PerfParser(QObject* parent)
 PerfParser::~PerfParser() = default;
 
 void PerfParser::startParseFile(const QString& path)
+{
+    startParseFiles({path});
+}
+
+void PerfParser::startParseFiles(const QStringList& paths)
+{
+    parseFiles(paths, false);
+}
+
+void PerfParser::startCompareFiles(const QString& baseline, const QString& comparison)
+{
+    parseFiles({baseline, comparison}, true);
+}
+
+void PerfParser::parseFiles(const QStringList& paths, bool compare)
 {
     Q_ASSERT(!m_isParsing);
+    Q_ASSERT(!paths.isEmpty());
+    Q_ASSERT(!compare || paths.size() == 2);
 
-    QFileInfo info(path);
-    if (!info.exists()) {
-        emit parsingFailed(tr("File '%1' does not exist.").arg(path));
-        return;
-    }
-    if (!info.isFile()) {
-        emit parsingFailed(tr("'%1' is not a file.").arg(path));
-        return;
-    }
-    if (!info.isReadable()) {
-        emit parsingFailed(tr("File '%1' is not readable.").arg(path));
-        return;
+    // the output of hotspot-perfparser is read directly, without the binary
+    auto parserBinary = Util::perfParserBinaryPath();
+
+    for (const auto& path : paths) {
+        QFileInfo info(path);
+        if (!info.exists()) {
+            emit parsingFailed(tr("File '%1' does not exist.").arg(path));
+            return;
+        }
+        if (!info.isFile()) {
+            emit parsingFailed(tr("'%1' is not a file.").arg(path));
+            return;
+        }
+        if (!info.isReadable()) {
+            emit parsingFailed(tr("File '%1' is not readable.").arg(path));
+            return;
+        }
+        if (parserBinary.isEmpty() && !path.endsWith(QLatin1String(".perfparser")) && !isImportedProfile(path)) {
+            emit parsingFailed(tr("Failed to find hotspot-perfparser binary."));
+            return;
+        }
     }
 
-    auto parserBinary = Util::perfParserBinaryPath();
-    if (parserBinary.isEmpty()) {
-        emit parsingFailed(tr("Failed to find hotspot-perfparser binary."));
+    if (paths.size() > MAX_MERGED_FILES) {
+        emit parsingFailed(tr("Cannot merge more than %1 files.").arg(MAX_MERGED_FILES));
         return;
     }
 
@@ -1495,26 +2059,50 @@ void PerfParser::startParseFile(const QString& path)
     };
 
     // reset the data to ensure filtering will pick up the new data
-    m_parserArgs = parserArgs(path);
+    m_decompressed.clear();
+    QVector<QStringList> allParserArgs;
+    allParserArgs.reserve(paths.size());
+    for (const auto& path : paths) {
+        // profiles of other samplers are read directly
+        allParserArgs.push_back(isImportedProfile(path) ? QStringList() : parserArgs(path));
+    }
+    // exporting reruns hotspot-perfparser, which can only write the data of a single file
+    m_parserArgs = paths.size() == 1 ? allParserArgs.constFirst() : QStringList();
     m_bottomUpResults = {};
     m_callerCalleeResults = {};
     m_tracepointResults = {};
     m_events = {};
     m_frequencyResults = {};
+    m_symbolStackIndex = {};
+    m_costCheckpoints = {};
+    m_diffBaseline = {};
+    m_isComparing = compare;
+    const auto diffNormalization = m_diffNormalization;
 
     auto debuginfodUrls = Settings::instance()->debuginfodUrls();
     const auto costAggregation = Settings::instance()->costAggregation();
+    m_costAggregation = static_cast<int>(costAggregation);
+
+    m_memoryBudget = static_cast<qint64>(Settings::instance()->memoryBudget()) * 1024 * 1024;
+    m_spillFile.reset();
+    if (m_memoryBudget) {
+        // the temp dir is often a tmpfs, which would defeat the purpose of spilling
+        auto spillDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (spillDirectory.isEmpty() || !QDir().mkpath(spillDirectory)) {
+            spillDirectory.clear();
+        }
+        m_spillFile = QSharedPointer<Data::SpillFile>::create(spillDirectory);
+    }
+    const auto memoryBudget = m_memoryBudget;
+    const auto spillFile = m_spillFile;
 
     emit parsingStarted();
     using namespace ThreadWeaver;
-    stream() << make_job([path, parserBinary, debuginfodUrls, costAggregation, this]() {
-        PerfParserPrivate d(costAggregation);
-        connect(&d, &PerfParserPrivate::progress, this, &PerfParser::progress);
-        connect(&d, &PerfParserPrivate::debugInfoDownloadProgress, this, &PerfParser::debugInfoDownloadProgress);
-        connect(this, &PerfParser::stopRequested, &d, &PerfParserPrivate::stop);
+    stream() << make_job([paths, compare, allParserArgs, parserBinary, debuginfodUrls, costAggregation, memoryBudget,
+                          spillFile, diffNormalization, this]() {
+        PHASE_TRACE("PerfParser::startParseFile");
 
-        auto finalize = [&d, this]() {
-            d.finalize();
+        auto emitResults = [this](const PerfParserPrivate& d) {
             emit bottomUpDataAvailable(d.bottomUpResult);
             emit topDownDataAvailable(d.topDownResult);
             emit perLibraryDataAvailable(d.perLibraryResult);
@@ -1531,123 +2119,260 @@ void PerfParser::startParseFile(const QString& path)
             }
         };
 
-        if (path.endsWith(QLatin1String(".perfparser"))) {
-            QFile file(path);
-            if (!file.open(QIODevice::ReadOnly)) {
-                emit parsingFailed(tr("Failed to open file %1: %2").arg(path, file.errorString()));
+        if (paths.size() == 1) {
+            PerfParserPrivate d(costAggregation, memoryBudget, spillFile);
+            connect(&d, &PerfParserPrivate::progress, this, &PerfParser::progress);
+            connect(&d, &PerfParserPrivate::debugInfoDownloadProgress, this, &PerfParser::debugInfoDownloadProgress);
+
+            const auto error = parseFile(&d, paths.constFirst(), parserBinary, allParserArgs.constFirst(),
+                                         debuginfodUrls);
+            if (!error.isEmpty()) {
+                emit parsingFailed(error);
                 return;
             }
-            d.setInput(&file);
-            while (!file.atEnd() && !d.stopRequested) {
-                if (!d.tryParse()) {
-                    emit parsingFailed(tr("Failed to parse file"));
-                    return;
+            d.finalize();
+            emitResults(d);
+            return;
+        }
+
+        // run one hotspot-perfparser per file concurrently, then merge their results
+        const auto numFiles = paths.size();
+        std::vector<std::unique_ptr<PerfParserPrivate>> parsers(numFiles);
+        QVector<QString> errors(numFiles);
+        QMutex progressMutex;
+        QVector<float> fileProgress(numFiles, 0.f);
+
+        // every parser runs its own hotspot-perfparser process and debuginfod downloads, so only a bounded
+        // number of files get parsed at once, the next file starts once a worker finished its previous one
+        std::atomic<int> nextFile(0);
+        auto parseNextFiles = [&]() {
+            for (int i = nextFile++; i < numFiles && !m_stopRequested; i = nextFile++) {
+                // the parser must live in the thread that runs the event loop for its process
+                parsers[i] = std::make_unique<PerfParserPrivate>(costAggregation, memoryBudget / numFiles, spillFile);
+                auto* d = parsers[i].get();
+                connect(d, &PerfParserPrivate::progress, d, [&, i, this](float percent) {
+                    QMutexLocker locker(&progressMutex);
+                    fileProgress[i] = percent;
+                    emit progress(std::accumulate(fileProgress.cbegin(), fileProgress.cend(), 0.f) / numFiles);
+                });
+                connect(d, &PerfParserPrivate::debugInfoDownloadProgress, this,
+                        &PerfParser::debugInfoDownloadProgress);
+
+                errors[i] = parseFile(d, paths[i], parserBinary, allParserArgs[i], debuginfodUrls);
+                if (errors[i].isEmpty()) {
+                    d->finalize();
                 }
             }
-            finalize();
-            return;
+        };
+
+        const auto numThreads = std::min(numFiles, std::max(1, QThread::idealThreadCount()));
+        std::vector<std::unique_ptr<QThread>> threads;
+        threads.reserve(numThreads);
+        for (int i = 0; i < numThreads; ++i) {
+            threads.emplace_back(QThread::create(parseNextFiles));
+            threads.back()->setObjectName(QStringLiteral("parser %1").arg(i));
+            threads.back()->start();
+        }
+        for (auto& thread : threads) {
+            thread->wait();
         }
 
-        QProcess process;
-        auto env = Util::appImageEnvironment();
+        if (m_stopRequested) {
+            emit parsingFailed(tr("Parsing stopped."));
+            return;
+        }
+        for (int i = 0; i < numFiles; ++i) {
+            if (!errors[i].isEmpty()) {
+                emit parsingFailed(tr("Failed to parse %1: %2").arg(paths[i], errors[i]));
+                return;
+            }
+        }
 
-        if (!debuginfodUrls.isEmpty()) {
-            const auto envVar = QStringLiteral("DEBUGINFOD_URLS");
-            const auto defaultUrls = env.value(envVar);
-            const auto separator = QLatin1Char(' ');
-            env.insert(envVar, debuginfodUrls.join(separator) + separator + defaultUrls);
+        if (compare) {
+            auto& baseline = *parsers.front();
+            auto& comparison = *parsers.back();
+            // queued like the result signals below, so these are set before the results arrive
+            QMetaObject::invokeMethod(
+                this,
+                [this, baselineResult = baseline.bottomUpResult, comparisonResult = comparison.bottomUpResult]() {
+                    m_diffBaseline = baselineResult;
+                    m_bottomUpResults = comparisonResult;
+                },
+                Qt::QueuedConnection);
+
+            comparison.bottomUpResult = Data::BottomUpResults::diff(baseline.bottomUpResult,
+                                                                    comparison.bottomUpResult, diffNormalization);
+            comparison.callerCalleeResult = {};
+            comparison.buildCallerCalleeResult();
+            comparison.buildTopDownResult();
+            comparison.buildPerLibraryResult();
+            emitResults(comparison);
+            return;
         }
 
-        process.setProcessEnvironment(env);
-        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
-        connect(this, &PerfParser::stopRequested, &process, &QProcess::kill);
+        PerfParserPrivate merged(costAggregation, memoryBudget, spillFile);
+        merged.merge(parsers, paths);
+        parsers.clear();
+        merged.finalizeMerge();
+        emitResults(merged);
+    });
+}
 
-        d.setInput(&process);
+QString PerfParser::parseFile(PerfParserPrivate* d, const QString& path, const QString& parserBinary,
+                              const QStringList& parserArgs, const QStringList& debuginfodUrls)
+{
+    connect(this, &PerfParser::stopRequested, d, &PerfParserPrivate::stop);
 
-        connect(&process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &process,
-                [finalize, this](int exitCode, QProcess::ExitStatus exitStatus) {
-                    if (m_stopRequested) {
-                        emit parsingFailed(tr("Parsing stopped."));
-                        return;
-                    }
-                    qCDebug(LOG_PERFPARSER) << exitCode << exitStatus;
-
-                    enum ErrorCodes
-                    {
-                        NoError,
-                        TcpSocketError,
-                        CannotOpen,
-                        BadMagic,
-                        HeaderError,
-                        DataError,
-                        MissingData,
-                        InvalidOption
-                    };
-                    switch (exitCode) {
-                    case NoError:
-                        finalize();
-                        break;
-                    case TcpSocketError:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (TCP socket error).").arg(exitCode));
-                        break;
-                    case CannotOpen:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (file could not be opened).")
-                                .arg(exitCode));
-                        break;
-                    case BadMagic:
-                    case HeaderError:
-                    case DataError:
-                    case MissingData:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (invalid perf data file).")
-                                .arg(exitCode));
-                        break;
-                    case InvalidOption:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (invalid option).").arg(exitCode));
-                        break;
-                    default:
-                        emit parsingFailed(tr("The hotspot-perfparser binary exited with code %1.").arg(exitCode));
-                        break;
-                    }
-                });
+    if (isImportedProfile(path)) {
+        ImportedProfile profile;
+        const auto error =
+            FoldedParser::canParse(path) ? FoldedParser::parse(path, &profile) : PprofParser::parse(path, &profile);
+        if (!error.isEmpty()) {
+            return error;
+        }
+        d->addImportedProfile(profile, QFileInfo(path).fileName());
+        return {};
+    }
 
-        connect(&process, &QProcess::errorOccurred, &process, [&d, &process, this](QProcess::ProcessError error) {
-            if (m_stopRequested) {
-                emit parsingFailed(tr("Parsing stopped."));
-                return;
+    if (path.endsWith(QLatin1String(".perfparser"))) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return tr("Failed to open file %1: %2").arg(path, file.errorString());
+        }
+        d->setInput(&file);
+        PHASE_TRACE("PerfParserPrivate::parseEvents");
+        while (!file.atEnd() && !d->stopRequested) {
+            if (!d->tryParse()) {
+                return tr("Failed to parse file");
             }
+        }
+        return {};
+    }
 
-            qCWarning(LOG_PERFPARSER) << error << process.errorString();
+    QProcess process;
+    auto env = Util::appImageEnvironment();
 
-            emit parsingFailed(process.errorString());
-        });
+    if (!debuginfodUrls.isEmpty()) {
+        const auto envVar = QStringLiteral("DEBUGINFOD_URLS");
+        const auto defaultUrls = env.value(envVar);
+        const auto separator = QLatin1Char(' ');
+        env.insert(envVar, debuginfodUrls.join(separator) + separator + defaultUrls);
+    }
+
+    // download all debug information up front and concurrently, hotspot-perfparser then finds it in the cache
+    const auto serverUrls = DebuginfodPrefetcher::serverUrls(debuginfodUrls);
+    if (!serverUrls.isEmpty()) {
+        const auto cachePath = DebuginfodPrefetcher::defaultCachePath();
+        env.insert(QStringLiteral("DEBUGINFOD_CACHE_PATH"), cachePath);
+
+        DebuginfodPrefetcher prefetcher(serverUrls, cachePath);
+        connect(this, &PerfParser::stopRequested, &prefetcher, &DebuginfodPrefetcher::stop);
+        connect(&prefetcher, &DebuginfodPrefetcher::downloadProgress, this, &PerfParser::debugInfoDownloadProgress);
+        if (!m_stopRequested) {
+            const auto input = parserArgs.value(parserArgs.indexOf(QStringLiteral("--input")) + 1);
+            const auto result = prefetcher.prefetch(DebuginfodPrefetcher::readBuildIds(input));
+            qCDebug(LOG_PERFPARSER) << "prefetched debug information:" << result.downloaded << "downloaded,"
+                                    << result.cached << "cached," << result.failed << "failed";
+        }
+        if (m_stopRequested) {
+            return tr("Parsing stopped.");
+        }
+    }
+
+    process.setProcessEnvironment(env);
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(this, &PerfParser::stopRequested, &process, &QProcess::kill);
+
+    d->setInput(&process);
+
+    QString error;
+    connect(&process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &process,
+            [&error, this](int exitCode, QProcess::ExitStatus exitStatus) {
+                if (m_stopRequested) {
+                    error = tr("Parsing stopped.");
+                    return;
+                }
+                qCDebug(LOG_PERFPARSER) << exitCode << exitStatus;
+
+                enum ErrorCodes
+                {
+                    NoError,
+                    TcpSocketError,
+                    CannotOpen,
+                    BadMagic,
+                    HeaderError,
+                    DataError,
+                    MissingData,
+                    InvalidOption
+                };
+                switch (exitCode) {
+                case NoError:
+                    break;
+                case TcpSocketError:
+                    error = tr("The hotspot-perfparser binary exited with code %1 (TCP socket error).").arg(exitCode);
+                    break;
+                case CannotOpen:
+                    error = tr("The hotspot-perfparser binary exited with code %1 (file could not be opened).")
+                                .arg(exitCode);
+                    break;
+                case BadMagic:
+                case HeaderError:
+                case DataError:
+                case MissingData:
+                    error = tr("The hotspot-perfparser binary exited with code %1 (invalid perf data file).")
+                                .arg(exitCode);
+                    break;
+                case InvalidOption:
+                    error = tr("The hotspot-perfparser binary exited with code %1 (invalid option).").arg(exitCode);
+                    break;
+                default:
+                    error = tr("The hotspot-perfparser binary exited with code %1.").arg(exitCode);
+                    break;
+                }
+            });
 
-        process.start(parserBinary, m_parserArgs);
-        if (!process.waitForStarted()) {
-            emit parsingFailed(tr("Failed to start the hotspot-perfparser process"));
+    connect(&process, &QProcess::errorOccurred, &process, [&error, &process, this](QProcess::ProcessError processError) {
+        if (m_stopRequested) {
+            error = tr("Parsing stopped.");
             return;
         }
 
-        QEventLoop loop;
-        connect(&process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &loop,
-                &QEventLoop::quit);
-        loop.exec();
+        qCWarning(LOG_PERFPARSER) << processError << process.errorString();
+
+        error = process.errorString();
     });
+
+    process.start(parserBinary, parserArgs);
+    if (!process.waitForStarted()) {
+        return tr("Failed to start the hotspot-perfparser process");
+    }
+
+    QEventLoop loop;
+    connect(&process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &loop,
+            &QEventLoop::quit);
+    loop.exec();
+    return error;
 }
 
-void PerfParser::filterResults(const Data::FilterAction& filter)
+void PerfParser::filterResults(const Data::FilterAction& requestedFilter)
 {
     Q_ASSERT(!m_isParsing);
 
+    // the filters refer to the time line, threads and stacks of the comparison, they can't be mapped onto the
+    // baseline, so when comparing both sides are always diffed as a whole and only the aggregation gets applied
+    const auto filter = m_isComparing ? Data::FilterAction {} : requestedFilter;
+    const auto memoryBudget = m_memoryBudget;
+    const auto spillFile = m_spillFile;
+    const auto costAggregation = Settings::instance()->costAggregation();
+    const auto isComparing = m_isComparing;
+    const auto diffBaseline = m_diffBaseline;
+    const auto diffNormalization = m_diffNormalization;
+
     emit parsingStarted();
     using namespace ThreadWeaver;
-    stream() << make_job([this, filter]() {
-        Queue queue;
-        queue.setMaximumNumberOfThreads(QThread::idealThreadCount());
-
+    stream() << make_job([this, filter, memoryBudget, spillFile, costAggregation, isComparing, diffBaseline,
+                          diffNormalization]() {
+        PHASE_TRACE("PerfParser::filterResults");
         Data::BottomUpResults bottomUp;
         Data::EventResults events = m_events;
         Data::CallerCalleeResults callerCallee;
@@ -1661,11 +2386,18 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
         const bool includeByBinary = !filter.includeBinaries.isEmpty();
         const bool excludeByBinary = !filter.excludeBinaries.isEmpty();
         const bool filterByStack = includeBySymbol || excludeBySymbol || includeByBinary || excludeByBinary;
-
-        if (!filter.isValid()) {
+        const bool filterByThread = filter.processId != Data::INVALID_PID || filter.threadId != Data::INVALID_TID
+            || !filter.excludeProcessIds.isEmpty() || !filter.excludeThreadIds.isEmpty();
+        // the costs of a plain time range get aggregated from the checkpoints instead of replaying every event
+        // the checkpoints keep a copy of all events in memory though, so not when they get spilled to disk
+        const bool useCheckpoints =
+            filterByTime && !filterByThread && !filterByCpu && !excludeByCpu && !filterByStack && !memoryBudget;
+
+        if (!filter.isValid() && static_cast<int>(costAggregation) == m_costAggregation) {
             bottomUp = m_bottomUpResults;
             callerCallee = m_callerCalleeResults;
         } else {
+            PHASE_TRACE("PerfParser::filterEvents");
             bottomUp.symbols = m_bottomUpResults.symbols;
             bottomUp.locations = m_bottomUpResults.locations;
             bottomUp.costs.initializeCostsFrom(m_bottomUpResults.costs);
@@ -1673,101 +2405,103 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             const int numCosts = m_bottomUpResults.costs.numTypes();
 
             // rebuild per-CPU data, i.e. wipe all the events and then re-add them
-            for (auto& cpu : events.cpus) {
-                cpu.events.clear();
+            // the checkpoints only need the per-CPU events cut to the time range, see below
+            if (!useCheckpoints) {
+                for (auto& cpu : events.cpus) {
+                    cpu.events.clear();
+                }
             }
 
+            // the aggregation is applied to the stored events, changing it does not require parsing again
+            const auto processNames = ::processNames(m_events);
+
             // we filter all available stacks and then remember the stack ids that should be
             // included, which is hopefully less work than filtering the stack for every event
+            // the inverted symbol index is built once per import, afterwards every filter is
+            // just a couple of set operations on sorted stack id lists
             QVector<bool> filterStacks;
             if (filterByStack) {
-                filterStacks.resize(m_events.stacks.size());
-
-                const auto threadCount = queue.maximumNumberOfThreads();
-                const auto jobsPerThread = m_events.stacks.size() / threadCount;
-
-                auto filterStack = [&filter, &filterStacks, this](int start, int stop) {
-                    for (qint32 stackId = start, c = stop; stackId < c; ++stackId) {
-                        //  if empty, then all include filters are matched
-                        auto includedSymbols = filter.includeSymbols;
-                        auto includedBinaries = filter.includeBinaries;
-                        // if false, then none of the exclude filters matched
-                        bool excluded = false;
-                        m_bottomUpResults.foreachFrame(
-                            m_events.stacks.at(stackId),
-                            [&includedSymbols, &includedBinaries, &excluded,
-                             &filter](const Data::Symbol& symbol, const Data::Location& /*location*/) {
-                                excluded = filter.excludeSymbols.contains(symbol);
-                                if (excluded) {
-                                    return false;
-                                }
-                                includedSymbols.remove(symbol);
-
-                                excluded = filter.excludeBinaries.contains(symbol.binary);
-                                if (excluded) {
-                                    return false;
-                                }
-                                includedBinaries.remove(symbol.binary);
-
-                                // only stop when we included everything and no exclude filter is
-                                // set
-                                return !includedSymbols.isEmpty() || !filter.excludeSymbols.isEmpty()
-                                    || includedBinaries.isEmpty() || !filter.excludeBinaries.isEmpty();
-                            });
-                        filterStacks[stackId] = !excluded && includedSymbols.isEmpty() && includedBinaries.isEmpty();
-                    }
-                };
-
-                for (int i = 0; i < threadCount - 1; i++) {
-                    queue.stream() << make_job(
-                        [filterStack, i, jobsPerThread] { filterStack(i * jobsPerThread, (i + 1) * jobsPerThread); });
+                if (m_symbolStackIndex.isEmpty()) {
+                    m_symbolStackIndex = Data::SymbolStackIndex::fromStacks(m_bottomUpResults, m_events.stacks);
                 }
+                filterStacks = m_symbolStackIndex.filterStacks(filter);
+            }
 
-                queue.stream() << make_job([filterStack, threadCount, jobsPerThread, this] {
-                    filterStack((threadCount - 1) * jobsPerThread, m_events.stacks.size());
-                });
+            if (useCheckpoints
+                && (m_costCheckpoints.isEmpty() || m_costCheckpointsAggregation != static_cast<int>(costAggregation))) {
+                m_costCheckpoints = Data::CostCheckpoints::fromEvents(
+                    m_events, [costAggregation](const Data::ThreadEvents& thread, const Data::Event& event) -> qint64 {
+                        switch (costAggregation) {
+                        case Settings::CostAggregation::BySymbol:
+                            break;
+                        case Settings::CostAggregation::ByThread:
+                            return thread.tid;
+                        case Settings::CostAggregation::ByProcess:
+                            return thread.pid;
+                        case Settings::CostAggregation::ByCPU:
+                            return event.cpuId;
+                        }
+                        return 0;
+                    });
+                m_costCheckpointsAggregation = static_cast<int>(costAggregation);
             }
 
             if (filterByTime) {
-                auto it = std::remove_if(
-                    tracepointResults.tracepoints.begin(), tracepointResults.tracepoints.end(),
-                    [filter](const Data::Tracepoint& tracepoint) { return !filter.time.contains(tracepoint.time); });
-                tracepointResults.tracepoints.erase(it, tracepointResults.tracepoints.end());
+                tracepointResults.filterByTime(filter.time);
 
                 for (auto& core : frequencyResults.cores) {
                     for (auto& costType : core.costs) {
-
-                        auto frequencyIt = std::remove_if(
-                            costType.values.begin(), costType.values.end(),
-                            [filter](const Data::FrequencyData& point) { return !filter.time.contains(point.time); });
-                        costType.values.erase(frequencyIt, costType.values.end());
+                        costType.filterByTime(filter.time);
                     }
                 }
             }
 
-            queue.finish();
-
-            // remove events that lie outside the selected time span
-            // TODO: parallelize
-            for (auto& thread : events.threads) {
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
-                    return;
+            if (useCheckpoints) {
+                PHASE_TRACE("PerfParser::restrictEvents");
+                // the events are sorted by time, so they are cut to the time range without looking at every one
+                // of them. the windows share the stored events, the views only copy them when they modify them
+                auto restrictEvents = [&filter](Data::Events* events) {
+                    const auto begin = std::lower_bound(
+                        events->begin(), events->end(), filter.time.start,
+                        [](const Data::Event& event, quint64 time) { return event.time < time; });
+                    const auto end =
+                        std::upper_bound(begin, events->end(), filter.time.end,
+                                         [](quint64 time, const Data::Event& event) { return time < event.time; });
+                    *events = events->mid(static_cast<int>(begin - events->begin()), static_cast<int>(end - begin));
+                };
+                for (auto& thread : events.threads) {
+                    restrictEvents(&thread.events);
+                    auto it = std::remove_if(thread.wakeups.begin(), thread.wakeups.end(),
+                                             [filter](const Data::Wakeup& wakeup) {
+                                                 return !filter.time.contains(wakeup.offCpu.end);
+                                             });
+                    thread.wakeups.erase(it, thread.wakeups.end());
                 }
-
-                if ((filter.processId != Data::INVALID_PID && thread.pid != filter.processId)
-                    || (filter.threadId != Data::INVALID_TID && thread.tid != filter.threadId)
-                    || (filterByTime && (thread.time.start > filter.time.end || thread.time.end < filter.time.start))
-                    || filter.excludeProcessIds.contains(thread.pid) || filter.excludeThreadIds.contains(thread.tid)) {
-                    thread.events.clear();
-                    continue;
+                for (auto& cpu : events.cpus) {
+                    restrictEvents(&cpu.events);
                 }
+            } else {
+                // remove events that lie outside the selected time span
+                // TODO: parallelize
+                for (auto& thread : events.threads) {
+                    if (m_stopRequested) {
+                        emit parsingFailed(tr("Parsing stopped."));
+                        return;
+                    }
 
-                if (filterByTime || filterByCpu || excludeByCpu || filterByStack) {
-                    auto it = std::remove_if(
-                        thread.events.begin(), thread.events.end(),
-                        [filter, filterByTime, filterByCpu, excludeByCpu, filterByStack,
-                         filterStacks](const Data::Event& event) {
+                    if ((filter.processId != Data::INVALID_PID && thread.pid != filter.processId)
+                        || (filter.threadId != Data::INVALID_TID && thread.tid != filter.threadId)
+                        || (filterByTime
+                            && (thread.time.start > filter.time.end || thread.time.end < filter.time.start))
+                        || filter.excludeProcessIds.contains(thread.pid)
+                        || filter.excludeThreadIds.contains(thread.tid)) {
+                        thread.events.clear();
+                        continue;
+                    }
+
+                    if (filterByTime || filterByCpu || excludeByCpu || filterByStack) {
+                        thread.events.removeIf([filter, filterByTime, filterByCpu, excludeByCpu, filterByStack,
+                                                filterStacks](const Data::Event& event) {
                             if (filterByTime && !filter.time.contains(event.time)) {
                                 return true;
                             } else if (filterByCpu && event.cpuId != filter.cpuId) {
@@ -1779,35 +2513,76 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
                             }
                             return false;
                         });
-                    thread.events.erase(it, thread.events.end());
-                }
+                    }
 
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
-                    return;
-                }
+                    if (filterByTime) {
+                        auto it = std::remove_if(thread.wakeups.begin(), thread.wakeups.end(),
+                                                 [filter](const Data::Wakeup& wakeup) {
+                                                     return !filter.time.contains(wakeup.offCpu.end);
+                                                 });
+                        thread.wakeups.erase(it, thread.wakeups.end());
+                    }
+
+                    if (m_stopRequested) {
+                        emit parsingFailed(tr("Parsing stopped."));
+                        return;
+                    }
 
-                // add event data to cpus, bottom up and caller callee sets
-                for (const auto& event : thread.events) {
-                    // only add non-time events to the cpu line, context switches shouldn't show up there
-                    if (event.type == events.lostEventCostId) {
-                        // the lost event never has a valid cpu set, add to all CPUs
-                        for (auto& cpu : events.cpus)
-                            cpu.events.push_back(event);
-                    } else if (event.type != events.offCpuTimeCostId) {
-                        events.cpus[event.cpuId].events.push_back(event);
+                    // add event data to cpus, bottom up and caller callee sets
+                    for (const auto& event : thread.events) {
+                        // only add non-time events to the cpu line, context switches shouldn't show up there
+                        if (event.type == events.lostEventCostId) {
+                            // the lost event never has a valid cpu set, add to all CPUs
+                            for (auto& cpu : events.cpus)
+                                cpu.events.push_back(event);
+                        } else if (event.type != events.offCpuTimeCostId) {
+                            events.cpus[event.cpuId].events.push_back(event);
+                        }
+
+                        if (event.stackId == -1) {
+                            continue;
+                        }
+
+                        QSet<Data::Symbol> recursionGuard;
+                        auto frameCallback = [&callerCallee, &recursionGuard, &event,
+                                              numCosts](const Data::Symbol& symbol, const Data::Location& location) {
+                            addCallerCalleeEvent(symbol, location, event.type, event.cost, &recursionGuard,
+                                                 &callerCallee, numCosts);
+                        };
+
+                        addAggregatedEvent(&bottomUp, costAggregation, thread.name, thread.tid,
+                                           processNames.value(thread.pid), thread.pid, event.cpuId, event.type,
+                                           event.cost, events.stacks.at(event.stackId), frameCallback);
                     }
 
+                    if (memoryBudget && events.memoryUsage() > memoryBudget) {
+                        events.spill(spillFile.data(), memoryBudget);
+                    }
+                }
+            }
+            events.makeContiguous(spillFile.data());
+
+            if (useCheckpoints) {
+                PHASE_TRACE("PerfParser::aggregateCheckpoints");
+                // every slot is a distinct stack, so this is proportional to the number of stacks in the time range
+                const auto slotCosts = m_costCheckpoints.costs(filter.time);
+                for (int slotId = 0, numSlots = slotCosts.size(); slotId < numSlots; ++slotId) {
+                    const auto cost = slotCosts[slotId];
+                    if (!cost) {
+                        continue;
+                    }
+                    const auto& slot = m_costCheckpoints.slots[slotId];
+                    const auto& thread = m_events.threads[slot.threadIndex];
+
                     QSet<Data::Symbol> recursionGuard;
-                    auto frameCallback = [&callerCallee, &recursionGuard, &event,
+                    auto frameCallback = [&callerCallee, &recursionGuard, &slot, cost,
                                           numCosts](const Data::Symbol& symbol, const Data::Location& location) {
-                        addCallerCalleeEvent(symbol, location, event.type, event.cost, &recursionGuard, &callerCallee,
+                        addCallerCalleeEvent(symbol, location, slot.type, cost, &recursionGuard, &callerCallee,
                                              numCosts);
                     };
-
-                    if (event.stackId != -1) {
-                        bottomUp.addEvent(event.type, event.cost, events.stacks.at(event.stackId), frameCallback);
-                    }
+                    addAggregatedEvent(&bottomUp, costAggregation, thread.name, thread.tid,
+                                       processNames.value(thread.pid), thread.pid, slot.cpuId, slot.type, cost,
+                                       m_events.stacks.at(slot.stackId), frameCallback);
                 }
             }
 
@@ -1817,6 +2592,7 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             events.threads.erase(it, events.threads.end());
 
             Data::BottomUp::initializeParents(&bottomUp.root);
+            bottomUp.topRows = Data::topChildren(bottomUp.root.children, bottomUp.costs);
 
             if (m_stopRequested) {
                 emit parsingFailed(tr("Parsing stopped."));
@@ -1827,6 +2603,12 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
         }
 
+        if (isComparing) {
+            bottomUp = Data::BottomUpResults::diff(diffBaseline, bottomUp, diffNormalization);
+            callerCallee = {};
+            Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
+        }
+
         if (m_stopRequested) {
             emit parsingFailed(tr("Parsing stopped."));
             return;
@@ -1912,8 +2694,6 @@ void PerfParser::exportResults(const QUrl& url)
 QString PerfParser::decompressIfNeeded(const QString& path)
 {
 #if KF5Archive_FOUND
-    m_decompressed = std::make_unique<QTemporaryFile>(this);
-
     KCompressionDevice compressedFile(path);
 
     if (compressedFile.compressionType() == KCompressionDevice::None) {
@@ -1921,7 +2701,9 @@ QString PerfParser::decompressIfNeeded(const QString& path)
     }
 
     if (compressedFile.open(QIODevice::ReadOnly)) {
-        m_decompressed->open();
+        m_decompressed.push_back(std::make_unique<QTemporaryFile>(this));
+        auto& decompressed = m_decompressed.back();
+        decompressed->open();
 
         const int chunkSize = 1024 * 100;
 
@@ -1930,12 +2712,12 @@ QString PerfParser::decompressIfNeeded(const QString& path)
 
         while (!compressedFile.atEnd()) {
             int size = compressedFile.read(buffer.data(), buffer.size());
-            m_decompressed->write(buffer.data(), size);
+            decompressed->write(buffer.data(), size);
         }
-        m_decompressed->flush();
+        decompressed->flush();
 
         compressedFile.close();
-        return m_decompressed->fileName();
+        return decompressed->fileName();
     }
 #endif
     // fallback
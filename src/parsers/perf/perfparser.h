@@ -9,12 +9,14 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 #include <QObject>
 
 #include <models/data.h>
 
 class QUrl;
 class QTemporaryFile;
+class PerfParserPrivate;
 
 // TODO: create a parser interface
 class PerfParser : public QObject
@@ -25,9 +27,41 @@ public:
     ~PerfParser();
 
     void startParseFile(const QString& path);
+    // parses all files concurrently and merges them into a single profile
+    void startParseFiles(const QStringList& paths);
+    // parses both files concurrently, the results show how the costs changed from the baseline to the comparison
+    void startCompareFiles(const QString& baseline, const QString& comparison);
 
+    // also re-aggregates the stored events when the cost aggregation changed since the import
+    // the filter is ignored while comparing, it can't be applied to the baseline
     void filterResults(const Data::FilterAction& filter);
 
+    bool isParsing() const
+    {
+        return m_isParsing;
+    }
+
+    // only recordings parsed by hotspot-perfparser can be exported, not merged ones or imported profiles
+    bool canExport() const
+    {
+        return !m_parserArgs.isEmpty();
+    }
+
+    bool isComparing() const
+    {
+        return m_isComparing;
+    }
+
+    // the cost type whose total the baseline gets scaled to when comparing, or -1, applied by filterResults
+    void setDiffNormalization(int type)
+    {
+        m_diffNormalization = type;
+    }
+    int diffNormalization() const
+    {
+        return m_diffNormalization;
+    }
+
     void stop();
 
     void exportResults(const QUrl& url);
@@ -66,16 +100,36 @@ signals:
 
 private:
     friend class TestPerfParser;
+    void parseFiles(const QStringList& paths, bool compare);
     QString decompressIfNeeded(const QString& path);
+    // blocks until the file got parsed, returns the error message on failure
+    QString parseFile(PerfParserPrivate* d, const QString& path, const QString& parserBinary,
+                      const QStringList& parserArgs, const QStringList& debuginfodUrls);
 
     // only set once after the initial startParseFile finished
     QStringList m_parserArgs;
+    // when comparing, these are the results of the comparison recording before diffing
     Data::BottomUpResults m_bottomUpResults;
     Data::CallerCalleeResults m_callerCalleeResults;
     Data::TracepointResults m_tracepointResults;
     Data::EventResults m_events;
     Data::FrequencyResults m_frequencyResults;
+    // lazily built on the first symbol or binary filter after an import
+    Data::SymbolStackIndex m_symbolStackIndex;
+    // lazily built on the first time range filter after an import, or after the aggregation changed
+    Data::CostCheckpoints m_costCheckpoints;
+    // the Settings::CostAggregation of m_costCheckpoints, the parser doesn't depend on the settings otherwise
+    int m_costCheckpointsAggregation = 0;
+    // in bytes, zero when events are never spilled to disk
+    qint64 m_memoryBudget = 0;
+    // the Settings::CostAggregation of m_bottomUpResults
+    int m_costAggregation = 0;
+    QSharedPointer<Data::SpillFile> m_spillFile;
+    // only the bottom up results of the baseline are kept, the events are those of the comparison
+    Data::BottomUpResults m_diffBaseline;
+    bool m_isComparing = false;
+    int m_diffNormalization = -1;
     std::atomic<bool> m_isParsing;
     std::atomic<bool> m_stopRequested;
-    std::unique_ptr<QTemporaryFile> m_decompressed;
+    std::vector<std::unique_ptr<QTemporaryFile>> m_decompressed;
 };
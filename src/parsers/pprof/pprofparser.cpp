@@ -0,0 +1,450 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pprofparser.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+
+#include <hotspot-config.h>
+
+#include <algorithm>
+
+#if KF5Archive_FOUND
+#include <KArchive/KCompressionDevice>
+#endif
+
+#include "parsers/importedprofile.h"
+#include "phasetrace.h"
+
+namespace {
+QString tr(const char* text)
+{
+    return QCoreApplication::translate("PprofParser", text);
+}
+
+/**
+ * Decodes the protobuf wire format, just enough to walk the fields of a message.
+ */
+class ProtobufReader
+{
+public:
+    enum WireType
+    {
+        Varint = 0,
+        Fixed64 = 1,
+        LengthDelimited = 2,
+        Fixed32 = 5
+    };
+
+    ProtobufReader(const char* begin, const char* end)
+        : m_data(begin)
+        , m_end(end)
+    {
+    }
+
+    bool hasError() const
+    {
+        return m_hasError;
+    }
+
+    // returns false at the end of the message or on errors
+    bool readField(quint32* field, quint32* wireType)
+    {
+        if (m_hasError || m_data >= m_end) {
+            return false;
+        }
+        const auto key = readVarint();
+        *field = static_cast<quint32>(key >> 3);
+        *wireType = static_cast<quint32>(key & 7);
+        return !m_hasError;
+    }
+
+    quint64 readVarint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_data >= m_end) {
+                break;
+            }
+            const auto byte = static_cast<quint8>(*m_data++);
+            value |= quint64(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        m_hasError = true;
+        return 0;
+    }
+
+    ProtobufReader readMessage()
+    {
+        const auto size = readVarint();
+        if (m_hasError || size > static_cast<quint64>(m_end - m_data)) {
+            m_hasError = true;
+            return {m_end, m_end};
+        }
+        const auto* begin = m_data;
+        m_data += size;
+        return {begin, m_data};
+    }
+
+    QByteArray readBytes()
+    {
+        const auto message = readMessage();
+        return QByteArray(message.m_data, static_cast<int>(message.m_end - message.m_data));
+    }
+
+    // repeated integers are usually packed, but may also be written one by one
+    void readVarints(quint32 wireType, QVector<quint64>* values)
+    {
+        if (wireType == Varint) {
+            values->append(readVarint());
+            return;
+        }
+        if (wireType != LengthDelimited) {
+            skip(wireType);
+            return;
+        }
+        auto packed = readMessage();
+        while (packed.m_data < packed.m_end && !packed.m_hasError) {
+            values->append(packed.readVarint());
+        }
+        m_hasError |= packed.m_hasError;
+    }
+
+    void skip(quint32 wireType)
+    {
+        switch (wireType) {
+        case Varint:
+            readVarint();
+            return;
+        case Fixed64:
+            advance(8);
+            return;
+        case LengthDelimited:
+            readMessage();
+            return;
+        case Fixed32:
+            advance(4);
+            return;
+        }
+        // groups are deprecated and never used by pprof
+        m_hasError = true;
+    }
+
+private:
+    void advance(qint64 size)
+    {
+        if (size > m_end - m_data) {
+            m_hasError = true;
+            return;
+        }
+        m_data += size;
+    }
+
+    const char* m_data;
+    const char* m_end;
+    bool m_hasError = false;
+};
+
+// the messages of profile.proto, strings are indices into the string table
+struct Line
+{
+    quint64 functionId = 0;
+    qint64 line = 0;
+};
+
+struct Location
+{
+    quint64 mappingId = 0;
+    quint64 address = 0;
+    // innermost first, the last line is the function all others got inlined into
+    QVector<Line> lines;
+};
+
+struct Mapping
+{
+    qint64 fileName = 0;
+};
+
+struct Function
+{
+    qint64 name = 0;
+    qint64 fileName = 0;
+};
+
+struct ValueType
+{
+    qint64 type = 0;
+    qint64 unit = 0;
+};
+
+struct Sample
+{
+    QVector<quint64> locationIds;
+    QVector<quint64> values;
+};
+
+ValueType readValueType(ProtobufReader reader)
+{
+    ValueType valueType;
+    quint32 field = 0;
+    quint32 wireType = 0;
+    while (reader.readField(&field, &wireType)) {
+        if (field == 1 && wireType == ProtobufReader::Varint) {
+            valueType.type = static_cast<qint64>(reader.readVarint());
+        } else if (field == 2 && wireType == ProtobufReader::Varint) {
+            valueType.unit = static_cast<qint64>(reader.readVarint());
+        } else {
+            reader.skip(wireType);
+        }
+    }
+    return valueType;
+}
+}
+
+bool PprofParser::canParse(const QString& path)
+{
+    return path.endsWith(QLatin1String(".pprof")) || path.endsWith(QLatin1String(".pb"))
+        || path.endsWith(QLatin1String(".pb.gz"));
+}
+
+QString PprofParser::parse(const QString& path, ImportedProfile* profile)
+{
+    PHASE_TRACE("PprofParser::parse");
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return tr("Failed to open file %1: %2").arg(path, file.errorString());
+    }
+
+    auto data = file.readAll();
+    // profiles are gzip compressed by default
+    if (data.startsWith("\x1f\x8b")) {
+#if KF5Archive_FOUND
+        QBuffer buffer(&data);
+        KCompressionDevice decompressed(&buffer, false, KCompressionDevice::GZip);
+        if (!decompressed.open(QIODevice::ReadOnly)) {
+            return tr("Failed to decompress %1: %2").arg(path, decompressed.errorString());
+        }
+        data = decompressed.readAll();
+#else
+        return tr("Cannot read the compressed profile %1, hotspot was built without KArchive.").arg(path);
+#endif
+    }
+
+    return parse(data, profile);
+}
+
+QString PprofParser::parse(const QByteArray& data, ImportedProfile* profile)
+{
+    QVector<QString> strings;
+    QVector<ValueType> sampleTypes;
+    QVector<Sample> samples;
+    QHash<quint64, Mapping> mappings;
+    QHash<quint64, Location> locations;
+    // keep the order of the file, so that the frames are stable
+    QVector<quint64> locationOrder;
+    QHash<quint64, Function> functions;
+
+    ProtobufReader reader(data.constData(), data.constData() + data.size());
+    quint32 field = 0;
+    quint32 wireType = 0;
+    while (reader.readField(&field, &wireType)) {
+        if (wireType != ProtobufReader::LengthDelimited) {
+            switch (field) {
+            case 9: // time_nanos
+                profile->startTime = reader.readVarint();
+                break;
+            case 10: // duration_nanos
+                profile->duration = reader.readVarint();
+                break;
+            default:
+                reader.skip(wireType);
+                break;
+            }
+            continue;
+        }
+
+        if (field == 6) { // string_table
+            strings.append(QString::fromUtf8(reader.readBytes()));
+            continue;
+        }
+
+        auto message = reader.readMessage();
+        quint32 messageField = 0;
+        quint32 messageWireType = 0;
+        switch (field) {
+        case 1: // sample_type
+            sampleTypes.append(readValueType(message));
+            break;
+        case 2: { // sample
+            Sample sample;
+            while (message.readField(&messageField, &messageWireType)) {
+                if (messageField == 1) {
+                    message.readVarints(messageWireType, &sample.locationIds);
+                } else if (messageField == 2) {
+                    message.readVarints(messageWireType, &sample.values);
+                } else {
+                    message.skip(messageWireType);
+                }
+            }
+            samples.append(sample);
+            break;
+        }
+        case 3: { // mapping
+            quint64 id = 0;
+            Mapping mapping;
+            while (message.readField(&messageField, &messageWireType)) {
+                if (messageField == 1 && messageWireType == ProtobufReader::Varint) {
+                    id = message.readVarint();
+                } else if (messageField == 5 && messageWireType == ProtobufReader::Varint) {
+                    mapping.fileName = static_cast<qint64>(message.readVarint());
+                } else {
+                    message.skip(messageWireType);
+                }
+            }
+            mappings.insert(id, mapping);
+            break;
+        }
+        case 4: { // location
+            quint64 id = 0;
+            Location location;
+            while (message.readField(&messageField, &messageWireType)) {
+                if (messageField == 1 && messageWireType == ProtobufReader::Varint) {
+                    id = message.readVarint();
+                } else if (messageField == 2 && messageWireType == ProtobufReader::Varint) {
+                    location.mappingId = message.readVarint();
+                } else if (messageField == 3 && messageWireType == ProtobufReader::Varint) {
+                    location.address = message.readVarint();
+                } else if (messageField == 4 && messageWireType == ProtobufReader::LengthDelimited) {
+                    auto lineMessage = message.readMessage();
+                    Line line;
+                    quint32 lineField = 0;
+                    quint32 lineWireType = 0;
+                    while (lineMessage.readField(&lineField, &lineWireType)) {
+                        if (lineField == 1 && lineWireType == ProtobufReader::Varint) {
+                            line.functionId = lineMessage.readVarint();
+                        } else if (lineField == 2 && lineWireType == ProtobufReader::Varint) {
+                            line.line = static_cast<qint64>(lineMessage.readVarint());
+                        } else {
+                            lineMessage.skip(lineWireType);
+                        }
+                    }
+                    location.lines.append(line);
+                } else {
+                    message.skip(messageWireType);
+                }
+            }
+            locations.insert(id, location);
+            locationOrder.append(id);
+            break;
+        }
+        case 5: { // function
+            quint64 id = 0;
+            Function function;
+            while (message.readField(&messageField, &messageWireType)) {
+                if (messageField == 1 && messageWireType == ProtobufReader::Varint) {
+                    id = message.readVarint();
+                } else if (messageField == 2 && messageWireType == ProtobufReader::Varint) {
+                    function.name = static_cast<qint64>(message.readVarint());
+                } else if (messageField == 4 && messageWireType == ProtobufReader::Varint) {
+                    function.fileName = static_cast<qint64>(message.readVarint());
+                } else {
+                    message.skip(messageWireType);
+                }
+            }
+            functions.insert(id, function);
+            break;
+        }
+        default:
+            break;
+        }
+        if (message.hasError()) {
+            return tr("Invalid pprof profile, field %1 is corrupted.").arg(field);
+        }
+    }
+    if (reader.hasError()) {
+        return tr("Invalid pprof profile, the data is truncated.");
+    }
+    if (sampleTypes.isEmpty() || samples.isEmpty()) {
+        return tr("The pprof profile contains no samples.");
+    }
+
+    // the string table is usually written last, so the strings can only get resolved now
+    auto string = [&strings](qint64 index) { return strings.value(static_cast<int>(index)); };
+
+    for (const auto& sampleType : qAsConst(sampleTypes)) {
+        ImportedProfile::CostType costType;
+        costType.name = string(sampleType.type);
+        const auto unit = string(sampleType.unit);
+        if (unit == QLatin1String("nanoseconds")) {
+            costType.unit = Data::Costs::Unit::Time;
+        } else if (!unit.isEmpty() && unit != QLatin1String("count")) {
+            costType.name += QLatin1String(" [") + unit + QLatin1Char(']');
+        }
+        profile->costTypes.append(costType);
+    }
+
+    // every line of a location becomes a frame, the inlined ones point to the frame they got inlined into
+    QHash<quint64, qint32> locationFrames;
+    locationFrames.reserve(locations.size());
+    for (const auto id : qAsConst(locationOrder)) {
+        const auto& location = locations[id];
+        const auto mappingFile = string(mappings.value(location.mappingId).fileName);
+        auto addFrame = [&](const QString& symbol, const QString& file, qint64 line) {
+            ImportedProfile::Frame frame;
+            frame.symbol = symbol;
+            frame.path = mappingFile;
+            frame.binary = mappingFile.isEmpty() ? QStringLiteral("[unknown]") : QFileInfo(mappingFile).fileName();
+            frame.isKernel = mappingFile.startsWith(QLatin1String("[kernel"));
+            frame.file = file;
+            frame.line = line > 0 ? static_cast<qint32>(line) : -1;
+            frame.address = location.address;
+            profile->frames.append(frame);
+        };
+
+        locationFrames.insert(id, profile->frames.size());
+        if (location.lines.isEmpty()) {
+            addFrame({}, {}, 0);
+            continue;
+        }
+        for (int i = 0; i < location.lines.size(); ++i) {
+            const auto& line = location.lines[i];
+            const auto function = functions.value(line.functionId);
+            addFrame(string(function.name), string(function.fileName), line.line);
+            if (i + 1 < location.lines.size()) {
+                profile->frames.last().parent = profile->frames.size();
+            }
+        }
+    }
+
+    profile->samples.reserve(samples.size());
+    for (const auto& sample : qAsConst(samples)) {
+        ImportedProfile::Sample importedSample;
+        importedSample.frames.reserve(sample.locationIds.size());
+        for (const auto locationId : sample.locationIds) {
+            const auto frame = locationFrames.value(locationId, -1);
+            if (frame == -1) {
+                return tr("Invalid pprof profile, unknown location %1.").arg(locationId);
+            }
+            importedSample.frames.append(frame);
+        }
+        importedSample.costs.reserve(sampleTypes.size());
+        for (int i = 0; i < sampleTypes.size(); ++i) {
+            // values are signed, e.g. in the differences of pprof -diff_base, which we cannot represent
+            const auto value = static_cast<qint64>(sample.values.value(i));
+            importedSample.costs.append(static_cast<quint64>(std::max(qint64(0), value)));
+        }
+        profile->samples.append(importedSample);
+    }
+    return {};
+}
@@ -0,0 +1,27 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QString>
+
+class QByteArray;
+
+struct ImportedProfile;
+
+/**
+ * Reads the protobuf profiles of pprof, e.g. as written by the Go runtime or gperftools, optionally gzip compressed.
+ * Only the fields needed for the call stacks and their costs are decoded, see profile.proto.
+ */
+namespace PprofParser {
+// decided by the file extension, i.e. .pprof, .pb or .pb.gz
+bool canParse(const QString& path);
+
+// returns an error message on failure
+QString parse(const QString& path, ImportedProfile* profile);
+QString parse(const QByteArray& data, ImportedProfile* profile);
+}
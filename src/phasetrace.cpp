@@ -0,0 +1,146 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "phasetrace.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+#include <chrono>
+
+namespace {
+// keeps a forgotten trace from growing without bounds
+const int MAX_EVENTS = 1000000;
+
+struct Registry
+{
+    QMutex mutex;
+    // the time of Detail::now() the events are relative to, scopes that started earlier got cleared
+    qint64 epoch = -1;
+    QVector<PhaseTrace::Event> events;
+    QVector<PhaseTrace::Thread> threads;
+    // invalidates the thread ids cached by the threads on clear()
+    int generation = 0;
+};
+
+Q_GLOBAL_STATIC(Registry, registry)
+
+struct ThreadId
+{
+    int id = -1;
+    int generation = -1;
+};
+
+thread_local ThreadId currentThread;
+
+// call with the mutex locked
+int threadId(Registry* registry)
+{
+    if (currentThread.generation != registry->generation) {
+        currentThread.id = registry->threads.size();
+        currentThread.generation = registry->generation;
+
+        auto name = QThread::currentThread()->objectName();
+        if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+            name = QStringLiteral("main");
+        } else if (name.isEmpty()) {
+            name = QStringLiteral("worker %1").arg(currentThread.id);
+        }
+        registry->threads.append({currentThread.id, name});
+    }
+    return currentThread.id;
+}
+}
+
+namespace PhaseTrace {
+namespace Detail {
+std::atomic<bool> enabled {false};
+
+qint64 now()
+{
+    // doesn't touch the registry, so that it can't race with clear()
+    const auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+void record(const char* name, qint64 start)
+{
+    const auto end = now();
+    auto* r = registry();
+    QMutexLocker locker(&r->mutex);
+    if (r->epoch < 0 || start < r->epoch || r->events.size() >= MAX_EVENTS) {
+        return;
+    }
+    r->events.append({name, threadId(r), (start - r->epoch) / 1000, (end - start) / 1000});
+}
+}
+
+void setEnabled(bool enabled)
+{
+    auto* r = registry();
+    QMutexLocker locker(&r->mutex);
+    if (enabled && r->epoch < 0) {
+        r->epoch = Detail::now();
+    }
+    Detail::enabled = enabled;
+}
+
+void clear()
+{
+    auto* r = registry();
+    QMutexLocker locker(&r->mutex);
+    r->events.clear();
+    r->threads.clear();
+    ++r->generation;
+    r->epoch = Detail::now();
+}
+
+QVector<Event> events()
+{
+    auto* r = registry();
+    QMutexLocker locker(&r->mutex);
+    return r->events;
+}
+
+QVector<Thread> threads()
+{
+    auto* r = registry();
+    QMutexLocker locker(&r->mutex);
+    return r->threads;
+}
+
+QByteArray toChromeTrace(const QVector<Event>& events, const QVector<Thread>& threads)
+{
+    const auto pid = static_cast<qint64>(QCoreApplication::applicationPid());
+
+    QJsonArray traceEvents;
+    for (const auto& thread : threads) {
+        traceEvents.append(QJsonObject {{QStringLiteral("name"), QStringLiteral("thread_name")},
+                                        {QStringLiteral("ph"), QStringLiteral("M")},
+                                        {QStringLiteral("pid"), pid},
+                                        {QStringLiteral("tid"), thread.id},
+                                        {QStringLiteral("args"), QJsonObject {{QStringLiteral("name"), thread.name}}}});
+    }
+    for (const auto& event : events) {
+        traceEvents.append(QJsonObject {{QStringLiteral("name"), QString::fromUtf8(event.name)},
+                                        {QStringLiteral("cat"), QStringLiteral("hotspot")},
+                                        {QStringLiteral("ph"), QStringLiteral("X")},
+                                        {QStringLiteral("ts"), event.start},
+                                        {QStringLiteral("dur"), event.duration},
+                                        {QStringLiteral("pid"), pid},
+                                        {QStringLiteral("tid"), event.threadId}});
+    }
+
+    return QJsonDocument(QJsonObject {{QStringLiteral("traceEvents"), traceEvents},
+                                      {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")}})
+        .toJson(QJsonDocument::Compact);
+}
+}
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+/**
+ * Traces the phases of hotspot itself, e.g. parsing, building the results and updating the views.
+ *
+ * Scopes only get timed while tracing is enabled, otherwise they cost a relaxed atomic load.
+ * The phases can be exported in the Chrome trace event format, to be viewed in chrome://tracing
+ * or ui.perfetto.dev.
+ */
+namespace PhaseTrace {
+struct Event
+{
+    // the string literal passed to the scope
+    const char* name = nullptr;
+    int threadId = 0;
+    // in microseconds since tracing got enabled or cleared
+    qint64 start = 0;
+    qint64 duration = 0;
+};
+
+struct Thread
+{
+    int id = 0;
+    QString name;
+};
+
+namespace Detail {
+extern std::atomic<bool> enabled;
+// in nanoseconds of a steady clock
+qint64 now();
+void record(const char* name, qint64 start);
+}
+
+inline bool isEnabled()
+{
+    return Detail::enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled);
+void clear();
+
+QVector<Event> events();
+QVector<Thread> threads();
+
+QByteArray toChromeTrace(const QVector<Event>& events, const QVector<Thread>& threads);
+
+class Scope
+{
+public:
+    explicit Scope(const char* name)
+        : m_name(name)
+        , m_start(isEnabled() ? Detail::now() : -1)
+    {
+    }
+
+    ~Scope()
+    {
+        if (m_start >= 0) {
+            Detail::record(m_name, m_start);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_name;
+    qint64 m_start;
+};
+}
+
+#define PHASE_TRACE_CONCAT_IMPL(a, b) a##b
+#define PHASE_TRACE_CONCAT(a, b) PHASE_TRACE_CONCAT_IMPL(a, b)
+// traces the rest of the enclosing scope, name must be a string literal
+#define PHASE_TRACE(name) const PhaseTrace::Scope PHASE_TRACE_CONCAT(phaseTraceScope, __LINE__)(name)
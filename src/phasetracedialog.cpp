@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "phasetracedialog.h"
+
+#include <QCheckBox>
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QHash>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "phasetrace.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace {
+enum Columns
+{
+    PhaseColumn,
+    CallsColumn,
+    TotalColumn,
+    MaximumColumn,
+    NUM_COLUMNS
+};
+
+// sorts by the raw durations instead of the formatted strings
+class PhaseItem : public QTreeWidgetItem
+{
+public:
+    bool operator<(const QTreeWidgetItem& other) const override
+    {
+        const auto column = treeWidget()->sortColumn();
+        if (column == PhaseColumn) {
+            return QTreeWidgetItem::operator<(other);
+        }
+        return data(column, Qt::UserRole).toLongLong() < other.data(column, Qt::UserRole).toLongLong();
+    }
+};
+
+struct PhaseStats
+{
+    qint64 calls = 0;
+    qint64 total = 0;
+    qint64 maximum = 0;
+};
+}
+
+PhaseTraceDialog::PhaseTraceDialog(QWidget* parent)
+    : QDialog(parent)
+    , m_enabled(new QCheckBox(tr("Record analysis phases"), this))
+    , m_phases(new QTreeWidget(this))
+{
+    setWindowTitle(tr("Analysis Performance"));
+
+    m_enabled->setToolTip(tr("Measure how long parsing, filtering and updating the views take. "
+                             "Recording can also be enabled by setting HOTSPOT_PHASE_TRACE to the path of a trace "
+                             "file that gets written on exit."));
+    connect(m_enabled, &QCheckBox::toggled, this, [](bool enabled) { PhaseTrace::setEnabled(enabled); });
+
+    m_phases->setColumnCount(NUM_COLUMNS);
+    m_phases->setHeaderLabels({tr("Phase"), tr("Calls"), tr("Total"), tr("Maximum")});
+    m_phases->setRootIsDecorated(false);
+    m_phases->setSortingEnabled(true);
+    m_phases->header()->setSectionResizeMode(PhaseColumn, QHeaderView::Stretch);
+    m_phases->header()->setStretchLastSection(false);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    auto* refreshButton = buttons->addButton(tr("Refresh"), QDialogButtonBox::ActionRole);
+    connect(refreshButton, &QPushButton::clicked, this, &PhaseTraceDialog::refresh);
+    auto* clearButton = buttons->addButton(tr("Clear"), QDialogButtonBox::ResetRole);
+    connect(clearButton, &QPushButton::clicked, this, [this]() {
+        PhaseTrace::clear();
+        refresh();
+    });
+    auto* exportButton = buttons->addButton(tr("Export Chrome Trace..."), QDialogButtonBox::ActionRole);
+    connect(exportButton, &QPushButton::clicked, this, &PhaseTraceDialog::exportChromeTrace);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addWidget(m_enabled);
+    layout->addWidget(m_phases);
+    layout->addWidget(buttons);
+
+    resize(600, 400);
+}
+
+PhaseTraceDialog::~PhaseTraceDialog() = default;
+
+void PhaseTraceDialog::refresh()
+{
+    m_enabled->setChecked(PhaseTrace::isEnabled());
+
+    // the names are string literals, but the same literal may have different addresses across translation units
+    QHash<QByteArray, PhaseStats> stats;
+    const auto events = PhaseTrace::events();
+    for (const auto& event : events) {
+        auto& phase = stats[QByteArray(event.name)];
+        ++phase.calls;
+        phase.total += event.duration;
+        phase.maximum = std::max(phase.maximum, event.duration);
+    }
+
+    m_phases->clear();
+    for (auto it = stats.cbegin(), end = stats.cend(); it != end; ++it) {
+        auto* item = new PhaseItem;
+        item->setText(PhaseColumn, QString::fromUtf8(it.key()));
+        auto setDuration = [item](int column, qint64 microseconds) {
+            item->setText(column, Util::formatTimeString(static_cast<quint64>(microseconds) * 1000));
+            item->setData(column, Qt::UserRole, microseconds);
+        };
+        item->setText(CallsColumn, QString::number(it->calls));
+        item->setData(CallsColumn, Qt::UserRole, it->calls);
+        setDuration(TotalColumn, it->total);
+        setDuration(MaximumColumn, it->maximum);
+        m_phases->addTopLevelItem(item);
+    }
+    m_phases->sortByColumn(TotalColumn, Qt::DescendingOrder);
+}
+
+void PhaseTraceDialog::showEvent(QShowEvent* event)
+{
+    refresh();
+    QDialog::showEvent(event);
+}
+
+void PhaseTraceDialog::exportChromeTrace()
+{
+    const auto path = QFileDialog::getSaveFileName(this, tr("Export Chrome Trace"), QStringLiteral("hotspot-trace.json"),
+                                                   tr("Chrome Trace (*.json)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, tr("Export Failed"),
+                             tr("Failed to open %1 for writing: %2").arg(path, file.errorString()));
+        return;
+    }
+    file.write(PhaseTrace::toChromeTrace(PhaseTrace::events(), PhaseTrace::threads()));
+}
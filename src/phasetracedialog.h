@@ -0,0 +1,36 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QDialog>
+
+class QCheckBox;
+class QTreeWidget;
+
+/**
+ * Shows how long hotspot spent in its own phases, e.g. parsing or building the flame graph,
+ * and exports them as Chrome trace.
+ */
+class PhaseTraceDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit PhaseTraceDialog(QWidget* parent = nullptr);
+    ~PhaseTraceDialog();
+
+    void refresh();
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private:
+    void exportChromeTrace();
+
+    QCheckBox* m_enabled;
+    QTreeWidget* m_phases;
+};
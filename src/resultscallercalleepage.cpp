@@ -90,9 +90,12 @@ ResultsCallerCalleePage::ResultsCallerCalleePage(FilterAndZoomStack* filterStack
         ResultsUtil::hideEmptyColumns(data.selfCosts, ui->callerCalleeTableView,
                                       CallerCalleeModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
         ResultsUtil::hideTracepointColumns(data.selfCosts, ui->callerCalleeTableView, BottomUpModel::NUM_BASE_COLUMNS);
+        // the model gets updated in place, keep the selection and sorting of the user when filtering
         auto view = ui->callerCalleeTableView;
-        view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
-        view->setCurrentIndex(view->model()->index(0, 0, {}));
+        if (!view->currentIndex().isValid()) {
+            view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
+            view->setCurrentIndex(view->model()->index(0, 0, {}));
+        }
         ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callersView, CallerModel::NUM_BASE_COLUMNS);
         ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->calleesView, CalleeModel::NUM_BASE_COLUMNS);
         ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->sourceMapView, SourceMapModel::NUM_BASE_COLUMNS);
@@ -164,6 +167,15 @@ ResultsCallerCalleePage::ResultsCallerCalleePage(FilterAndZoomStack* filterStack
                 }
             });
 
+    // the current row stays when the results change, but its callers and callees need to be updated
+    connect(m_callerCalleeCostModel, &QAbstractItemModel::dataChanged, this,
+            [this, selectCallerCaleeeIndex](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+                const auto current = m_callerCalleeProxy->mapToSource(ui->callerCalleeTableView->currentIndex());
+                if (current.isValid() && current.row() >= topLeft.row() && current.row() <= bottomRight.row()) {
+                    selectCallerCaleeeIndex(current);
+                }
+            });
+
     ResultsUtil::setupResultsAggregation(ui->costAggregationComboBox);
 }
 
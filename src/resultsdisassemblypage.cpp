@@ -9,14 +9,17 @@
 #include "resultsdisassemblypage.h"
 #include "ui_resultsdisassemblypage.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QListWidgetItem>
 #include <QMenu>
 #include <QMessageBox>
+#include <QPointer>
 #include <QProcess>
 #include <QString>
 #include <QTemporaryFile>
@@ -25,11 +28,13 @@
 #include <QStandardPaths>
 
 #include <KRecursiveFilterProxyModel>
+#include <ThreadWeaver/ThreadWeaver>
 
 #include "parsers/perf/perfparser.h"
 #include "resultsutil.h"
 
 #include "data.h"
+#include "models/controlflowgraph.h"
 #include "models/costdelegate.h"
 #include "models/disassemblydelegate.h"
 #include "models/disassemblymodel.h"
@@ -37,6 +42,12 @@
 #include "models/topproxy.h"
 #include "models/treemodel.h"
 
+namespace {
+// the number of hottest symbols that get disassembled in the background once the results are available
+const int NUM_PREFETCHED_SYMBOLS = 10;
+const int NUM_HOTTEST_LOOPS = 3;
+}
+
 ResultsDisassemblyPage::ResultsDisassemblyPage(QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::ResultsDisassemblyPage)
@@ -44,6 +55,8 @@ ResultsDisassemblyPage::ResultsDisassemblyPage(QWidget* parent)
     , m_costDelegate(new CostDelegate(DisassemblyModel::CostRole, DisassemblyModel::TotalCostRole, this))
     , m_disassemblyDelegate(new DisassemblyDelegate(this))
 {
+    m_disassemblyCache.setMaxCost(500000);
+
     ui->setupUi(this);
     ui->asmView->setModel(m_model);
 
@@ -64,6 +77,18 @@ ResultsDisassemblyPage::ResultsDisassemblyPage(QWidget* parent)
                     }
                 }
             });
+
+    // the links are offsets of the loop headers, relative to the entry of the function
+    ui->loopsLabel->hide();
+    connect(ui->loopsLabel, &QLabel::linkActivated, this, [this](const QString& link) {
+        ui->asmView->scrollTo(m_model->findIndexWithOffset(link.toInt()), QAbstractItemView::ScrollHint::PositionAtTop);
+    });
+
+    // clicking a cost column, or a cell in it, selects the cost type of the hottest loops
+    ui->asmView->header()->setSectionsClickable(true);
+    connect(ui->asmView->header(), &QHeaderView::sectionClicked, this, &ResultsDisassemblyPage::selectCostColumn);
+    connect(ui->asmView->selectionModel(), &QItemSelectionModel::currentChanged, this,
+            [this](const QModelIndex& current) { selectCostColumn(current.column()); });
 }
 
 ResultsDisassemblyPage::~ResultsDisassemblyPage() = default;
@@ -94,24 +119,196 @@ void ResultsDisassemblyPage::showDisassembly()
         clear();
     }
 
+    m_curKey = DisassemblyOutput::CacheKey::forSymbol(objdump(), m_curSymbol);
+    if (const auto* disassemblyOutput = m_disassemblyCache.object(m_curKey)) {
+        showDisassembly(*disassemblyOutput);
+        return;
+    }
+
+    // slicing the disassembly out of an index is cheap enough to do it right away
+    const auto index = m_disassemblyIndices.value(DisassemblyIndex::indexPath(objdump(), m_curSymbol.actualPath));
+    if (index.isValid()) {
+        const auto disassemblyOutput = index.disassemble(m_curSymbol);
+        if (disassemblyOutput) {
+            onDisassemblyFinished(m_curKey, disassemblyOutput);
+            return;
+        }
+    }
+
+    // the view gets updated once objdump finished
+    m_model->clear();
+    ui->symbolLabel->setText(tr("Disassembling symbol:  %1").arg(Util::formatSymbol(m_curSymbol)));
+    ui->errorMessage->hide();
+    ui->loopsLabel->hide();
+    scheduleDisassembly(m_curSymbol);
+    requestIndex(m_curSymbol);
+}
+
+QString ResultsDisassemblyPage::objdump() const
+{
+    if (!m_objdump.isEmpty())
+        return m_objdump;
+
     // TODO: add the ability to configure the arch <-> objdump mapping somehow in the settings
-    const auto objdump = [this]() {
-        if (!m_objdump.isEmpty())
-            return m_objdump;
+    if (m_arch.startsWith(QLatin1String("armv8")) || m_arch.startsWith(QLatin1String("aarch64"))) {
+        return QStringLiteral("aarch64-linux-gnu-objdump");
+    }
+    const auto isArm = m_arch.startsWith(QLatin1String("arm"));
+    return isArm ? QStringLiteral("arm-linux-gnueabi-objdump") : QStringLiteral("objdump");
+}
 
-        if (m_arch.startsWith(QLatin1String("armv8")) || m_arch.startsWith(QLatin1String("aarch64"))) {
-            return QStringLiteral("aarch64-linux-gnu-objdump");
+void ResultsDisassemblyPage::scheduleDisassembly(const Data::Symbol& symbol)
+{
+    const auto objdump = this->objdump();
+    const auto key = DisassemblyOutput::CacheKey::forSymbol(objdump, symbol);
+    if (m_pendingDisassemblies.contains(key)) {
+        return;
+    }
+    m_pendingDisassemblies.insert(key);
+
+    using namespace ThreadWeaver;
+    // the page may get destroyed while the job runs, so it is only checked and used on the GUI thread
+    QPointer<ResultsDisassemblyPage> smartThis(this);
+    auto* context = QCoreApplication::instance();
+    const auto arch = m_arch;
+    stream() << make_job([smartThis, context, key, objdump, arch, symbol]() {
+        const auto disassemblyOutput = DisassemblyOutput::disassemble(objdump, arch, symbol);
+        QMetaObject::invokeMethod(
+            context,
+            [smartThis, key, disassemblyOutput]() {
+                if (smartThis) {
+                    smartThis->onDisassemblyFinished(key, disassemblyOutput);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void ResultsDisassemblyPage::onDisassemblyFinished(const DisassemblyOutput::CacheKey& key,
+                                                   const DisassemblyOutput& disassemblyOutput)
+{
+    m_pendingDisassemblies.remove(key);
+
+    // don't cache errors, the user may fix them e.g. by installing objdump
+    if (disassemblyOutput) {
+        m_disassemblyCache.insert(key, new DisassemblyOutput(disassemblyOutput),
+                                  std::max(1, disassemblyOutput.disassemblyLines.size()));
+    }
+
+    if (key == m_curKey) {
+        showDisassembly(disassemblyOutput);
+    }
+}
+
+void ResultsDisassemblyPage::prefetchHotSymbols()
+{
+    const auto& selfCosts = m_callerCalleeResults.selfCosts;
+    if (!selfCosts.numTypes()) {
+        return;
+    }
+
+    QVector<QPair<qint64, Data::Symbol>> hotSymbols;
+    for (auto it = m_callerCalleeResults.entries.cbegin(), end = m_callerCalleeResults.entries.cend(); it != end;
+         ++it) {
+        const auto& symbol = it.key();
+        if (symbol.symbol.isEmpty() || !symbol.size || symbol.actualPath.isEmpty() || symbol.isKernel) {
+            continue;
         }
-        const auto isArm = m_arch.startsWith(QLatin1String("arm"));
-        return isArm ? QStringLiteral("arm-linux-gnueabi-objdump") : QStringLiteral("objdump");
-    };
+        const auto cost = selfCosts.cost(0, it->id);
+        if (cost > 0) {
+            hotSymbols.append({cost, symbol});
+        }
+    }
 
-    showDisassembly(DisassemblyOutput::disassemble(objdump(), m_arch, m_curSymbol));
+    const auto numPrefetched = std::min(hotSymbols.size(), NUM_PREFETCHED_SYMBOLS);
+    std::partial_sort(hotSymbols.begin(), hotSymbols.begin() + numPrefetched, hotSymbols.end(),
+                      [](const QPair<qint64, Data::Symbol>& lhs, const QPair<qint64, Data::Symbol>& rhs) {
+                          return lhs.first > rhs.first;
+                      });
+
+    // binaries with multiple hot symbols get indexed as a whole, instead of running objdump for every symbol
+    QHash<QString, int> numHotSymbolsPerBinary;
+    for (int i = 0; i < numPrefetched; ++i) {
+        ++numHotSymbolsPerBinary[hotSymbols[i].second.actualPath];
+    }
+
+    const auto objdump = this->objdump();
+    for (int i = 0; i < numPrefetched; ++i) {
+        const auto& symbol = hotSymbols[i].second;
+        if (numHotSymbolsPerBinary.value(symbol.actualPath) > 1) {
+            requestIndex(symbol);
+        } else if (!m_disassemblyCache.contains(DisassemblyOutput::CacheKey::forSymbol(objdump, symbol))) {
+            scheduleDisassembly(symbol);
+        }
+    }
+}
+
+void ResultsDisassemblyPage::requestIndex(const Data::Symbol& symbol)
+{
+    if (symbol.actualPath.isEmpty() || symbol.isKernel) {
+        return;
+    }
+
+    const auto objdump = this->objdump();
+    const auto indexPath = DisassemblyIndex::indexPath(objdump, symbol.actualPath);
+
+    // the path changes when the binary got rebuilt, the outdated index is of no use anymore
+    auto& currentIndexPath = m_indexPaths[symbol.actualPath];
+    if (currentIndexPath != indexPath) {
+        m_disassemblyIndices.remove(currentIndexPath);
+        m_indexRequests.remove(currentIndexPath);
+        currentIndexPath = indexPath;
+    }
+
+    if (m_disassemblyIndices.contains(indexPath) || m_pendingIndices.contains(indexPath)) {
+        return;
+    }
+
+    // a single symbol is quicker to disassemble on its own, so only index binaries that we see repeatedly
+    // or that got indexed in a previous session already
+    if (++m_indexRequests[indexPath] < 2 && !QFile::exists(indexPath)) {
+        return;
+    }
+    m_indexRequests.remove(indexPath);
+    m_pendingIndices.insert(indexPath);
+
+    using namespace ThreadWeaver;
+    QPointer<ResultsDisassemblyPage> smartThis(this);
+    auto* context = QCoreApplication::instance();
+    const auto actualPath = symbol.actualPath;
+    stream() << make_job([smartThis, context, objdump, actualPath, indexPath]() {
+        auto index = DisassemblyIndex::load(indexPath);
+        if (!index.isValid()) {
+            QString errorMessage;
+            index = DisassemblyIndex::build(objdump, actualPath, indexPath, &errorMessage);
+            if (!index.isValid()) {
+                qWarning() << "failed to index disassembly of" << actualPath << errorMessage;
+            }
+            // make room for the new index
+            DisassemblyIndex::evictCache(QFileInfo(indexPath).absolutePath());
+        }
+        QMetaObject::invokeMethod(
+            context,
+            [smartThis, indexPath, index]() {
+                if (smartThis) {
+                    smartThis->onIndexFinished(indexPath, index);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void ResultsDisassemblyPage::onIndexFinished(const QString& indexPath, const DisassemblyIndex& index)
+{
+    m_pendingIndices.remove(indexPath);
+    // invalid indices are stored too, to not try again
+    m_disassemblyIndices.insert(indexPath, index);
 }
 
 void ResultsDisassemblyPage::showDisassembly(const DisassemblyOutput& disassemblyOutput)
 {
     m_model->clear();
+    m_controlFlowGraph = {};
 
     const auto& entry = m_callerCalleeResults.entry(m_curSymbol);
 
@@ -123,6 +320,7 @@ void ResultsDisassemblyPage::showDisassembly(const DisassemblyOutput& disassembl
     if (!disassemblyOutput) {
         ui->errorMessage->setText(disassemblyOutput.errorMessage);
         ui->errorMessage->show();
+        ui->loopsLabel->hide();
         return;
     }
 
@@ -131,6 +329,45 @@ void ResultsDisassemblyPage::showDisassembly(const DisassemblyOutput& disassembl
     m_model->setDisassembly(disassemblyOutput);
 
     setupAsmViewModel();
+    m_controlFlowGraph =
+        ControlFlowGraph::build(disassemblyOutput, entry, m_callerCalleeResults.selfCosts.numTypes());
+    showHottestLoops();
+}
+
+void ResultsDisassemblyPage::selectCostColumn(int column)
+{
+    const auto type = column - DisassemblyModel::COLUMN_COUNT;
+    if (type < 0 || type >= m_callerCalleeResults.selfCosts.numTypes() || type == m_loopsCostType) {
+        return;
+    }
+    m_loopsCostType = type;
+    showHottestLoops();
+}
+
+void ResultsDisassemblyPage::showHottestLoops()
+{
+    const auto& graph = m_controlFlowGraph;
+    const auto type = m_loopsCostType;
+    const auto hottestLoops = graph.hottestLoops(type);
+    if (hottestLoops.isEmpty()) {
+        ui->loopsLabel->hide();
+        return;
+    }
+
+    const auto entryAddr = graph.blocks.first().startAddr;
+    QStringList loops;
+    for (int i = 0, c = std::min(hottestLoops.size(), NUM_HOTTEST_LOOPS); i < c; ++i) {
+        const auto& loop = graph.loops[hottestLoops[i]];
+        const auto& header = graph.blocks[loop.header];
+        loops.append(tr("<a href=\"%1\">%2 - %3</a>: %4 in %n instruction(s)", nullptr, loop.numInstructions)
+                         .arg(QString::number(header.startAddr - entryAddr),
+                              QLatin1String("0x") + QString::number(loop.startAddr, 16),
+                              QLatin1String("0x") + QString::number(loop.endAddr, 16),
+                              Util::formatCostRelative(loop.cost[type], graph.totalCost[type], true)));
+    }
+    ui->loopsLabel->setText(tr("Hottest loops by %1: %2")
+                                .arg(m_callerCalleeResults.selfCosts.typeName(type), loops.join(QLatin1String(", "))));
+    ui->loopsLabel->show();
 }
 
 void ResultsDisassemblyPage::setSymbol(const Data::Symbol& symbol)
@@ -140,8 +377,14 @@ void ResultsDisassemblyPage::setSymbol(const Data::Symbol& symbol)
 
 void ResultsDisassemblyPage::setCostsMap(const Data::CallerCalleeResults& callerCalleeResults)
 {
+    if (m_loopsCostType >= callerCalleeResults.selfCosts.numTypes()) {
+        m_loopsCostType = 0;
+    }
+    // the requests of the previous results don't tell anything about the binaries that are hot now
+    m_indexRequests.clear();
     m_callerCalleeResults = callerCalleeResults;
-    m_model->setResults(m_callerCalleeResults);    
+    m_model->setResults(m_callerCalleeResults);
+    prefetchHotSymbols();
 }
 
 void ResultsDisassemblyPage::setObjdump(const QString& objdump)
@@ -9,7 +9,13 @@
 #pragma once
 
 #include "data.h"
+#include "models/controlflowgraph.h"
 #include "models/costdelegate.h"
+#include "models/disassemblyindex.h"
+#include "models/disassemblyoutput.h"
+#include <QCache>
+#include <QHash>
+#include <QSet>
 #include <QWidget>
 
 class QMenu;
@@ -29,7 +35,6 @@ class QStandardItemModel;
 class QTemporaryFile;
 class CostDelegate;
 class DisassemblyDelegate;
-struct DisassemblyOutput;
 class DisassemblyModel;
 
 class ResultsDisassemblyPage : public QWidget
@@ -52,6 +57,17 @@ signals:
 
 private:
     void showDisassembly(const DisassemblyOutput& disassemblyOutput);
+    void showHottestLoops();
+    // the loops get ranked by the cost of the selected column
+    void selectCostColumn(int column);
+    QString objdump() const;
+    // runs objdump on a worker, unless the disassembly of the symbol is already pending
+    void scheduleDisassembly(const Data::Symbol& symbol);
+    void onDisassemblyFinished(const DisassemblyOutput::CacheKey& key, const DisassemblyOutput& disassemblyOutput);
+    void prefetchHotSymbols();
+    // indexes the whole binary of the symbol on a worker, once it seems worth it
+    void requestIndex(const Data::Symbol& symbol);
+    void onIndexFinished(const QString& indexPath, const DisassemblyIndex& index);
 
     QScopedPointer<Ui::ResultsDisassemblyPage> ui;
     // Model
@@ -64,7 +80,22 @@ private:
     QString m_objdump;
     // Map of symbols and its locations with costs
     Data::CallerCalleeResults m_callerCalleeResults;
+    // Control flow of the shown disassembly
+    ControlFlowGraph m_controlFlowGraph;
+    int m_loopsCostType = 0;
     // Cost delegate
     CostDelegate* m_costDelegate;
     DisassemblyDelegate* m_disassemblyDelegate;
+    // Successful disassemblies, the cost is the number of lines
+    QCache<DisassemblyOutput::CacheKey, DisassemblyOutput> m_disassemblyCache;
+    QSet<DisassemblyOutput::CacheKey> m_pendingDisassemblies;
+    // The disassembly we are waiting for to show it
+    DisassemblyOutput::CacheKey m_curKey;
+    // Disassembly of whole binaries keyed by DisassemblyIndex::indexPath, invalid when indexing failed
+    QHash<QString, DisassemblyIndex> m_disassemblyIndices;
+    QSet<QString> m_pendingIndices;
+    // how often the disassembly of binaries without an index got requested, until they get indexed
+    QHash<QString, int> m_indexRequests;
+    // the current index path by actual path of the binaries
+    QHash<QString, QString> m_indexPaths;
 };
@@ -45,7 +45,8 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
         ui->flameGraph->setBottomUpData(data);
         m_exportAction = exportMenu->addAction(QIcon::fromTheme(QStringLiteral("image-x-generic")), tr("Flamegraph"));
         connect(m_exportAction, &QAction::triggered, this, [this]() {
-            const auto filter = tr("Images (%1);;SVG (*.svg)").arg(imageFormatFilter());
+            const auto filter =
+                tr("Images (%1);;SVG (*.svg);;Folded Stacks (*.folded *.txt)").arg(imageFormatFilter());
             QString selectedFilter;
             const auto fileName =
                 QFileDialog::getSaveFileName(this, tr("Export Flamegraph"), {}, filter, &selectedFilter);
@@ -53,6 +54,8 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
                 return;
             if (selectedFilter.contains(QStringLiteral("svg"))) {
                 ui->flameGraph->saveSvg(fileName);
+            } else if (selectedFilter.contains(QStringLiteral("folded"))) {
+                ui->flameGraph->saveFoldedStacks(fileName);
             } else {
                 QImageWriter writer(fileName);
                 if (!writer.write(ui->flameGraph->toImage())) {
@@ -66,6 +69,10 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
     connect(parser, &PerfParser::topDownDataAvailable, this,
             [this](const Data::TopDownResults& data) { ui->flameGraph->setTopDownData(data); });
 
+    connect(ui->flameGraph, &FlameGraph::exportFailed, this, [this](const QString& errorMessage) {
+        QMessageBox::warning(this, tr("Export Failed"), tr("Failed to export flamegraph: %1").arg(errorMessage));
+    });
+
     connect(ui->flameGraph, &FlameGraph::jumpToCallerCallee, this, &ResultsFlameGraphPage::jumpToCallerCallee);
     connect(ui->flameGraph, &FlameGraph::openEditor, this, &ResultsFlameGraphPage::openEditor);
     connect(ui->flameGraph, &FlameGraph::selectSymbol, this, &ResultsFlameGraphPage::selectSymbol);
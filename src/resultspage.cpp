@@ -12,7 +12,9 @@
 #include "parsers/perf/perfparser.h"
 
 #include "costcontextmenu.h"
+#include "cpuheatmapwidget.h"
 #include "dockwidgetsetup.h"
+#include "flamechartwidget.h"
 #include "resultsbottomuppage.h"
 #include "resultscallercalleepage.h"
 #include "resultsdisassemblypage.h"
@@ -44,6 +46,7 @@
 ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::ResultsPage)
+    , m_parser(parser)
     , m_contents(createDockingArea(QStringLiteral("results"), this))
     , m_filterAndZoomStack(new FilterAndZoomStack(this))
     , m_costContextMenu(new CostContextMenu(this))
@@ -54,6 +57,8 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
           new ResultsBottomUpPage(m_filterAndZoomStack, parser, m_costContextMenu, m_exportMenu, this))
     , m_resultsTopDownPage(new ResultsTopDownPage(m_filterAndZoomStack, parser, m_costContextMenu, this))
     , m_resultsFlameGraphPage(new ResultsFlameGraphPage(m_filterAndZoomStack, parser, m_exportMenu, this))
+    , m_flameChartWidget(new FlameChartWidget(parser, m_filterAndZoomStack, this))
+    , m_cpuHeatmapWidget(new CpuHeatmapWidget(parser, m_filterAndZoomStack, this))
     , m_resultsCallerCalleePage(new ResultsCallerCalleePage(m_filterAndZoomStack, parser, m_costContextMenu, this))
     , m_resultsDisassemblyPage(new ResultsDisassemblyPage(this))
     , m_timeLineWidget(new TimeLineWidget(parser, m_filterMenu, m_filterAndZoomStack, this))
@@ -96,6 +101,10 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     m_summaryPageDock->addDockWidgetAsTab(m_topDownDock);
     m_flameGraphDock = dockify(m_resultsFlameGraphPage, QStringLiteral("flameGraph"), tr("Flame &Graph"), tr("Ctrl+G"));
     m_summaryPageDock->addDockWidgetAsTab(m_flameGraphDock);
+    m_flameChartDock = dockify(m_flameChartWidget, QStringLiteral("flameChart"), tr("Flame C&hart"), tr("Ctrl+H"));
+    m_summaryPageDock->addDockWidgetAsTab(m_flameChartDock);
+    m_cpuHeatmapDock = dockify(m_cpuHeatmapWidget, QStringLiteral("cpuHeatmap"), tr("CPU Heat&map"), tr("Ctrl+M"));
+    m_summaryPageDock->addDockWidgetAsTab(m_cpuHeatmapDock);
     m_callerCalleeDock =
         dockify(m_resultsCallerCalleePage, QStringLiteral("callerCallee"), tr("Ca&ller / Callee"), tr("Ctrl+L"));
     m_summaryPageDock->addDockWidgetAsTab(m_callerCalleeDock);
@@ -116,6 +125,8 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
             &ResultsDisassemblyPage::setCostsMap);
 
     connect(m_filterAndZoomStack, &FilterAndZoomStack::filterChanged, parser, &PerfParser::filterResults);
+    connect(parser, &PerfParser::parsingStarted, this,
+            [this]() { m_filterAndZoomStack->setFilterEnabled(!m_parser->isComparing()); });
 
     connect(parser, &PerfParser::summaryDataAvailable, this, [this](const Data::Summary& data) {
         if (data.lostChunks > 0) {
@@ -136,20 +147,28 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     connect(m_resultsCallerCalleePage, &ResultsCallerCalleePage::navigateToCodeFailed, this, &ResultsPage::showError);
     connect(m_resultsCallerCalleePage, &ResultsCallerCalleePage::selectSymbol, m_timeLineWidget,
             &TimeLineWidget::selectSymbol);
+    connect(m_resultsCallerCalleePage, &ResultsCallerCalleePage::selectSymbol, m_flameChartWidget,
+            &FlameChartWidget::selectSymbol);
 
     connect(m_resultsCallerCalleePage, &ResultsCallerCalleePage::jumpToDisassembly, this,
             &ResultsPage::onJumpToDisassembly);
     connect(m_resultsSummaryPage, &ResultsSummaryPage::jumpToCallerCallee, this, &ResultsPage::onJumpToCallerCallee);
     connect(m_resultsSummaryPage, &ResultsSummaryPage::openEditor, this, &ResultsPage::onOpenEditor);
     connect(m_resultsSummaryPage, &ResultsSummaryPage::selectSymbol, m_timeLineWidget, &TimeLineWidget::selectSymbol);
+    connect(m_resultsSummaryPage, &ResultsSummaryPage::selectSymbol, m_flameChartWidget,
+            &FlameChartWidget::selectSymbol);
     connect(m_resultsSummaryPage, &ResultsSummaryPage::jumpToDisassembly, this, &ResultsPage::onJumpToDisassembly);
     connect(m_resultsBottomUpPage, &ResultsBottomUpPage::jumpToCallerCallee, this, &ResultsPage::onJumpToCallerCallee);
     connect(m_resultsBottomUpPage, &ResultsBottomUpPage::openEditor, this, &ResultsPage::onOpenEditor);
     connect(m_resultsBottomUpPage, &ResultsBottomUpPage::selectSymbol, m_timeLineWidget, &TimeLineWidget::selectSymbol);
+    connect(m_resultsBottomUpPage, &ResultsBottomUpPage::selectSymbol, m_flameChartWidget,
+            &FlameChartWidget::selectSymbol);
     connect(m_resultsBottomUpPage, &ResultsBottomUpPage::jumpToDisassembly, this, &ResultsPage::onJumpToDisassembly);
     connect(m_resultsTopDownPage, &ResultsTopDownPage::jumpToCallerCallee, this, &ResultsPage::onJumpToCallerCallee);
     connect(m_resultsTopDownPage, &ResultsTopDownPage::openEditor, this, &ResultsPage::onOpenEditor);
     connect(m_resultsTopDownPage, &ResultsTopDownPage::selectSymbol, m_timeLineWidget, &TimeLineWidget::selectSymbol);
+    connect(m_resultsTopDownPage, &ResultsTopDownPage::selectSymbol, m_flameChartWidget,
+            &FlameChartWidget::selectSymbol);
     connect(m_resultsTopDownPage, &ResultsTopDownPage::jumpToDisassembly, this, &ResultsPage::onJumpToDisassembly);
     connect(m_resultsFlameGraphPage, &ResultsFlameGraphPage::jumpToCallerCallee, this,
             &ResultsPage::onJumpToCallerCallee);
@@ -175,6 +194,12 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
         // re-enable when we finished filtering
         m_contents->setEnabled(true);
         m_filterBusyIndicator->setVisible(false);
+
+        if (m_refilterPending) {
+            m_refilterPending = false;
+            // queued, the other receivers of parsingFinished still expect the parser to be done
+            QMetaObject::invokeMethod(this, &ResultsPage::refilter, Qt::QueuedConnection);
+        }
     });
 
     {
@@ -250,10 +275,22 @@ void ResultsPage::clear()
     m_resultsTopDownPage->clear();
     m_resultsCallerCalleePage->clear();
     m_resultsFlameGraphPage->clear();
+    m_flameChartWidget->clear();
+    m_cpuHeatmapWidget->clear();
     m_exportMenu->clear();
     m_disassemblyDock->forceClose();
 
     m_filterAndZoomStack->clear();
+    m_refilterPending = false;
+}
+
+void ResultsPage::refilter()
+{
+    if (m_parser->isParsing()) {
+        m_refilterPending = true;
+        return;
+    }
+    m_parser->filterResults(m_filterAndZoomStack->filter());
 }
 
 QMenu* ResultsPage::filterMenu() const
@@ -269,9 +306,9 @@ QMenu* ResultsPage::exportMenu() const
 QList<QAction*> ResultsPage::windowActions() const
 {
     auto ret = QList<QAction*>{
-        m_summaryPageDock->toggleAction(), m_bottomUpDock->toggleAction(),     m_topDownDock->toggleAction(),
-        m_flameGraphDock->toggleAction(),  m_callerCalleeDock->toggleAction(), m_disassemblyDock->toggleAction(),
-        m_timeLineDock->toggleAction()
+        m_summaryPageDock->toggleAction(),  m_bottomUpDock->toggleAction(),    m_topDownDock->toggleAction(),
+        m_flameGraphDock->toggleAction(),   m_flameChartDock->toggleAction(),  m_cpuHeatmapDock->toggleAction(),
+        m_callerCalleeDock->toggleAction(), m_disassemblyDock->toggleAction(), m_timeLineDock->toggleAction()
     };
     if (m_frequencyDock)
         ret.append(m_frequencyDock->toggleAction());
@@ -303,8 +340,8 @@ void ResultsPage::initDockWidgets(const QVector<KDDockWidgets::DockWidgetBase*>&
 {
     Q_ASSERT(restored.contains(m_summaryPageDock));
 
-    const auto docks = {m_bottomUpDock, m_topDownDock,     m_flameGraphDock, m_callerCalleeDock,
-                        m_timeLineDock, m_disassemblyDock, m_frequencyDock};
+    const auto docks = {m_bottomUpDock,     m_topDownDock,  m_flameGraphDock,  m_flameChartDock, m_cpuHeatmapDock,
+                        m_callerCalleeDock, m_timeLineDock, m_disassemblyDock, m_frequencyDock};
     for (auto dock : docks) {
         if (!dock || restored.contains(dock))
             continue;
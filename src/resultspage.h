@@ -32,6 +32,8 @@ class ResultsSummaryPage;
 class ResultsBottomUpPage;
 class ResultsTopDownPage;
 class ResultsFlameGraphPage;
+class FlameChartWidget;
+class CpuHeatmapWidget;
 class ResultsCallerCalleePage;
 class ResultsDisassemblyPage;
 class FilterAndZoomStack;
@@ -54,6 +56,9 @@ public:
 
     void initDockWidgets(const QVector<KDDockWidgets::DockWidgetBase*>& restored);
 
+    // re-applies the current filter, e.g. to re-aggregate the costs after the aggregation setting changed
+    void refilter();
+
 public slots:
     void setSysroot(const QString& path);
     void setAppPath(const QString& path);
@@ -72,6 +77,7 @@ private:
     void repositionFilterBusyIndicator();
 
     QScopedPointer<Ui::ResultsPage> ui;
+    PerfParser* m_parser;
     KDDockWidgets::MainWindow* m_contents;
     FilterAndZoomStack* m_filterAndZoomStack;
     CostContextMenu* m_costContextMenu;
@@ -85,6 +91,10 @@ private:
     ResultsTopDownPage* m_resultsTopDownPage;
     KDDockWidgets::DockWidget* m_flameGraphDock;
     ResultsFlameGraphPage* m_resultsFlameGraphPage;
+    KDDockWidgets::DockWidget* m_flameChartDock;
+    FlameChartWidget* m_flameChartWidget;
+    KDDockWidgets::DockWidget* m_cpuHeatmapDock;
+    CpuHeatmapWidget* m_cpuHeatmapWidget;
     KDDockWidgets::DockWidget* m_callerCalleeDock;
     ResultsCallerCalleePage* m_resultsCallerCalleePage;
     KDDockWidgets::DockWidget* m_disassemblyDock;
@@ -95,4 +105,6 @@ private:
     KDDockWidgets::DockWidget* m_frequencyDock = nullptr;
     QWidget* m_filterBusyIndicator = nullptr;
     bool m_timelineVisible;
+    // set when refilter() got called while the parser was busy
+    bool m_refilterPending = false;
 };
@@ -9,7 +9,6 @@
 #include "resultssummarypage.h"
 #include "ui_resultssummarypage.h"
 
-#include <QSortFilterProxyModel>
 #include <QStringListModel>
 #include <QTextStream>
 
@@ -71,8 +70,9 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
             });
 
     connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, bottomUpCostModel](const Data::BottomUpResults& data) {
+            [this, bottomUpCostModel, topHotspotsProxy](const Data::BottomUpResults& data) {
                 bottomUpCostModel->setData(data);
+                topHotspotsProxy->setTopRows(data.topRows);
                 ResultsUtil::hideEmptyColumns(data.costs, ui->topHotspotsTableView, BottomUpModel::NUM_BASE_COLUMNS);
                 ResultsUtil::hideTracepointColumns(data.costs, ui->topHotspotsTableView,
                                                    BottomUpModel::NUM_BASE_COLUMNS);
@@ -81,8 +81,9 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
             });
 
     connect(parser, &PerfParser::perLibraryDataAvailable, this,
-            [this, perLibraryModel](const Data::PerLibraryResults& data) {
+            [this, perLibraryModel, topLibraryProxy](const Data::PerLibraryResults& data) {
                 perLibraryModel->setData(data);
+                topLibraryProxy->setTopRows(data.topRows);
                 ResultsUtil::hideEmptyColumns(data.costs, ui->topLibraryTreeView, PerLibraryModel::NUM_BASE_COLUMNS);
                 ResultsUtil::hideTracepointColumns(data.costs, ui->topLibraryTreeView,
                                                    PerLibraryModel::NUM_BASE_COLUMNS);
@@ -32,7 +32,7 @@ void setupHeaderView(QTreeView* view, CostContextMenu* contextMenu)
     view->setHeader(new CostHeaderView(contextMenu, view));
 }
 
-void connectFilter(QLineEdit* filter, QSortFilterProxyModel* proxy)
+void connectFilter(QLineEdit* filter, QObject* context, std::function<void(const QString&)> setFilterText)
 {
     auto* timer = new QTimer(filter);
     timer->setSingleShot(true);
@@ -40,20 +40,21 @@ void connectFilter(QLineEdit* filter, QSortFilterProxyModel* proxy)
     filter->setClearButtonEnabled(true);
     filter->setPlaceholderText(QCoreApplication::translate("Util", "Search"));
 
+    QObject::connect(timer, &QTimer::timeout, context,
+                     [filter, setFilterText]() { setFilterText(filter->text()); });
+    QObject::connect(filter, &QLineEdit::textChanged, timer, [timer]() { timer->start(300); });
+}
+
+void connectFilter(QLineEdit* filter, QSortFilterProxyModel* proxy)
+{
     proxy->setFilterKeyColumn(-1);
     proxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
 
-    QObject::connect(timer, &QTimer::timeout, proxy,
-                     [filter, proxy]() { proxy->setFilterFixedString(filter->text()); });
-    QObject::connect(filter, &QLineEdit::textChanged, timer, [timer]() { timer->start(300); });
+    connectFilter(filter, proxy, [proxy](const QString& text) { proxy->setFilterFixedString(text); });
 }
 
-void setupTreeView(QTreeView* view, CostContextMenu* contextMenu, QLineEdit* filter, QSortFilterProxyModel* model,
-                   int initialSortColumn, int sortRole)
+void setupTreeView(QTreeView* view, CostContextMenu* contextMenu, QAbstractItemModel* model, int initialSortColumn)
 {
-    model->setSortRole(sortRole);
-    connectFilter(filter, model);
-
     view->setModel(model);
     setupHeaderView(view, contextMenu);
     view->sortByColumn(initialSortColumn, Qt::DescendingOrder);
@@ -175,7 +176,8 @@ void fillEventSourceComboBox(QComboBox* combo, const Data::Costs& costs, const Q
 
     combo->clear();
     for (int i = 0, c = costs.numTypes(); i < c; ++i) {
-        if (!costs.totalCost(i)) {
+        // the signed cost differences of a comparison are shown alongside their type, not on their own
+        if (!costs.totalCost(i) || costs.diffBaseType(i) >= 0) {
             continue;
         }
         const auto& typeName = costs.typeName(i);
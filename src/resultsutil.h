@@ -10,8 +10,8 @@
 
 #include <functional>
 
-#include "models/costproxy.h"
 #include <QFlags>
+#include <QString>
 
 class QMenu;
 class QTreeView;
@@ -19,6 +19,7 @@ class QComboBox;
 class QLineEdit;
 class QSortFilterProxyModel;
 class QAbstractItemModel;
+class QObject;
 
 namespace Data {
 class Costs;
@@ -31,18 +32,18 @@ class CostContextMenu;
 namespace ResultsUtil {
 void setupHeaderView(QTreeView* view, CostContextMenu* contextMenu);
 
+void connectFilter(QLineEdit* filter, QObject* context, std::function<void(const QString&)> setFilterText);
+
 void connectFilter(QLineEdit* filter, QSortFilterProxyModel* proxy);
 
-void setupTreeView(QTreeView* view, CostContextMenu* contextMenu, QLineEdit* filter, QSortFilterProxyModel* model,
-                   int initialSortColumn, int sortRole);
+void setupTreeView(QTreeView* view, CostContextMenu* contextMenu, QAbstractItemModel* model, int initialSortColumn);
 
+// the tree models sort and filter natively, without a proxy in between
 template<typename Model>
 void setupTreeView(QTreeView* view, CostContextMenu* costContextMenu, QLineEdit* filter, Model* model)
 {
-    auto* proxy = new CostProxy<Model>(view);
-    proxy->setSourceModel(model);
-    setupTreeView(view, costContextMenu, filter, qobject_cast<QSortFilterProxyModel*>(proxy), Model::InitialSortColumn,
-                  Model::SortRole);
+    connectFilter(filter, model, [model](const QString& text) { model->setFilterText(text); });
+    setupTreeView(view, costContextMenu, model, Model::InitialSortColumn);
 }
 
 void setupCostDelegate(QAbstractItemModel* model, QTreeView* view, int sortRole, int totalCostRole, int numBaseColumns);
@@ -156,6 +156,14 @@ void Settings::setLastUsedEnvironment(const QString& envName)
     }
 }
 
+void Settings::setMemoryBudget(int memoryBudget)
+{
+    if (m_memoryBudget != memoryBudget) {
+        m_memoryBudget = memoryBudget;
+        emit memoryBudgetChanged(m_memoryBudget);
+    }
+}
+
 void Settings::loadFromFile()
 {
     auto sharedConfig = KSharedConfig::openConfig();
@@ -164,6 +172,7 @@ void Settings::loadFromFile()
     setPrettifySymbols(config.readEntry("prettifySymbols", true));
     setCollapseTemplates(config.readEntry("collapseTemplates", true));
     setCollapseDepth(config.readEntry("collapseDepth", 1));
+    setMemoryBudget(config.readEntry("memoryBudget", 0));
 
     connect(Settings::instance(), &Settings::prettifySymbolsChanged, this, [sharedConfig](bool prettifySymbols) {
         sharedConfig->group("Settings").writeEntry("prettifySymbols", prettifySymbols);
@@ -177,6 +186,10 @@ void Settings::loadFromFile()
         sharedConfig->group("Settings").writeEntry("collapseDepth", collapseDepth);
     });
 
+    connect(this, &Settings::memoryBudgetChanged, this, [sharedConfig](int memoryBudget) {
+        sharedConfig->group("Settings").writeEntry("memoryBudget", memoryBudget);
+    });
+
     const QStringList userPaths = {QDir::homePath()};
     const QStringList systemPaths = {QDir::rootPath()};
     setPaths(sharedConfig->group("PathSettings").readEntry("userPaths", userPaths),
@@ -23,6 +23,8 @@ public:
         Binary,
         Kernel,
         System,
+        // colors by how the costs changed compared to the baseline recording
+        Difference,
         NumColorSchemes
     };
     Q_ENUM(ColorScheme);
@@ -133,6 +135,12 @@ public:
         return m_costAggregation;
     }
 
+    // in MiB, events get spilled to disk once the import exceeds it, zero means unlimited
+    int memoryBudget() const
+    {
+        return m_memoryBudget;
+    }
+
     QString lastUsedEnvironment() const
     {
         return m_lastUsedEnvironment;
@@ -157,6 +165,7 @@ signals:
     void objdumpChanged(const QString& objdump);
     void callgraphChanged();
     void lastUsedEnvironmentChanged(const QString& envName);
+    void memoryBudgetChanged(int memoryBudget);
 
 public slots:
     void setPrettifySymbols(bool prettifySymbols);
@@ -177,6 +186,7 @@ public slots:
     void setCallgraphColors(const QColor& active, const QColor& inactive);
     void setCostAggregation(CostAggregation costAggregation);
     void setLastUsedEnvironment(const QString& envName);
+    void setMemoryBudget(int memoryBudget);
 
 private:
     Settings() = default;
@@ -201,6 +211,8 @@ private:
 
     QString m_lastUsedEnvironment;
 
+    int m_memoryBudget = 0;
+
     int m_callgraphParentDepth = 3;
     int m_callgraphChildDepth = 2;
     QColor m_callgraphActiveColor;
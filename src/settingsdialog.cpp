@@ -16,7 +16,9 @@
 #include <KUrlRequester>
 #include <KConfigGroup>
 #include <KSharedConfig>
+#include <QFormLayout>
 #include <QKeyEvent>
+#include <QSpinBox>
 #include <QLineEdit>
 #include <settings.h>
 #include <QListView>
@@ -44,6 +46,7 @@ SettingsDialog::SettingsDialog(QWidget* parent)
     addPathSettingsPage();
     addFlamegraphPage();
     addDebuginfodPage();
+    addMemoryPage();
 #if KGRAPHVIEWER_FOUND
     addCallgraphPage();
 #endif
@@ -268,6 +271,31 @@ void SettingsDialog::addDebuginfodPage()
             [this] { Settings::instance()->setDebuginfodUrls(debuginfodPage->urls->items()); });
 }
 
+void SettingsDialog::addMemoryPage()
+{
+    auto page = new QWidget(this);
+    auto item = addPage(page, tr("Memory"));
+    item->setHeader(tr("Memory Settings"));
+    item->setIcon(QIcon::fromTheme(QStringLiteral("preferences-system-windows-behavior")));
+
+    auto memoryBudget = new QSpinBox(page);
+    memoryBudget->setRange(0, 1024 * 1024);
+    memoryBudget->setSingleStep(1024);
+    memoryBudget->setSuffix(tr(" MiB"));
+    memoryBudget->setSpecialValueText(tr("Unlimited"));
+    memoryBudget->setToolTip(tr("When the events of a recording exceed this budget, they are moved to temporary "
+                                "files on disk and read back from there. Takes effect for the next opened file."));
+    memoryBudget->setValue(Settings::instance()->memoryBudget());
+
+    auto layout = new QFormLayout(page);
+    layout->addRow(tr("Memory budget for events:"), memoryBudget);
+
+    connect(Settings::instance(), &Settings::memoryBudgetChanged, memoryBudget, &QSpinBox::setValue);
+
+    connect(buttonBox(), &QDialogButtonBox::accepted, this,
+            [memoryBudget] { Settings::instance()->setMemoryBudget(memoryBudget->value()); });
+}
+
 void SettingsDialog::addCallgraphPage()
 {
     auto page = new QWidget(this);
@@ -43,6 +43,7 @@ private:
     void addPathSettingsPage();
     void addFlamegraphPage();
     void addDebuginfodPage();
+    void addMemoryPage();
     void addCallgraphPage();
 
     std::unique_ptr<Ui::UnwindSettingsPage> unwindPage;
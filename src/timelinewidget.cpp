@@ -7,6 +7,7 @@
 
 #include "timelinewidget.h"
 
+#include "criticalpathdialog.h"
 #include "filterandzoomstack.h"
 #include "models/eventmodel.h"
 #include "resultsutil.h"
@@ -14,43 +15,19 @@
 
 #include "data.h"
 #include "parsers/perf/perfparser.h"
+#include "util.h"
 
 #include <QLabel>
-#include <QPointer>
 #include <QProgressBar>
 #include <QSortFilterProxyModel>
 #include <QVBoxLayout>
 
 #include <KLocalizedString>
-#include <ThreadWeaver/ThreadWeaver>
 
 #include <timeaxisheaderview.h>
 
 #include <ui_timelinewidget.h>
 
-namespace {
-template<typename Context, typename Job, typename SetData>
-void scheduleJob(Context* context, std::atomic<uint>* currentJobId, Job&& job, SetData&& setData)
-{
-    using namespace ThreadWeaver;
-    const auto jobId = ++(*currentJobId);
-    QPointer<Context> smartContext(context);
-    auto jobCancelled = [=]() { return !smartContext || jobId != (*currentJobId); };
-    stream() << make_job([=]() {
-        auto results = job(jobCancelled);
-
-        QMetaObject::invokeMethod(
-            smartContext.data(),
-            [results, jobCancelled, setData]() {
-                if (!jobCancelled()) {
-                    setData(results);
-                }
-            },
-            Qt::QueuedConnection);
-    });
-}
-}
-
 TimeLineWidget::TimeLineWidget(PerfParser* parser, QMenu* filterMenu, FilterAndZoomStack* filterAndZoomStack,
                                QWidget* parent)
     : QWidget(parent)
@@ -114,9 +91,11 @@ TimeLineWidget::TimeLineWidget(PerfParser* parser, QMenu* filterMenu, FilterAndZ
                 m_timeLineDelegate->setEventType(typeId);
             });
 
+    connect(m_timeLineDelegate, &TimeLineDelegate::criticalPathRequested, this, &TimeLineWidget::showCriticalPath);
+
     connect(m_timeLineDelegate, &TimeLineDelegate::stacksHovered, this, [this](const QSet<qint32>& stackIds) {
         if (stackIds.isEmpty()) {
-            ++m_currentHoverStacksJobId;
+            m_hoverStacksJobs.cancel();
             emit stacksHovered({});
             return;
         }
@@ -124,8 +103,8 @@ TimeLineWidget::TimeLineWidget(PerfParser* parser, QMenu* filterMenu, FilterAndZ
         const auto& stacks = m_parser->eventResults().stacks;
         const auto& bottomUpResults = m_parser->bottomUpResults();
 
-        scheduleJob(
-            this, &m_currentHoverStacksJobId,
+        m_hoverStacksJobs.schedule(
+            "TimeLineWidget::hoverStacks", this,
             [stacks, bottomUpResults, stackIds](auto jobCancelled) -> QVector<QVector<Data::Symbol>> {
                 QVector<QVector<Data::Symbol>> hovered;
                 hovered.reserve(stackIds.size());
@@ -152,10 +131,78 @@ TimeLineWidget::TimeLineWidget(PerfParser* parser, QMenu* filterMenu, FilterAndZ
 
 TimeLineWidget::~TimeLineWidget() = default;
 
+void TimeLineWidget::showCriticalPath(qint32 processId, qint32 threadId, const Data::TimeRange& time)
+{
+    if (!m_criticalPathDialog) {
+        m_criticalPathDialog = new CriticalPathDialog(this);
+    }
+
+    const auto& events = m_parser->eventResults();
+    const auto& bottomUpResults = m_parser->bottomUpResults();
+
+    m_criticalPathJobs.schedule(
+        "TimeLineWidget::criticalPath", m_criticalPathDialog,
+        [events, bottomUpResults, processId, threadId, time](auto jobCancelled) {
+            const auto path = events.criticalPath(processId, threadId, time);
+
+            auto threadName = [&events](qint32 pid, qint32 tid) {
+                const auto* thread = events.findThread(pid, tid);
+                return tr("%1 (#%2)").arg(thread ? thread->name : QString(), QString::number(tid));
+            };
+            // the innermost user space frame is more telling than the kernel scheduler
+            auto stackName = [&events, &bottomUpResults](qint32 stackId) {
+                if (stackId < 0 || stackId >= events.stacks.size()) {
+                    return QString();
+                }
+                QString innermost;
+                QString name;
+                bottomUpResults.foreachFrame(events.stacks.at(stackId),
+                                             [&](const Data::Symbol& symbol, const Data::Location&) {
+                                                 if (innermost.isEmpty()) {
+                                                     innermost = Util::formatSymbol(symbol);
+                                                 }
+                                                 if (symbol.isKernel) {
+                                                     return true;
+                                                 }
+                                                 name = Util::formatSymbol(symbol);
+                                                 return false;
+                                             });
+                return name.isEmpty() ? innermost : name;
+            };
+
+            QVector<CriticalPathDialog::Entry> entries;
+            entries.reserve(path.size());
+            for (const auto& segment : path) {
+                if (jobCancelled()) {
+                    return QVector<CriticalPathDialog::Entry>();
+                }
+                CriticalPathDialog::Entry entry;
+                entry.thread = threadName(segment.pid, segment.tid);
+                entry.state = segment.state;
+                entry.time = segment.time;
+                entry.blockedIn = stackName(segment.stackId);
+                if (segment.wakerTid != Data::INVALID_TID) {
+                    const auto waker = threadName(segment.wakerPid, segment.wakerTid);
+                    const auto wakerStack = stackName(segment.wakerStackId);
+                    entry.wokenBy = wakerStack.isEmpty() ? waker : tr("%1 in %2").arg(waker, wakerStack);
+                }
+                entries.push_back(entry);
+            }
+            return entries;
+        },
+        [this, processId, threadId, time](const QVector<CriticalPathDialog::Entry>& entries) {
+            const auto* thread = m_parser->eventResults().findThread(processId, threadId);
+            m_criticalPathDialog->setPath(
+                tr("%1 (#%2)").arg(thread ? thread->name : QString(), QString::number(threadId)), time, entries);
+            m_criticalPathDialog->show();
+            m_criticalPathDialog->raise();
+        });
+}
+
 void TimeLineWidget::selectSymbol(const Data::Symbol& symbol)
 {
     if (!symbol.isValid()) {
-        ++m_currentSelectStackJobId;
+        m_selectStackJobs.cancel();
         m_timeLineDelegate->setSelectedStacks({});
         return;
     }
@@ -163,8 +210,8 @@ void TimeLineWidget::selectSymbol(const Data::Symbol& symbol)
     const auto& stacks = m_parser->eventResults().stacks;
     const auto& bottomUpResults = m_parser->bottomUpResults();
 
-    scheduleJob(
-        m_timeLineDelegate, &m_currentSelectStackJobId,
+    m_selectStackJobs.schedule(
+        "TimeLineWidget::selectSymbol", m_timeLineDelegate,
         [stacks, bottomUpResults, symbol](auto jobCancelled) -> QSet<qint32> {
             const auto numStacks = stacks.size();
             QSet<qint32> selectedStacks;
@@ -192,7 +239,7 @@ void TimeLineWidget::selectSymbol(const Data::Symbol& symbol)
 void TimeLineWidget::selectStack(const QVector<Data::Symbol>& stack)
 {
     if (stack.isEmpty()) {
-        ++m_currentSelectStackJobId;
+        m_selectStackJobs.cancel();
         m_timeLineDelegate->setSelectedStacks({});
         return;
     }
@@ -200,8 +247,8 @@ void TimeLineWidget::selectStack(const QVector<Data::Symbol>& stack)
     const auto& stacks = m_parser->eventResults().stacks;
     const auto& bottomUpResults = m_parser->bottomUpResults();
 
-    scheduleJob(
-        m_timeLineDelegate, &m_currentSelectStackJobId,
+    m_selectStackJobs.schedule(
+        "TimeLineWidget::selectStack", m_timeLineDelegate,
         [stacks, bottomUpResults, stack](auto jobCancelled) -> QSet<qint32> {
             const auto numStacks = stacks.size();
             QSet<qint32> selectedStacks;
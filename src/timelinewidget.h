@@ -9,18 +9,21 @@
 
 #include <QWidget>
 
-#include <atomic>
 #include <memory>
 
+#include "jobscheduler.h"
+
 namespace Ui {
 class TimeLineWidget;
 }
 
 namespace Data {
 struct Symbol;
+struct TimeRange;
 }
 
 class PerfParser;
+class CriticalPathDialog;
 class FilterAndZoomStack;
 class TimeLineDelegate;
 class TimeAxisHeaderView;
@@ -42,12 +45,16 @@ signals:
     void stacksHovered(const QVector<QVector<Data::Symbol>>& stacks);
 
 private:
+    void showCriticalPath(qint32 processId, qint32 threadId, const Data::TimeRange& time);
+
     std::unique_ptr<Ui::TimeLineWidget> ui;
 
     PerfParser* m_parser = nullptr;
     FilterAndZoomStack* m_filterAndZoomStack = nullptr;
     TimeLineDelegate* m_timeLineDelegate = nullptr;
     TimeAxisHeaderView* m_timeAxisHeaderView = nullptr;
-    std::atomic<uint> m_currentSelectStackJobId;
-    std::atomic<uint> m_currentHoverStacksJobId;
+    CriticalPathDialog* m_criticalPathDialog = nullptr;
+    JobScheduler m_selectStackJobs;
+    JobScheduler m_hoverStacksJobs;
+    JobScheduler m_criticalPathJobs;
 };
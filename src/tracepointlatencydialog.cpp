@@ -0,0 +1,203 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tracepointlatencydialog.h"
+
+#include <QComboBox>
+#include <QCoreApplication>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPointer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <ThreadWeaver/ThreadWeaver>
+
+#include "parsers/perf/perfparser.h"
+#include "util.h"
+
+#include <algorithm>
+
+namespace {
+enum Columns
+{
+    LatencyColumn,
+    CountColumn,
+    ShareColumn,
+    NUM_COLUMNS
+};
+}
+
+TracepointLatencyDialog::TracepointLatencyDialog(PerfParser* parser, QWidget* parent)
+    : QDialog(parent)
+    , m_pairBox(new QComboBox(this))
+    , m_fieldBox(new QComboBox(this))
+    , m_valueEdit(new QLineEdit(this))
+    , m_summary(new QLabel(this))
+    , m_histogram(new QTreeWidget(this))
+{
+    setWindowTitle(tr("Tracepoint Latencies"));
+
+    m_valueEdit->setPlaceholderText(tr("Field value, e.g. the syscall id or the device"));
+    m_valueEdit->setClearButtonEnabled(true);
+
+    m_histogram->setColumnCount(NUM_COLUMNS);
+    m_histogram->setHeaderLabels({tr("Latency"), tr("Count"), tr("Share")});
+    m_histogram->setRootIsDecorated(false);
+    m_histogram->header()->setSectionResizeMode(LatencyColumn, QHeaderView::Stretch);
+    m_histogram->header()->setStretchLastSection(false);
+
+    auto* form = new QFormLayout;
+    form->addRow(tr("Begin and End:"), m_pairBox);
+    form->addRow(tr("Filter Field:"), m_fieldBox);
+    form->addRow(tr("Filter Value:"), m_valueEdit);
+
+    auto* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(m_summary);
+    layout->addWidget(m_histogram);
+    layout->addWidget(buttons);
+
+    connect(m_pairBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        updateFields();
+        updateHistogram();
+    });
+    connect(m_fieldBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &TracepointLatencyDialog::updateHistogram);
+    connect(m_valueEdit, &QLineEdit::editingFinished, this, &TracepointLatencyDialog::updateHistogram);
+
+    // also gets emitted for every filter change, so the latencies follow the selected time range
+    connect(parser, &PerfParser::tracepointDataAvailable, this, &TracepointLatencyDialog::setTracepoints);
+    connect(parser, &PerfParser::parsingStarted, this, [this]() { setTracepoints({}); });
+
+    setTracepoints({});
+    resize(600, 500);
+}
+
+TracepointLatencyDialog::~TracepointLatencyDialog() = default;
+
+void TracepointLatencyDialog::setTracepoints(const Data::TracepointResults& tracepoints)
+{
+    m_tracepoints = tracepoints;
+    m_pairs = m_tracepoints.latencyPairs();
+
+    const auto oldPair = m_pairBox->currentText();
+    {
+        QSignalBlocker blocker(m_pairBox);
+        m_pairBox->clear();
+        for (const auto& pair : qAsConst(m_pairs)) {
+            m_pairBox->addItem(tr("%1 → %2").arg(pair.begin, pair.end));
+        }
+        m_pairBox->setCurrentIndex(std::max(0, m_pairBox->findText(oldPair)));
+    }
+
+    updateFields();
+    // computing the latencies is deferred until the dialog gets shown
+    if (isVisible()) {
+        updateHistogram();
+    }
+}
+
+void TracepointLatencyDialog::showEvent(QShowEvent* event)
+{
+    updateHistogram();
+    QDialog::showEvent(event);
+}
+
+void TracepointLatencyDialog::updateFields()
+{
+    const auto oldField = m_fieldBox->currentData().toString();
+
+    QSignalBlocker blocker(m_fieldBox);
+    m_fieldBox->clear();
+    m_fieldBox->addItem(tr("None"));
+
+    const auto pairIndex = m_pairBox->currentIndex();
+    if (pairIndex < 0 || pairIndex >= m_pairs.size()) {
+        return;
+    }
+    if (const auto* format = m_tracepoints.format(m_pairs[pairIndex].begin)) {
+        for (const auto& field : format->fields) {
+            m_fieldBox->addItem(field.name, field.name);
+        }
+    }
+    m_fieldBox->setCurrentIndex(std::max(0, m_fieldBox->findData(oldField)));
+}
+
+void TracepointLatencyDialog::updateHistogram()
+{
+    m_histogram->clear();
+    // drops the results of jobs that are still running
+    const auto jobId = ++m_histogramJobId;
+
+    const auto pairIndex = m_pairBox->currentIndex();
+    if (pairIndex < 0 || pairIndex >= m_pairs.size()) {
+        m_summary->setText(tr("No paired tracepoints were recorded, e.g. block:block_rq_issue and "
+                              "block:block_rq_complete or raw_syscalls:sys_enter and raw_syscalls:sys_exit."));
+        return;
+    }
+
+    Data::TracepointFieldFilter filter;
+    filter.field = m_fieldBox->currentData().toString();
+    filter.value = m_valueEdit->text().trimmed();
+    if (filter.value.isEmpty()) {
+        filter.field.clear();
+    }
+
+    m_summary->setText(tr("Computing latencies..."));
+
+    using namespace ThreadWeaver;
+    // the dialog may get destroyed while the job runs, so it is only checked and used on the GUI thread
+    QPointer<TracepointLatencyDialog> smartThis(this);
+    auto* context = QCoreApplication::instance();
+    stream() << make_job([smartThis, context, jobId, tracepoints = m_tracepoints, pair = m_pairs[pairIndex], filter]() {
+        const auto histogram = tracepoints.latencies(pair, filter);
+        QMetaObject::invokeMethod(
+            context,
+            [smartThis, jobId, histogram]() {
+                if (smartThis && smartThis->m_histogramJobId == jobId) {
+                    smartThis->showHistogram(histogram);
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void TracepointLatencyDialog::showHistogram(const Data::LatencyHistogram& histogram)
+{
+    const auto count = static_cast<quint64>(histogram.latencies.size());
+    if (!count) {
+        m_summary->setText(tr("No matching begin and end samples."));
+        return;
+    }
+
+    m_summary->setText(tr("%1 latencies, minimum: %2, median: %3, 99th percentile: %4, maximum: %5, total: %6")
+                           .arg(QString::number(count), Util::formatTimeString(histogram.minimum),
+                                Util::formatTimeString(histogram.median), Util::formatTimeString(histogram.p99),
+                                Util::formatTimeString(histogram.maximum), Util::formatTimeString(histogram.total)));
+
+    for (int i = 0; i < histogram.buckets.size(); ++i) {
+        const auto bucketCount = histogram.buckets[i];
+        if (!bucketCount) {
+            continue;
+        }
+        const auto lower = i == 0 ? quint64(0) : quint64(1) << (i - 1);
+        const auto upper = quint64(1) << i;
+        auto* item = new QTreeWidgetItem;
+        item->setText(LatencyColumn,
+                      tr("%1 - %2").arg(Util::formatTimeString(lower, true), Util::formatTimeString(upper, true)));
+        item->setText(CountColumn, QString::number(bucketCount));
+        item->setText(ShareColumn, Util::formatCostRelative(bucketCount, count, true));
+        m_histogram->addTopLevelItem(item);
+    }
+}
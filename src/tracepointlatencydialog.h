@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QDialog>
+
+#include "models/data.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QTreeWidget;
+
+class PerfParser;
+
+/**
+ * Shows the latency histograms of paired tracepoints, e.g. block_rq_issue and block_rq_complete,
+ * optionally restricted to the samples with a given field value.
+ */
+class TracepointLatencyDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit TracepointLatencyDialog(PerfParser* parser, QWidget* parent = nullptr);
+    ~TracepointLatencyDialog();
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private:
+    void setTracepoints(const Data::TracepointResults& tracepoints);
+    void updateFields();
+    void updateHistogram();
+    void showHistogram(const Data::LatencyHistogram& histogram);
+
+    Data::TracepointResults m_tracepoints;
+    QVector<Data::TracepointPair> m_pairs;
+    // only the results of the latest job get shown
+    uint m_histogramJobId = 0;
+
+    QComboBox* m_pairBox;
+    QComboBox* m_fieldBox;
+    QLineEdit* m_valueEdit;
+    QLabel* m_summary;
+    QTreeWidget* m_histogram;
+};
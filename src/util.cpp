@@ -137,7 +137,7 @@ QString Util::formatCost(quint64 cost)
     return QString::number(static_cast<double>(cost), 'G', 4);
 }
 
-QString Util::formatCostRelative(quint64 selfCost, quint64 totalCost, bool addPercentSign)
+QString Util::formatCostRelative(qint64 selfCost, quint64 totalCost, bool addPercentSign)
 {
     if (!totalCost) {
         return QString();
@@ -0,0 +1,294 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <sys/resource.h>
+
+#include "perfparser.h"
+#include "perfstreamwriter.h"
+#include "settings.h"
+#include "syntheticprofile.h"
+
+#include <functional>
+
+namespace {
+struct Phase
+{
+    QString name;
+    qint64 wallTimeMs = 0;
+    double eventsPerSecond = 0;
+    // the peak of the whole process so far, in KiB
+    qint64 peakRss = 0;
+};
+
+qint64 peakRss()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // kilobytes on Linux
+    return usage.ru_maxrss;
+}
+
+// streams the synthetic profile to disk, without keeping the samples in memory
+quint64 writePerfStream(const SyntheticProfileConfig& config, QIODevice* output)
+{
+    SyntheticSampleGenerator generator(config);
+    PerfStreamWriter writer(output);
+
+    const quint32 pid = 1000;
+    const qint32 attributeId = 0;
+    writer.writeAttributes(attributeId, QByteArrayLiteral("cycles"), 1);
+    writer.writeCommand({pid, pid, 1, 0}, QByteArrayLiteral("synthetic"));
+    for (int thread = 0; thread < generator.numThreads(); ++thread) {
+        const quint32 tid = pid + static_cast<quint32>(thread);
+        writer.writeThreadStart({pid, tid, 1, 0}, pid);
+        writer.writeCommand({pid, tid, 1, 0}, QByteArrayLiteral("synthetic") + QByteArray::number(thread));
+    }
+
+    for (int id = 0; id < generator.numFunctions(); ++id) {
+        const auto symbol = SyntheticProfile::symbol(id, config.symbolComplexity);
+        const auto location = SyntheticProfile::location(id).location;
+        writer.writeLocation(id, pid, location.address, location.relAddr,
+                             QByteArrayLiteral("synthetic") + QByteArray::number(id % 64) + ".cpp", id);
+        writer.writeSymbol(id, symbol.symbol.toUtf8(), symbol.binary.toUtf8(), symbol.path.toUtf8(), symbol.relAddr,
+                           symbol.size);
+    }
+
+    SyntheticSample sample;
+    for (int i = 0; i < config.numSamples; ++i) {
+        generator.next(&sample);
+        // the threads start at time 1
+        writer.writeSample({pid, pid + static_cast<quint32>(sample.thread), sample.time + 1, sample.cpu},
+                           sample.frames, attributeId, sample.cost);
+    }
+
+    return writer.numEvents();
+}
+
+// runs one parser job to completion
+bool runParser(PerfParser* parser, const std::function<void()>& start)
+{
+    QEventLoop loop;
+    bool success = false;
+    QObject::connect(parser, &PerfParser::parsingFinished, &loop, [&loop, &success]() {
+        success = true;
+        loop.quit();
+    });
+    QObject::connect(parser, &PerfParser::parsingFailed, &loop, [&loop](const QString& errorMessage) {
+        qWarning() << "parsing failed:" << errorMessage;
+        loop.quit();
+    });
+    start();
+    loop.exec();
+    return success;
+}
+
+QJsonObject toJson(const QVector<Phase>& phases, int numSamples)
+{
+    QJsonObject phasesObject;
+    for (const auto& phase : phases) {
+        phasesObject.insert(phase.name,
+                            QJsonObject {{QStringLiteral("wallTimeMs"), phase.wallTimeMs},
+                                         {QStringLiteral("eventsPerSecond"), phase.eventsPerSecond},
+                                         {QStringLiteral("peakRssKiB"), phase.peakRss}});
+    }
+    return {{QStringLiteral("samples"), numSamples}, {QStringLiteral("phases"), phasesObject}};
+}
+
+// returns false when a phase got slower or used more memory than the tolerance allows
+bool compareToBaseline(const QVector<Phase>& phases, int numSamples, const QJsonObject& baseline, double tolerance)
+{
+    if (baseline.value(QStringLiteral("samples")).toInt() != numSamples) {
+        qWarning() << "the baseline was recorded with" << baseline.value(QStringLiteral("samples")).toInt()
+                   << "samples instead of" << numSamples;
+        return false;
+    }
+
+    bool success = true;
+    const auto baselinePhases = baseline.value(QStringLiteral("phases")).toObject();
+    for (const auto& phase : phases) {
+        const auto baselinePhase = baselinePhases.value(phase.name).toObject();
+        if (baselinePhase.isEmpty()) {
+            continue;
+        }
+
+        auto compare = [&phase, &success, tolerance](const char* metric, qint64 value, qint64 baselineValue) {
+            const auto limit = static_cast<double>(baselineValue) * (1. + tolerance / 100.);
+            if (baselineValue > 0 && static_cast<double>(value) > limit) {
+                qWarning().noquote() << QStringLiteral("regression in %1: %2 is %3 instead of %4")
+                                            .arg(phase.name, QLatin1String(metric))
+                                            .arg(value)
+                                            .arg(baselineValue);
+                success = false;
+            }
+        };
+        compare("wallTimeMs", phase.wallTimeMs, baselinePhase.value(QStringLiteral("wallTimeMs")).toInt());
+        compare("peakRssKiB", phase.peakRss, baselinePhase.value(QStringLiteral("peakRssKiB")).toInt());
+    }
+    return success;
+}
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Measures the import of a synthetic profile: writing, parsing and filtering it."));
+    parser.addHelpOption();
+
+    QCommandLineOption samplesOption(QStringLiteral("samples"), QStringLiteral("Number of samples."),
+                                     QStringLiteral("count"), QStringLiteral("100000"));
+    parser.addOption(samplesOption);
+    QCommandLineOption stackDepthOption(QStringLiteral("stack-depth"), QStringLiteral("Maximum frames per sample."),
+                                        QStringLiteral("depth"), QStringLiteral("16"));
+    parser.addOption(stackDepthOption);
+    QCommandLineOption fanOutOption(QStringLiteral("fan-out"), QStringLiteral("Callees per function."),
+                                    QStringLiteral("count"), QStringLiteral("4"));
+    parser.addOption(fanOutOption);
+    QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Number of threads."),
+                                     QStringLiteral("count"), QStringLiteral("4"));
+    parser.addOption(threadsOption);
+    QCommandLineOption outputOption(QStringLiteral("output"),
+                                    QStringLiteral("Keep the generated stream at the given *.perfparser path."),
+                                    QStringLiteral("path"));
+    parser.addOption(outputOption);
+    QCommandLineOption baselineOption(QStringLiteral("baseline"),
+                                      QStringLiteral("Compare the results to a baseline written by --save-baseline."),
+                                      QStringLiteral("path"));
+    parser.addOption(baselineOption);
+    QCommandLineOption saveBaselineOption(QStringLiteral("save-baseline"),
+                                          QStringLiteral("Write the results as JSON to the given path."),
+                                          QStringLiteral("path"));
+    parser.addOption(saveBaselineOption);
+    QCommandLineOption toleranceOption(QStringLiteral("tolerance"),
+                                       QStringLiteral("Allowed regression against the baseline in percent."),
+                                       QStringLiteral("percent"), QStringLiteral("20"));
+    parser.addOption(toleranceOption);
+    QCommandLineOption memoryBudgetOption(QStringLiteral("memory-budget"),
+                                          QStringLiteral("Spill events to disk beyond this budget, zero is unlimited."),
+                                          QStringLiteral("MiB"), QStringLiteral("0"));
+    parser.addOption(memoryBudgetOption);
+
+    parser.process(app);
+
+    SyntheticProfileConfig config;
+    config.numSamples = parser.value(samplesOption).toInt();
+    config.stackDepth = parser.value(stackDepthOption).toInt();
+    config.fanOut = parser.value(fanOutOption).toInt();
+    config.numThreads = parser.value(threadsOption).toInt();
+    Settings::instance()->setMemoryBudget(parser.value(memoryBudgetOption).toInt());
+
+    QTemporaryDir tempDir;
+    auto path = parser.value(outputOption);
+    if (path.isEmpty()) {
+        path = tempDir.filePath(QStringLiteral("synthetic.perfparser"));
+    } else if (!path.endsWith(QLatin1String(".perfparser"))) {
+        qWarning() << "the output path must end with .perfparser";
+        return 1;
+    }
+
+    QVector<Phase> phases;
+    QElapsedTimer timer;
+    auto finishPhase = [&phases, &timer](const QString& name, quint64 numEvents) {
+        Phase phase;
+        phase.name = name;
+        phase.wallTimeMs = timer.elapsed();
+        phase.eventsPerSecond = 1000. * numEvents / std::max(qint64(1), phase.wallTimeMs);
+        phase.peakRss = peakRss();
+        qInfo().noquote() << QStringLiteral("%1: %2ms, %3 events/s, peak RSS %4 KiB")
+                                 .arg(name)
+                                 .arg(phase.wallTimeMs)
+                                 .arg(phase.eventsPerSecond, 0, 'f', 0)
+                                 .arg(phase.peakRss);
+        phases.append(phase);
+    };
+
+    quint64 numEvents = 0;
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "failed to open" << path << file.errorString();
+            return 1;
+        }
+        timer.start();
+        numEvents = writePerfStream(config, &file);
+        file.close();
+        finishPhase(QStringLiteral("write"), numEvents);
+    }
+
+    PerfParser perfParser;
+    Data::TimeRange applicationTime;
+    QObject::connect(&perfParser, &PerfParser::summaryDataAvailable,
+                     [&applicationTime](const Data::Summary& summary) { applicationTime = summary.applicationTime; });
+
+    // parsing includes the aggregation of the bottom up, top down, caller/callee and per library data
+    timer.start();
+    if (!runParser(&perfParser, [&perfParser, &path]() { perfParser.startParseFile(path); })) {
+        return 1;
+    }
+    finishPhase(QStringLiteral("parse"), numEvents);
+
+    const auto numSamples = static_cast<quint64>(std::max(0, config.numSamples));
+
+    // zoom into the middle half of the profile
+    Data::FilterAction timeFilter;
+    const auto quarter = applicationTime.delta() / 4;
+    timeFilter.time = {applicationTime.start + quarter, applicationTime.end - quarter};
+    timer.start();
+    if (!runParser(&perfParser, [&perfParser, &timeFilter]() { perfParser.filterResults(timeFilter); })) {
+        return 1;
+    }
+    finishPhase(QStringLiteral("filter by time"), numSamples);
+
+    Data::FilterAction binaryFilter;
+    binaryFilter.excludeBinaries.insert(SyntheticProfile::symbol(0, 0).binary);
+    timer.start();
+    if (!runParser(&perfParser, [&perfParser, &binaryFilter]() { perfParser.filterResults(binaryFilter); })) {
+        return 1;
+    }
+    finishPhase(QStringLiteral("filter by binary"), numSamples);
+
+    const auto results = toJson(phases, config.numSamples);
+
+    const auto saveBaseline = parser.value(saveBaselineOption);
+    if (!saveBaseline.isEmpty()) {
+        QFile file(saveBaseline);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "failed to open" << saveBaseline << file.errorString();
+            return 1;
+        }
+        file.write(QJsonDocument(results).toJson());
+    }
+
+    const auto baselinePath = parser.value(baselineOption);
+    if (!baselinePath.isEmpty()) {
+        QFile file(baselinePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "failed to open" << baselinePath << file.errorString();
+            return 1;
+        }
+        const auto baseline = QJsonDocument::fromJson(file.readAll()).object();
+        if (!compareToBaseline(phases, config.numSamples, baseline, parser.value(toleranceOption).toDouble())) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDebug>
+#include <QObject>
+#include <QTest>
+
+#include <models/data.h>
+
+#include "syntheticprofile.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<quint64> s_numAllocations {0};
+std::atomic<quint64> s_allocatedBytes {0};
+
+// counts the allocations of a single run of the given function
+template<typename Function>
+void reportAllocations(const char* name, Function function)
+{
+    const auto numAllocations = s_numAllocations.load();
+    const auto allocatedBytes = s_allocatedBytes.load();
+    function();
+    qInfo("%s: %llu allocations, %llu bytes", name, s_numAllocations.load() - numAllocations,
+          s_allocatedBytes.load() - allocatedBytes);
+}
+}
+
+void* operator new(std::size_t size)
+{
+    ++s_numAllocations;
+    s_allocatedBytes += size;
+    if (auto* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+Q_DECLARE_METATYPE(SyntheticProfileConfig)
+
+class BenchModels : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        qRegisterMetaType<SyntheticProfileConfig>();
+    }
+
+    void benchBottomUp_data()
+    {
+        addProfiles();
+    }
+
+    void benchBottomUp()
+    {
+        const auto profile = generate();
+
+        reportAllocations("bottom up", [&profile]() { profile.bottomUpResults(); });
+        QBENCHMARK {
+            profile.bottomUpResults();
+        }
+    }
+
+    void benchTopDown_data()
+    {
+        addProfiles();
+    }
+
+    void benchTopDown()
+    {
+        const auto bottomUp = generate().bottomUpResults();
+
+        reportAllocations("top down", [&bottomUp]() { Data::TopDownResults::fromBottomUp(bottomUp); });
+        QBENCHMARK {
+            Data::TopDownResults::fromBottomUp(bottomUp);
+        }
+    }
+
+    void benchCallerCallee_data()
+    {
+        addProfiles();
+    }
+
+    void benchCallerCallee()
+    {
+        const auto bottomUp = generate().bottomUpResults();
+
+        auto callerCallee = [&bottomUp]() {
+            Data::CallerCalleeResults results;
+            Data::callerCalleesFromBottomUpData(bottomUp, &results);
+        };
+        reportAllocations("caller callee", callerCallee);
+        QBENCHMARK {
+            callerCallee();
+        }
+    }
+
+    void benchPerLibrary_data()
+    {
+        addProfiles();
+    }
+
+    void benchPerLibrary()
+    {
+        const auto topDown = Data::TopDownResults::fromBottomUp(generate().bottomUpResults());
+
+        reportAllocations("per library", [&topDown]() { Data::PerLibraryResults::fromTopDown(topDown); });
+        QBENCHMARK {
+            Data::PerLibraryResults::fromTopDown(topDown);
+        }
+    }
+
+    void benchPrettifySymbol_data()
+    {
+        QTest::addColumn<int>("complexity");
+
+        QTest::newRow("plain") << 0;
+        QTest::newRow("templates") << 2;
+        QTest::newRow("nested templates") << 5;
+    }
+
+    void benchPrettifySymbol()
+    {
+        QFETCH(int, complexity);
+
+        QVector<QString> symbols;
+        for (int id = 0; id < 1000; ++id) {
+            symbols.append(SyntheticProfile::symbolName(id, complexity));
+        }
+
+        auto prettify = [&symbols]() {
+            for (const auto& symbol : qAsConst(symbols)) {
+                Data::prettifySymbol(symbol);
+            }
+        };
+        reportAllocations("prettify symbol", prettify);
+        QBENCHMARK {
+            prettify();
+        }
+    }
+
+private:
+    void addProfiles()
+    {
+        QTest::addColumn<SyntheticProfileConfig>("config");
+
+        // HOTSPOT_BENCHMARK_SCALE scales the number of samples, to measure closer to real world profiles
+        const auto scale = std::max(1, qEnvironmentVariableIntValue("HOTSPOT_BENCHMARK_SCALE"));
+        auto config = [scale](int stackDepth, int fanOut, int numThreads, int symbolComplexity) {
+            SyntheticProfileConfig config;
+            config.numSamples *= scale;
+            config.stackDepth = stackDepth;
+            config.fanOut = fanOut;
+            config.numThreads = numThreads;
+            config.symbolComplexity = symbolComplexity;
+            return config;
+        };
+
+        QTest::newRow("default") << config(16, 4, 4, 1);
+        QTest::newRow("deep") << config(64, 2, 4, 1);
+        QTest::newRow("wide") << config(8, 32, 4, 1);
+        QTest::newRow("many threads") << config(16, 4, 64, 1);
+        QTest::newRow("complex symbols") << config(16, 4, 4, 4);
+    }
+
+    SyntheticProfile generate()
+    {
+        QFETCH(SyntheticProfileConfig, config);
+        return SyntheticProfile::generate(config);
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchModels);
+
+#include "bench_models.moc"
@@ -0,0 +1,151 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QIODevice>
+#include <QVector>
+#include <QtEndian>
+
+#include "parsers/perf/perfeventtype.h"
+
+/**
+ * Writes the QPERFSTREAM format that hotspot-perfparser produces, i.e. what
+ * PerfParser reads from *.perfparser files. This allows feeding the parser
+ * with synthetic data without perf or the perfparser.
+ */
+class PerfStreamWriter
+{
+public:
+    using EventType = PerfEventType;
+
+    struct Record
+    {
+        quint32 pid = 0;
+        quint32 tid = 0;
+        quint64 time = 0;
+        quint32 cpu = 0;
+    };
+
+    explicit PerfStreamWriter(QIODevice* output)
+        : m_output(output)
+    {
+        const auto magic = QByteArrayLiteral("QPERFSTREAM");
+        // including the trailing \0
+        m_output->write(magic.constData(), magic.size() + 1);
+        const auto version = qToLittleEndian(static_cast<qint32>(m_version));
+        m_output->write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    // defines the string on first use
+    qint32 string(const QByteArray& value)
+    {
+        auto it = m_strings.constFind(value);
+        if (it != m_strings.constEnd()) {
+            return it.value();
+        }
+        const qint32 id = m_strings.size();
+        m_strings.insert(value, id);
+        writeEvent(EventType::StringDefinition, [&](QDataStream& stream) { stream << id << value; });
+        return id;
+    }
+
+    void writeAttributes(qint32 id, const QByteArray& name, quint64 period)
+    {
+        const auto nameId = string(name);
+        writeEvent(EventType::AttributesDefinition, [&](QDataStream& stream) {
+            const quint32 type = 0;
+            const quint64 config = 0;
+            const bool usesFrequency = false;
+            stream << id << type << config << nameId << usesFrequency << period;
+        });
+    }
+
+    void writeCommand(const Record& record, const QByteArray& comm)
+    {
+        const auto commId = string(comm);
+        writeEvent(EventType::Command, [&](QDataStream& stream) { stream << record << commId; });
+    }
+
+    void writeThreadStart(const Record& record, quint32 ppid)
+    {
+        writeEvent(EventType::ThreadStart, [&](QDataStream& stream) { stream << record << ppid; });
+    }
+
+    void writeThreadEnd(const Record& record)
+    {
+        writeEvent(EventType::ThreadEnd, [&](QDataStream& stream) { stream << record; });
+    }
+
+    // location ids must be written in order, starting at zero
+    void writeLocation(qint32 id, quint32 pid, quint64 address, quint64 relAddr, const QByteArray& file, qint32 line,
+                       qint32 parentLocationId = -1)
+    {
+        const auto fileId = string(file);
+        writeEvent(EventType::LocationDefinition, [&](QDataStream& stream) {
+            const qint32 column = -1;
+            stream << id << address << fileId << pid << line << column << parentLocationId << relAddr;
+        });
+    }
+
+    void writeSymbol(qint32 id, const QByteArray& name, const QByteArray& binary, const QByteArray& path,
+                     quint64 relAddr, quint64 size, bool isKernel = false)
+    {
+        const auto nameId = string(name);
+        const auto binaryId = string(binary);
+        const auto pathId = string(path);
+        writeEvent(EventType::SymbolDefinition, [&](QDataStream& stream) {
+            stream << id << nameId << binaryId << pathId << isKernel << relAddr << size << pathId;
+        });
+    }
+
+    void writeSample(const Record& record, const QVector<qint32>& frames, qint32 attributeId, quint64 cost)
+    {
+        writeEvent(EventType::Sample, [&](QDataStream& stream) {
+            const quint8 guessedFrames = 0;
+            // a QVector<SampleCost> with a single entry
+            const quint32 numCosts = 1;
+            stream << record << frames << guessedFrames << numCosts << attributeId << cost;
+        });
+    }
+
+    quint64 numEvents() const
+    {
+        return m_numEvents;
+    }
+
+private:
+    friend QDataStream& operator<<(QDataStream& stream, const Record& record)
+    {
+        return stream << record.pid << record.tid << record.time << record.cpu;
+    }
+
+    template<typename Write>
+    void writeEvent(EventType type, Write write)
+    {
+        m_buffer.resize(0);
+        {
+            QDataStream stream(&m_buffer, QIODevice::WriteOnly);
+            stream.setVersion(m_version);
+            stream << static_cast<qint8>(type);
+            write(stream);
+        }
+        const auto size = qToLittleEndian(static_cast<quint32>(m_buffer.size()));
+        m_output->write(reinterpret_cast<const char*>(&size), sizeof(size));
+        m_output->write(m_buffer);
+        ++m_numEvents;
+    }
+
+    QIODevice* m_output;
+    const int m_version = QDataStream::Qt_DefaultCompiledVersion;
+    QHash<QByteArray, qint32> m_strings;
+    QByteArray m_buffer;
+    quint64 m_numEvents = 0;
+};
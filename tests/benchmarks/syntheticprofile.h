@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <models/data.h>
+
+#include <algorithm>
+
+struct SyntheticProfileConfig
+{
+    int numSamples = 20000;
+    // the maximum number of frames per sample, the actual depth varies between half of it and all of it
+    int stackDepth = 16;
+    // the number of different callees per function
+    int fanOut = 4;
+    int numThreads = 4;
+    int numCpus = 8;
+    // the nesting depth of the templates in the symbol names, zero for plain C names
+    int symbolComplexity = 1;
+    quint64 seed = 1;
+};
+
+// a xorshift generator, the distributions of <random> differ between standard libraries
+class SyntheticRandom
+{
+public:
+    explicit SyntheticRandom(quint64 seed)
+        : m_state(seed ? seed : 1)
+    {
+    }
+
+    quint64 next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * 0x2545F4914F6CDD1DULL;
+    }
+
+    int bounded(int max)
+    {
+        return max > 0 ? static_cast<int>(next() % static_cast<quint64>(max)) : 0;
+    }
+
+private:
+    quint64 m_state;
+};
+
+struct SyntheticSample
+{
+    qint32 thread = 0;
+    quint32 cpu = 0;
+    quint64 time = 0;
+    quint64 cost = 0;
+    // location ids, leaf first like the perfparser reports them
+    QVector<qint32> frames;
+};
+
+/**
+ * Generates the samples of a synthetic profile one by one, so that huge profiles
+ * can be streamed without keeping them in memory.
+ *
+ * Every thread starts in its own entry function. Each function calls fanOut
+ * different functions on the next level, the number of functions per level is
+ * capped to keep the symbol table realistic.
+ */
+class SyntheticSampleGenerator
+{
+public:
+    explicit SyntheticSampleGenerator(const SyntheticProfileConfig& config)
+        : m_stackDepth(std::max(1, config.stackDepth))
+        , m_fanOut(std::max(1, config.fanOut))
+        , m_numThreads(std::max(1, config.numThreads))
+        , m_numCpus(std::max(1, config.numCpus))
+        , m_random(config.seed)
+    {
+        const int maxFunctionsPerLevel = 1024;
+        for (int level = 0, size = m_numThreads; level < m_stackDepth; ++level) {
+            m_levelOffsets.append(m_numFunctions);
+            m_levelSizes.append(size);
+            m_numFunctions += size;
+            size = std::min(size * m_fanOut, maxFunctionsPerLevel);
+        }
+    }
+
+    int numFunctions() const
+    {
+        return m_numFunctions;
+    }
+
+    int numThreads() const
+    {
+        return m_numThreads;
+    }
+
+    // the frames vector of the sample gets reused
+    void next(SyntheticSample* sample)
+    {
+        m_time += 1000 + m_random.bounded(1000);
+        sample->time = m_time;
+        sample->cost = 1 + m_random.bounded(1000);
+        sample->thread = m_random.bounded(m_numThreads);
+        sample->cpu = static_cast<quint32>((sample->thread + m_random.bounded(2)) % m_numCpus);
+
+        const auto depth = m_stackDepth / 2 + 1 + m_random.bounded(m_stackDepth - m_stackDepth / 2);
+        sample->frames.resize(std::min(depth, m_stackDepth));
+        auto function = sample->thread;
+        for (int level = 0, c = sample->frames.size(); level < c; ++level) {
+            if (level > 0) {
+                function = (function * m_fanOut + m_random.bounded(m_fanOut)) % m_levelSizes[level];
+            }
+            // the leaf comes first
+            sample->frames[c - level - 1] = m_levelOffsets[level] + function;
+        }
+    }
+
+private:
+    int m_stackDepth;
+    int m_fanOut;
+    int m_numThreads;
+    int m_numCpus;
+    SyntheticRandom m_random;
+    quint64 m_time = 0;
+    int m_numFunctions = 0;
+    // the first function id of every level
+    QVector<int> m_levelOffsets;
+    QVector<int> m_levelSizes;
+};
+
+/**
+ * A deterministic, synthetic profile for benchmarks, kept in memory.
+ */
+struct SyntheticProfile
+{
+    using Sample = SyntheticSample;
+
+    // indexed by location id, one location per function
+    QVector<Data::Symbol> symbols;
+    QVector<Data::FrameLocation> locations;
+    QVector<Sample> samples;
+
+    static QString symbolName(int id, int complexity)
+    {
+        const auto function = QStringLiteral("func%1").arg(id);
+        if (complexity <= 0) {
+            return function;
+        }
+
+        auto type = QStringLiteral("int");
+        for (int i = 0; i < complexity; ++i) {
+            type = QStringLiteral("std::vector<%1, std::allocator<%1> >").arg(type);
+        }
+        return QStringLiteral("ns%1::Type<%2>::%3(%2 const&)").arg(id % 16).arg(type, function);
+    }
+
+    static Data::Symbol symbol(int id, int complexity)
+    {
+        const auto binary = QStringLiteral("libsynthetic%1.so").arg(id % 8);
+        return Data::Symbol(symbolName(id, complexity), static_cast<quint64>(id) * 0x100, 0x100, binary,
+                            QLatin1String("/usr/lib/") + binary);
+    }
+
+    static Data::FrameLocation location(int id)
+    {
+        return Data::FrameLocation(-1, Data::Location(0x400000 + static_cast<quint64>(id) * 0x100 + 0x10,
+                                                      static_cast<quint64>(id) * 0x100 + 0x10,
+                                                      QStringLiteral("synthetic%1.cpp:%2").arg(id % 64).arg(id)));
+    }
+
+    static SyntheticProfile generate(const SyntheticProfileConfig& config)
+    {
+        SyntheticSampleGenerator generator(config);
+        SyntheticProfile profile;
+
+        const auto numFunctions = generator.numFunctions();
+        profile.symbols.reserve(numFunctions);
+        profile.locations.reserve(numFunctions);
+        for (int id = 0; id < numFunctions; ++id) {
+            profile.symbols.append(symbol(id, config.symbolComplexity));
+            profile.locations.append(location(id));
+        }
+
+        profile.samples.resize(std::max(0, config.numSamples));
+        for (auto& sample : profile.samples) {
+            generator.next(&sample);
+        }
+
+        return profile;
+    }
+
+    // feeds all samples into a bottom up tree, the way the perfparser does it
+    Data::BottomUpResults bottomUpResults() const
+    {
+        Data::BottomUpResults results;
+        results.symbols = symbols;
+        results.locations = locations;
+        results.costs.addType(0, QStringLiteral("cycles"), Data::Costs::Unit::Unknown);
+        for (const auto& sample : samples) {
+            results.addEvent(0, sample.cost, sample.frames, [](const Data::Symbol&, const Data::Location&) {});
+        }
+        Data::BottomUp::initializeParents(&results.root);
+        results.topRows = Data::topChildren(results.root.children, results.costs);
+        return results;
+    }
+};
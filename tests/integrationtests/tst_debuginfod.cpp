@@ -0,0 +1,226 @@
+/*
+    SPDX-FileCopyrightText: Milian Wolff <milian.wolff@kdab.com>
+    SPDX-FileCopyrightText: 2016-2022 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QTimer>
+
+#include "debuginfodprefetcher.h"
+
+#include <algorithm>
+
+namespace {
+/**
+ * Stands in for a debuginfod server, serving the given files and answering everything else with 404.
+ * The responses get delayed a bit, so that concurrent downloads overlap.
+ */
+class DebuginfodServer : public QTcpServer
+{
+public:
+    explicit DebuginfodServer(QObject* parent = nullptr)
+        : QTcpServer(parent)
+    {
+        connect(this, &QTcpServer::newConnection, this, [this]() {
+            while (auto* socket = nextPendingConnection()) {
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() { handleRequest(socket); });
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+        listen(QHostAddress::LocalHost);
+    }
+
+    QString url() const
+    {
+        return QStringLiteral("http://127.0.0.1:%1").arg(serverPort());
+    }
+
+    // the contents by path, e.g. /buildid/<hex>/debuginfo
+    QHash<QByteArray, QByteArray> files;
+    QVector<QByteArray> requests;
+    int maxPendingRequests = 0;
+
+private:
+    void handleRequest(QTcpSocket* socket)
+    {
+        auto& request = m_buffers[socket];
+        request += socket->readAll();
+        if (!request.contains("\r\n\r\n")) {
+            return;
+        }
+        const auto path = request.split(' ').value(1);
+        m_buffers.remove(socket);
+
+        requests.append(path);
+        ++m_pendingRequests;
+        maxPendingRequests = std::max(maxPendingRequests, m_pendingRequests);
+
+        QTimer::singleShot(20, socket, [this, socket, path]() {
+            --m_pendingRequests;
+            const auto it = files.constFind(path);
+            if (it == files.constEnd()) {
+                socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            } else {
+                socket->write("HTTP/1.1 200 OK\r\nContent-Length: " + QByteArray::number(it->size())
+                              + "\r\nConnection: close\r\n\r\n" + *it);
+            }
+            socket->disconnectFromHost();
+        });
+    }
+
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    int m_pendingRequests = 0;
+};
+
+QByteArray debugInfoPath(const QByteArray& buildId)
+{
+    return "/buildid/" + buildId.toHex() + "/debuginfo";
+}
+
+QByteArray readFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+}
+
+class TestDebuginfod : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testReadBuildIds()
+    {
+        const auto md5Id = QByteArray::fromHex("00112233445566778899aabbccddeeff");
+        const auto sha1Id = QByteArray::fromHex("0123456789abcdef0123456789abcdef01234567");
+
+        QByteArray buildIdSection;
+        {
+            QDataStream stream(&buildIdSection, QIODevice::WriteOnly);
+            stream.setByteOrder(QDataStream::LittleEndian);
+            auto writeBuildId = [&stream](const QByteArray& id, bool withSize, const QByteArray& fileName) {
+                // the file name is null terminated and padded to 8 bytes
+                const auto name = fileName + QByteArray(8 - fileName.size() % 8, '\0');
+                const quint16 misc = withSize ? 1 << 15 : 0;
+                stream << quint32(67) << misc << quint16(8 + 4 + 24 + name.size()) << qint32(-1);
+                auto paddedId = id + QByteArray(24 - id.size(), '\0');
+                if (withSize) {
+                    paddedId[20] = static_cast<char>(id.size());
+                }
+                stream.writeRawData(paddedId.constData(), paddedId.size());
+                stream.writeRawData(name.constData(), name.size());
+            };
+            writeBuildId(md5Id, true, "/usr/lib/libfoo.so");
+            writeBuildId(sha1Id, false, "/usr/bin/app");
+            writeBuildId(sha1Id, false, "/usr/bin/app");
+            writeBuildId(QByteArray(20, '\0'), false, "[vdso]");
+        }
+
+        QTemporaryFile perfData;
+        QVERIFY(perfData.open());
+        {
+            QDataStream stream(&perfData);
+            stream.setByteOrder(QDataStream::LittleEndian);
+            const quint64 headerSize = 104;
+            // magic, header size, attribute size, the attributes, the data and the event types sections
+            stream << quint64(0x32454c4946524550ULL) << headerSize << quint64(0) << quint64(0) << quint64(0)
+                   << headerSize << quint64(0) << quint64(0) << quint64(0);
+            // the feature bits for the tracing data and the build-ids
+            stream << quint64((1 << 1) | (1 << 2)) << quint64(0) << quint64(0) << quint64(0);
+            // the feature sections follow the empty data section
+            stream << quint64(0) << quint64(0) << quint64(headerSize + 2 * 16) << quint64(buildIdSection.size());
+            stream.writeRawData(buildIdSection.constData(), buildIdSection.size());
+        }
+        perfData.close();
+
+        QCOMPARE(DebuginfodPrefetcher::readBuildIds(perfData.fileName()), (QVector<QByteArray> {md5Id, sha1Id}));
+        QVERIFY(DebuginfodPrefetcher::readBuildIds(QStringLiteral("/does/not/exist")).isEmpty());
+    }
+
+    void testPrefetch()
+    {
+        const QVector<QByteArray> buildIds = {
+            QByteArray::fromHex("0123456789abcdef0123456789abcdef01234567"),
+            QByteArray::fromHex("1123456789abcdef0123456789abcdef01234567"),
+            QByteArray::fromHex("2123456789abcdef0123456789abcdef01234567"),
+            QByteArray::fromHex("3123456789abcdef0123456789abcdef01234567"),
+        };
+
+        // the first server knows nothing, so every download falls back to the second one
+        DebuginfodServer emptyServer;
+        DebuginfodServer server;
+        QVERIFY(emptyServer.isListening());
+        QVERIFY(server.isListening());
+        for (int i = 0; i < 3; ++i) {
+            server.files.insert(debugInfoPath(buildIds[i]), "debuginfo " + buildIds[i].toHex());
+        }
+
+        QTemporaryDir cache;
+        QVERIFY(cache.isValid());
+        const QStringList urls = {emptyServer.url() + QLatin1Char('/'), server.url()};
+
+        DebuginfodPrefetcher prefetcher(urls, cache.path());
+        prefetcher.setMaxParallelDownloads(2);
+        QSignalSpy progressSpy(&prefetcher, &DebuginfodPrefetcher::downloadProgress);
+
+        const auto result = prefetcher.prefetch(buildIds);
+        QCOMPARE(result.cached, 0);
+        QCOMPARE(result.downloaded, 3);
+        QCOMPARE(result.failed, 1);
+
+        QCOMPARE(emptyServer.requests.size(), 4);
+        QCOMPARE(server.requests.size(), 4);
+        QVERIFY(emptyServer.maxPendingRequests <= 2);
+        QVERIFY(server.maxPendingRequests <= 2);
+
+        for (int i = 0; i < 3; ++i) {
+            QCOMPARE(readFile(prefetcher.cachedDebugInfo(buildIds[i])), "debuginfo " + buildIds[i].toHex());
+        }
+        // no server has the last one, which gets recorded with an empty file like the debuginfod client does
+        QVERIFY(QFile::exists(prefetcher.cachedDebugInfo(buildIds[3])));
+        QVERIFY(readFile(prefetcher.cachedDebugInfo(buildIds[3])).isEmpty());
+
+        QVERIFY(!progressSpy.isEmpty());
+        const auto lastProgress = progressSpy.constLast();
+        QCOMPARE(lastProgress.at(1).toLongLong(), qlonglong(4));
+        QCOMPARE(lastProgress.at(2).toLongLong(), qlonglong(4));
+
+        // the next run doesn't ask for the recent miss again
+        DebuginfodPrefetcher secondRun(urls, cache.path());
+        const auto secondResult = secondRun.prefetch(buildIds);
+        QCOMPARE(secondResult.cached, 3);
+        QCOMPARE(secondResult.downloaded, 0);
+        QCOMPARE(secondResult.failed, 1);
+        QCOMPARE(emptyServer.requests.size(), 4);
+        QCOMPARE(server.requests.size(), 4);
+
+        // unless the miss expired
+        QFile cacheMiss(cache.path() + QLatin1String("/cache_miss_s"));
+        QVERIFY(cacheMiss.open(QIODevice::WriteOnly));
+        cacheMiss.write("0\n");
+        cacheMiss.close();
+        DebuginfodPrefetcher thirdRun(urls, cache.path());
+        const auto thirdResult = thirdRun.prefetch(buildIds);
+        QCOMPARE(thirdResult.cached, 3);
+        QCOMPARE(thirdResult.failed, 1);
+        QCOMPARE(server.requests.size(), 5);
+        QCOMPARE(server.requests.constLast(), debugInfoPath(buildIds[3]));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDebuginfod)
+
+#include "tst_debuginfod.moc"
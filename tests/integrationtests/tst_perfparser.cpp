@@ -16,14 +16,18 @@
 #include <QTextStream>
 
 #include "data.h"
+#include "parsers/importedprofile.h"
+#include "parsers/pprof/pprofparser.h"
 #include "perfparser.h"
 #include "perfrecord.h"
+#include "settings.h"
 #include "unistd.h"
 #include "util.h"
 
 #include "../testutils.h"
 #include <hotspot-config.h>
 
+#include <algorithm>
 #include <exception>
 
 namespace {
@@ -66,6 +70,28 @@ int maxElementTopIndex(const Results& collection, int costIndex = 0)
                                       });
     return std::distance(collection.root.children.begin(), topResult);
 }
+
+// minimal protobuf encoding, to write pprof profiles by hand
+QByteArray varint(quint64 value)
+{
+    QByteArray bytes;
+    do {
+        const auto byte = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        bytes.append(value ? static_cast<char>(byte | 0x80) : byte);
+    } while (value);
+    return bytes;
+}
+
+QByteArray varintField(quint32 field, quint64 value)
+{
+    return varint(field << 3) + varint(value);
+}
+
+QByteArray bytesField(quint32 field, const QByteArray& value)
+{
+    return varint((field << 3) | 2) + varint(value.size()) + value;
+}
 }
 
 struct ComparableSymbol
@@ -649,6 +675,273 @@ private slots:
         QCOMPARE(actual, expected);
     }
 
+    void testCostAggregationWithoutReparsing_data()
+    {
+        testCustomCostAggregation_data();
+    }
+
+    void testCostAggregationWithoutReparsing()
+    {
+        QFETCH(Settings::CostAggregation, aggregation);
+        QFETCH(QString, filename);
+
+        QFile expectedData(QFINDTESTDATA("custom_cost_aggregation_testfiles/" + filename));
+        QVERIFY(expectedData.open(QIODevice::ReadOnly | QIODevice::Text));
+        QStringList expectedRoots;
+        for (const auto& line : expectedData.readAll().split('\n')) {
+            if (line.startsWith('\t') && !line.startsWith("\t\t")) {
+                expectedRoots.append(QString::fromUtf8(line.mid(1)));
+            }
+        }
+        std::sort(expectedRoots.begin(), expectedRoots.end());
+
+        const auto perfData = QFINDTESTDATA("custom_cost_aggregation_testfiles/custom_cost_aggregation.perfparser");
+        QVERIFY(!perfData.isEmpty() && QFile::exists(perfData));
+
+        Settings::instance()->setCostAggregation(Settings::CostAggregation::BySymbol);
+
+        PerfParser parser(this);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        parser.startParseFile(perfData);
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto parsed = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+
+        // the stored events get re-aggregated, without parsing the file again
+        Settings::instance()->setCostAggregation(aggregation);
+        parser.filterResults({});
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto aggregated = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+
+        QStringList actualRoots;
+        for (const auto& child : aggregated.root.children) {
+            actualRoots.append(child.symbol.symbol);
+        }
+        std::sort(actualRoots.begin(), actualRoots.end());
+        QCOMPARE(actualRoots, expectedRoots);
+
+        for (int i = 0; i < parsed.costs.numTypes(); ++i) {
+            QCOMPARE(aggregated.costs.totalCost(i), parsed.costs.totalCost(i));
+        }
+
+        Settings::instance()->setCostAggregation(Settings::CostAggregation::BySymbol);
+    }
+
+    void testImportFoldedStacks()
+    {
+        QTemporaryFile folded;
+        folded.setFileTemplate(QStringLiteral("XXXXXX.folded"));
+        QVERIFY(folded.open());
+        folded.write("main;compute;[libm.so.6] 3\n"
+                     "main;compute 2\n"
+                     "# comment\n"
+                     "main;schedule_[k] 1\n"
+                     "main;compute 2\n");
+        folded.close();
+
+        PerfParser parser(this);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+        QSignalSpy topDownDataSpy(&parser, &PerfParser::topDownDataAvailable);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        parser.startParseFile(folded.fileName());
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QVERIFY(!parser.canExport());
+
+        QCOMPARE(topDownDataSpy.count(), 1);
+        const auto topDown = topDownDataSpy.takeFirst().at(0).value<Data::TopDownResults>();
+        QCOMPARE(topDown.root.children.size(), 1);
+        const auto& main = topDown.root.children.first();
+        QCOMPARE(main.symbol.symbol, QStringLiteral("main"));
+        QCOMPARE(topDown.inclusiveCosts.cost(0, main.id), qint64(8));
+        QVERIFY(searchForChildSymbol(topDown.root, QStringLiteral("schedule")));
+
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto bottomUp = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+        QCOMPARE(bottomUp.costs.totalCost(0), qint64(8));
+        const auto kernel = std::find_if(
+            bottomUp.root.children.begin(), bottomUp.root.children.end(),
+            [](const Data::BottomUp& entry) { return entry.symbol.symbol == QLatin1String("schedule"); });
+        QVERIFY(kernel != bottomUp.root.children.end());
+        QVERIFY(kernel->symbol.isKernel);
+        QCOMPARE(bottomUp.costs.cost(0, kernel->id), qint64(1));
+        const auto libm = std::find_if(
+            bottomUp.root.children.begin(), bottomUp.root.children.end(),
+            [](const Data::BottomUp& entry) { return entry.symbol.binary == QLatin1String("libm.so.6"); });
+        QVERIFY(libm != bottomUp.root.children.end());
+        QCOMPARE(bottomUp.costs.cost(0, libm->id), qint64(3));
+    }
+
+    void testFilteredComparison()
+    {
+        auto writeFolded = [](QTemporaryFile* file, const QByteArray& data) {
+            file->setFileTemplate(QStringLiteral("XXXXXX.folded"));
+            QVERIFY(file->open());
+            file->write(data);
+            file->close();
+        };
+        QTemporaryFile baseline;
+        writeFolded(&baseline, "main;compute 3\nmain;idle 1\n");
+        QTemporaryFile comparison;
+        writeFolded(&comparison, "main;compute 5\nmain;idle 1\n");
+
+        PerfParser parser(this);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        parser.startCompareFiles(baseline.fileName(), comparison.fileName());
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QVERIFY(parser.isComparing());
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto unfiltered = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+
+        auto costsOf = [](const Data::BottomUpResults& results) {
+            QStringList costs;
+            for (const auto& child : results.root.children) {
+                QStringList row = {child.symbol.symbol};
+                for (int i = 0; i < results.costs.numTypes(); ++i) {
+                    row.append(QString::number(results.costs.cost(i, child.id)));
+                }
+                costs.append(row.join(QLatin1Char(' ')));
+            }
+            std::sort(costs.begin(), costs.end());
+            return costs;
+        };
+        QCOMPARE(costsOf(unfiltered), QStringList({"compute 5 2", "idle 1 0"}));
+
+        // the filter can't be applied to the baseline, so the diff is not restricted to the filtered costs
+        const auto compute = std::find_if(
+            unfiltered.root.children.begin(), unfiltered.root.children.end(),
+            [](const Data::BottomUp& entry) { return entry.symbol.symbol == QLatin1String("compute"); });
+        QVERIFY(compute != unfiltered.root.children.end());
+        Data::FilterAction filter;
+        filter.excludeSymbols.insert(compute->symbol);
+        parser.filterResults(filter);
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto filtered = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+        QCOMPARE(costsOf(filtered), costsOf(unfiltered));
+        for (int i = 0; i < unfiltered.costs.numTypes(); ++i) {
+            QCOMPARE(filtered.costs.totalCost(i), unfiltered.costs.totalCost(i));
+        }
+    }
+
+    void testMergedAggregationRoots()
+    {
+        auto writeFolded = [](QTemporaryFile* file, const QByteArray& data) {
+            file->setFileTemplate(QStringLiteral("XXXXXX.folded"));
+            QVERIFY(file->open());
+            file->write(data);
+            file->close();
+        };
+        // both recordings only have CPU 0 and the same process, but are not from the same host
+        QTemporaryFile first;
+        writeFolded(&first, "main;compute 3\nmain;idle 1\n");
+        QTemporaryFile second;
+        writeFolded(&second, "main;compute 5\n");
+
+        Settings::instance()->setCostAggregation(Settings::CostAggregation::ByCPU);
+
+        PerfParser parser(this);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        auto rootCosts = [](const Data::BottomUpResults& results) {
+            QStringList roots;
+            for (const auto& child : results.root.children) {
+                roots.append(child.symbol.symbol + QLatin1Char(' ')
+                             + QString::number(results.costs.cost(0, child.id)));
+            }
+            std::sort(roots.begin(), roots.end());
+            return roots;
+        };
+
+        parser.startParseFiles({first.fileName(), second.fileName()});
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto merged = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+        QCOMPARE(rootCosts(merged), QStringList({"CPU 0 4", "CPU 1 5"}));
+
+        // excluding a CPU that doesn't exist re-aggregates all the merged events
+        Data::FilterAction filter;
+        filter.excludeCpuIds.push_back(99);
+        parser.filterResults(filter);
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto filtered = bottomUpDataSpy.takeFirst().at(0).value<Data::BottomUpResults>();
+        QCOMPARE(rootCosts(filtered), rootCosts(merged));
+        QCOMPARE(filtered.costs.totalCost(0), merged.costs.totalCost(0));
+
+        Settings::instance()->setCostAggregation(Settings::CostAggregation::BySymbol);
+    }
+
+    void testImportPprof()
+    {
+        const QVector<QByteArray> strings = {"", "cpu", "nanoseconds", "main", "compute", "/usr/bin/app", "main.cpp"};
+
+        QByteArray data;
+        data += bytesField(1, varintField(1, 1) + varintField(2, 2));
+        data += bytesField(3, varintField(1, 1) + varintField(5, 5));
+        // compute got inlined into main
+        data += bytesField(4,
+                           varintField(1, 1) + varintField(2, 1) + varintField(3, 0x1000)
+                               + bytesField(4, varintField(1, 2) + varintField(2, 20))
+                               + bytesField(4, varintField(1, 1) + varintField(2, 10)));
+        data += bytesField(4, varintField(1, 2) + varintField(2, 1) + varintField(3, 0x2000));
+        data += bytesField(5, varintField(1, 1) + varintField(2, 3) + varintField(4, 6));
+        data += bytesField(5, varintField(1, 2) + varintField(2, 4) + varintField(4, 6));
+        // packed location ids, leaf first
+        data += bytesField(2, bytesField(1, varint(2) + varint(1)) + bytesField(2, varint(100)));
+        // unpacked location ids
+        data += bytesField(2, varintField(1, 1) + varintField(2, 50));
+        for (const auto& string : strings) {
+            data += bytesField(6, string);
+        }
+        data += varintField(9, 1000);
+        data += varintField(10, 5000);
+
+        ImportedProfile profile;
+        QCOMPARE(PprofParser::parse(data, &profile), QString());
+
+        QCOMPARE(profile.costTypes.size(), 1);
+        QCOMPARE(profile.costTypes[0].name, QStringLiteral("cpu"));
+        QCOMPARE(profile.costTypes[0].unit, Data::Costs::Unit::Time);
+        QCOMPARE(profile.startTime, quint64(1000));
+        QCOMPARE(profile.duration, quint64(5000));
+
+        QCOMPARE(profile.frames.size(), 3);
+        QCOMPARE(profile.frames[0].symbol, QStringLiteral("compute"));
+        QCOMPARE(profile.frames[0].line, 20);
+        QCOMPARE(profile.frames[0].parent, 1);
+        QCOMPARE(profile.frames[1].symbol, QStringLiteral("main"));
+        QCOMPARE(profile.frames[1].file, QStringLiteral("main.cpp"));
+        QCOMPARE(profile.frames[1].binary, QStringLiteral("app"));
+        QCOMPARE(profile.frames[1].path, QStringLiteral("/usr/bin/app"));
+        QCOMPARE(profile.frames[1].parent, -1);
+        QCOMPARE(profile.frames[2].symbol, QString());
+        QCOMPARE(profile.frames[2].address, quint64(0x2000));
+
+        QCOMPARE(profile.samples.size(), 2);
+        QCOMPARE(profile.samples[0].frames, (QVector<qint32> {2, 0}));
+        QCOMPARE(profile.samples[0].costs, QVector<quint64> {100});
+        QCOMPARE(profile.samples[1].frames, QVector<qint32> {0});
+        QCOMPARE(profile.samples[1].costs, QVector<quint64> {50});
+
+        ImportedProfile truncated;
+        QVERIFY(!PprofParser::parse(data.chopped(1), &truncated).isEmpty());
+    }
+
 #if KF5Archive_FOUND
     void testDecompression_data()
     {
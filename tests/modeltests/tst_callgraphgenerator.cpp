@@ -40,10 +40,12 @@ private slots:
             }
         }
 
+        CallGraph graph(key, 0.4 / 100.f);
+        graph.expand(results, Direction::Caller, 3);
+
         QString test;
         QTextStream stream(&test);
-        QHash<Data::Symbol, QString> lookup;
-        resultsToDot(3, Direction::Caller, key, results, 0, stream, lookup, 0.4 / 100.f);
+        graph.writeDot(stream, 3, 0, {});
 
         int parent3Pos = test.indexOf("parent3");
         int parent2Pos = test.indexOf("parent2");
@@ -67,10 +69,12 @@ private slots:
             }
         }
 
+        CallGraph graph(key, 0.4 / 100.f);
+        graph.expand(results, Direction::Callee, 3);
+
         QString test;
         QTextStream stream(&test);
-        QHash<Data::Symbol, QString> lookup;
-        resultsToDot(3, Direction::Callee, key, results, 0, stream, lookup, 0.4 / 100.f);
+        graph.writeDot(stream, 0, 3, {});
 
         int child1Pos = test.indexOf("child1");
         int child2Pos = test.indexOf("child2");
@@ -78,6 +82,57 @@ private slots:
         QVERIFY(child1Pos < child2Pos);
     }
 
+    void testIncrementalExpansion()
+    {
+        // a -> b -> c -> d, b -> e with a cost below the threshold
+        Data::CallerCalleeResults results;
+        results.selfCosts.addType(0, "cycles", Data::Costs::Unit::Unknown);
+        results.selfCosts.addTotalCost(0, 1000);
+        const auto a = Data::Symbol("a");
+        const auto b = Data::Symbol("b");
+        const auto c = Data::Symbol("c");
+        const auto d = Data::Symbol("d");
+        const auto e = Data::Symbol("e");
+        auto addCall = [&results](const Data::Symbol& caller, const Data::Symbol& callee, qint64 cost) {
+            results.entry(caller).callee(callee, 1)[0] += cost;
+            results.entry(callee).caller(caller, 1)[0] += cost;
+        };
+        addCall(a, b, 500);
+        addCall(b, c, 400);
+        addCall(c, d, 300);
+        addCall(b, e, 1);
+
+        CallGraph graph(b, 0.01);
+        graph.expand(results, Direction::Callee, 1);
+        QCOMPARE(graph.depth(Direction::Callee), 1);
+        QCOMPARE(graph.nodes().size(), 2);
+        QCOMPARE(graph.nodes()[1].symbol, c);
+
+        // only the new frontier gets expanded
+        graph.expand(results, Direction::Callee, 2);
+        QCOMPARE(graph.nodes().size(), 3);
+        QCOMPARE(graph.nodes()[2].symbol, d);
+        QCOMPARE(graph.nodes()[2].distance[static_cast<int>(Direction::Callee)], 2);
+        QCOMPARE(graph.edges().size(), 2);
+
+        graph.expand(results, Direction::Caller, 3);
+        QCOMPARE(graph.nodes().size(), 4);
+        QCOMPARE(graph.nodes()[3].symbol, a);
+        // there are no more callers, so the graph is complete
+        QCOMPARE(graph.depth(Direction::Caller), 3);
+
+        // the shallower graph is a subset of the expanded one
+        QString dot;
+        QTextStream stream(&dot);
+        graph.writeDot(stream, 1, 1, {});
+        stream.flush();
+        QVERIFY(dot.contains("node1 [label=\"c\"]"));
+        QVERIFY(!dot.contains("node2 "));
+        QVERIFY(dot.contains("node3 -> node0"));
+        QVERIFY(dot.contains("node0 -> node1"));
+        QVERIFY(!dot.contains("node1 -> node2"));
+    }
+
 private:
     Data::CallerCalleeResults callerCalleeResults(const QString& filename)
     {
@@ -6,19 +6,28 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
 #include <QObject>
 #include <QProcess>
 #include <QStandardPaths>
 #include <QString>
 #include <QStringList>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
 #include <QVector>
 
+#include <models/controlflowgraph.h>
+#include <models/disassemblyindex.h>
 #include <models/disassemblyoutput.h>
 #include "data.h"
 
+#include <future>
+#include <vector>
+
 class TestDisassemblyOutput : public QObject
 {
     Q_OBJECT
@@ -85,6 +94,204 @@ private slots:
         QCOMPARE(actualText, expectedText);
     }
 
+    void testCacheKey()
+    {
+        QTemporaryFile binary;
+        QVERIFY(binary.open());
+        binary.write("binary");
+        binary.close();
+
+        Data::Symbol symbol = {"foo", 0x1000, 0x100, "binary", binary.fileName(), binary.fileName()};
+        const auto key = DisassemblyOutput::CacheKey::forSymbol("objdump", symbol);
+        QCOMPARE(key.actualPath, binary.fileName());
+        QVERIFY(key.lastModified > 0);
+        QCOMPARE(DisassemblyOutput::CacheKey::forSymbol("objdump", symbol), key);
+        QCOMPARE(qHash(DisassemblyOutput::CacheKey::forSymbol("objdump", symbol)), qHash(key));
+
+        QVERIFY(!(DisassemblyOutput::CacheKey::forSymbol("arm-linux-gnueabi-objdump", symbol) == key));
+        auto other = symbol;
+        other.relAddr += other.size;
+        QVERIFY(!(DisassemblyOutput::CacheKey::forSymbol("objdump", other) == key));
+
+        // a rebuilt binary must not hit the cached output of the old one
+        QFile file(binary.fileName());
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        const auto modified = QDateTime::fromMSecsSinceEpoch(key.lastModified + 1000);
+        QVERIFY(file.setFileTime(modified, QFileDevice::FileModificationTime));
+        file.close();
+        QVERIFY(!(DisassemblyOutput::CacheKey::forSymbol("objdump", symbol) == key));
+    }
+
+    void testConcurrentDisassembly_data()
+    {
+        testSymbol_data();
+    }
+
+    void testConcurrentDisassembly()
+    {
+        QFETCH(Data::Symbol, symbol);
+
+        symbol.actualPath = QFINDTESTDATA(symbol.binary);
+        QVERIFY(!symbol.actualPath.isEmpty() && QFile::exists(symbol.actualPath));
+
+        // the disassembly page runs this on the worker threads
+        const auto expected = DisassemblyOutput::disassemble("objdump", "x86_64", symbol);
+        QVERIFY(expected);
+        std::vector<std::future<DisassemblyOutput>> outputs;
+        for (int i = 0; i < 4; ++i) {
+            outputs.push_back(std::async(std::launch::async, [symbol]() {
+                return DisassemblyOutput::disassemble("objdump", "x86_64", symbol);
+            }));
+        }
+        for (auto& output : outputs) {
+            const auto actual = output.get();
+            QVERIFY(actual);
+            QCOMPARE(actual.disassemblyLines.size(), expected.disassemblyLines.size());
+            for (int i = 0, c = actual.disassemblyLines.size(); i < c; ++i) {
+                QCOMPARE(actual.disassemblyLines[i].addr, expected.disassemblyLines[i].addr);
+                QCOMPARE(actual.disassemblyLines[i].disassembly, expected.disassemblyLines[i].disassembly);
+            }
+        }
+    }
+
+    void testIndex_data()
+    {
+        testSymbol_data();
+    }
+
+    void testIndex()
+    {
+        QFETCH(Data::Symbol, symbol);
+
+        symbol.actualPath = QFINDTESTDATA(symbol.binary);
+        QVERIFY(!symbol.actualPath.isEmpty() && QFile::exists(symbol.actualPath));
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto indexPath = dir.filePath("binary.index");
+
+        QString errorMessage;
+        const auto index = DisassemblyIndex::build("objdump", symbol.actualPath, indexPath, &errorMessage);
+        QVERIFY2(index.isValid(), qPrintable(errorMessage));
+        QVERIFY(index.numLines() > 0);
+        QCOMPARE(DisassemblyIndex::load(indexPath).numLines(), index.numLines());
+
+        auto instructions = [](const DisassemblyOutput& disassemblyOutput) {
+            QStringList ret;
+            for (const auto& line : disassemblyOutput.disassemblyLines) {
+                if (line.addr) {
+                    ret.append(QString::number(line.addr, 16) + line.disassembly);
+                }
+            }
+            return ret;
+        };
+
+        const auto expected = DisassemblyOutput::disassemble("objdump", "x86_64", symbol);
+        const auto actual = index.disassemble(symbol);
+        QVERIFY(actual);
+        QCOMPARE(instructions(actual), instructions(expected));
+
+        // loading marks the index as recently used
+        const auto lastWeek = QDateTime::currentDateTime().addDays(-7);
+        {
+            QFile file(indexPath);
+            QVERIFY(file.open(QIODevice::ReadWrite));
+            QVERIFY(file.setFileTime(lastWeek, QFileDevice::FileModificationTime));
+        }
+        QVERIFY(DisassemblyIndex::load(indexPath).isValid());
+        QVERIFY(QFileInfo(indexPath).lastModified() > lastWeek.addDays(1));
+    }
+
+    void testIndexEviction()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        const auto now = QDateTime::currentDateTime();
+        auto addIndex = [&dir, &now](const QString& name, int size, int daysUnused) {
+            QFile file(dir.filePath(name));
+            // flush before setting the time, the write would update it otherwise
+            return file.open(QIODevice::WriteOnly) && file.write(QByteArray(size, 'x')) == size && file.flush()
+                && file.setFileTime(now.addDays(-daysUnused), QFileDevice::FileModificationTime);
+        };
+        auto remaining = [&dir]() { return QDir(dir.path()).entryList(QDir::Files, QDir::Name); };
+
+        QVERIFY(addIndex("a.index", 100, 0));
+        QVERIFY(addIndex("b.index", 100, 2));
+        QVERIFY(addIndex("c.index", 100, 1));
+        QVERIFY(addIndex("d.index", 100, 40));
+        // not an index, e.g. an unfinished QSaveFile
+        QVERIFY(addIndex("e.index.abcdef", 100, 40));
+
+        DisassemblyIndex::evictCache(dir.path());
+        QCOMPARE(remaining(), QStringList({"a.index", "b.index", "c.index", "e.index.abcdef"}));
+
+        // the least recently used ones go first
+        DisassemblyIndex::evictCache(dir.path(), 250);
+        QCOMPARE(remaining(), QStringList({"a.index", "c.index", "e.index.abcdef"}));
+
+        DisassemblyIndex::evictCache(dir.path(), 250, 12 * 60 * 60);
+        QCOMPARE(remaining(), QStringList({"a.index", "e.index.abcdef"}));
+    }
+
+    void testControlFlowGraph()
+    {
+        DisassemblyOutput disassemblyOutput;
+        disassemblyOutput.symbol.symbol = "nested";
+        auto addLine = [&](quint64 addr, const QString& disassembly) {
+            disassemblyOutput.disassemblyLines.push_back(
+                {addr, disassembly, DisassemblyOutput::extractLinkedFunction(disassembly)});
+        };
+        addLine(0x10, "  10:\t31 c0\txor    %eax,%eax");
+        addLine(0, "    for (int i = 0; i < n; ++i) {");
+        addLine(0x12, "  12:\t31 c9\txor    %ecx,%ecx");
+        addLine(0x14, "  14:\t83 c1 01\tadd    $0x1,%ecx");
+        addLine(0x17, "  17:\t39 f1\tcmp    %esi,%ecx");
+        addLine(0x19, "  19:\t75 f9\tjne    14 <nested+0x4>");
+        addLine(0x1b, "  1b:\te8 e0 ff ff ff\tcall   10 <nested>");
+        addLine(0x20, "  20:\tff c8\tdec    %eax");
+        addLine(0x22, "  22:\t75 ee\tjne    12 <nested+0x2>");
+        addLine(0x24, "  24:\tc3\tret");
+
+        Data::CallerCalleeEntry entry;
+        entry.offset(0x17, 1).selfCost[0] = 100;
+        entry.offset(0x20, 1).selfCost[0] = 10;
+        entry.offset(0x24, 1).selfCost[0] = 1;
+
+        const auto graph = ControlFlowGraph::build(disassemblyOutput, entry, 1);
+        QCOMPARE(graph.totalCost[0], qint64(111));
+
+        QCOMPARE(graph.blocks.size(), 5);
+        auto startAddr = [&graph](int block) { return graph.blocks[block].startAddr; };
+        QCOMPARE(startAddr(0), quint64(0x10));
+        QCOMPARE(startAddr(1), quint64(0x12));
+        QCOMPARE(startAddr(2), quint64(0x14));
+        // the call doesn't end the block
+        QCOMPARE(startAddr(3), quint64(0x1b));
+        QCOMPARE(startAddr(4), quint64(0x24));
+        QCOMPARE(graph.blocks[2].numInstructions, 3);
+        QCOMPARE(graph.blocks[2].firstLine, 3);
+        QCOMPARE(graph.blocks[2].successors, (QVector<int> {2, 3}));
+        QCOMPARE(graph.blocks[3].successors, (QVector<int> {1, 4}));
+        QVERIFY(graph.blocks[4].successors.isEmpty());
+
+        QCOMPARE(graph.loops.size(), 2);
+        const auto& outer = graph.loops[0];
+        QCOMPARE(outer.header, 1);
+        QCOMPARE(outer.blocks, (QVector<int> {1, 2, 3}));
+        QCOMPARE(outer.startAddr, quint64(0x12));
+        QCOMPARE(outer.endAddr, quint64(0x22));
+        QCOMPARE(outer.numInstructions, 7);
+        QCOMPARE(outer.cost[0], qint64(110));
+        const auto& inner = graph.loops[1];
+        QCOMPARE(inner.header, 2);
+        QCOMPARE(inner.blocks, (QVector<int> {2}));
+        QCOMPARE(inner.numInstructions, 3);
+        QCOMPARE(inner.cost[0], qint64(100));
+
+        QCOMPARE(graph.hottestLoops(0), (QVector<int> {0, 1}));
+    }
+
     QString patch_expected_file(const QString& actualText, const QString& actualBinaryFile)
     {
         if (actualText.contains("jmpq")) {
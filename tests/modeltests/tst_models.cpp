@@ -6,15 +6,23 @@
 */
 
 #include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QTest>
 #include <QTextStream>
 #include <QAbstractItemModelTester>
+#include <QBuffer>
 
 #include "../testutils.h"
 
 #include <models/eventmodel.h>
+#include <phasetrace.h>
 #include <models/disassemblymodel.h>
+#include <flamegraph.h>
 
 namespace {
 Data::BottomUpResults buildBottomUpTree(const QByteArray& stacks)
@@ -24,7 +32,6 @@ Data::BottomUpResults buildBottomUpTree(const QByteArray& stacks)
     ret.root.symbol = {"<root>", {}};
     const auto& lines = stacks.split('\n');
     QHash<quint32, Data::Symbol> ids;
-    quint32 maxId = 0;
     for (const auto& line : lines) {
         auto trimmed = line.trimmed();
         if (trimmed.isEmpty()) {
@@ -35,7 +42,7 @@ Data::BottomUpResults buildBottomUpTree(const QByteArray& stacks)
         for (auto it = frames.rbegin(), end = frames.rend(); it != end; ++it) {
             const auto& frame = *it;
             const auto symbol = Data::Symbol {frame, {}};
-            auto node = parent->entryForSymbol(symbol, &maxId);
+            auto node = parent->entryForSymbol(symbol, &ret.maxBottomUpId);
             Q_ASSERT(!ids.contains(node->id) || ids[node->id] == symbol);
             ids[node->id] = symbol;
             ret.costs.increment(0, node->id);
@@ -100,6 +107,291 @@ private slots:
         model.setData(tree);
     }
 
+    void testMergeResults()
+    {
+        auto tree = generateTree1();
+        const auto other = buildBottomUpTree(R"(
+            C
+            X;C
+        )");
+
+        Data::MergeMapping mapping;
+        mapping.costTypes = {0};
+        tree.merge(other, mapping);
+        Data::BottomUp::initializeParents(&tree.root);
+
+        QCOMPARE(tree.costs.totalCost(0), qint64(11));
+        const auto expectedTree = QStringList {
+            // clang-format: off
+            "C=7",  " B=1",  "  A=1", " E=1", "  C=1", "   B=1", "    A=1", " C=1",   "  B=1",   "   A=1",  " X=1",
+            "D=2",  " B=2",  "  A=2", "E=2",  " C=2",  "  B=1",  "   A=1", "  E=1",   "   C=1", "    B=1", "     A=1"
+            //clang-format on
+        };
+        QCOMPARE(printTree(tree), expectedTree);
+
+        auto generateEvent = [](quint64 time, qint32 stackId) {
+            Data::Event event;
+            event.time = time;
+            event.cost = 1;
+            event.type = 0;
+            event.stackId = stackId;
+            event.cpuId = 0;
+            return event;
+        };
+
+        Data::EventResults events;
+        events.stacks = {{0, 1}};
+        events.threads.resize(1);
+        events.threads[0].pid = 1;
+        events.threads[0].tid = 1;
+        events.threads[0].name = QStringLiteral("foo");
+        events.threads[0].events << generateEvent(10, 0) << generateEvent(30, 0);
+        events.cpus.resize(1);
+        events.cpus[0].cpuId = 0;
+        events.cpus[0].events = events.threads[0].events;
+
+        Data::EventResults segment;
+        segment.stacks = {{0}};
+        segment.threads.resize(1);
+        segment.threads[0].pid = 1;
+        segment.threads[0].tid = 1;
+        segment.threads[0].name = QStringLiteral("foo");
+        segment.threads[0].events << generateEvent(20, 0);
+        segment.cpus.resize(1);
+        segment.cpus[0].cpuId = 0;
+        segment.cpus[0].events = segment.threads[0].events;
+
+        // a segment of the same recording shares its threads
+        mapping.locationOffset = 2;
+        events.merge(segment, mapping);
+        const Data::Stacks expectedStacks = {{0, 1}, {2}};
+        QVERIFY(events.stacks == expectedStacks);
+        QCOMPARE(events.threads.size(), 1);
+        QCOMPARE(events.threads[0].events.size(), 3);
+        QCOMPARE(events.threads[0].events.at(1), generateEvent(20, 1));
+        QCOMPARE(events.cpus.size(), 1);
+        QCOMPARE(events.cpus[0].events.size(), 3);
+
+        // a recording from another host gets its own threads and CPUs
+        mapping.locationOffset = 3;
+        mapping.pidOffset = 100;
+        mapping.cpuOffset = 1;
+        mapping.threadSuffix = QStringLiteral(" (host)");
+        events.merge(segment, mapping);
+        QCOMPARE(events.stacks.size(), 3);
+        QCOMPARE(events.threads.size(), 2);
+        QCOMPARE(events.threads[1].pid, 101);
+        QCOMPARE(events.threads[1].tid, 101);
+        QCOMPARE(events.threads[1].name, QStringLiteral("foo (host)"));
+        QCOMPARE(events.threads[1].events.at(0).stackId, 2);
+        QCOMPARE(events.cpus.size(), 2);
+        QCOMPARE(events.cpus[1].cpuId, 1u);
+        QCOMPARE(events.cpus[1].events.at(0).cpuId, 1u);
+    }
+
+    void testBottomUpDiff()
+    {
+        const auto baseline = buildBottomUpTree(R"(
+            A;B
+            A;B
+            C
+        )");
+        const auto comparison = buildBottomUpTree(R"(
+            A;B
+            A;D
+            A;D
+            A;D
+        )");
+
+        auto diff = Data::BottomUpResults::diff(baseline, comparison);
+        QCOMPARE(diff.costs.numTypes(), 2);
+        QCOMPARE(diff.costs.diffType(0), 1);
+        QCOMPARE(diff.costs.diffType(1), -1);
+        QCOMPARE(diff.costs.diffBaseType(1), 0);
+        QCOMPARE(diff.costs.diffBaseType(0), -1);
+        QCOMPARE(diff.costs.totalCost(0), qint64(4));
+        QCOMPARE(diff.costs.totalCost(1), qint64(3));
+
+        // C only exists in the baseline, D only in the comparison
+        auto expectedTree = QStringList {"B=1, -1", " A=1, -1", "D=3, 3", " A=3, 3", "C=0, -1"};
+        QCOMPARE(printTree(diff), expectedTree);
+        QCOMPARE(diff.costs.formatCost(1, diff.costs.cost(1, diff.root.children.last().id)), QStringLiteral("-1"));
+
+        // frames whose costs only changed in the difference still show up
+        const auto topDown = Data::TopDownResults::fromBottomUp(diff);
+        QVERIFY(printTree(topDown).contains(QStringLiteral("C=s:0,i:0")));
+
+        // the baseline gets scaled to the same total samples, i.e. by 4/3
+        diff = Data::BottomUpResults::diff(baseline, comparison, 0);
+        QCOMPARE(diff.costs.totalCost(1), qint64(4));
+        expectedTree = QStringList {"B=1, -2", " A=1, -2", "D=3, 3", " A=3, 3", "C=0, -1"};
+        QCOMPARE(printTree(diff), expectedTree);
+
+        BottomUpModel model;
+        QAbstractItemModelTester tester(&model);
+        model.setData(diff);
+    }
+
+    void testTracepointLatencies()
+    {
+        auto addSample = [](Data::TracepointFormat* format, quint64 time, qint32 tid, qint64 id) {
+            format->times.push_back(time);
+            format->tids.push_back(tid);
+            format->cpuIds.push_back(0);
+            format->fields[0].values.push_back(id);
+        };
+        auto makeFormat = [](const QString& name) {
+            Data::TracepointFormat format;
+            format.name = name;
+            format.fields.resize(1);
+            format.fields[0].name = QStringLiteral("id");
+            return format;
+        };
+
+        auto enter = makeFormat(QStringLiteral("raw_syscalls:sys_enter"));
+        auto exit = makeFormat(QStringLiteral("raw_syscalls:sys_exit"));
+        // two threads interleave their syscalls, the exits are out of order and the last enter is never matched
+        addSample(&enter, 100, 1, 0);
+        addSample(&enter, 150, 2, 1);
+        addSample(&exit, 300, 1, 0);
+        addSample(&exit, 160, 2, 1);
+        addSample(&enter, 400, 1, 1);
+        addSample(&exit, 1400, 1, 1);
+        addSample(&enter, 2000, 1, 0);
+
+        Data::TracepointResults results;
+        results.formats = {enter, exit, makeFormat(QStringLiteral("sched:sched_wakeup"))};
+
+        const auto pairs = results.latencyPairs();
+        QCOMPARE(pairs.size(), 1);
+        QCOMPARE(pairs[0].begin, enter.name);
+        QCOMPARE(pairs[0].end, exit.name);
+
+        auto histogram = results.latencies(pairs[0]);
+        QCOMPARE(histogram.latencies.size(), 3);
+        QCOMPARE(histogram.latencies[0].time, quint64(100));
+        QCOMPARE(histogram.latencies[0].duration, quint64(200));
+        QCOMPARE(histogram.latencies[1].tid, 2);
+        QCOMPARE(histogram.latencies[1].duration, quint64(10));
+        QCOMPARE(histogram.latencies[2].duration, quint64(1000));
+        QCOMPARE(histogram.minimum, quint64(10));
+        QCOMPARE(histogram.median, quint64(200));
+        QCOMPARE(histogram.maximum, quint64(1000));
+        QCOMPARE(histogram.total, quint64(1210));
+        QCOMPARE(histogram.buckets[Data::LatencyHistogram::bucketForDuration(10)], quint64(1));
+        QCOMPARE(Data::LatencyHistogram::bucketForDuration(0), 0);
+        QCOMPARE(Data::LatencyHistogram::bucketForDuration(1), 1);
+        QCOMPARE(Data::LatencyHistogram::bucketForDuration(1000), 10);
+
+        histogram = results.latencies(pairs[0], {QStringLiteral("id"), QStringLiteral("1")});
+        QCOMPARE(histogram.latencies.size(), 2);
+        QCOMPARE(histogram.maximum, quint64(1000));
+
+        histogram = results.latencies(pairs[0], {QStringLiteral("unknown"), QStringLiteral("1")});
+        QVERIFY(histogram.latencies.isEmpty());
+
+        // the end samples have to pass the filter too
+        auto mismatchedEnter = makeFormat(enter.name);
+        auto mismatchedExit = makeFormat(exit.name);
+        addSample(&mismatchedEnter, 100, 3, 1);
+        addSample(&mismatchedExit, 200, 3, 0);
+        Data::TracepointResults mismatched;
+        mismatched.formats = {mismatchedEnter, mismatchedExit};
+        const Data::TracepointPair unkeyed = {enter.name, exit.name, {}, Data::TracepointPair::Scope::Thread};
+        QCOMPARE(mismatched.latencies(unkeyed).latencies.size(), 1);
+        QVERIFY(mismatched.latencies(unkeyed, {QStringLiteral("id"), QStringLiteral("1")}).latencies.isEmpty());
+
+        results.filterByTime({0, 1000});
+        QCOMPARE(results.format(enter.name)->size(), 3);
+        QCOMPARE(results.format(exit.name)->size(), 2);
+        QCOMPARE(results.latencies(pairs[0]).latencies.size(), 2);
+
+        // strings get remapped, tids namespaced
+        Data::TracepointFormat issue;
+        issue.name = QStringLiteral("block:block_rq_issue");
+        issue.times = {10};
+        issue.tids = {5};
+        issue.cpuIds = {0};
+        Data::TracepointField rwbs;
+        rwbs.name = QStringLiteral("rwbs");
+        rwbs.isString = true;
+        rwbs.strings = {QStringLiteral("R")};
+        rwbs.values = {0};
+        issue.fields = {rwbs};
+
+        Data::TracepointResults other;
+        other.formats = {issue};
+        Data::MergeMapping mapping;
+        mapping.pidOffset = 100;
+        results.merge(other, mapping);
+        issue.fields[0].strings = {QStringLiteral("W"), QStringLiteral("R")};
+        issue.fields[0].values = {1};
+        issue.times = {20};
+        results.merge({{}, {issue}}, mapping);
+
+        const auto* merged = results.format(issue.name);
+        QVERIFY(merged);
+        QCOMPARE(merged->size(), 2);
+        QCOMPARE(merged->tids, QVector<qint32>({105, 105}));
+        QCOMPARE(merged->fields[0].displayValue(0), QStringLiteral("R"));
+        QCOMPARE(merged->fields[0].displayValue(1), QStringLiteral("R"));
+        QCOMPARE(merged->fields[0].strings.size(), 2);
+    }
+
+    void testCriticalPath()
+    {
+        Data::EventResults events;
+        events.threads.resize(2);
+        auto& waiter = events.threads[0];
+        waiter.pid = 1;
+        waiter.tid = 1;
+        waiter.time = {0, 1000};
+        auto& waker = events.threads[1];
+        waker.pid = 1;
+        waker.tid = 2;
+        waker.time = {0, 1000};
+
+        // the waiter blocks on something the waker releases, the waker itself waited for an interrupt before
+        Data::Wakeup wakeup;
+        wakeup.offCpu = {200, 600};
+        wakeup.time = 500;
+        wakeup.stackId = 0;
+        wakeup.wakerPid = 1;
+        wakeup.wakerTid = 2;
+        wakeup.wakerStackId = 1;
+        waiter.wakeups.push_back(wakeup);
+        Data::Wakeup interrupt;
+        interrupt.offCpu = {100, 300};
+        interrupt.stackId = 2;
+        waker.wakeups.push_back(interrupt);
+
+        using State = Data::CriticalPathSegment::State;
+        auto path = events.criticalPath(1, 1, {0, 1000});
+        QCOMPARE(path.size(), 5);
+        const QVector<State> expectedStates = {State::Running, State::Blocked, State::Running, State::Runnable,
+                                               State::Running};
+        const QVector<qint32> expectedTids = {2, 2, 2, 1, 1};
+        const QVector<Data::TimeRange> expectedTimes = {{0, 100}, {100, 300}, {300, 500}, {500, 600}, {600, 1000}};
+        for (int i = 0; i < path.size(); ++i) {
+            QCOMPARE(path[i].state, expectedStates[i]);
+            QCOMPARE(path[i].tid, expectedTids[i]);
+            QCOMPARE(path[i].time, expectedTimes[i]);
+        }
+        QCOMPARE(path[1].stackId, 2);
+        QCOMPARE(path[3].stackId, 0);
+        QCOMPARE(path[3].wakerTid, 2);
+        QCOMPARE(path[3].wakerStackId, 1);
+
+        // the path gets clipped to the requested time
+        path = events.criticalPath(1, 1, {550, 800});
+        QCOMPARE(path.size(), 2);
+        QCOMPARE(path[0].state, State::Runnable);
+        QCOMPARE(path[0].time, Data::TimeRange(550, 600));
+        QCOMPARE(path[1].time, Data::TimeRange(600, 800));
+
+        QVERIFY(events.criticalPath(1, 3, {0, 1000}).isEmpty());
+    }
+
     void testSimplifiedModel()
     {
         const auto tree = buildBottomUpTree(R"(
@@ -181,6 +473,32 @@ private slots:
             // clang-format: on
         };
         QCOMPARE(modelData, expectedModelData);
+
+        // simplified chains end with the first node that is filtered out
+        model.setFilterText(QStringLiteral("1"));
+        const auto expectedFiltered = QStringList {"1", " 2", "6", " 7", "  10", "   11", "  12", " 13", "14"};
+        QTRY_COMPARE(printModel(&model), expectedFiltered);
+        QCOMPARE(model.rowCount(model.index(0, 0)), 1);
+        QVERIFY(!model.hasChildren(model.index(0, 0, model.index(0, 0))));
+
+        // matching leaves are shown with their ancestors, the children of matches are shown too
+        model.setFilterText(QStringLiteral("2"));
+        QTRY_COMPARE(printModel(&model), QStringList({"1", " 2", " ↪3", "6", " 7", "  12"}));
+        QVERIFY(!model.hasChildren(model.index(1, 0, model.index(0, 0))));
+
+        model.setFilterText({});
+        QCOMPARE(printModel(&model), expectedModelData);
+
+        // the single top-level node gets filtered out too
+        BottomUpModel chainModel;
+        QAbstractItemModelTester chainTester(&chainModel);
+        chainModel.setData(buildBottomUpTree(R"(
+            b;a
+        )"));
+        QCOMPARE(printModel(&chainModel), QStringList({"a", " b"}));
+        chainModel.setFilterText(QStringLiteral("x"));
+        QTRY_COMPARE(chainModel.rowCount(), 0);
+        QVERIFY(!chainModel.hasChildren());
     }
 
     void testTopDownModel()
@@ -204,24 +522,101 @@ private slots:
         model.setData(tree);
     }
 
+    void testSortedFilteredModel()
+    {
+        const auto tree = generateTree1();
+
+        BottomUpModel model;
+        model.setSimplify(false);
+        QAbstractItemModelTester tester(&model);
+        model.setData(tree);
+
+        model.sort(BottomUpModel::InitialSortColumn, Qt::AscendingOrder);
+        const auto expectedSorted = QStringList {
+            // clang-format: off
+            "D", " B", "  A", "E",    " C",  "  B",  "   A", "  E", "   C", "    B", "     A",
+            "C", " B", "  A", " E",   "  C", "   B", "    A", " C",  "  B",  "   A"
+            // clang-format: on
+        };
+        QCOMPARE(printModel(&model), expectedSorted);
+
+        const QPersistentModelIndex c = model.index(2, 0);
+        QCOMPARE(c.data().toString(), QStringLiteral("C"));
+        const QPersistentModelIndex d = model.index(0, 0);
+
+        // E nodes are shown together with their ancestors and direct children
+        model.setFilterText(QStringLiteral("e"));
+        const auto expectedFiltered = QStringList {"E", " C", "  E", "   C", "C", " E", "  C"};
+        QTRY_COMPARE(printModel(&model), expectedFiltered);
+        QCOMPARE(c.row(), 1);
+        QVERIFY(!d.isValid());
+        const auto leaf = model.index(0, 0, model.index(0, 0, model.index(0, 0, model.index(0, 0))));
+        QCOMPARE(leaf.data().toString(), QStringLiteral("C"));
+        QVERIFY(!model.hasChildren(leaf));
+
+        model.setFilterText({});
+        QCOMPARE(printModel(&model), expectedSorted);
+        QCOMPARE(c.row(), 2);
+
+        model.sort(BottomUpModel::InitialSortColumn, Qt::DescendingOrder);
+        QCOMPARE(c.row(), 0);
+        QCOMPARE(model.index(1, 0).data().toString(), QStringLiteral("D"));
+    }
+
     void testTopProxy()
     {
         BottomUpModel model;
         TopProxy proxy;
         QAbstractItemModelTester tester(&proxy);
 
-        const auto data = generateTree1();
+        auto data = generateTree1();
+        data.topRows = Data::topChildren(data.root.children, data.costs);
         model.setData(data);
 
         proxy.setSourceModel(&model);
+        QCOMPARE(proxy.rowCount(), 0);
+        proxy.setTopRows(data.topRows);
         QCOMPARE(proxy.rowCount(), model.rowCount());
         QCOMPARE(proxy.columnCount(), 3);
 
+        const auto expectedSymbols = QStringList {"C", "D", "E"};
         for (auto i = 0, c = proxy.rowCount(); i < c; ++i) {
             auto index = proxy.index(i, 0, {});
             QVERIFY(index.isValid());
             QVERIFY(!proxy.rowCount(index));
+            QCOMPARE(index.data(BottomUpModel::SymbolRole).value<Data::Symbol>().symbol, expectedSymbols[i]);
         }
+
+        // in-place updates of the source show up without waiting for new top rows
+        QSignalSpy dataChangedSpy(&proxy, &QAbstractItemModel::dataChanged);
+        const auto prettifySymbols = Settings::instance()->prettifySymbols();
+        Settings::instance()->setPrettifySymbols(!prettifySymbols);
+        Settings::instance()->setPrettifySymbols(prettifySymbols);
+        QCOMPARE(dataChangedSpy.count(), 2);
+        QCOMPARE(dataChangedSpy.first().at(0).toModelIndex(), proxy.index(0, 0));
+        QCOMPARE(dataChangedSpy.first().at(1).toModelIndex(), proxy.index(2, 2));
+
+        // sorting the source moves the symbols to other source rows, but the proxy keeps showing the same ones
+        const QPersistentModelIndex first = proxy.index(0, 0);
+        QSignalSpy layoutChangedSpy(&proxy, &QAbstractItemModel::layoutChanged);
+        model.sort(BottomUpModel::Symbol, Qt::DescendingOrder);
+        QCOMPARE(layoutChangedSpy.count(), 1);
+        QCOMPARE(model.index(0, 0).data(BottomUpModel::SymbolRole).value<Data::Symbol>().symbol, QStringLiteral("E"));
+        QCOMPARE(proxy.rowCount(), expectedSymbols.size());
+        const auto expectedSourceRows = QVector<int> {2, 1, 0};
+        for (auto i = 0, c = proxy.rowCount(); i < c; ++i) {
+            const auto index = proxy.index(i, 0);
+            QCOMPARE(index.data(BottomUpModel::SymbolRole).value<Data::Symbol>().symbol, expectedSymbols[i]);
+            const auto sourceIndex = proxy.mapToSource(index);
+            QCOMPARE(sourceIndex.row(), expectedSourceRows[i]);
+            QCOMPARE(sourceIndex.data(BottomUpModel::SymbolRole).value<Data::Symbol>().symbol, expectedSymbols[i]);
+            QCOMPARE(proxy.mapFromSource(sourceIndex), index);
+        }
+        QCOMPARE(first.row(), 0);
+        QCOMPARE(first.data(BottomUpModel::SymbolRole).value<Data::Symbol>().symbol, expectedSymbols[0]);
+
+        const auto topOne = Data::topChildren(data.root.children, data.costs, 1);
+        QCOMPARE(topOne, Data::TopRows({{0}}));
     }
 
     void testCallerCalleeModel()
@@ -264,6 +659,620 @@ private slots:
         }
     }
 
+    void testCallerModelIncrementalUpdate()
+    {
+        Data::Costs costs;
+        costs.addType(0, "samples", Data::Costs::Unit::Unknown);
+        costs.addTotalCost(0, 100);
+
+        const Data::Symbol a = {"A", 0, 0, "liba"};
+        const Data::Symbol b = {"B", 0, 0, "liba"};
+        const Data::Symbol c = {"C", 0, 0, "libb"};
+        const Data::Symbol d = {"D", 0, 0, "libb"};
+        auto cost = [](qint64 value) { return Data::ItemCost(value, 1); };
+
+        CallerModel model;
+        QAbstractItemModelTester tester(&model);
+        model.setResults({{a, cost(10)}, {b, cost(20)}, {c, cost(30)}}, costs);
+        QCOMPARE(model.rowCount(), 3);
+        QCOMPARE(model.indexForKey(b).data(CallerModel::SymbolRole).value<Data::Symbol>(), b);
+        QVERIFY(!model.indexForKey(d).isValid());
+
+        QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy removedSpy(&model, &QAbstractItemModel::rowsRemoved);
+        QSignalSpy insertedSpy(&model, &QAbstractItemModel::rowsInserted);
+        QSignalSpy changedSpy(&model, &QAbstractItemModel::dataChanged);
+
+        // b changes, c is gone and d is new
+        model.setResults({{a, cost(10)}, {b, cost(25)}, {d, cost(5)}}, costs);
+        QCOMPARE(resetSpy.count(), 0);
+        QCOMPARE(removedSpy.count(), 1);
+        QCOMPARE(insertedSpy.count(), 1);
+        QCOMPARE(changedSpy.count(), 1);
+        const auto changed = changedSpy.first().first().toModelIndex();
+        QCOMPARE(changed.data(CallerModel::SymbolRole).value<Data::Symbol>(), b);
+        QCOMPARE(changed.sibling(changed.row(), CallerModel::NUM_BASE_COLUMNS).data(CallerModel::SortRole).toLongLong(),
+                 qlonglong(25));
+
+        QCOMPARE(model.rowCount(), 3);
+        QVERIFY(!model.indexForKey(c).isValid());
+        for (const auto& symbol : {a, b, d}) {
+            QCOMPARE(model.indexForKey(symbol).data(CallerModel::SymbolRole).value<Data::Symbol>(), symbol);
+        }
+
+        // all costs are relative to the total, so all rows change along with it
+        changedSpy.clear();
+        costs.addTotalCost(0, 100);
+        model.setResults({{a, cost(10)}, {b, cost(25)}, {d, cost(5)}}, costs);
+        QCOMPARE(resetSpy.count(), 0);
+        QCOMPARE(changedSpy.count(), 1);
+        QCOMPARE(changedSpy.first().at(0).toModelIndex().row(), 0);
+        QCOMPARE(changedSpy.first().at(1).toModelIndex().row(), 2);
+
+        // most rows are gone, so it's reset instead
+        model.setResults({{c, cost(30)}}, costs);
+        QCOMPARE(resetSpy.count(), 1);
+        QCOMPARE(model.rowCount(), 1);
+        QCOMPARE(model.indexForKey(c).row(), 0);
+    }
+
+    void testCallerCalleeModelIncrementalUpdate()
+    {
+        const Data::Symbol a = {"A", 0, 0, "liba"};
+        const Data::Symbol b = {"B", 0, 0, "liba"};
+        const Data::Symbol c = {"C", 0, 0, "libb"};
+
+        // the ids are assigned anew for every result, like the parser does
+        auto makeResults = [&](qint64 costOfB, quint32 firstId) {
+            Data::CallerCalleeResults results;
+            for (auto* costs : {&results.selfCosts, &results.inclusiveCosts}) {
+                costs->addType(0, "samples", Data::Costs::Unit::Unknown);
+                costs->addTotalCost(0, 100);
+            }
+            auto id = firstId;
+            for (const auto& entry : {qMakePair(a, qint64(10)), qMakePair(b, costOfB), qMakePair(c, qint64(30))}) {
+                results.entries[entry.first].id = id;
+                results.selfCosts.add(0, id, entry.second);
+                results.inclusiveCosts.add(0, id, entry.second);
+                ++id;
+            }
+            return results;
+        };
+
+        CallerCalleeModel model;
+        QAbstractItemModelTester tester(&model);
+        model.setResults(makeResults(20, 0));
+        QCOMPARE(model.rowCount(), 3);
+
+        QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy changedSpy(&model, &QAbstractItemModel::dataChanged);
+
+        // nothing visible changed
+        model.setResults(makeResults(20, 5));
+        QCOMPARE(changedSpy.count(), 0);
+
+        model.setResults(makeResults(25, 0));
+        QCOMPARE(changedSpy.count(), 1);
+        auto changed = changedSpy.first().first().toModelIndex();
+        QCOMPARE(changed.data(CallerCalleeModel::SymbolRole).value<Data::Symbol>(), b);
+        QCOMPARE(changedSpy.first().at(1).toModelIndex().row(), changed.row());
+
+        // the callers are part of the row too
+        changedSpy.clear();
+        auto withCaller = makeResults(25, 0);
+        withCaller.entries[c].caller(a, 1)[0] = 5;
+        model.setResults(withCaller);
+        QCOMPARE(changedSpy.count(), 1);
+        changed = changedSpy.first().first().toModelIndex();
+        QCOMPARE(changed.data(CallerCalleeModel::SymbolRole).value<Data::Symbol>(), c);
+        QCOMPARE(resetSpy.count(), 0);
+    }
+
+    void testSymbolStackIndex()
+    {
+        Data::BottomUpResults results;
+        const Data::Symbol a = {"A", 0, 0, "liba"};
+        const Data::Symbol b = {"B", 0, 0, "liba"};
+        const Data::Symbol c = {"C", 0, 0, "libb"};
+        const Data::Symbol d = {"D", 0, 0, "libb"};
+        results.symbols = {a, b, c, d};
+        results.locations = {{}, {}, {}, {}};
+
+        const Data::Stacks stacks = {{0, 1}, {2, 1}, {3}, {0, 2}};
+        const auto index = Data::SymbolStackIndex::fromStacks(results, stacks);
+        QCOMPARE(index.numStacks, 4);
+        QCOMPARE(index.symbolStacks.size(), 4);
+        QCOMPARE(index.binaryStacks.size(), 2);
+
+        auto filteredStacks = [&index](const Data::FilterAction& filter) {
+            QVector<qint32> ret;
+            const auto filterStacks = index.filterStacks(filter);
+            for (int i = 0; i < filterStacks.size(); ++i) {
+                if (filterStacks[i])
+                    ret.push_back(i);
+            }
+            return ret;
+        };
+
+        {
+            Data::FilterAction filter;
+            filter.includeSymbols = {a};
+            QCOMPARE(filteredStacks(filter), QVector<qint32>({0, 3}));
+            filter.includeSymbols.insert(c);
+            QCOMPARE(filteredStacks(filter), QVector<qint32>({3}));
+            filter.includeSymbols.insert(Data::Symbol {"unknown"});
+            QCOMPARE(filteredStacks(filter), QVector<qint32>());
+        }
+        {
+            Data::FilterAction filter;
+            filter.includeBinaries = {QStringLiteral("libb")};
+            QCOMPARE(filteredStacks(filter), QVector<qint32>({1, 2, 3}));
+        }
+        {
+            Data::FilterAction filter;
+            filter.excludeSymbols = {b};
+            QCOMPARE(filteredStacks(filter), QVector<qint32>({2, 3}));
+        }
+        {
+            Data::FilterAction filter;
+            filter.includeBinaries = {QStringLiteral("liba")};
+            filter.excludeSymbols = {c};
+            QCOMPARE(filteredStacks(filter), QVector<qint32>({0}));
+        }
+    }
+
+    void testCostCheckpoints()
+    {
+        Data::EventResults events;
+        events.threads.resize(3);
+        for (int i = 0; i < events.threads.size(); ++i) {
+            auto& thread = events.threads[i];
+            thread.pid = 1;
+            thread.tid = i + 1;
+            // interleaved in time, with duplicate times across threads
+            for (quint64 time = i; time < 200; time += 2 + i) {
+                Data::Event event;
+                event.time = time;
+                event.cost = time + 1;
+                event.type = static_cast<qint32>(time % 2);
+                event.stackId = static_cast<qint32>(time % 5) - 1;
+                event.cpuId = static_cast<quint32>(time % 3);
+                thread.events << event;
+            }
+        }
+
+        auto groupByCpu = [](const Data::ThreadEvents& /*thread*/, const Data::Event& event) -> qint64 {
+            return event.cpuId;
+        };
+        // tiny intervals to cover several levels of the delta encoded checkpoints and the partial parts
+        const auto checkpoints = Data::CostCheckpoints::fromEvents(events, groupByCpu, 4);
+        QVERIFY(!checkpoints.isEmpty());
+        QVERIFY(checkpoints.deltaOffsets.size() > 32);
+        QVERIFY(std::is_sorted(checkpoints.samples.cbegin(), checkpoints.samples.cend(),
+                               [](const Data::CostCheckpoints::Sample& lhs, const Data::CostCheckpoints::Sample& rhs) {
+                                   return lhs.time < rhs.time;
+                               }));
+
+        auto expectedCosts = [&events, &checkpoints](const Data::TimeRange& time) {
+            QVector<quint64> ret(checkpoints.slots.size(), 0);
+            for (const auto& thread : events.threads) {
+                for (const auto& event : thread.events) {
+                    if (event.stackId == -1 || !time.contains(event.time)) {
+                        continue;
+                    }
+                    for (int i = 0; i < checkpoints.slots.size(); ++i) {
+                        const auto& slot = checkpoints.slots[i];
+                        if (slot.stackId == event.stackId && slot.type == event.type && slot.cpuId == event.cpuId) {
+                            ret[i] += event.cost;
+                            break;
+                        }
+                    }
+                }
+            }
+            return ret;
+        };
+
+        for (quint64 start = 0; start < 210; start += 7) {
+            for (quint64 end = start; end < 210; end += 11) {
+                const Data::TimeRange time(start, end);
+                QCOMPARE(checkpoints.costs(time), expectedCosts(time));
+            }
+        }
+        QCOMPARE(checkpoints.costs({300, 400}), QVector<quint64>(checkpoints.slots.size(), 0));
+    }
+
+    void testFlameGraphExport()
+    {
+        const auto bottomUp = buildBottomUpTree(R"(
+            A;B;C
+            A;B;C
+            A;B
+            D
+        )");
+        const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
+
+        QBuffer folded;
+        QVERIFY(folded.open(QIODevice::WriteOnly));
+        QVERIFY(FlameGraph::writeFoldedStacks(&folded, topDown, 0));
+        auto lines = QString::fromUtf8(folded.data()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+        std::sort(lines.begin(), lines.end());
+        QCOMPARE(lines, QStringList({"A;B 1", "A;B;C 2", "D 1"}));
+
+        FlameGraph::ExportSettings settings;
+        settings.title = QStringLiteral("Top <Down>");
+        auto writeSvg = [&bottomUp, &topDown](const FlameGraph::ExportSettings& exportSettings) {
+            QBuffer svg;
+            svg.open(QIODevice::WriteOnly);
+            const auto written = FlameGraph::writeSvg(&svg, bottomUp, topDown, exportSettings);
+            return written ? QString::fromUtf8(svg.data()) : QString();
+        };
+        auto svg = writeSvg(settings);
+        QVERIFY(svg.startsWith(QLatin1String("<?xml")));
+        QVERIFY(svg.endsWith(QLatin1String("</g>\n</svg>\n")));
+        QVERIFY(svg.contains(QLatin1String("<title>Top &lt;Down&gt;</title>")));
+        // the background, the root and A, B, C and D
+        QCOMPARE(svg.count(QLatin1String("<rect ")), 6);
+        // the frames are sorted by symbol and scaled by their inclusive cost, three levels deep
+        QVERIFY(svg.contains(QLatin1String("height=\"124\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"10.0\" y=\"82.0\" width=\"885.0\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"10.0\" y=\"66.0\" width=\"885.0\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"10.0\" y=\"50.0\" width=\"590.0\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"895.0\" y=\"82.0\" width=\"295.0\"")));
+        QVERIFY(svg.contains(QLatin1String(">D</text>")));
+
+        // the bottom up graph starts with the leaves, i.e. with B, C and D and their callers
+        settings.showBottomUpData = true;
+        svg = writeSvg(settings);
+        QCOMPARE(svg.count(QLatin1String("<rect ")), 8);
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"10.0\" y=\"82.0\" width=\"295.0\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"305.0\" y=\"82.0\" width=\"590.0\"")));
+        QVERIFY(svg.contains(QLatin1String("<rect x=\"895.0\" y=\"82.0\" width=\"295.0\"")));
+    }
+
+    void testFlameChart()
+    {
+        Data::BottomUpResults results;
+        const Data::Symbol main = {"main", 0, 0, "app"};
+        const Data::Symbol work = {"work", 0, 0, "app"};
+        const Data::Symbol idle = {"idle", 0, 0, "libc"};
+        results.symbols = {main, work, idle};
+        results.locations = {{}, {}, {}};
+        // the stacks start with the innermost frame
+        const Data::Stacks stacks = {{1, 0}, {2, 0}, {0}};
+
+        auto sample = [](quint64 time, qint32 stackId, qint32 type = 0) {
+            Data::Event event;
+            event.time = time;
+            event.cost = 1;
+            event.type = type;
+            event.stackId = stackId;
+            return event;
+        };
+
+        Data::ThreadEvents thread;
+        thread.events << sample(100, 0) << sample(110, 0) << sample(115, 1, 1) << sample(120, 1) << sample(130, 0)
+                       << sample(500, 0) << sample(510, 2);
+
+        auto printSpans = [](const Data::FlameChart& chart, int level, int depth) {
+            QStringList ret;
+            const auto spans = chart.spans(level, depth, chart.time);
+            for (auto* span = spans.first; span != spans.second; ++span) {
+                const auto name = span->symbol == -1 ? QStringLiteral("*") : chart.symbols[span->symbol].symbol;
+                ret << QStringLiteral("%1[%2,%3]x%4")
+                           .arg(name, QString::number(span->time.start), QString::number(span->time.end),
+                                QString::number(span->samples));
+            }
+            return ret;
+        };
+
+        auto chart = Data::FlameChart::fromEvents(thread, stacks, results, 0);
+        QCOMPARE(chart.sampleInterval, quint64(10));
+        QCOMPARE(chart.time, Data::TimeRange(100, 520));
+        QCOMPARE(chart.depth(), 2);
+        QCOMPARE(chart.levels.size(), 1);
+        // the long gap ends the spans, the other samples share their callers
+        QCOMPARE(printSpans(chart, 0, 0), QStringList({"main[100,140]x4", "main[500,520]x2"}));
+        QCOMPARE(printSpans(chart, 0, 1),
+                 QStringList({"work[100,120]x2", "idle[120,130]x1", "work[130,140]x1", "work[500,510]x1"}));
+        const auto visible = chart.spans(0, 1, {125, 135});
+        QCOMPARE(visible.second - visible.first, 2);
+        QCOMPARE(visible.first->symbol, 2);
+
+        // every sample alternates between two callees, so only the coarser levels can merge them
+        thread.events = {};
+        for (int i = 0; i < 10000; ++i) {
+            thread.events << sample(quint64(i) * 10, i % 2);
+        }
+        chart = Data::FlameChart::fromEvents(thread, stacks, results, 0);
+        QVERIFY(chart.levels.size() > 2);
+        QCOMPARE(chart.levels[0][1].size(), 10000);
+        QCOMPARE(chart.levelForResolution(0), 0);
+        QCOMPARE(chart.levelForResolution(std::numeric_limits<quint64>::max()), chart.levels.size() - 1);
+
+        for (int level = 1; level < chart.levels.size(); ++level) {
+            QVERIFY(chart.minDuration(level) > chart.minDuration(level - 1));
+            const auto& depths = chart.levels[level];
+            QVERIFY(depths[1].size() <= chart.levels[level - 1][1].size());
+            // the callees stay within their callers
+            for (const auto& span : depths[1]) {
+                const auto& parent = depths[0][span.parent];
+                QVERIFY(parent.time.start <= span.time.start && span.time.end <= parent.time.end);
+            }
+        }
+        const auto lastLevel = chart.levels.size() - 1;
+        QCOMPARE(printSpans(chart, lastLevel, 0), QStringList({"main[0,100000]x10000"}));
+        QCOMPARE(printSpans(chart, lastLevel, 1), QStringList({"*[0,100000]x10000"}));
+    }
+
+    void testCpuHeatmap()
+    {
+        auto sample = [](quint64 time, quint64 cost, qint32 type = 0) {
+            Data::Event event;
+            event.time = time;
+            event.cost = cost;
+            event.type = type;
+            return event;
+        };
+
+        QVector<Data::CpuEvents> cpus(3);
+        cpus[0].cpuId = 0;
+        cpus[0].events << sample(0, 2) << sample(10, 3) << sample(30, 5, 1) << sample(99, 4) << sample(150, 1);
+        // never got any events, so it gets no row
+        cpus[1].cpuId = 1;
+        cpus[2].cpuId = 2;
+        cpus[2].events << sample(50, 1) << sample(100, 7);
+
+        auto rows = [](const Data::CpuHeatmap& heatmap) {
+            QVector<QVector<quint64>> ret;
+            for (int row = 0; row < heatmap.cpuIds.size(); ++row) {
+                ret.append(heatmap.cells.mid(row * heatmap.numBuckets, heatmap.numBuckets));
+            }
+            return ret;
+        };
+
+        auto heatmap = Data::CpuHeatmap::fromEvents(cpus, 0, Data::CpuHeatmap::Value::Samples, {0, 100}, 4);
+        QCOMPARE(heatmap.cpuIds, (QVector<quint32> {0, 2}));
+        QCOMPARE(rows(heatmap), (QVector<QVector<quint64>> {{2, 0, 0, 1}, {0, 0, 1, 1}}));
+        QCOMPARE(heatmap.maxCell, quint64(2));
+        QCOMPARE(heatmap.bucketTime(0), Data::TimeRange(0, 25));
+        QCOMPARE(heatmap.bucketTime(3), Data::TimeRange(75, 100));
+        QCOMPARE(heatmap.bucketAt(24), 0);
+        QCOMPARE(heatmap.bucketAt(25), 1);
+        QCOMPARE(heatmap.bucketAt(100), 3);
+        QCOMPARE(heatmap.bucketAt(101), -1);
+
+        heatmap = Data::CpuHeatmap::fromEvents(cpus, 0, Data::CpuHeatmap::Value::Cost, {0, 100}, 4);
+        QCOMPARE(rows(heatmap), (QVector<QVector<quint64>> {{5, 0, 0, 4}, {0, 0, 1, 7}}));
+        QCOMPARE(heatmap.maxCell, quint64(7));
+
+        // zooming in keeps the idle rows and only bins the visible events
+        heatmap = Data::CpuHeatmap::fromEvents(cpus, 0, Data::CpuHeatmap::Value::Samples, {40, 60}, 2);
+        QCOMPARE(heatmap.cpuIds, (QVector<quint32> {0, 2}));
+        QCOMPARE(rows(heatmap), (QVector<QVector<quint64>> {{0, 0}, {0, 1}}));
+        QCOMPARE(heatmap.bucketAt(30), -1);
+
+        QVERIFY(Data::CpuHeatmap::fromEvents(cpus, 0, Data::CpuHeatmap::Value::Samples, {0, 100}, 0).isEmpty());
+        QVERIFY(Data::CpuHeatmap::fromEvents({}, 0, Data::CpuHeatmap::Value::Samples, {0, 100}, 4).isEmpty());
+    }
+
+    void testSpillEvents()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        Data::SpillFile spillFile(dir.path());
+
+        auto generateEvent = [](quint64 time) {
+            Data::Event event;
+            event.time = time;
+            event.cost = time * 10;
+            event.type = 0;
+            event.stackId = static_cast<qint32>(time % 3);
+            event.cpuId = 1;
+            return event;
+        };
+
+        Data::Events events;
+        Data::Events expected;
+        for (quint64 time = 0; time < 100; ++time) {
+            events << generateEvent(time);
+            expected << generateEvent(time);
+        }
+
+        QVERIFY(events.spill(&spillFile));
+        QCOMPARE(events.numSpilled(), 100);
+        QCOMPARE(events.numInMemory(), 0);
+        QCOMPARE(events.memoryUsage(), qint64(0));
+        QVERIFY(events.isContiguous());
+        QCOMPARE(events, expected);
+        QCOMPARE(events.last(), generateEvent(99));
+        QCOMPARE(events.end() - events.begin(), std::ptrdiff_t(100));
+
+        // appending after a spill keeps the new events in memory
+        for (quint64 time = 100; time < 150; ++time) {
+            events << generateEvent(time);
+            expected << generateEvent(time);
+        }
+        QVERIFY(!events.isContiguous());
+        QCOMPARE(events.size(), 150);
+        QCOMPARE(events.at(99), generateEvent(99));
+        QCOMPARE(events.at(100), generateEvent(100));
+        QCOMPARE(events, expected);
+
+        events.makeContiguous(&spillFile);
+        QVERIFY(events.isContiguous());
+        QCOMPARE(events.numSpilled(), 150);
+        QVERIFY(std::equal(events.begin(), events.end(), expected.begin(), expected.end()));
+
+        // windows share the events until they get modified
+        const auto spilledWindow = events.mid(100, 10);
+        QCOMPARE(spilledWindow.size(), 10);
+        QCOMPARE(spilledWindow.constData(), events.constData() + 100);
+        QCOMPARE(spilledWindow.last(), generateEvent(109));
+        auto window = expected.mid(10, 5);
+        QCOMPARE(window.begin(), expected.begin() + 10);
+        QCOMPARE(window.first(), generateEvent(10));
+        window << generateEvent(200);
+        QCOMPARE(window.size(), 6);
+        QCOMPARE(window.at(4), generateEvent(14));
+        QCOMPARE(window.at(5), generateEvent(200));
+        QCOMPARE(expected.size(), 150);
+        QCOMPARE(expected.at(15), generateEvent(15));
+
+        // the spilled events are read-only, filtering copies the remaining ones back into memory
+        events.removeIf([](const Data::Event& event) { return event.time % 2; });
+        QCOMPARE(events.numSpilled(), 0);
+        QCOMPARE(events.size(), 75);
+        QCOMPARE(events.at(1), generateEvent(2));
+
+        Data::Stacks stacks = {{0, 1}, {2}};
+        QVERIFY(stacks.spill(&spillFile));
+        stacks.push_back({3, 4, 5});
+        stacks.push_back({});
+        QVERIFY(stacks.spill(&spillFile));
+        stacks.push_back({6});
+        QCOMPARE(stacks.size(), 5);
+        QVERIFY(stacks.memoryUsage() > 0);
+        QVERIFY(stacks.at(0) == QVector<qint32>({0, 1}));
+        QVERIFY(stacks.at(1) == QVector<qint32>({2}));
+        QVERIFY(stacks.at(2) == QVector<qint32>({3, 4, 5}));
+        QVERIFY(stacks.at(3).isEmpty());
+        QVERIFY(stacks.at(4) == QVector<qint32>({6}));
+        const Data::Stacks expectedStacks = {{0, 1}, {2}, {3, 4, 5}, {}, {6}};
+        QVERIFY(stacks == expectedStacks);
+
+        // spilling the results keeps at most half of the budget in memory
+        Data::EventResults results;
+        results.stacks = stacks;
+        results.threads.resize(3);
+        results.cpus.resize(2);
+        for (quint64 time = 0; time < 1000; ++time) {
+            const auto event = generateEvent(time);
+            results.threads[time % 3].events << event;
+            results.cpus[time % 2].events << event;
+        }
+        const auto copy = results;
+        const qint64 budget = 1024;
+        results.spill(&spillFile, budget);
+        QVERIFY(results.memoryUsage() <= budget / 2);
+        results.makeContiguous(&spillFile);
+        QVERIFY(results == copy);
+        QVERIFY(spillFile.spilledBytes() > 0);
+
+        // merging writes the events that exceed the budget straight into the spill file
+        Data::MergeMapping mapping;
+        mapping.costTypes = {0};
+        Data::EventResults merged;
+        Data::EventResults expectedMerge;
+        for (int i = 0; i < 2; ++i) {
+            merged.merge(copy, mapping, &spillFile, budget);
+            expectedMerge.merge(copy, mapping);
+        }
+        QVERIFY(merged.memoryUsage() <= budget);
+        QCOMPARE(merged.threads[0].events.size(), 668);
+        QCOMPARE(merged.threads[0].events.numInMemory(), 0);
+        QVERIFY(merged == expectedMerge);
+    }
+
+    void testFrequencyBuckets()
+    {
+        const auto width = Data::PerCostFrequencyData::BASE_BUCKET_WIDTH;
+
+        Data::PerCostFrequencyData data;
+        data.addValue(0, 1.);
+        data.addValue(width / 2, 3.);
+        data.addValue(width + 1, 2.);
+        // out of order values get sorted into the right bucket
+        data.addValue(width / 4, 2.);
+        data.buildLevels();
+
+        QCOMPARE(data.levels.size(), 1);
+        const auto& buckets = data.levels[0];
+        QCOMPARE(buckets.size(), 2);
+        QCOMPARE(buckets[0].time, quint64(0));
+        QCOMPARE(buckets[0].count, quint32(3));
+        QCOMPARE(buckets[0].min, 1.f);
+        QCOMPARE(buckets[0].max, 3.f);
+        QCOMPARE(buckets[0].mean, 2.f);
+        QCOMPARE(buckets[1].time, quint64(width));
+        QCOMPARE(buckets[1].count, quint32(1));
+
+        Data::PerCostFrequencyData longData;
+        const int numBuckets = Data::PerCostFrequencyData::MAX_BUCKETS_PER_LEVEL * 2;
+        for (int i = 0; i < numBuckets; ++i) {
+            longData.addValue(i * width, i);
+        }
+        longData.buildLevels();
+        QCOMPARE(longData.levels.size(), 2);
+        QCOMPARE(longData.levels[0].size(), numBuckets);
+        QCOMPARE(longData.levels[1].size(), numBuckets / int(Data::PerCostFrequencyData::LEVEL_FACTOR));
+        QCOMPARE(longData.levels[1][0].count, quint32(Data::PerCostFrequencyData::LEVEL_FACTOR));
+        QCOMPARE(longData.levels[1][0].mean, 3.5f);
+
+        QCOMPARE(longData.levelForRange(numBuckets * width, numBuckets), 0);
+        QCOMPARE(longData.levelForRange(numBuckets * width, numBuckets / 2), 1);
+
+        longData.filterByTime({10 * width, 20 * width});
+        QCOMPARE(longData.levels[0].size(), 11);
+        QCOMPARE(longData.levels[1].size(), 2);
+    }
+
+    void testPhaseTrace()
+    {
+        PhaseTrace::clear();
+        {
+            PHASE_TRACE("disabled");
+        }
+        QVERIFY(PhaseTrace::events().isEmpty());
+
+        PhaseTrace::setEnabled(true);
+        {
+            PHASE_TRACE("outer");
+            PHASE_TRACE("inner");
+        }
+        PhaseTrace::setEnabled(false);
+
+        const auto events = PhaseTrace::events();
+        QCOMPARE(events.size(), 2);
+        // scopes are recorded when they end
+        QCOMPARE(QByteArray(events[0].name), QByteArray("inner"));
+        QCOMPARE(QByteArray(events[1].name), QByteArray("outer"));
+        QVERIFY(events[1].start <= events[0].start);
+        QVERIFY(events[1].duration >= events[0].duration);
+        QCOMPARE(events[0].threadId, events[1].threadId);
+
+        const auto threads = PhaseTrace::threads();
+        QCOMPARE(threads.size(), 1);
+        QCOMPARE(threads[0].id, events[0].threadId);
+
+        const auto trace = QJsonDocument::fromJson(PhaseTrace::toChromeTrace(events, threads)).object();
+        const auto traceEvents = trace.value(QStringLiteral("traceEvents")).toArray();
+        // the thread name metadata and both phases
+        QCOMPARE(traceEvents.size(), 3);
+        QCOMPARE(traceEvents[0].toObject().value(QStringLiteral("ph")).toString(), QStringLiteral("M"));
+        const auto inner = traceEvents[1].toObject();
+        QCOMPARE(inner.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+        QCOMPARE(inner.value(QStringLiteral("name")).toString(), QStringLiteral("inner"));
+        QCOMPARE(inner.value(QStringLiteral("dur")).toVariant().toLongLong(), events[0].duration);
+
+        PhaseTrace::clear();
+        QVERIFY(PhaseTrace::events().isEmpty());
+        QVERIFY(PhaseTrace::threads().isEmpty());
+
+        // scopes that were running while the trace got cleared don't end up in the new one
+        PhaseTrace::setEnabled(true);
+        {
+            PHASE_TRACE("cleared");
+            PhaseTrace::clear();
+            PHASE_TRACE("after clear");
+        }
+        PhaseTrace::setEnabled(false);
+        const auto afterClear = PhaseTrace::events();
+        QCOMPARE(afterClear.size(), 1);
+        QCOMPARE(QByteArray(afterClear[0].name), QByteArray("after clear"));
+        QVERIFY(afterClear[0].start >= 0);
+        PhaseTrace::clear();
+    }
+
     void testDisassemblyModel_data()
     {
         QTest::addColumn<Data::Symbol>("symbol");
@@ -303,6 +1312,14 @@ private slots:
         DisassemblyOutput disassemblyOutput = DisassemblyOutput::disassemble("objdump","x86_64", symbol);
         model.setDisassembly(disassemblyOutput);
         QCOMPARE(model.rowCount(), disassemblyOutput.disassemblyLines.size());
+
+        const auto& lines = disassemblyOutput.disassemblyLines;
+        const auto firstInstruction = std::find_if(lines.begin(), lines.end(),
+                                                   [](const DisassemblyOutput::DisassemblyLine& line) { return line.addr; });
+        QVERIFY(firstInstruction != lines.end());
+        const auto firstInstructionRow = static_cast<int>(std::distance(lines.begin(), firstInstruction));
+        QCOMPARE(model.findIndexWithOffset(0).row(), firstInstructionRow);
+        QVERIFY(!model.findIndexWithOffset(-1).isValid());
     }
 
     void testEventModel()
@@ -84,6 +84,51 @@ private slots:
             << data << (rect.width() / 2) << (time.start + time.delta() / 2) << time;
         QTest::newRow("maxTime_zoom_4th_quadrant") << data << rect.width() << time.end << time;
     }
+
+    void testRenderedRow()
+    {
+        auto event = [](quint64 time, qint32 type, qint32 stackId) {
+            Data::Event event;
+            event.time = time;
+            event.type = type;
+            event.stackId = stackId;
+            return event;
+        };
+        // type 1 is not shown, type 2 is the off-CPU time
+        Data::Events events;
+        events << event(10, 0, 1) << event(20, 1, 2) << event(30, 0, -1) << event(40, 2, 3) << event(50, 0, 1);
+        QCOMPARE(highlightableStacks(events, 0, 2), (QSet<qint32> {1, 3}));
+        QCOMPARE(highlightableStacks(events, 0, -1), (QSet<qint32> {1}));
+
+        TimeLineRenderKey key;
+        key.events = events.constData();
+        key.time = {0, 100};
+        key.size = {100, 20};
+
+        TimeLineRenderedRow row;
+        row.key = key;
+        row.events = events;
+        row.stacks = highlightableStacks(events, 0, 2);
+        QVERIFY(row.isUpToDate(key, {}));
+        // hovering stacks of other rows, or ones that aren't drawn, doesn't require a new image
+        QVERIFY(row.isUpToDate(key, {2, 4}));
+        QVERIFY(!row.isUpToDate(key, {1}));
+        QVERIFY(!row.isUpToDate(key, {3, 4}));
+
+        row.hoveredStacks = {1};
+        QVERIFY(row.isUpToDate(key, {1, 4}));
+        QVERIFY(!row.isUpToDate(key, {4}));
+        QVERIFY(!row.isUpToDate(key, {1, 3}));
+
+        // everything else invalidates the whole row
+        auto zoomed = key;
+        zoomed.time = {50, 100};
+        QVERIFY(!row.isUpToDate(zoomed, {1}));
+        auto nextGeneration = key;
+        ++nextGeneration.generation;
+        QVERIFY(!row.isUpToDate(nextGeneration, {1}));
+        QCOMPARE(qHash(key), qHash(TimeLineRenderKey(key)));
+    }
 };
 
 QTEST_GUILESS_MAIN(TestTimeLineDelegate);